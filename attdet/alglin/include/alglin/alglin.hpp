@@ -27,7 +27,13 @@
 #include <cmath>
 #include <cstring>
 #include <initializer_list>
-#include <ostream>
+#include <iterator>
+#include <limits>
+#include <type_traits>
+
+#if !defined(ALGLIN_NO_IOSTREAM)
+#define ALGLIN_NO_IOSTREAM 0
+#endif
 
 #if !defined(ALGLIN_PRECISION)
 // Used in 'operator==' in floating-point comparison
@@ -37,6 +43,15 @@
 #define CONSTEXPR_17
 #define NODISCARD
 #define MAYBE_UNUSED
+// Loops das decomposições: desenrolados por completo até N = 4, acima
+// disso o desenrolamento total aumentou o tempo (attdet-benchmark)
+#if defined(__clang__)
+#define ALGLIN_UNROLL _Pragma("unroll 4")
+#elif defined(__GNUC__) && __GNUC__ >= 8
+#define ALGLIN_UNROLL _Pragma("GCC unroll 4")
+#else
+#define ALGLIN_UNROLL
+#endif
 // Is constexpr if C++17 or higher
 #if __cplusplus >= 201703L
 #undef CONSTEXPR_17
@@ -85,7 +100,18 @@
  *  std::array
  *
  *  std::initializer_list
- *  std::ostream
+ *  std::ostream (só em 'alglin/io.hpp')
+ *  std::conditional
+ *  std::random_access_iterator_tag
+ *
+ *  Tamanho:
+ *   Com ALGLIN_NO_IOSTREAM=1 (perfil ATTDET_MINIMAL) 'alglin/io.hpp' não é
+ *   incluído e nada aqui depende de <ostream>.
+ *
+ *  SIMD:
+ *   Com USE_SIMD=1 (opção ALGLIN_USE_SIMD) as operações de Matrix3/Vec3 usam
+ *   os kernels SSE2/AVX2 de 'alglin/simd.hpp', escolhidos em tempo de
+ *   execução. A API não muda, mas essas operações deixam de ser constexpr.
  ***/
 
 namespace alglin {
@@ -155,24 +181,152 @@ template<typename T, int N, int M> struct GenericMatrix {
 	  const GenericMatrix<T, N, M> &rhs) const {
 		return (*this + (static_cast<T>(-1) * rhs));
 	}
-	constexpr alglin::array<T, M> operator[](int i) const {
+	constexpr const alglin::array<T, M> &operator[](int i) const {
 		return elements[i];
 	}
 	CONSTEXPR_17 alglin::array<T, M> &operator[](int i) { return elements[i]; }
-	constexpr alglin::array<alglin::array<T, M>, N> data() const {
+	constexpr const alglin::array<alglin::array<T, M>, N> &data() const {
 		return elements;
 	}
 };
 
+/**
+ * @brief Visão da linha i de A, sem cópia
+ *
+ * @param A Matrix NxM
+ * @param i linha
+ * @return const alglin::array<T, M>& Referência para a linha
+ */
+template<class T, int N, int M>
+constexpr const alglin::array<T, M> &row(
+  const GenericMatrix<T, N, M> &A, int i) noexcept {
+	return A[i];
+}
+
+/**
+ * @brief ColumnView é uma visão da coluna de uma Matrix NxM, sem cópia.
+ * Guarda apenas um ponteiro para a matriz e o índice da coluna, logo não
+ * deve sobreviver à matriz.
+ */
+template<class T, int N, int M> struct ColumnView {
+	struct iterator {
+		using iterator_category = std::random_access_iterator_tag;
+		using value_type = T;
+		using difference_type = std::ptrdiff_t;
+		using pointer = const T *;
+		using reference = const T &;
+
+		constexpr iterator() = default;
+		// Matriz e coluna, não a view: iteradores de uma view temporária
+		// continuam válidos enquanto a matriz existir
+		constexpr iterator(const GenericMatrix<T, N, M> *m_, int col_, int i_)
+		  : m(m_), col(col_), i(i_) {}
+
+		constexpr reference operator*() const { return (*m)[i][col]; }
+		constexpr pointer operator->() const { return &(*m)[i][col]; }
+		constexpr reference operator[](difference_type n) const {
+			return (*m)[i + static_cast<int>(n)][col];
+		}
+		iterator &operator++() {
+			++i;
+			return *this;
+		}
+		iterator operator++(int) {
+			iterator tmp = *this;
+			++i;
+			return tmp;
+		}
+		iterator &operator--() {
+			--i;
+			return *this;
+		}
+		iterator operator--(int) {
+			iterator tmp = *this;
+			--i;
+			return tmp;
+		}
+		iterator &operator+=(difference_type n) {
+			i += static_cast<int>(n);
+			return *this;
+		}
+		iterator &operator-=(difference_type n) {
+			i -= static_cast<int>(n);
+			return *this;
+		}
+		constexpr friend iterator operator+(iterator a, difference_type n) {
+			return { a.m, a.col, a.i + static_cast<int>(n) };
+		}
+		constexpr friend iterator operator+(difference_type n, iterator a) {
+			return a + n;
+		}
+		constexpr friend iterator operator-(iterator a, difference_type n) {
+			return { a.m, a.col, a.i - static_cast<int>(n) };
+		}
+		constexpr friend difference_type operator-(iterator a, iterator b) {
+			return a.i - b.i;
+		}
+		constexpr friend bool operator==(iterator a, iterator b) {
+			return a.m == b.m && a.col == b.col && a.i == b.i;
+		}
+		constexpr friend bool operator!=(iterator a, iterator b) {
+			return !(a == b);
+		}
+		constexpr friend bool operator<(iterator a, iterator b) {
+			return a.i < b.i;
+		}
+		constexpr friend bool operator>(iterator a, iterator b) {
+			return a.i > b.i;
+		}
+		constexpr friend bool operator<=(iterator a, iterator b) {
+			return a.i <= b.i;
+		}
+		constexpr friend bool operator>=(iterator a, iterator b) {
+			return a.i >= b.i;
+		}
+
+	  private:
+		const GenericMatrix<T, N, M> *m{};
+		int col{};
+		int i{};
+	};
+	using const_iterator = iterator;
+
+	constexpr ColumnView(const GenericMatrix<T, N, M> &A, int j) noexcept
+	  : m(&A), col(j) {}
+
+	constexpr const T &operator[](int i) const { return (*m)[i][col]; }
+	static constexpr int size() { return N; }
+	constexpr iterator begin() const { return { m, col, 0 }; }
+	constexpr iterator end() const { return { m, col, N }; }
+
+  private:
+	const GenericMatrix<T, N, M> *m;
+	int col;
+};
+
+/**
+ * @brief Visão da coluna j de A, sem cópia
+ *
+ * @param A Matrix NxM
+ * @param j coluna
+ * @return ColumnView<T, N, M>
+ */
+template<class T, int N, int M>
+constexpr ColumnView<T, N, M> column(
+  const GenericMatrix<T, N, M> &A, int j) noexcept {
+	return { A, j };
+}
+
 /***
  * GenericMatrix operators
  ***/
 template<class T, int N, int M>
 CONSTEXPR_17 bool operator==(
   const GenericMatrix<T, N, M> &A, const GenericMatrix<T, N, M> &B) {
+	using std::abs;// ou alglin::abs(Fixed) por ADL
 	for (int row = 0; row < N; row++) {
 		for (int col = 0; col < M; col++) {
-			if (std::abs(A[row][col] - B[row][col])
+			if (abs(A[row][col] - B[row][col])
 				> static_cast<T>(ALGLIN_PRECISION)) {
 				return false;
 			}
@@ -225,15 +379,6 @@ constexpr GenericMatrix<T, 3, 3> operator*(
 		  A[2][0] * B[0][2] + A[2][1] * B[1][2] + A[2][2] * B[2][2] } };
 }
 
-template<class T, int N, int M>
-std::ostream &operator<<(std::ostream &sout, const GenericMatrix<T, N, M> &p) {
-	for (int i = 0; i < N; ++i) {
-		for (int j = 0; j < M; j++) { sout << p[i][j] << '\t'; }
-		sout << '\n';
-	}
-	return sout;
-}
-
 /**
  * @brief Calcula o transposto de A
  *
@@ -280,15 +425,112 @@ NODISCARD CONSTEXPR_17 T trace(const GenericMatrix<T, N, M> &A) {
 template<class T, int N> using SquareMatrix = GenericMatrix<T, N, N>;
 
 /**
- * @brief Rejeita o calculo de determinantes de matrizes
- * maiores que 3x3. Não compila.
+ * @brief Decomposição PA = LU com pivotamento parcial.
+ * L (triangular inferior com diagonal unitária) e U são guardadas juntas
+ * em 'LU'. 'perm[i]' é a linha de A que foi para a linha i.
+ */
+template<class T, int N> struct LUDecomposition {
+	SquareMatrix<T, N> LU{};
+	alglin::array<int, N> perm{};
+	int sign{ 1 };
+	bool singular{};
+};
+
+/**
+ * @brief Calcula a decomposição LU de A com pivotamento parcial
  *
- * @param M Matrix
- * @return CONSTEXPR_17 T determinante
+ * @param A Matrix NxN
+ * @return LUDecomposition<T, N> 'singular' se algum pivô for zero
  */
 template<class T, int N>
-NODISCARD CONSTEXPR_17 T det(MAYBE_UNUSED const SquareMatrix<T, N> &) {
-	static_assert(N < 4, "Matrix must be at most 3x3");
+NODISCARD LUDecomposition<T, N> lu(const SquareMatrix<T, N> &A) noexcept {
+	LUDecomposition<T, N> out{};
+	using std::abs;
+	auto &M = out.LU;
+	M = A;
+	ALGLIN_UNROLL
+	for (int i = 0; i < N; ++i) { out.perm[i] = i; }
+	ALGLIN_UNROLL
+	for (int k = 0; k < N; ++k) {
+		int p = k;
+		T max = abs(M[k][k]);
+		for (int i = k + 1; i < N; ++i) {
+			if (abs(M[i][k]) > max) {
+				max = abs(M[i][k]);
+				p = i;
+			}
+		}
+		if (max == static_cast<T>(0)) {
+			out.singular = true;
+			continue;
+		}
+		if (p != k) {
+			using std::swap;
+			swap(M[p], M[k]);
+			swap(out.perm[p], out.perm[k]);
+			out.sign = -out.sign;
+		}
+		const T inv = static_cast<T>(1) / M[k][k];
+		for (int i = k + 1; i < N; ++i) {
+			M[i][k] *= inv;
+			const T l = M[i][k];
+			for (int j = k + 1; j < N; ++j) { M[i][j] -= l * M[k][j]; }
+		}
+	}
+	return out;
+}
+
+/**
+ * @brief Determinante a partir da decomposição LU
+ */
+template<class T, int N>
+NODISCARD T det(const LUDecomposition<T, N> &F) noexcept {
+	if (F.singular) { return static_cast<T>(0); }
+	T d = static_cast<T>(F.sign);
+	ALGLIN_UNROLL
+	for (int i = 0; i < N; ++i) { d *= F.LU[i][i]; }
+	return d;
+}
+
+/**
+ * @brief Inverso a partir da decomposição LU. Resolve A X = I coluna a
+ * coluna. Matriz nula se A for singular, como nos casos 2x2 e 3x3.
+ */
+template<class T, int N>
+NODISCARD SquareMatrix<T, N> inverse(const LUDecomposition<T, N> &F) noexcept {
+	SquareMatrix<T, N> X{};
+	if (F.singular) { return X; }
+	const auto &M = F.LU;
+	for (int col = 0; col < N; ++col) {
+		alglin::array<T, N> x{};
+		// L y = P e_col
+		ALGLIN_UNROLL
+		for (int i = 0; i < N; ++i) {
+			T sum = (F.perm[i] == col) ? static_cast<T>(1) : static_cast<T>(0);
+			for (int j = 0; j < i; ++j) { sum -= M[i][j] * x[j]; }
+			x[i] = sum;
+		}
+		// U x = y
+		ALGLIN_UNROLL
+		for (int i = N - 1; i >= 0; --i) {
+			T sum = x[i];
+			for (int j = i + 1; j < N; ++j) { sum -= M[i][j] * x[j]; }
+			x[i] = sum / M[i][i];
+		}
+		for (int i = 0; i < N; ++i) { X[i][col] = x[i]; }
+	}
+	return X;
+}
+
+/**
+ * @brief Calcula o determinante de matrizes NxN (N > 3) por LU.
+ * 2x2 e 3x3 usam as formas fechadas abaixo.
+ *
+ * @param A Matrix
+ * @return T determinante
+ */
+template<class T, int N> NODISCARD T det(const SquareMatrix<T, N> &A) {
+	return det(lu(A));
 }
 
 /**
@@ -324,16 +566,15 @@ NODISCARD CONSTEXPR_17 SquareMatrix<T, N> transpose(
 }
 
 /**
- * @brief Rejeita o calculo de inversos de matrizes
- * maiores que 3x3. Não compila.
+ * @brief Calcula o inverso de matrizes NxN (N > 3) por LU.
+ * 2x2 e 3x3 usam as formas fechadas abaixo.
  *
  * @param M Matrix
- * @return SquareMatrix<T,N> Matrix Inversa
+ * @return SquareMatrix<T,N> Matrix Inversa, nula se M for singular
  */
 template<class T, int N>
-NODISCARD CONSTEXPR_17 SquareMatrix<T, N> inverse(
-  MAYBE_UNUSED const SquareMatrix<T, N> &) {
-	static_assert(N < 4, "Matrix must be at most 3x3");
+NODISCARD SquareMatrix<T, N> inverse(const SquareMatrix<T, N> &M) noexcept {
+	return inverse(lu(M));
 }
 
 /**
@@ -357,15 +598,30 @@ NODISCARD CONSTEXPR_17 SquareMatrix<T, 2> inverse(
 }
 
 /**
- * @brief Rejeita calculo da matriz adjunta de matrizes
- * maiores que 3x3. Não compila.
+ * @brief Calcula a Matriz Adjunta (dos cofatores) de M, NxN.
+ * Usa o determinante de cada menor, logo também vale para M singular.
  *
- * @return CONSTEXPR_17 SquareMatrix<T, N> Matriz Adjunta
+ * @return SquareMatrix<T, N> Matriz Adjunta
  */
 template<class T, int N>
-NODISCARD CONSTEXPR_17 SquareMatrix<T, N> adjugate(
-  MAYBE_UNUSED const SquareMatrix<T, N> &) {
-	static_assert(N == 3, "Matrix must be 3x3");
+NODISCARD SquareMatrix<T, N> adjugate(const SquareMatrix<T, N> &M) noexcept {
+	static_assert(N > 1, "Matrix must be at least 2x2");
+	SquareMatrix<T, N> out{};
+	SquareMatrix<T, N - 1> m{};
+	for (int i = 0; i < N; ++i) {
+		for (int j = 0; j < N; ++j) {
+			for (int r = 0, u = 0; r < N; ++r) {
+				if (r == i) { continue; }
+				for (int c = 0, v = 0; c < N; ++c) {
+					if (c == j) { continue; }
+					m[u][v++] = M[r][c];
+				}
+				++u;
+			}
+			out[i][j] = ((i + j) % 2) ? -det(m) : det(m);
+		}
+	}
+	return out;
 }
 
 /**
@@ -433,7 +689,8 @@ NODISCARD CONSTEXPR_17 SquareMatrix<T, 3> inverse(
 	const auto d = det(M);
 	if (d == static_cast<T>(0)) { return {}; }
 	const auto a = static_cast<T>(1.) / d;
-	return transpose(fast_adjugate(M)) * a;
+	// transpose(fast_adjugate(M)) == cofactor(M)
+	return cofactor(M) * a;
 }
 
 /**
@@ -455,7 +712,7 @@ template<typename T, int N> struct Vector : public GenericMatrix<T, 1, N> {
 	constexpr operator alglin::array<T, N>() const { return this->elements[0]; }
 
 	constexpr Vector() = default;
-	constexpr T operator[](int i) const { return this->elements[0][i]; }
+	constexpr const T &operator[](int i) const { return this->elements[0][i]; }
 	T &operator[](int i) { return this->elements[0][i]; }
 };
 
@@ -490,6 +747,17 @@ NODISCARD CONSTEXPR_17 SquareMatrix<T, N> outer(
 	}
 	return out;
 }
+namespace detail {
+	/**
+	 * @brief Tipo do acumulador do produto interno: ponto flutuante soma em
+	 * double, outros tipos (alglin::Fixed) somam no próprio tipo
+	 */
+	template<class T> struct accumulator {
+		using type = typename std::
+		  conditional<std::is_floating_point<T>::value, double, T>::type;
+	};
+}// namespace detail
+
 /**
  * @brief Produto Interno de dois vetores de tamanho N
  *
@@ -500,15 +768,27 @@ NODISCARD CONSTEXPR_17 SquareMatrix<T, N> outer(
 template<class T, int N>
 NODISCARD CONSTEXPR_17 T operator*(
   const Vector<T, N> &lhs, const Vector<T, N> &rhs) {
-	double sum{};
+	using acc = typename detail::accumulator<T>::type;
+	acc sum{};
 	for (int i = 0; i < N; ++i) {
-		sum = sum + static_cast<double>(lhs[i] * rhs[i]);
+		sum = sum + static_cast<acc>(lhs[i] * rhs[i]);
 	}
 	return static_cast<T>(sum);
 	// return std::inner_product(lhs[0].begin(), lhs[0].end(),
 	//                           rhs[0].begin(), static_cast<T>(0));
 }
 
+/**
+ * @brief 1/sqrt(x). alglin::Fixed tem o seu próprio overload (ADL)
+ */
+template<class T> inline double inverse_sqrt(const T x) {
+#if USE_FAST_INVSQRT
+	return fast_invsqrt(static_cast<float>(x));
+#else
+	return 1. / std::sqrt(x);
+#endif
+}
+
 /**
  * @brief Normaliza o vetor v
  *
@@ -518,11 +798,7 @@ NODISCARD CONSTEXPR_17 T operator*(
  */
 template<class T, int N>
 NODISCARD Vector<T, N> normalize(const Vector<T, N> &v) {
-#if USE_FAST_INVSQRT
-	const auto n = fast_invsqrt(v * v);
-#else
-	const double n = 1. / std::sqrt(v * v);
-#endif
+	const auto n = inverse_sqrt(v * v);
 	auto out = v;
 	for (int i = 0; i < N; ++i) { out[i] = v[i] * n; }
 	return out;
@@ -546,8 +822,702 @@ template<class T, int N> NODISCARD CONSTEXPR_17 SquareMatrix<T, N> eye() {
 	return out;
 }
 
+/**
+ ____                                _        _
+/ ___| _   _ _ __ ___  _ __ ___   ___| |_ _ __(_) ___
+\___ \| | | | '_ ` _ \| '_ ` _ \ / _ \ __| '__| |/ __|
+ ___) | |_| | | | | | | | | | | |  __/ |_| |  | | (__
+|____/ \__, |_| |_| |_|_| |_| |_|\___|\__|_|  |_|\___|
+       |___/
+**/
+/**
+ * @brief SymmetricMatrix guarda uma matriz simétrica NxN empacotada:
+ * só os N(N+1)/2 elementos da parte triangular superior, linha a linha.
+ * (i, j) e (j, i) são o mesmo elemento.
+ */
+template<class T, int N> struct SymmetricMatrix {
+	static constexpr int size = N * (N + 1) / 2;
+
+  protected:
+	alglin::array<T, size> elements{};
+
+  public:
+	/**
+	 * @brief Posição de (i, j) no armazenamento empacotado
+	 */
+	static constexpr int index(int i, int j) {
+		return (i > j) ? index(j, i) : i * N - i * (i - 1) / 2 + (j - i);
+	}
+
+	constexpr SymmetricMatrix() = default;
+
+	constexpr const T &operator()(int i, int j) const {
+		return elements[index(i, j)];
+	}
+	T &operator()(int i, int j) { return elements[index(i, j)]; }
+
+	constexpr const alglin::array<T, size> &data() const { return elements; }
+	alglin::array<T, size> &data() { return elements; }
+
+	/**
+	 * @brief Matriz cheia NxN equivalente
+	 */
+	CONSTEXPR_17 SquareMatrix<T, N> full() const {
+		SquareMatrix<T, N> out{};
+		for (int i = 0; i < N; ++i) {
+			for (int j = 0; j < N; ++j) { out[i][j] = (*this)(i, j); }
+		}
+		return out;
+	}
+
+	CONSTEXPR_17 SymmetricMatrix<T, N> operator+(
+	  const SymmetricMatrix<T, N> &rhs) const {
+		SymmetricMatrix<T, N> out{};
+		for (int k = 0; k < size; ++k) {
+			out.elements[k] = elements[k] + rhs.elements[k];
+		}
+		return out;
+	}
+	CONSTEXPR_17 SymmetricMatrix<T, N> operator*(const T a) const {
+		SymmetricMatrix<T, N> out{};
+		for (int k = 0; k < size; ++k) { out.elements[k] = a * elements[k]; }
+		return out;
+	}
+};
+
+// Definição necessária em C++11 se 'size' for ODR-used
+template<class T, int N> constexpr int SymmetricMatrix<T, N>::size;
+
+template<class T, int N>
+CONSTEXPR_17 bool operator==(
+  const SymmetricMatrix<T, N> &A, const SymmetricMatrix<T, N> &B) {
+	using std::abs;
+	for (int k = 0; k < SymmetricMatrix<T, N>::size; ++k) {
+		if (abs(A.data()[k] - B.data()[k])
+			> static_cast<T>(ALGLIN_PRECISION)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+template<class T, int N>
+constexpr SymmetricMatrix<T, N> operator*(
+  T a, const SymmetricMatrix<T, N> &S) {
+	return S * a;
+}
+
+/**
+ * @brief Parte triangular superior de A, que deve ser simétrica
+ */
+template<class T, int N>
+NODISCARD CONSTEXPR_17 SymmetricMatrix<T, N> symmetric(
+  const SquareMatrix<T, N> &A) {
+	SymmetricMatrix<T, N> out{};
+	for (int i = 0; i < N; ++i) {
+		for (int j = i; j < N; ++j) { out(i, j) = A[i][j]; }
+	}
+	return out;
+}
+
+/**
+ * @brief Calcula A + A^T direto no formato empacotado (S do QUEST)
+ */
+template<class T, int N>
+NODISCARD CONSTEXPR_17 SymmetricMatrix<T, N> plus_transpose(
+  const SquareMatrix<T, N> &A) {
+	SymmetricMatrix<T, N> out{};
+	for (int i = 0; i < N; ++i) {
+		for (int j = i; j < N; ++j) { out(i, j) = A[i][j] + A[j][i]; }
+	}
+	return out;
+}
+
+template<class T, int N>
+NODISCARD CONSTEXPR_17 T trace(const SymmetricMatrix<T, N> &S) {
+	T sum{};
+	for (int i = 0; i < N; ++i) { sum += S(i, i); }
+	return sum;
+}
+
+/**
+ * @brief Produto S v
+ */
+template<class T, int N>
+NODISCARD CONSTEXPR_17 Vector<T, N> operator*(
+  const SymmetricMatrix<T, N> &S, const Vector<T, N> &v) {
+	Vector<T, N> out{};
+	for (int i = 0; i < N; ++i) {
+		T sum{};
+		for (int j = 0; j < N; ++j) { sum += S(i, j) * v[j]; }
+		out[i] = sum;
+	}
+	return out;
+}
+
+/**
+ * @brief Forma quadrática v^T S v. Usa a simetria: N(N+1)/2 produtos
+ */
+template<class T, int N>
+NODISCARD CONSTEXPR_17 T quadratic_form(
+  const SymmetricMatrix<T, N> &S, const Vector<T, N> &v) {
+	T sum{};
+	for (int i = 0; i < N; ++i) {
+		sum += S(i, i) * v[i] * v[i];
+		for (int j = i + 1; j < N; ++j) {
+			sum += static_cast<T>(2) * S(i, j) * v[i] * v[j];
+		}
+	}
+	return sum;
+}
+
+/**
+ * @brief Produto S * S, que também é simétrico. Só a parte triangular
+ * superior é calculada.
+ */
+template<class T, int N>
+NODISCARD CONSTEXPR_17 SymmetricMatrix<T, N> square(
+  const SymmetricMatrix<T, N> &S) {
+	SymmetricMatrix<T, N> out{};
+	for (int i = 0; i < N; ++i) {
+		for (int j = i; j < N; ++j) {
+			T sum{};
+			for (int k = 0; k < N; ++k) { sum += S(i, k) * S(k, j); }
+			out(i, j) = sum;
+		}
+	}
+	return out;
+}
+
+/**
+ * @brief Produto de duas simétricas, em geral não simétrico
+ */
+template<class T, int N>
+NODISCARD CONSTEXPR_17 SquareMatrix<T, N> operator*(
+  const SymmetricMatrix<T, N> &A, const SymmetricMatrix<T, N> &B) {
+	SquareMatrix<T, N> out{};
+	for (int i = 0; i < N; ++i) {
+		for (int j = 0; j < N; ++j) {
+			T sum{};
+			for (int k = 0; k < N; ++k) { sum += A(i, k) * B(k, j); }
+			out[i][j] = sum;
+		}
+	}
+	return out;
+}
+
+/**
+ * @brief Atualização de posto 1: S += alpha v v^T
+ * (covariâncias e equações normais acumuladas amostra a amostra)
+ */
+template<class T, int N>
+CONSTEXPR_17 void rank1_update(
+  SymmetricMatrix<T, N> &S, const T alpha, const Vector<T, N> &v) {
+	for (int i = 0; i < N; ++i) {
+		const T a = alpha * v[i];
+		for (int j = i; j < N; ++j) { S(i, j) += a * v[j]; }
+	}
+}
+
+/**
+ * @brief Determinante de uma simétrica 3x3: 10 multiplicações em vez de 12
+ */
+template<class T>
+NODISCARD constexpr T det(const SymmetricMatrix<T, 3> &S) {
+	return S(0, 0) * (S(1, 1) * S(2, 2) - S(1, 2) * S(1, 2))
+		   - S(0, 1) * (S(0, 1) * S(2, 2) - S(1, 2) * S(0, 2))
+		   + S(0, 2) * (S(0, 1) * S(1, 2) - S(1, 1) * S(0, 2));
+}
+
+/**
+ * @brief Matriz Adjunta de uma simétrica 3x3, também simétrica: só 6
+ * cofatores
+ */
+template<class T>
+NODISCARD CONSTEXPR_17 SymmetricMatrix<T, 3> adjugate(
+  const SymmetricMatrix<T, 3> &S) {
+	SymmetricMatrix<T, 3> out{};
+	out(0, 0) = S(1, 1) * S(2, 2) - S(1, 2) * S(1, 2);
+	out(0, 1) = S(0, 2) * S(1, 2) - S(0, 1) * S(2, 2);
+	out(0, 2) = S(0, 1) * S(1, 2) - S(0, 2) * S(1, 1);
+	out(1, 1) = S(0, 0) * S(2, 2) - S(0, 2) * S(0, 2);
+	out(1, 2) = S(0, 1) * S(0, 2) - S(0, 0) * S(1, 2);
+	out(2, 2) = S(0, 0) * S(1, 1) - S(0, 1) * S(0, 1);
+	return out;
+}
+
+/**
+ * @brief Inverso de uma simétrica 3x3. Nula se S for singular.
+ */
+template<class T>
+NODISCARD CONSTEXPR_17 SymmetricMatrix<T, 3> inverse(
+  const SymmetricMatrix<T, 3> &S) {
+	const auto A = adjugate(S);
+	const T d = S(0, 0) * A(0, 0) + S(0, 1) * A(0, 1) + S(0, 2) * A(0, 2);
+	if (d == static_cast<T>(0)) { return {}; }
+	return (static_cast<T>(1) / d) * A;
+}
+
+/**
+ ____        _
+/ ___|  ___ | |_   _____
+\___ \ / _ \| \ \ / / _ \
+ ___) | (_) | |\ V /  __/
+|____/ \___/|_| \_/ \___|
+**/
+/**
+ * @brief Resolve A x = b a partir da decomposição LU de A
+ *
+ * @param F lu(A)
+ * @param b Vetor
+ * @return Vector<T, N> x, nulo se A for singular
+ */
+template<class T, int N>
+NODISCARD Vector<T, N> solve(
+  const LUDecomposition<T, N> &F, const Vector<T, N> &b) noexcept {
+	Vector<T, N> x{};
+	if (F.singular) { return x; }
+	const auto &M = F.LU;
+	ALGLIN_UNROLL
+	for (int i = 0; i < N; ++i) {
+		T sum = b[F.perm[i]];
+		for (int j = 0; j < i; ++j) { sum -= M[i][j] * x[j]; }
+		x[i] = sum;
+	}
+	ALGLIN_UNROLL
+	for (int i = N - 1; i >= 0; --i) {
+		T sum = x[i];
+		for (int j = i + 1; j < N; ++j) { sum -= M[i][j] * x[j]; }
+		x[i] = sum / M[i][i];
+	}
+	return x;
+}
+
+/**
+ * @brief Resolve A x = b (A NxN qualquer) por LU com pivotamento parcial
+ */
+template<class T, int N>
+NODISCARD Vector<T, N> solve(
+  const SquareMatrix<T, N> &A, const Vector<T, N> &b) noexcept {
+	return solve(lu(A), b);
+}
+
+/**
+ * @brief Decomposição de Cholesky A = L L^T de uma matriz simétrica
+ * positiva definida. Só a parte triangular inferior de A é lida.
+ * 'ok' é falso se A não for positiva definida.
+ */
+template<class T, int N> struct CholeskyDecomposition {
+	SquareMatrix<T, N> L{};
+	bool ok{};
+};
+
+template<class T, int N>
+NODISCARD CholeskyDecomposition<T, N> cholesky(
+  const SquareMatrix<T, N> &A) noexcept {
+	CholeskyDecomposition<T, N> out{};
+	auto &L = out.L;
+	ALGLIN_UNROLL
+	for (int j = 0; j < N; ++j) {
+		T d = A[j][j];
+		for (int k = 0; k < j; ++k) { d -= L[j][k] * L[j][k]; }
+		if (!(d > static_cast<T>(0))) { return out; }
+		using std::sqrt;
+		L[j][j] = sqrt(d);
+		const T inv = static_cast<T>(1) / L[j][j];
+		for (int i = j + 1; i < N; ++i) {
+			T sum = A[i][j];
+			for (int k = 0; k < j; ++k) { sum -= L[i][k] * L[j][k]; }
+			L[i][j] = sum * inv;
+		}
+	}
+	out.ok = true;
+	return out;
+}
+
+/**
+ * @brief Resolve A x = b a partir de cholesky(A)
+ *
+ * @return Vector<T, N> x, nulo se a decomposição falhou
+ */
+template<class T, int N>
+NODISCARD Vector<T, N> solve(
+  const CholeskyDecomposition<T, N> &F, const Vector<T, N> &b) noexcept {
+	Vector<T, N> x{};
+	if (!F.ok) { return x; }
+	const auto &L = F.L;
+	ALGLIN_UNROLL
+	for (int i = 0; i < N; ++i) {
+		T sum = b[i];
+		for (int k = 0; k < i; ++k) { sum -= L[i][k] * x[k]; }
+		x[i] = sum / L[i][i];
+	}
+	ALGLIN_UNROLL
+	for (int i = N - 1; i >= 0; --i) {
+		T sum = x[i];
+		for (int k = i + 1; k < N; ++k) { sum -= L[k][i] * x[k]; }
+		x[i] = sum / L[i][i];
+	}
+	return x;
+}
+
+/**
+ * @brief Inverso a partir de cholesky(A). Matriz nula se a decomposição
+ * falhou.
+ */
+template<class T, int N>
+NODISCARD SquareMatrix<T, N> inverse(
+  const CholeskyDecomposition<T, N> &F) noexcept {
+	SquareMatrix<T, N> X{};
+	if (!F.ok) { return X; }
+	for (int col = 0; col < N; ++col) {
+		Vector<T, N> e{};
+		e[col] = static_cast<T>(1);
+		const auto x = solve(F, e);
+		// A^-1 é simétrica
+		for (int i = 0; i < N; ++i) { X[i][col] = x[i]; }
+	}
+	return X;
+}
+
+/**
+ * @brief Decomposição A = L D L^T (L com diagonal unitária) de uma matriz
+ * simétrica. Não precisa de raiz e aceita matrizes indefinidas, mas não
+ * pivota: 'ok' é falso se algum D[k] for zero.
+ */
+template<class T, int N> struct LDLTDecomposition {
+	SquareMatrix<T, N> L{};
+	Vector<T, N> D{};
+	bool ok{};
+};
+
+template<class T, int N>
+NODISCARD LDLTDecomposition<T, N> ldlt(const SquareMatrix<T, N> &A) noexcept {
+	LDLTDecomposition<T, N> out{};
+	auto &L = out.L;
+	auto &D = out.D;
+	ALGLIN_UNROLL
+	for (int j = 0; j < N; ++j) {
+		T d = A[j][j];
+		for (int k = 0; k < j; ++k) { d -= L[j][k] * L[j][k] * D[k]; }
+		if (d == static_cast<T>(0)) { return out; }
+		D[j] = d;
+		L[j][j] = static_cast<T>(1);
+		const T inv = static_cast<T>(1) / d;
+		for (int i = j + 1; i < N; ++i) {
+			T sum = A[i][j];
+			for (int k = 0; k < j; ++k) { sum -= L[i][k] * L[j][k] * D[k]; }
+			L[i][j] = sum * inv;
+		}
+	}
+	out.ok = true;
+	return out;
+}
+
+/**
+ * @brief Resolve A x = b a partir de ldlt(A)
+ *
+ * @return Vector<T, N> x, nulo se a decomposição falhou
+ */
+template<class T, int N>
+NODISCARD Vector<T, N> solve(
+  const LDLTDecomposition<T, N> &F, const Vector<T, N> &b) noexcept {
+	Vector<T, N> x{};
+	if (!F.ok) { return x; }
+	const auto &L = F.L;
+	ALGLIN_UNROLL
+	for (int i = 0; i < N; ++i) {
+		T sum = b[i];
+		for (int k = 0; k < i; ++k) { sum -= L[i][k] * x[k]; }
+		x[i] = sum;
+	}
+	ALGLIN_UNROLL
+	for (int i = 0; i < N; ++i) { x[i] /= F.D[i]; }
+	ALGLIN_UNROLL
+	for (int i = N - 1; i >= 0; --i) {
+		T sum = x[i];
+		for (int k = i + 1; k < N; ++k) { sum -= L[k][i] * x[k]; }
+		x[i] = sum;
+	}
+	return x;
+}
+
+/**
+ _____ _
+| ____(_) __ _  ___ _ __
+|  _| | |/ _` |/ _ \ '_ \
+| |___| | (_| |  __/ | | |
+|_____|_|\__, |\___|_| |_|
+         |___/
+**/
+/**
+ * @brief Autovalores e autovetores de uma matriz simétrica.
+ * 'vectors[i][k]' é a componente i do autovetor k (autovetores nas colunas),
+ * associado a 'values[k]'. Os autovalores não são ordenados.
+ */
+template<class T, int N> struct EigenDecomposition {
+	Vector<T, N> values{};
+	SquareMatrix<T, N> vectors{};
+};
+
+namespace detail {
+	/**
+	 * @brief Rotação de Jacobi que zera A[p][q] (Numerical Recipes 11.1).
+	 * Retorna t = tan(theta), c e s por referência.
+	 */
+	template<class T>
+	inline T jacobi_rotation(T app, T aqq, T apq, T &c, T &s) noexcept {
+		if (apq == static_cast<T>(0)) {
+			c = static_cast<T>(1);
+			s = static_cast<T>(0);
+			return static_cast<T>(0);
+		}
+		const T theta = (aqq - app) / (static_cast<T>(2) * apq);
+		const T t = std::copysign(static_cast<T>(1), theta)
+					/ (std::abs(theta) + std::sqrt(theta * theta + static_cast<T>(1)));
+		c = static_cast<T>(1) / std::sqrt(t * t + static_cast<T>(1));
+		s = t * c;
+		return t;
+	}
+}// namespace detail
+
+/**
+ * @brief Decomposição de uma matriz simétrica por Jacobi cíclico.
+ * Converge quadraticamente, para 4x4 bastam ~5 varreduras.
+ *
+ * @param A Matrix simétrica NxN (só a parte triangular superior é lida)
+ * @param max_sweeps Número máximo de varreduras
+ * @return EigenDecomposition<T, N>
+ */
+template<class T, int N>
+NODISCARD EigenDecomposition<T, N> eigen_symmetric(
+  const SquareMatrix<T, N> &A, int max_sweeps = 10) noexcept {
+	SquareMatrix<T, N> a = A;
+	for (int i = 0; i < N; ++i) {
+		for (int j = 0; j < i; ++j) { a[i][j] = a[j][i]; }
+	}
+	EigenDecomposition<T, N> out{};
+	auto &V = out.vectors;
+	V = eye<T, N>();
+	for (int sweep = 0; sweep < max_sweeps; ++sweep) {
+		T off{};
+		T diag{};
+		for (int p = 0; p < N; ++p) {
+			diag += a[p][p] * a[p][p];
+			for (int q = p + 1; q < N; ++q) { off += a[p][q] * a[p][q]; }
+		}
+		if (off <= std::numeric_limits<T>::epsilon()
+					* std::numeric_limits<T>::epsilon() * diag) {
+			break;
+		}
+		ALGLIN_UNROLL
+		for (int p = 0; p < N - 1; ++p) {
+			ALGLIN_UNROLL
+			for (int q = p + 1; q < N; ++q) {
+				T c, s;
+				const T t = detail::jacobi_rotation(a[p][p], a[q][q], a[p][q], c, s);
+				if (t == static_cast<T>(0)) { continue; }
+				const T apq = a[p][q];
+				a[p][p] -= t * apq;
+				a[q][q] += t * apq;
+				a[p][q] = a[q][p] = static_cast<T>(0);
+				for (int r = 0; r < N; ++r) {
+					if (r != p && r != q) {
+						const T arp = a[r][p];
+						const T arq = a[r][q];
+						a[r][p] = a[p][r] = c * arp - s * arq;
+						a[r][q] = a[q][r] = s * arp + c * arq;
+					}
+					const T vrp = V[r][p];
+					const T vrq = V[r][q];
+					V[r][p] = c * vrp - s * vrq;
+					V[r][q] = s * vrp + c * vrq;
+				}
+			}
+		}
+	}
+	for (int i = 0; i < N; ++i) { out.values[i] = a[i][i]; }
+	return out;
+}
+
+/**
+ * @brief Maior autovalor de uma matriz simétrica e seu autovetor (unitário)
+ */
+template<class T, int N> struct EigenPair {
+	T value{};
+	Vector<T, N> vector{};
+};
+
+/**
+ * @brief Caminho rápido para o maior autopar de uma matriz simétrica.
+ * Iteração inversa com deslocamento fixo 'shift' >= maior autovalor, que
+ * converge para o autovalor mais próximo dele. Com um bom limitante (para
+ * a matriz K de Davenport a soma dos pesos) 2 ou 3 iterações bastam.
+ *
+ * @param A Matrix simétrica NxN
+ * @param shift Limitante superior do maior autovalor
+ * @param iterations Número de iterações
+ * @return EigenPair<T, N> 'value' é o quociente de Rayleigh
+ */
+template<class T, int N>
+NODISCARD EigenPair<T, N> dominant_eigen(
+  const SquareMatrix<T, N> &A, T shift, int iterations = 3) noexcept {
+	auto M = A;
+	// Se shift é exatamente um autovalor (A - shift I) é singular
+	LUDecomposition<T, N> F{};
+	for (int k = 0; k < 4; ++k) {
+		for (int i = 0; i < N; ++i) { M[i][i] = A[i][i] - shift; }
+		F = lu(M);
+		if (!F.singular) { break; }
+		shift += (std::abs(shift) + static_cast<T>(1))
+				 * std::numeric_limits<T>::epsilon() * static_cast<T>(16);
+	}
+
+	EigenPair<T, N> out{};
+	// Chute inicial sem simetrias, para não ser ortogonal ao autovetor
+	Vector<T, N> x{};
+	for (int i = 0; i < N; ++i) { x[i] = static_cast<T>(1) / (i + 1); }
+	for (int k = 0; k < iterations; ++k) {
+		x = solve(F, x);
+		x = static_cast<T>(1) / std::sqrt(x * x) * x;
+	}
+	out.vector = x;
+	out.value = x * (A * x);
+	return out;
+}
+
+/**
+ * @brief Maior autopar de uma matriz simétrica por Jacobi completo.
+ * Não precisa de limitante, mas custa uma decomposição inteira.
+ */
+template<class T, int N>
+NODISCARD EigenPair<T, N> dominant_eigen(const SquareMatrix<T, N> &A) noexcept {
+	const auto E = eigen_symmetric(A);
+	int k = 0;
+	for (int i = 1; i < N; ++i) {
+		if (E.values[i] > E.values[k]) { k = i; }
+	}
+	EigenPair<T, N> out{};
+	out.value = E.values[k];
+	for (int i = 0; i < N; ++i) { out.vector[i] = E.vectors[i][k]; }
+	return out;
+}
+
+/**
+ * @brief Lote de B matrizes simétricas NxN em Structure of Arrays.
+ * 'a[i][j][l]' é o elemento (i, j) da matriz l, então cada operação de
+ * Jacobi percorre os B lanes de forma contígua e vetoriza.
+ */
+template<class T, int N, int B> struct SymmetricBatch {
+	alglin::array<alglin::array<alglin::array<T, B>, N>, N> a{};
+
+	void set(int l, const SquareMatrix<T, N> &A) noexcept {
+		for (int i = 0; i < N; ++i) {
+			for (int j = 0; j < N; ++j) { a[i][j][l] = A[i][j]; }
+		}
+	}
+};
+
+/**
+ * @brief Resultado do lote: maior autopar de cada matriz
+ */
+template<class T, int N, int B> struct EigenPairBatch {
+	alglin::array<T, B> value{};
+	alglin::array<alglin::array<T, B>, N> vector{};
+
+	EigenPair<T, N> get(int l) const noexcept {
+		EigenPair<T, N> out{};
+		out.value = value[l];
+		for (int i = 0; i < N; ++i) { out.vector[i] = vector[i][l]; }
+		return out;
+	}
+};
+
+/**
+ * @brief Maior autopar de B matrizes simétricas de uma vez (SoA).
+ * Jacobi cíclico com número fixo de varreduras e sem desvios por lane.
+ *
+ * @param in Lote de matrizes (só a parte triangular superior é lida)
+ * @param sweeps Número de varreduras
+ * @return EigenPairBatch<T, N, B>
+ */
+template<class T, int N, int B>
+NODISCARD EigenPairBatch<T, N, B> dominant_eigen(
+  const SymmetricBatch<T, N, B> &in, int sweeps = 6) noexcept {
+	auto a = in.a;
+	alglin::array<alglin::array<alglin::array<T, B>, N>, N> V{};
+	for (int i = 0; i < N; ++i) {
+		for (int l = 0; l < B; ++l) { V[i][i][l] = static_cast<T>(1); }
+	}
+	for (int sweep = 0; sweep < sweeps; ++sweep) {
+		for (int p = 0; p < N - 1; ++p) {
+			for (int q = p + 1; q < N; ++q) {
+				alglin::array<T, B> c, s, t;
+				// Mesma rotação de detail::jacobi_rotation, sem desvios
+				for (int l = 0; l < B; ++l) {
+					const T apq = a[p][q][l];
+					const bool zero = (apq == static_cast<T>(0));
+					const T theta = (a[q][q][l] - a[p][p][l])
+									/ (zero ? static_cast<T>(1) : static_cast<T>(2) * apq);
+					const T tl = std::copysign(static_cast<T>(1), theta)
+								 / (std::abs(theta)
+									+ std::sqrt(theta * theta + static_cast<T>(1)));
+					t[l] = zero ? static_cast<T>(0) : tl;
+					c[l] = static_cast<T>(1) / std::sqrt(t[l] * t[l] + static_cast<T>(1));
+					s[l] = t[l] * c[l];
+				}
+				for (int l = 0; l < B; ++l) {
+					const T apq = a[p][q][l];
+					a[p][p][l] -= t[l] * apq;
+					a[q][q][l] += t[l] * apq;
+					a[p][q][l] = static_cast<T>(0);
+				}
+				for (int r = 0; r < N; ++r) {
+					if (r != p && r != q) {
+						// Só a parte triangular superior é mantida
+						auto &arp = (r < p) ? a[r][p] : a[p][r];
+						auto &arq = (r < q) ? a[r][q] : a[q][r];
+						for (int l = 0; l < B; ++l) {
+							const T x = arp[l];
+							const T y = arq[l];
+							arp[l] = c[l] * x - s[l] * y;
+							arq[l] = s[l] * x + c[l] * y;
+						}
+					}
+					auto &vrp = V[r][p];
+					auto &vrq = V[r][q];
+					for (int l = 0; l < B; ++l) {
+						const T x = vrp[l];
+						const T y = vrq[l];
+						vrp[l] = c[l] * x - s[l] * y;
+						vrq[l] = s[l] * x + c[l] * y;
+					}
+				}
+			}
+		}
+	}
+	EigenPairBatch<T, N, B> out{};
+	for (int l = 0; l < B; ++l) {
+		int k = 0;
+		for (int i = 1; i < N; ++i) {
+			if (a[i][i][l] > a[k][k][l]) { k = i; }
+		}
+		out.value[l] = a[k][k][l];
+		for (int i = 0; i < N; ++i) { out.vector[i][l] = V[i][k][l]; }
+	}
+	return out;
+}
+
 }// namespace alglin
 
+#if ALGLIN_SIMD
+#include <alglin/simd.hpp>
+#endif
+
+#if !ALGLIN_NO_IOSTREAM
+#include <alglin/io.hpp>
+#endif
+
 /***
  * Helpers para tipos comuns
  ***/
@@ -557,7 +1527,10 @@ using Vec3 = alglin::Vector<double, 3>;
 using Quat = alglin::Vector<double, 4>;
 // Matrix 3x3
 using Matrix3 = alglin::SquareMatrix<double, 3>;
+// Matrix 4x4 (K de Davenport)
+using Matrix4 = alglin::SquareMatrix<double, 4>;
 #undef CONSTEXPR_17
 #undef NODISCARD
 #undef MAYBE_UNUSED
+#undef ALGLIN_UNROLL
 #endif
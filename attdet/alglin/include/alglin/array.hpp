@@ -1,55 +1,77 @@
 #ifndef ARRAY_HPP
 #define ARRAY_HPP
 
+#include <cstddef>
+
 #if __cplusplus >= 201703L
 #define CONSTEXPR_17 constexpr
 #else
 #define CONSTEXPR_17
 #endif
 
+// Backend SIMD só existe em x86 com GCC/Clang (ver alglin/simd.hpp)
+#if !defined(ALGLIN_SIMD)
+#if USE_SIMD && (defined(__x86_64__) || defined(__i386__)) \
+  && defined(__GNUC__)
+#define ALGLIN_SIMD 1
+#else
+#define ALGLIN_SIMD 0
+#endif
+#endif// ALGLIN_SIMD
+
 
 namespace alglin {
-template<class Type, int N> class array {
-
-	struct iterator {
-		/* not "real" iterator */
-		// using iterator_category = std::forward_iterator_tag;
-
-		constexpr iterator(Type *ptr) : m_ptr(ptr) {}
-
-		constexpr Type &operator*() const { return *m_ptr; }
-		Type *operator->() { return m_ptr; }
-		iterator &operator++() {
-			m_ptr++;
-			return *this;
-		}
-		iterator operator++(int) {
-			iterator tmp = *this;
-			++(*this);
-			return tmp;
-		}
-		constexpr friend bool operator==(const iterator &a, const iterator &b) {
-			return a.m_ptr == b.m_ptr;
-		};
-		constexpr friend bool operator!=(const iterator &a, const iterator &b) {
-			return a.m_ptr != b.m_ptr;
-		}
-
-	  private:
-		Type *m_ptr;
+namespace detail {
+	/**
+	 * @brief Layout de armazenamento de alglin::array<Type, N>.
+	 * Com o backend SIMD vetores de 3 doubles são guardados em 4 lanes
+	 * alinhados (a quarta é sempre zero) para serem carregados inteiros.
+	 */
+	template<class Type, int N> struct storage {
+		static constexpr int size = N;
+		static constexpr int align = alignof(Type);
 	};
+#if ALGLIN_SIMD
+	template<> struct storage<double, 3> {
+		static constexpr int size = 4;
+		static constexpr int align = 32;
+	};
+#endif
+}// namespace detail
+
+/**
+ * @brief Array de tamanho fixo. Os iteradores são ponteiros, logo
+ * random access e compatíveis com <algorithm> e range-for.
+ */
+template<class Type, int N> class array {
+  public:
+	using value_type = Type;
+	using reference = Type &;
+	using const_reference = const Type &;
+	using iterator = Type *;
+	using const_iterator = const Type *;
+	using size_type = std::size_t;
+	using difference_type = std::ptrdiff_t;
 
   private:
-	Type elem[N];
+	alignas(detail::storage<Type, N>::align) Type
+	  elem[detail::storage<Type, N>::size];
 
   public:
 	constexpr array() = default;
 	array(Type from[]) : elem{ from } {}
-	constexpr Type operator[](int i) const { return elem[i]; }
+	constexpr const Type &operator[](int i) const { return elem[i]; }
 	Type &operator[](int i) { return elem[i]; }
 	Type *data() { return elem; }
-	iterator begin() { return iterator(&elem[0]); }
-	iterator end() { return iterator(&elem[N]); }// one pass the end
+	constexpr const Type *data() const { return elem; }
+	static constexpr int size() { return N; }
+
+	iterator begin() { return &elem[0]; }
+	iterator end() { return &elem[N]; }// one pass the end
+	constexpr const_iterator begin() const { return &elem[0]; }
+	constexpr const_iterator end() const { return &elem[N]; }
+	constexpr const_iterator cbegin() const { return &elem[0]; }
+	constexpr const_iterator cend() const { return &elem[N]; }
 };
 }// namespace alglin
 #undef CONSTEXPR_17
@@ -0,0 +1,209 @@
+#ifndef ALGLIN_FIXED_HPP
+#define ALGLIN_FIXED_HPP
+
+/***
+ * @file fixed.hpp
+ * @brief Escalar de ponto fixo (formato Q) para alvos sem FPU
+ *
+ *? alglin::Fixed<F> é um inteiro de 32 bits com F bits fracionários
+ *? (Q(31-F).F). Toda a aritmética é inteira e satura em vez de estourar,
+ *? então pode ser usado como T em GenericMatrix/Vector/SymmetricMatrix:
+ *?
+ *?   alglin::Vector<alglin::Q16_16, 3> v{ ... };
+ *?
+ *? Resolução e faixa:
+ *?   Q16_16 (F = 16): 1.5e-5, [-32768, 32768)
+ *?   Q2_30  (F = 30): 9.3e-10, [-2, 2)  -> vetores e quatérnios unitários
+ *?
+ *? sqrt, reciprocal e inverse_sqrt também são inteiras (bit a bit).
+ *? Construir a partir de double é explícito: só para constantes e testes.
+ ***/
+
+#include <alglin/alglin.hpp>
+#include <algorithm>
+#include <cstdint>
+
+namespace alglin {
+
+template<int F> struct Fixed {
+	static_assert(F > 0 && F < 31, "Fixed<F> needs 0 < F < 31");
+	using rep = std::int32_t;
+	using wide = std::int64_t;
+
+	static constexpr wide one = wide(1) << F;
+	static constexpr wide max = INT32_MAX;
+	static constexpr wide min = INT32_MIN;
+
+	rep raw{};
+
+	static constexpr rep saturate(wide x) {
+		return static_cast<rep>(x > max ? max : (x < min ? min : x));
+	}
+	static constexpr rep saturate(double x) {
+		return static_cast<rep>(x >= static_cast<double>(max)
+								  ? max
+								  : (x <= static_cast<double>(min)
+										? min
+										: static_cast<wide>(x >= 0 ? x + .5 : x - .5)));
+	}
+	static constexpr Fixed from_raw(rep r) { return Fixed(r, raw_tag{}); }
+
+	constexpr Fixed() = default;
+	constexpr Fixed(int x) : raw(saturate(static_cast<wide>(x) * one)) {}
+	constexpr explicit Fixed(double x)
+	  : raw(saturate(x * static_cast<double>(one))) {}
+	constexpr explicit operator double() const {
+		return static_cast<double>(raw) / static_cast<double>(one);
+	}
+
+	Fixed &operator+=(Fixed b) { return *this = *this + b; }
+	Fixed &operator-=(Fixed b) { return *this = *this - b; }
+	Fixed &operator*=(Fixed b) { return *this = *this * b; }
+	Fixed &operator/=(Fixed b) { return *this = *this / b; }
+
+	constexpr Fixed operator-() const {
+		return from_raw(saturate(-static_cast<wide>(raw)));
+	}
+	friend constexpr Fixed operator+(Fixed a, Fixed b) {
+		return from_raw(saturate(static_cast<wide>(a.raw) + b.raw));
+	}
+	friend constexpr Fixed operator-(Fixed a, Fixed b) {
+		return from_raw(saturate(static_cast<wide>(a.raw) - b.raw));
+	}
+	// Arredonda para o mais próximo
+	friend constexpr Fixed operator*(Fixed a, Fixed b) {
+		return from_raw(
+		  saturate((static_cast<wide>(a.raw) * b.raw + (one >> 1)) >> F));
+	}
+	// Divisão por zero satura com o sinal do numerador
+	friend constexpr Fixed operator/(Fixed a, Fixed b) {
+		return (b.raw == 0)
+				 ? from_raw(a.raw < 0 ? static_cast<rep>(min) : static_cast<rep>(max))
+				 : from_raw(saturate(div_round(static_cast<wide>(a.raw) * one, b.raw)));
+	}
+
+	friend constexpr bool operator==(Fixed a, Fixed b) { return a.raw == b.raw; }
+	friend constexpr bool operator!=(Fixed a, Fixed b) { return a.raw != b.raw; }
+	friend constexpr bool operator<(Fixed a, Fixed b) { return a.raw < b.raw; }
+	friend constexpr bool operator>(Fixed a, Fixed b) { return a.raw > b.raw; }
+	friend constexpr bool operator<=(Fixed a, Fixed b) { return a.raw <= b.raw; }
+	friend constexpr bool operator>=(Fixed a, Fixed b) { return a.raw >= b.raw; }
+
+  private:
+	struct raw_tag {};
+	constexpr Fixed(rep r, raw_tag) : raw(r) {}
+	static constexpr wide div_round(wide n, wide d) {
+		return ((n < 0) == (d < 0)) ? (n + d / 2) / d : (n - d / 2) / d;
+	}
+};
+
+template<int F> constexpr typename Fixed<F>::wide Fixed<F>::one;
+template<int F> constexpr typename Fixed<F>::wide Fixed<F>::max;
+template<int F> constexpr typename Fixed<F>::wide Fixed<F>::min;
+
+using Q16_16 = Fixed<16>;
+using Q2_30 = Fixed<30>;
+
+/**
+ * @brief Converte entre formatos Q, saturando
+ */
+template<int G, int F> constexpr Fixed<G> fixed_cast(Fixed<F> x) {
+	return Fixed<G>::from_raw((G >= F) ? Fixed<G>::saturate(
+								static_cast<std::int64_t>(x.raw) * (std::int64_t(1) << (G - F)))
+									   : static_cast<std::int32_t>(
+										 x.raw / (std::int64_t(1) << (F - G))));
+}
+
+/**
+ * @brief a / b com o resultado em outro formato Q (ex.: Q16.16 / Q16.16 ->
+ * Q2.30), sem perder os bits fracionários do quociente
+ */
+template<int G, int F> constexpr Fixed<G> fixed_ratio(Fixed<F> a, Fixed<F> b) {
+	return (b.raw == 0) ? Fixed<G>::from_raw(a.raw < 0 ? INT32_MIN : INT32_MAX)
+						: Fixed<G>::from_raw(Fixed<G>::saturate(
+						  static_cast<std::int64_t>(a.raw) * (std::int64_t(1) << G) / b.raw));
+}
+
+#if !ALGLIN_NO_IOSTREAM
+template<int F>
+std::ostream &operator<<(std::ostream &sout, const Fixed<F> x) {
+	return sout << static_cast<double>(x);
+}
+#endif
+
+template<int F> constexpr Fixed<F> abs(Fixed<F> x) { return x.raw < 0 ? -x : x; }
+
+namespace detail {
+	// Raiz quadrada inteira, bit a bit (sem FPU)
+	inline std::uint64_t isqrt(std::uint64_t n) {
+		std::uint64_t res = 0;
+		std::uint64_t bit = std::uint64_t(1) << 62;
+		while (bit > n) { bit >>= 2; }
+		while (bit != 0) {
+			if (n >= res + bit) {
+				n -= res + bit;
+				res = (res >> 1) + bit;
+			} else {
+				res >>= 1;
+			}
+			bit >>= 2;
+		}
+		return res;
+	}
+}// namespace detail
+
+/**
+ * @brief Raiz quadrada. Negativos dão zero.
+ */
+template<int F> inline Fixed<F> sqrt(Fixed<F> x) {
+	if (x.raw <= 0) { return {}; }
+	// sqrt(raw / 2^F) * 2^F = sqrt(raw * 2^F)
+	const auto r = detail::isqrt(static_cast<std::uint64_t>(x.raw) << F);
+	return Fixed<F>::from_raw(Fixed<F>::saturate(static_cast<std::int64_t>(r)));
+}
+
+template<int F> constexpr Fixed<F> reciprocal(Fixed<F> x) {
+	return Fixed<F>(1) / x;
+}
+
+/**
+ * @brief 1/sqrt(x), usado por alglin::normalize
+ */
+template<int F> inline Fixed<F> inverse_sqrt(Fixed<F> x) {
+	return reciprocal(sqrt(x));
+}
+
+/**
+ * @brief Normaliza v e devolve o resultado em outro formato Q (ex.: Q8.24 ->
+ * Q2.30). A norma é acumulada em 64 bits sobre os valores brutos, então
+ * mesmo vetores pequenos saem unitários até a resolução de Fixed<G>.
+ */
+template<int G, int F, int N>
+Vector<Fixed<G>, N> fixed_normalize(const Vector<Fixed<F>, N> &v) {
+	static_assert(N <= 4, "fixed_normalize supports up to 4 components");
+	std::int64_t big = 0;
+	for (int i = 0; i < N; ++i) {
+		const std::int64_t r = v[i].raw;
+		big = std::max(big, r < 0 ? -r : r);
+	}
+	// |raw| < 2^30 mantém a soma de até 4 quadrados em 62 bits
+	int shift = 0;
+	while ((big >> shift) >= (std::int64_t(1) << 30)) { ++shift; }
+
+	std::uint64_t sum = 0;
+	for (int i = 0; i < N; ++i) {
+		const std::int64_t r = v[i].raw >> shift;
+		sum += static_cast<std::uint64_t>(r * r);
+	}
+	const auto norm = static_cast<std::int64_t>(detail::isqrt(sum));
+	Vector<Fixed<G>, N> out{};
+	if (norm == 0) { return out; }
+	for (int i = 0; i < N; ++i) {
+		const std::int64_t r = v[i].raw >> shift;
+		out[i] = Fixed<G>::from_raw(Fixed<G>::saturate(r * (std::int64_t(1) << G) / norm));
+	}
+	return out;
+}
+
+}// namespace alglin
+#endif// ALGLIN_FIXED_HPP
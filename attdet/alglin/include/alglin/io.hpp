@@ -0,0 +1,28 @@
+#ifndef ALGLIN_IO_HPP
+#define ALGLIN_IO_HPP
+
+/***
+ * @file io.hpp
+ * @brief Impressão de matrizes e vetores em std::ostream
+ *
+ *? Separado de alglin.hpp para que alvos sem iostream (perfil
+ *? ATTDET_MINIMAL, ALGLIN_NO_IOSTREAM=1) não paguem por <ostream>.
+ *? alglin.hpp inclui este arquivo por padrão.
+ ***/
+
+#include <alglin/alglin.hpp>
+#include <ostream>
+
+namespace alglin {
+
+template<class T, int N, int M>
+std::ostream &operator<<(std::ostream &sout, const GenericMatrix<T, N, M> &p) {
+	for (int i = 0; i < N; ++i) {
+		for (int j = 0; j < M; j++) { sout << p[i][j] << '\t'; }
+		sout << '\n';
+	}
+	return sout;
+}
+
+}// namespace alglin
+#endif// ALGLIN_IO_HPP
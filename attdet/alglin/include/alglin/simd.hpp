@@ -0,0 +1,417 @@
+#ifndef ALGLIN_SIMD_HPP
+#define ALGLIN_SIMD_HPP
+
+/***
+ * @file simd.hpp
+ * @brief Kernels SSE2/AVX2 para Matrix3 e Vec3 (double)
+ *
+ *? Com USE_SIMD=1 (opção ALGLIN_USE_SIMD no CMake) alglin::array<double, 3>
+ *? guarda 4 lanes alinhados em 32 bytes, logo uma Matrix3 são 12 doubles
+ *? contíguos com stride 4 e um Vec3 é uma única linha [x y z 0].
+ *?
+ *? O backend é escolhido em tempo de execução (cpuid) na primeira chamada:
+ *?  AVX2+FMA -> SSE2 -> Scalar
+ *? 'force_backend' existe para que os testes rodem todos os backends.
+ *?
+ *? Os overloads no fim do arquivo não são templates, então têm prioridade
+ *? sobre as versões genéricas de alglin.hpp para T = double e N = 3.
+ ***/
+
+#include <immintrin.h>
+
+namespace alglin {
+namespace simd {
+
+enum class Backend { Scalar, SSE2, AVX2 };
+
+namespace detail {
+	constexpr int stride = 4;
+
+	struct Kernels {
+		Backend backend;
+		void (*mul)(const double *A, const double *B, double *out);
+		void (*outer)(const double *u, const double *v, double *out);
+		void (*cross)(const double *u, const double *v, double *out);
+		double (*det)(const double *A);
+		void (*adjugate)(const double *A, double *out);
+		// Retorna o determinante, out fica zerado se for singular
+		double (*inverse)(const double *A, double *out);
+	};
+
+	/*** Scalar ***/
+	namespace scalar {
+		inline void cross(const double *u, const double *v, double *out) {
+			const double x = u[1] * v[2] - u[2] * v[1];
+			const double y = u[2] * v[0] - u[0] * v[2];
+			const double z = u[0] * v[1] - u[1] * v[0];
+			out[0] = x;
+			out[1] = y;
+			out[2] = z;
+			out[3] = 0.;
+		}
+		inline void mul(const double *A, const double *B, double *out) {
+			double tmp[3 * stride]{};
+			for (int i = 0; i < 3; ++i) {
+				for (int j = 0; j < 3; ++j) {
+					tmp[i * stride + j] = A[i * stride + 0] * B[0 * stride + j]
+										  + A[i * stride + 1] * B[1 * stride + j]
+										  + A[i * stride + 2] * B[2 * stride + j];
+				}
+			}
+			for (int i = 0; i < 3 * stride; ++i) { out[i] = tmp[i]; }
+		}
+		inline void outer(const double *u, const double *v, double *out) {
+			for (int i = 0; i < 3; ++i) {
+				for (int j = 0; j < 3; ++j) { out[i * stride + j] = u[i] * v[j]; }
+				out[i * stride + 3] = 0.;
+			}
+		}
+		inline double det(const double *A) {
+			double c[stride];
+			cross(A + stride, A + 2 * stride, c);
+			return A[0] * c[0] + A[1] * c[1] + A[2] * c[2];
+		}
+		inline void adjugate(const double *A, double *out) {
+			double tmp[3 * stride];
+			cross(A + stride, A + 2 * stride, tmp);
+			cross(A + 2 * stride, A, tmp + stride);
+			cross(A, A + stride, tmp + 2 * stride);
+			for (int i = 0; i < 3 * stride; ++i) { out[i] = tmp[i]; }
+		}
+		inline double inverse(const double *A, double *out) {
+			double C[3 * stride];
+			adjugate(A, C);
+			const double d = A[0] * C[0] + A[1] * C[1] + A[2] * C[2];
+			const double a = (d == 0.) ? 0. : 1. / d;
+			for (int i = 0; i < 3; ++i) {
+				for (int j = 0; j < 3; ++j) {
+					out[i * stride + j] = a * C[j * stride + i];
+				}
+				out[i * stride + 3] = 0.;
+			}
+			return d;
+		}
+	}// namespace scalar
+
+	/*** SSE2: cada linha são dois __m128d, (x, y) e (z, 0) ***/
+	namespace sse2 {
+#define ALGLIN_TARGET __attribute__((target("sse2")))
+		struct row {
+			__m128d lo;
+			__m128d hi;
+		};
+		ALGLIN_TARGET inline row load(const double *p) {
+			return { _mm_loadu_pd(p), _mm_loadu_pd(p + 2) };
+		}
+		ALGLIN_TARGET inline void store(double *p, row r) {
+			_mm_storeu_pd(p, r.lo);
+			_mm_storeu_pd(p + 2, r.hi);
+		}
+		ALGLIN_TARGET inline row cross(row u, row v) {
+			const __m128d zero = _mm_setzero_pd();
+			// (y, z, x, 0) e (z, x, y, 0)
+			const row u_yzx{ _mm_shuffle_pd(u.lo, u.hi, 1),
+				_mm_move_sd(zero, u.lo) };
+			const row u_zxy{ _mm_shuffle_pd(u.hi, u.lo, 0),
+				_mm_unpackhi_pd(u.lo, zero) };
+			const row v_yzx{ _mm_shuffle_pd(v.lo, v.hi, 1),
+				_mm_move_sd(zero, v.lo) };
+			const row v_zxy{ _mm_shuffle_pd(v.hi, v.lo, 0),
+				_mm_unpackhi_pd(v.lo, zero) };
+			return { _mm_sub_pd(
+					   _mm_mul_pd(u_yzx.lo, v_zxy.lo), _mm_mul_pd(u_zxy.lo, v_yzx.lo)),
+				_mm_sub_pd(
+				  _mm_mul_pd(u_yzx.hi, v_zxy.hi), _mm_mul_pd(u_zxy.hi, v_yzx.hi)) };
+		}
+		ALGLIN_TARGET inline double dot(row u, row v) {
+			const __m128d p =
+			  _mm_add_pd(_mm_mul_pd(u.lo, v.lo), _mm_mul_pd(u.hi, v.hi));
+			return _mm_cvtsd_f64(_mm_add_sd(p, _mm_unpackhi_pd(p, p)));
+		}
+		ALGLIN_TARGET inline row scale(double a, row r) {
+			const __m128d s = _mm_set1_pd(a);
+			return { _mm_mul_pd(s, r.lo), _mm_mul_pd(s, r.hi) };
+		}
+		ALGLIN_TARGET inline row add(row a, row b) {
+			return { _mm_add_pd(a.lo, b.lo), _mm_add_pd(a.hi, b.hi) };
+		}
+
+		ALGLIN_TARGET inline void mul(
+		  const double *A, const double *B, double *out) {
+			const row b0 = load(B);
+			const row b1 = load(B + stride);
+			const row b2 = load(B + 2 * stride);
+			row r[3];
+			for (int i = 0; i < 3; ++i) {
+				const double *a = A + i * stride;
+				r[i] = add(add(scale(a[0], b0), scale(a[1], b1)), scale(a[2], b2));
+			}
+			for (int i = 0; i < 3; ++i) { store(out + i * stride, r[i]); }
+		}
+		ALGLIN_TARGET inline void outer(
+		  const double *u, const double *v, double *out) {
+			const row V = load(v);
+			const double x = u[0], y = u[1], z = u[2];
+			store(out, scale(x, V));
+			store(out + stride, scale(y, V));
+			store(out + 2 * stride, scale(z, V));
+		}
+		ALGLIN_TARGET inline void cross(
+		  const double *u, const double *v, double *out) {
+			store(out, cross(load(u), load(v)));
+		}
+		ALGLIN_TARGET inline double det(const double *A) {
+			return dot(load(A), cross(load(A + stride), load(A + 2 * stride)));
+		}
+		ALGLIN_TARGET inline void adjugate(const double *A, double *out) {
+			const row r0 = load(A);
+			const row r1 = load(A + stride);
+			const row r2 = load(A + 2 * stride);
+			const row c0 = cross(r1, r2);
+			const row c1 = cross(r2, r0);
+			const row c2 = cross(r0, r1);
+			store(out, c0);
+			store(out + stride, c1);
+			store(out + 2 * stride, c2);
+		}
+		ALGLIN_TARGET inline double inverse(const double *A, double *out) {
+			const row r0 = load(A);
+			const row c0 = cross(load(A + stride), load(A + 2 * stride));
+			const row c1 = cross(load(A + 2 * stride), r0);
+			const row c2 = cross(r0, load(A + stride));
+			const double d = dot(r0, c0);
+			const __m128d a = _mm_set1_pd((d == 0.) ? 0. : 1. / d);
+			const __m128d zero = _mm_setzero_pd();
+			// inverse = transpose([c0; c1; c2]) / d
+			store(out,
+			  { _mm_mul_pd(a, _mm_unpacklo_pd(c0.lo, c1.lo)),
+				_mm_mul_pd(a, _mm_move_sd(zero, c2.lo)) });
+			store(out + stride,
+			  { _mm_mul_pd(a, _mm_unpackhi_pd(c0.lo, c1.lo)),
+				_mm_mul_pd(a, _mm_unpackhi_pd(c2.lo, zero)) });
+			store(out + 2 * stride,
+			  { _mm_mul_pd(a, _mm_unpacklo_pd(c0.hi, c1.hi)),
+				_mm_mul_pd(a, _mm_move_sd(zero, c2.hi)) });
+			return d;
+		}
+#undef ALGLIN_TARGET
+	}// namespace sse2
+
+	/*** AVX2 + FMA: cada linha é um __m256d (x, y, z, 0) ***/
+	namespace avx2 {
+#define ALGLIN_TARGET __attribute__((target("avx2,fma")))
+		ALGLIN_TARGET inline __m256d cross(__m256d u, __m256d v) {
+			const __m256d u_yzx = _mm256_permute4x64_pd(u, _MM_SHUFFLE(3, 0, 2, 1));
+			const __m256d u_zxy = _mm256_permute4x64_pd(u, _MM_SHUFFLE(3, 1, 0, 2));
+			const __m256d v_yzx = _mm256_permute4x64_pd(v, _MM_SHUFFLE(3, 0, 2, 1));
+			const __m256d v_zxy = _mm256_permute4x64_pd(v, _MM_SHUFFLE(3, 1, 0, 2));
+			return _mm256_fmsub_pd(u_yzx, v_zxy, _mm256_mul_pd(u_zxy, v_yzx));
+		}
+		ALGLIN_TARGET inline double dot(__m256d u, __m256d v) {
+			const __m256d p = _mm256_mul_pd(u, v);
+			const __m128d s =
+			  _mm_add_pd(_mm256_castpd256_pd128(p), _mm256_extractf128_pd(p, 1));
+			return _mm_cvtsd_f64(_mm_add_sd(s, _mm_unpackhi_pd(s, s)));
+		}
+
+		ALGLIN_TARGET inline void mul(
+		  const double *A, const double *B, double *out) {
+			const __m256d b0 = _mm256_loadu_pd(B);
+			const __m256d b1 = _mm256_loadu_pd(B + stride);
+			const __m256d b2 = _mm256_loadu_pd(B + 2 * stride);
+			__m256d r[3];
+			for (int i = 0; i < 3; ++i) {
+				const double *a = A + i * stride;
+				r[i] = _mm256_mul_pd(_mm256_broadcast_sd(a), b0);
+				r[i] = _mm256_fmadd_pd(_mm256_broadcast_sd(a + 1), b1, r[i]);
+				r[i] = _mm256_fmadd_pd(_mm256_broadcast_sd(a + 2), b2, r[i]);
+			}
+			for (int i = 0; i < 3; ++i) {
+				_mm256_storeu_pd(out + i * stride, r[i]);
+			}
+		}
+		ALGLIN_TARGET inline void outer(
+		  const double *u, const double *v, double *out) {
+			const __m256d V = _mm256_loadu_pd(v);
+			const __m256d x = _mm256_broadcast_sd(u);
+			const __m256d y = _mm256_broadcast_sd(u + 1);
+			const __m256d z = _mm256_broadcast_sd(u + 2);
+			_mm256_storeu_pd(out, _mm256_mul_pd(x, V));
+			_mm256_storeu_pd(out + stride, _mm256_mul_pd(y, V));
+			_mm256_storeu_pd(out + 2 * stride, _mm256_mul_pd(z, V));
+		}
+		ALGLIN_TARGET inline void cross(
+		  const double *u, const double *v, double *out) {
+			_mm256_storeu_pd(
+			  out, cross(_mm256_loadu_pd(u), _mm256_loadu_pd(v)));
+		}
+		ALGLIN_TARGET inline double det(const double *A) {
+			return dot(_mm256_loadu_pd(A),
+			  cross(_mm256_loadu_pd(A + stride), _mm256_loadu_pd(A + 2 * stride)));
+		}
+		ALGLIN_TARGET inline void adjugate(const double *A, double *out) {
+			const __m256d r0 = _mm256_loadu_pd(A);
+			const __m256d r1 = _mm256_loadu_pd(A + stride);
+			const __m256d r2 = _mm256_loadu_pd(A + 2 * stride);
+			const __m256d c0 = cross(r1, r2);
+			const __m256d c1 = cross(r2, r0);
+			const __m256d c2 = cross(r0, r1);
+			_mm256_storeu_pd(out, c0);
+			_mm256_storeu_pd(out + stride, c1);
+			_mm256_storeu_pd(out + 2 * stride, c2);
+		}
+		ALGLIN_TARGET inline double inverse(const double *A, double *out) {
+			const __m256d r0 = _mm256_loadu_pd(A);
+			const __m256d r1 = _mm256_loadu_pd(A + stride);
+			const __m256d r2 = _mm256_loadu_pd(A + 2 * stride);
+			const __m256d c0 = cross(r1, r2);
+			const __m256d c1 = cross(r2, r0);
+			const __m256d c2 = cross(r0, r1);
+			const double d = dot(r0, c0);
+			const __m256d a = _mm256_set1_pd((d == 0.) ? 0. : 1. / d);
+			// inverse = transpose([c0; c1; c2]) / d. A lane 3 de c* é zero.
+			const __m256d t0 = _mm256_unpacklo_pd(c0, c1);// c00 c10 c02 c12
+			const __m256d t1 = _mm256_unpackhi_pd(c0, c1);// c01 c11 c03 c13
+			const __m256d t2 = _mm256_unpacklo_pd(c2, c2);// c20 c20 c22 c22
+			const __m256d t3 = _mm256_unpackhi_pd(c2, c2);// c21 c21 c23 c23
+			const __m256d zero = _mm256_setzero_pd();
+			// Mantém a lane 3 em zero
+			const __m256d i0 = _mm256_blend_pd(
+			  _mm256_permute2f128_pd(t0, t2, 0x20), zero, 0x8);
+			const __m256d i1 = _mm256_blend_pd(
+			  _mm256_permute2f128_pd(t1, t3, 0x20), zero, 0x8);
+			const __m256d i2 = _mm256_blend_pd(
+			  _mm256_permute2f128_pd(t0, t2, 0x31), zero, 0x8);
+			_mm256_storeu_pd(out, _mm256_mul_pd(a, i0));
+			_mm256_storeu_pd(out + stride, _mm256_mul_pd(a, i1));
+			_mm256_storeu_pd(out + 2 * stride, _mm256_mul_pd(a, i2));
+			return d;
+		}
+#undef ALGLIN_TARGET
+	}// namespace avx2
+
+	inline Kernels kernels_for(Backend b) {
+		switch (b) {
+			case Backend::AVX2:
+				return { Backend::AVX2,
+					avx2::mul,
+					avx2::outer,
+					avx2::cross,
+					avx2::det,
+					avx2::adjugate,
+					avx2::inverse };
+			case Backend::SSE2:
+				return { Backend::SSE2,
+					sse2::mul,
+					sse2::outer,
+					sse2::cross,
+					sse2::det,
+					sse2::adjugate,
+					sse2::inverse };
+			default:
+			case Backend::Scalar:
+				return { Backend::Scalar,
+					scalar::mul,
+					scalar::outer,
+					scalar::cross,
+					scalar::det,
+					scalar::adjugate,
+					scalar::inverse };
+		}
+	}
+
+	inline Backend detect() {
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+			return Backend::AVX2;
+		}
+		if (__builtin_cpu_supports("sse2")) { return Backend::SSE2; }
+		return Backend::Scalar;
+	}
+
+	// Tabela única (inline => mesma instância em todas as TUs)
+	inline Kernels &table() {
+		static Kernels k = kernels_for(detect());
+		return k;
+	}
+}// namespace detail
+
+/**
+ * @brief Backend em uso
+ */
+inline Backend backend() { return detail::table().backend; }
+
+/**
+ * @brief Maior backend suportado pela CPU
+ */
+inline Backend best_backend() { return detail::detect(); }
+
+/**
+ * @brief Força um backend. Usado nos testes, não é thread-safe.
+ * Forçar um backend não suportado pela CPU é comportamento indefinido.
+ */
+inline void force_backend(Backend b) {
+	detail::table() = detail::kernels_for(b);
+}
+}// namespace simd
+
+/***
+ * Overloads para double 3x3
+ ***/
+namespace detail {
+	inline const double *raw(const GenericMatrix<double, 3, 3> &A) {
+		return A.data().data()->data();
+	}
+	inline double *raw(GenericMatrix<double, 3, 3> &A) { return &A[0][0]; }
+	inline const double *raw(const GenericMatrix<double, 1, 3> &v) {
+		return v.data().data()->data();
+	}
+	inline double *raw(GenericMatrix<double, 1, 3> &v) { return &v[0][0]; }
+}// namespace detail
+
+inline GenericMatrix<double, 3, 3> operator*(
+  const GenericMatrix<double, 3, 3> &A,
+  const GenericMatrix<double, 3, 3> &B) noexcept {
+	GenericMatrix<double, 3, 3> out{};
+	simd::detail::table().mul(detail::raw(A), detail::raw(B), detail::raw(out));
+	return out;
+}
+
+inline double det(const SquareMatrix<double, 3> &A) {
+	return simd::detail::table().det(detail::raw(A));
+}
+
+inline SquareMatrix<double, 3> adjugate(
+  const SquareMatrix<double, 3> &M) noexcept {
+	SquareMatrix<double, 3> out{};
+	simd::detail::table().adjugate(detail::raw(M), detail::raw(out));
+	return out;
+}
+
+inline SquareMatrix<double, 3> fast_adjugate(SquareMatrix<double, 3> const &M) {
+	return adjugate(M);
+}
+
+inline SquareMatrix<double, 3> inverse(
+  const SquareMatrix<double, 3> &M) noexcept {
+	SquareMatrix<double, 3> out{};
+	simd::detail::table().inverse(detail::raw(M), detail::raw(out));
+	return out;
+}
+
+inline Vector<double, 3> cross(
+  const Vector<double, 3> &u, const Vector<double, 3> &v) {
+	Vector<double, 3> out{};
+	simd::detail::table().cross(detail::raw(u), detail::raw(v), detail::raw(out));
+	return out;
+}
+
+inline SquareMatrix<double, 3> outer(
+  const Vector<double, 3> &u, const Vector<double, 3> &v) {
+	SquareMatrix<double, 3> out{};
+	simd::detail::table().outer(detail::raw(u), detail::raw(v), detail::raw(out));
+	return out;
+}
+
+}// namespace alglin
+#endif// ALGLIN_SIMD_HPP
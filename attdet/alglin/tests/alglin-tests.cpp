@@ -1,4 +1,7 @@
+#include <algorithm>
 #include <alglin/alglin.hpp>
+#include <alglin/fixed.hpp>
+#include <numeric>
 
 #include <catch2/catch.hpp>
 TEST_CASE("A * A^-1  = I") {
@@ -129,3 +132,234 @@ TEST_CASE("Vector from InitList of lvalue") {
 	Quat w({ 1, 1, 1, 1 });
 	REQUIRE(v == w);
 }
+
+TEST_CASE("Row and Column Views") {
+
+	Matrix3 A({ { 1, 2, 3 }, { 10, 2024, 17 }, { 9, 8, 7 } });
+	const Matrix3 &cA = A;
+
+	// Acesso const não copia a linha
+	REQUIRE(&cA[1][2] == &A[1][2]);
+	REQUIRE(&alglin::row(A, 2)[0] == &A[2][0]);
+
+	auto c = alglin::column(A, 1);
+	REQUIRE(c.size() == 3);
+	REQUIRE(&c[2] == &A[2][1]);
+	REQUIRE(std::accumulate(c.begin(), c.end(), 0.) == 2034.);
+	REQUIRE(*std::max_element(c.begin(), c.end()) == 2024.);
+	REQUIRE(c.end() - c.begin() == 3);
+
+	// A visão acompanha a matriz
+	A[0][1] = -1.;
+	REQUIRE(c[0] == -1.);
+
+	// Iteradores de views temporárias apontam para a matriz, não para a view
+	REQUIRE(*std::max_element(alglin::column(A, 2).begin(), alglin::column(A, 2).end()) == 17.);
+	REQUIRE(alglin::column(A, 1).begin() == c.begin());
+	REQUIRE(alglin::column(A, 0).begin() != c.begin());
+	const Matrix3 B = A;
+	REQUIRE(alglin::column(B, 1).end() != c.end());
+
+	double sum{};
+	for (const auto &x : alglin::row(cA, 0)) { sum += x; }
+	REQUIRE(sum == 3.);
+}
+
+TEST_CASE("Array with <algorithm>") {
+
+	alglin::array<double, 4> a{};
+	std::iota(a.begin(), a.end(), 1.);
+	std::reverse(a.begin(), a.end());
+	REQUIRE(a[0] == 4.);
+	std::sort(a.begin(), a.end());
+	REQUIRE(std::is_sorted(a.cbegin(), a.cend()));
+	REQUIRE(a.end() - a.begin() == a.size());
+
+	const Vec3 v({ 3., -1., 2. });
+	const auto &r = alglin::row(v, 0);
+	REQUIRE(*std::min_element(r.begin(), r.end()) == -1.);
+	REQUIRE(&v[2] == &r[2]);
+}
+
+TEST_CASE("LU for N > 3") {
+
+	const Matrix4 A(
+	  { { 4, 3, 2, 1 }, { 1, 5, 2, 3 }, { 2, 1, 6, 1 }, { 0, 2, 1, 7 } });
+	const auto I = alglin::eye<double, 4>();
+
+	REQUIRE(A * alglin::inverse(A) == I);
+	REQUIRE(std::abs(alglin::det(A) - 498.) < 1E-9);
+
+	const alglin::Vector<double, 4> x({ 1., -2., 3., -4. });
+	const alglin::Vector<double, 4> b = A * x;
+	REQUIRE(alglin::solve(A, b) == x);
+
+	// Mesmo resultado que a forma fechada para 3x3
+	const Matrix3 B({ { 1, 2, 3 }, { 10, 2024, 17 }, { 9, 8, 7 } });
+	REQUIRE(std::abs(alglin::det(alglin::lu(B)) - alglin::det(B)) < 1E-8);
+	REQUIRE(alglin::inverse(alglin::lu(B)) == alglin::inverse(B));
+
+	// Singular: inverso e solução nulos, adjunta ainda definida
+	const Matrix4 S(
+	  { { 1, 2, 3, 4 }, { 2, 4, 6, 8 }, { 0, 1, 0, 1 }, { 1, 0, 0, 1 } });
+	REQUIRE(alglin::lu(S).singular);
+	REQUIRE(alglin::det(S) == 0.);
+	REQUIRE(alglin::inverse(S) == Matrix4{});
+	REQUIRE(alglin::adjugate(A) == alglin::det(A) * alglin::transpose(alglin::inverse(A)));
+}
+
+TEST_CASE("Cholesky and LDLT") {
+
+	using Matrix6 = alglin::SquareMatrix<double, 6>;
+	Matrix6 P{};
+	for (int i = 0; i < 6; ++i) {
+		for (int j = 0; j < 6; ++j) { P[i][j] = 1. / (1. + i + j); }
+		P[i][i] += 1.;
+	}
+	const auto chol = alglin::cholesky(P);
+	REQUIRE(chol.ok);
+	REQUIRE(chol.L * alglin::transpose(chol.L) == P);
+	REQUIRE(P * alglin::inverse(chol) == alglin::eye<double, 6>());
+
+	alglin::Vector<double, 6> b({ 1., 2., 3., 4., 5., 6. });
+	REQUIRE(alglin::solve(chol, b) == alglin::solve(P, b));
+	REQUIRE(alglin::solve(alglin::ldlt(P), b) == alglin::solve(P, b));
+
+	// Indefinida: Cholesky falha, LDLT não
+	const Matrix3 K({ { 2, 1, 0 }, { 1, -3, 1 }, { 0, 1, 1 } });
+	REQUIRE_FALSE(alglin::cholesky(K).ok);
+	const auto f = alglin::ldlt(K);
+	REQUIRE(f.ok);
+	const Vec3 y({ 1., 2., 3. });
+	REQUIRE(K * alglin::solve(f, y) == y);
+}
+
+TEST_CASE("Symmetric Eigen Decomposition") {
+
+	const Matrix4 K({ { -0.2, 0.4, -0.1, 0.3 },
+	  { 0.4, 0.5, 0.2, -0.6 },
+	  { -0.1, 0.2, -0.9, 0.1 },
+	  { 0.3, -0.6, 0.1, 0.6 } });
+
+	const auto E = alglin::eigen_symmetric(K);
+	Matrix4 D{};
+	for (int i = 0; i < 4; ++i) { D[i][i] = E.values[i]; }
+	REQUIRE(K * E.vectors == E.vectors * D);
+	REQUIRE(alglin::transpose(E.vectors) * E.vectors == alglin::eye<double, 4>());
+
+	const auto jacobi = alglin::dominant_eigen(K);
+	const auto fast = alglin::dominant_eigen(K, 1.5, 20);
+	REQUIRE(std::abs(jacobi.value - fast.value) < 1E-12);
+	REQUIRE(std::abs(std::abs(jacobi.vector * fast.vector) - 1.) < 1E-12);
+
+	alglin::SymmetricBatch<double, 4, 8> batch{};
+	for (int l = 0; l < 8; ++l) { batch.set(l, (1. + l) * K); }
+	const auto out = alglin::dominant_eigen(batch);
+	for (int l = 0; l < 8; ++l) {
+		const auto e = out.get(l);
+		REQUIRE(std::abs(e.value - (1. + l) * jacobi.value) < 1E-12);
+		REQUIRE(std::abs(std::abs(e.vector * jacobi.vector) - 1.) < 1E-12);
+	}
+}
+
+TEST_CASE("Packed Symmetric Matrix") {
+
+	const Matrix3 B({ { 1, 2, 3 }, { 10, 2024, 17 }, { 9, 8, 7 } });
+	const Matrix3 S = B + alglin::transpose(B);
+	const auto P = alglin::plus_transpose(B);
+	const Vec3 v({ 0.333, 2., 7. });
+
+	REQUIRE(alglin::SymmetricMatrix<double, 3>::size == 6);
+	REQUIRE(P.full() == S);
+	REQUIRE(alglin::symmetric(S) == P);
+	REQUIRE(P(2, 0) == P(0, 2));
+	REQUIRE(alglin::trace(P) == alglin::trace(S));
+	REQUIRE(alglin::det(P) == alglin::det(S));
+	REQUIRE(alglin::adjugate(P).full() == alglin::adjugate(S));
+	REQUIRE(alglin::inverse(P).full() == alglin::inverse(S));
+	REQUIRE(alglin::square(P).full() == S * S);
+	REQUIRE(P * P == S * S);
+	REQUIRE(P * v == S * v);
+	REQUIRE(std::abs(alglin::quadratic_form(P, v) - v * (S * v)) < 1E-9);
+
+	auto R = P;
+	alglin::rank1_update(R, 0.5, v);
+	REQUIRE(R.full() == S + 0.5 * alglin::outer(v, v));
+}
+
+TEST_CASE("Fixed Point") {
+
+	using alglin::Q16_16;
+	using alglin::Q2_30;
+	const Q16_16 a(1.5);
+	const Q16_16 b(-0.25);
+
+	REQUIRE(static_cast<double>(a + b) == 1.25);
+	REQUIRE(static_cast<double>(a * b) == -0.375);
+	REQUIRE(static_cast<double>(a / b) == -6.);
+	REQUIRE(static_cast<double>(alglin::sqrt(Q16_16(2.)))
+			== Approx(std::sqrt(2.)).epsilon(2E-5));
+	REQUIRE(static_cast<double>(alglin::reciprocal(Q16_16(3)))
+			== Approx(1. / 3.).epsilon(2E-5));
+	REQUIRE(static_cast<double>(alglin::inverse_sqrt(Q16_16(4))) == .5);
+
+	// Satura em vez de estourar
+	const Q16_16 big(30000);
+	REQUIRE((big + big).raw == INT32_MAX);
+	REQUIRE((-big - big).raw == INT32_MIN);
+	REQUIRE((big * big).raw == INT32_MAX);
+	REQUIRE((a / Q16_16{}).raw == INT32_MAX);
+	REQUIRE(Q2_30(3.).raw == INT32_MAX);
+
+	// Conversões entre formatos
+	REQUIRE(static_cast<double>(alglin::fixed_cast<30>(b)) == -0.25);
+	REQUIRE(static_cast<double>(alglin::fixed_ratio<30>(Q16_16(1), Q16_16(3)))
+			== Approx(1. / 3.).epsilon(1E-8));
+
+	// Funciona nos tipos genéricos
+	using Vec3Q = alglin::Vector<Q16_16, 3>;
+	const Vec3Q u({ Q16_16(3), Q16_16(0), Q16_16(4) });
+	const auto n = alglin::normalize(u);
+	REQUIRE(static_cast<double>(n[0]) == Approx(.6).epsilon(1E-4));
+	REQUIRE(static_cast<double>(n[2]) == Approx(.8).epsilon(1E-4));
+	REQUIRE(static_cast<double>(u * u) == 25.);
+	// Vetor pequeno: a norma em 64 bits preserva a precisão
+	const Vec3Q tiny({ Q16_16::from_raw(3), Q16_16{}, Q16_16::from_raw(-4) });
+	const auto m = alglin::fixed_normalize<30>(tiny);
+	REQUIRE(static_cast<double>(m[0]) == Approx(.6).epsilon(1E-8));
+	REQUIRE(static_cast<double>(m[2]) == Approx(-.8).epsilon(1E-8));
+	const alglin::SquareMatrix<Q16_16, 3> I = alglin::eye<Q16_16, 3>();
+	REQUIRE(I * alglin::outer(u, u) == alglin::outer(u, u));
+}
+
+#if ALGLIN_SIMD
+TEST_CASE("SIMD backends") {
+	using alglin::simd::Backend;
+	const Matrix3 A({ { 1, 2, 3 }, { 10, 2024, 17 }, { 9, 8, 7 } });
+	const Matrix3 B({ { 9, 5, 1 }, { 14, 254, 11 }, { 8, 8, 4 } });
+	const Vec3 u({ 1.4, 0., 1. });
+	const Vec3 v({ 0.333, 2., 7. });
+
+	const auto best = alglin::simd::best_backend();
+	for (auto b : { Backend::Scalar, Backend::SSE2, Backend::AVX2 }) {
+		if (static_cast<int>(b) > static_cast<int>(best)) { continue; }
+		alglin::simd::force_backend(b);
+		REQUIRE(alglin::simd::backend() == b);
+
+		REQUIRE(A * B == alglin::operator*<double>(A, B));
+		REQUIRE(alglin::det(A) == alglin::det<double>(A));
+		REQUIRE(alglin::adjugate(A) == alglin::adjugate<double>(A));
+		REQUIRE(alglin::fast_adjugate(A) == alglin::fast_adjugate<double>(A));
+		REQUIRE(alglin::inverse(A) == alglin::inverse<double>(A));
+		REQUIRE(alglin::inverse(Matrix3{}) == Matrix3{});
+		REQUIRE(alglin::cross(u, v) == alglin::cross<double>(u, v));
+		REQUIRE(alglin::outer(u, v) == alglin::outer<double, 3>(u, v));
+
+		// Lane de padding continua zerada
+		const auto I = alglin::inverse(A);
+		REQUIRE(I.data().data()->data()[3] == 0.);
+		REQUIRE(alglin::cross(u, v).data().data()->data()[3] == 0.);
+	}
+	alglin::simd::force_backend(best);
+}
+#endif
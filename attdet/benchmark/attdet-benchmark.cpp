@@ -1,34 +1,106 @@
 #include "alglin/alglin.hpp"
 #include "attdet/attdet.h"
+#include "attdet/calibration.h"
+#include "attdet/codec.h"
+#include "attdet/montecarlo.h"
+#include "attdet/refmodel.h"
+#include "attdet/robust.h"
+#include "attdet/shm.h"
+#include "attdet/starid.h"
+#include "attdet/timeseries.h"
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <benchmark/benchmark.h>
+#include <cstdint>
+#include <numeric>
 #include <random>
+#include <string>
+#include <thread>
+#include <unistd.h>
 #include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
 
 namespace {
+// Contador de ciclos (TSC), para comparar com alvos sem FPU
+inline std::uint64_t cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+// Um stream Philox por chamada, em sequência: sem random_device e sem
+// montar a DCM por ângulos de Euler a cada sensor
 attdet::Sensor gen_sensor() {
-	using T = double;
-	constexpr T tpi = 3.1415926535897932384 + 1E-4;
-	auto DCM = [](T phi, T theta, T psi) -> Matrix3 {
-		auto s = [](T x) -> T { return std::sin(x); };
-		auto c = [](T x) -> T { return std::cos(x); };
-		return { { c(theta) * c(psi),
-				   s(phi) * s(theta) * c(psi) - c(phi) * s(psi),
-				   s(phi) * s(psi) + c(phi) * s(theta) * c(psi) },
-			{ c(theta) * s(psi),
-			  s(phi) * s(theta) * s(psi) - c(phi) * c(psi),
-			  c(phi) * s(theta) * s(psi) - s(phi) * c(psi) },
-			{ -s(theta), s(phi) * c(theta), c(phi) * c(theta) } };
-	};
+	static std::uint64_t call = 0;
+	attdet::montecarlo::Stream stream(2021, call++);
+	const Matrix3 M = attdet::Quat2DCM(stream.attitude());
+	const Vec3 v = stream.direction();
+	return { M * v, v, 0.5 };
+}
+
+template<int N> alglin::SquareMatrix<double, N> gen_matrix() {
 	std::random_device rd;
 	std::mt19937 g(rd());
-	std::uniform_real_distribution<double> angles(-tpi, tpi);
-	std::uniform_real_distribution<double> vecs(-1, 1);
-	auto M = DCM(angles(g), angles(g), angles(g));
-	Vec3 v({ vecs(g), vecs(g), vecs(g) });
-	v = alglin::normalize(v);
-	return { M * v, v, 0.5 };
+	std::uniform_real_distribution<double> vals(-1, 1);
+	alglin::SquareMatrix<double, N> A{};
+	for (int i = 0; i < N; ++i) {
+		for (int j = 0; j < N; ++j) { A[i][j] = vals(g); }
+		A[i][i] += N;
+	}
+	return A;
+}
+
+// Memória de trabalho do LU dinâmico, alocada fora do laço medido
+struct LUScratch {
+	explicit LUScratch(int n)
+	  : M(static_cast<std::size_t>(n * n)), perm(static_cast<std::size_t>(n)),
+		x(static_cast<std::size_t>(n)) {}
+	std::vector<double> M;
+	std::vector<int> perm;
+	std::vector<double> x;
+};
+
+// LU com N em tempo de execução, referência para as versões de tamanho fixo
+void inverse_dynamic(const double *A, double *X, int n, LUScratch &scratch) {
+	auto &M = scratch.M;
+	auto &perm = scratch.perm;
+	auto &x = scratch.x;
+	std::copy(A, A + n * n, M.begin());
+	std::iota(perm.begin(), perm.end(), 0);
+	for (int k = 0; k < n; ++k) {
+		int p = k;
+		for (int i = k + 1; i < n; ++i) {
+			if (std::abs(M[i * n + k]) > std::abs(M[p * n + k])) { p = i; }
+		}
+		if (p != k) {
+			std::swap_ranges(&M[p * n], &M[p * n] + n, &M[k * n]);
+			std::swap(perm[p], perm[k]);
+		}
+		for (int i = k + 1; i < n; ++i) {
+			M[i * n + k] /= M[k * n + k];
+			for (int j = k + 1; j < n; ++j) {
+				M[i * n + j] -= M[i * n + k] * M[k * n + j];
+			}
+		}
+	}
+	for (int col = 0; col < n; ++col) {
+		for (int i = 0; i < n; ++i) {
+			double sum = (perm[i] == col) ? 1. : 0.;
+			for (int j = 0; j < i; ++j) { sum -= M[i * n + j] * x[j]; }
+			x[i] = sum;
+		}
+		for (int i = n - 1; i >= 0; --i) {
+			double sum = x[i];
+			for (int j = i + 1; j < n; ++j) { sum -= M[i * n + j] * x[j]; }
+			x[i] = sum / M[i * n + i];
+		}
+		for (int i = 0; i < n; ++i) { X[i * n + col] = x[i]; }
+	}
 }
 };// namespace
 
@@ -42,13 +114,530 @@ static void BM_QUEST(benchmark::State &state) {
 	std::generate(sensors.begin(), sensors.end(), gen);
 	Quat q;
 	benchmark::DoNotOptimize(q);
+	const auto start = cycles();
 	for (auto _ : state) {
 		q = attdet::quest({ sensors[state.iterations() % shelf][0],
 		  sensors[state.iterations() % shelf][1] });
 	}
+	state.counters["cycles"] = benchmark::Counter(
+	  static_cast<double>(cycles() - start), benchmark::Counter::kAvgIterations);
 }
 BENCHMARK(BM_QUEST);
 
+// Só o núcleo (quatro referenciais) sobre B já acumulada; rótulo = kernel do build
+static void BM_QUEST_Profile(benchmark::State &state) {
+	constexpr auto shelf = 10000;
+	std::vector<Matrix3> profiles(shelf);
+	for (auto &B : profiles) {
+		const attdet::Sensor s0 = gen_sensor(), s1 = gen_sensor();
+		B = Matrix3(s0.weight * alglin::outer(s0.measure, s0.reference)
+					+ s1.weight * alglin::outer(s1.measure, s1.reference));
+	}
+	Quat q;
+	benchmark::DoNotOptimize(q);
+	std::size_t i = 0;
+	const auto start = cycles();
+	for (auto _ : state) {
+		q = attdet::quest_profile(profiles[i++ % shelf], 1.);
+		benchmark::ClobberMemory();
+	}
+	state.counters["cycles"] = benchmark::Counter(
+	  static_cast<double>(cycles() - start), benchmark::Counter::kAvgIterations);
+#if defined(QUEST_FUSED) && !QUEST_FUSED
+	state.SetLabel("matrix");
+#else
+	state.SetLabel("fused");
+#endif
+}
+BENCHMARK(BM_QUEST_Profile);
+
+// Mesma suíte que BM_QUEST, com 3 sensores (acc + mag + sol) pela lista
+static void BM_QUEST_List3(benchmark::State &state) {
+	constexpr auto shelf = 10000;
+	std::vector<std::array<attdet::Sensor, 3>> sensors(shelf);
+	for (auto &s : sensors) { s = { { gen_sensor(), gen_sensor(), gen_sensor() } }; }
+	Quat q;
+	benchmark::DoNotOptimize(q);
+	std::size_t i = 0;
+	for (auto _ : state) {
+		const auto &s = sensors[i++ % shelf];
+		q = attdet::quest({ s[0], s[1], s[2] });
+	}
+}
+BENCHMARK(BM_QUEST_List3);
+
+// SensorSet<N>: acumulação desenrolada; N = 2 usa a forma fechada
+template<std::size_t N> static void BM_QUEST_SensorSet(benchmark::State &state) {
+	constexpr auto shelf = 10000;
+	std::vector<attdet::SensorSet<N>> sensors(shelf);
+	for (auto &s : sensors) {
+		for (auto &x : s) { x = gen_sensor(); }
+	}
+	Quat q;
+	benchmark::DoNotOptimize(q);
+	std::size_t i = 0;
+	const auto start = cycles();
+	for (auto _ : state) { q = attdet::quest(sensors[i++ % shelf]); }
+	state.counters["cycles"] = benchmark::Counter(
+	  static_cast<double>(cycles() - start), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK_TEMPLATE(BM_QUEST_SensorSet, 2);
+BENCHMARK_TEMPLATE(BM_QUEST_SensorSet, 3);
+
+static void BM_QUEST_Fixed(benchmark::State &state) {
+	constexpr auto shelf = 10000;
+	std::vector<std::array<attdet::SensorQ, 2>> sensors(shelf);
+	auto gen = []() {
+		return std::array<attdet::SensorQ, 2>{ attdet::SensorQ(gen_sensor()),
+			attdet::SensorQ(gen_sensor()) };
+	};
+	std::generate(sensors.begin(), sensors.end(), gen);
+	attdet::QuatQ q;
+	benchmark::DoNotOptimize(q);
+	std::size_t i = 0;
+	const auto start = cycles();
+	for (auto _ : state) {
+		const auto &s = sensors[i++ % shelf];
+		q = attdet::quest_fixed({ s[0], s[1] });
+	}
+	state.counters["cycles"] = benchmark::Counter(
+	  static_cast<double>(cycles() - start), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_QUEST_Fixed);
+
+// Trajetória suave (0.1 grau por amostra): Arg 0 = quest(), 1 = StreamingQuest
+static void BM_QUEST_Stream(benchmark::State &state) {
+	constexpr auto shelf = 10000;
+	const Vec3 axis = alglin::normalize(Vec3({ 1., 2., 3. }));
+	const Vec3 ref0({ 1., 0., 0. }), ref1({ 0., 0.6, -0.8 });
+	attdet::montecarlo::Stream noise(3, 0);
+	std::vector<std::array<attdet::Sensor, 2>> sensors(shelf);
+	for (int i = 0; i < shelf; ++i) {
+		const double half = i * 0.05 * 3.141592653589793 / 180.;
+		const Matrix3 A = attdet::Quat2DCM(Quat({ axis[0] * std::sin(half),
+		  axis[1] * std::sin(half), axis[2] * std::sin(half), std::cos(half) }));
+		const Vec3 e0({ noise.normal(), noise.normal(), noise.normal() });
+		const Vec3 e1({ noise.normal(), noise.normal(), noise.normal() });
+		sensors[i][0] = { alglin::normalize(Vec3(A * ref0 + 1E-3 * e0)), ref0, .5 };
+		sensors[i][1] = { alglin::normalize(Vec3(A * ref1 + 1E-3 * e1)), ref1, .5 };
+	}
+	attdet::StreamingQuest solver;
+	Quat q;
+	benchmark::DoNotOptimize(q);
+	// state.iterations() só é atualizado depois do laço
+	std::size_t i = 0;
+	const auto start = cycles();
+	for (auto _ : state) {
+		const auto &s = sensors[i++ % shelf];
+		q = state.range(0) ? solver.update(s.data(), s.data() + 2)
+						   : attdet::quest(s.data(), s.data() + 2);
+	}
+	state.counters["cycles"] = benchmark::Counter(
+	  static_cast<double>(cycles() - start), benchmark::Counter::kAvgIterations);
+	state.counters["searches"] = static_cast<double>(solver.searches());
+}
+BENCHMARK(BM_QUEST_Stream)->Arg(0)->Arg(1);
+
+// Identificação lost-in-space: catálogo uniforme, campo de 20 graus
+static void BM_StarID_LostInSpace(benchmark::State &state) {
+	using namespace attdet::starid;
+	constexpr double fov = 20. * 3.141592653589793 / 180.;
+	std::mt19937 g(1);
+	std::normal_distribution<double> gauss(0., 1.);
+	auto unit = [&]() {
+		return alglin::normalize(Vec3({ gauss(g), gauss(g), gauss(g) }));
+	};
+	std::vector<CatalogStar> catalog(static_cast<std::size_t>(state.range(0)));
+	for (std::size_t i = 0; i < catalog.size(); ++i) {
+		catalog[i] = { static_cast<std::uint32_t>(i), unit() };
+	}
+	const auto index = StarIndex::build(catalog, fov);
+
+	// Cenas: atitude aleatória, estrelas visíveis com 5 µrad de ruído
+	constexpr auto shelf = 64;
+	std::vector<std::vector<Vec3>> scenes(shelf);
+	for (auto &scene : scenes) {
+		const auto q = alglin::normalize(Quat({ gauss(g), gauss(g), gauss(g), gauss(g) }));
+		const double x = q[0], y = q[1], z = q[2], w = q[3];
+		const Matrix3 A({ { 1 - 2 * (y * y + z * z), 2 * (x * y + z * w),
+							2 * (x * z - y * w) },
+		  { 2 * (x * y - z * w), 1 - 2 * (x * x + z * z), 2 * (y * z + x * w) },
+		  { 2 * (x * z + y * w), 2 * (y * z - x * w), 1 - 2 * (x * x + y * y) } });
+		const Vec3 boresight = unit();
+		for (const auto &star : catalog) {
+			if (std::acos(star.direction * boresight) > fov / 2) { continue; }
+			scene.push_back(
+			  alglin::normalize(Vec3(A * star.direction + 5E-6 * unit())));
+		}
+	}
+	std::size_t identified = 0, i = 0;
+	for (auto _ : state) {
+		const auto &scene = scenes[i++ % shelf];
+		const auto matches = identify(index, scene, 1E-4);
+		benchmark::DoNotOptimize(matches.data());
+		identified += matches.empty() ? 0 : 1;
+	}
+	state.counters["pairs"] = static_cast<double>(index.pairs());
+	state.counters["identified"] = benchmark::Counter(
+	  static_cast<double>(identified), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_StarID_LostInSpace)->RangeMultiplier(2)->Range(1000, 16000);
+
+// n observações de uma mesma atitude, uma delas corrompida
+std::vector<attdet::Sensor> gen_outlier_set(std::size_t n) {
+	std::mt19937 g(9);
+	std::normal_distribution<double> gauss(0., 1.);
+	auto unit = [&]() {
+		return alglin::normalize(Vec3({ gauss(g), gauss(g), gauss(g) }));
+	};
+	const auto A = attdet::Quat2DCM(
+	  alglin::normalize(Quat({ gauss(g), gauss(g), gauss(g), gauss(g) })));
+	std::vector<attdet::Sensor> sensors;
+	for (std::size_t i = 0; i < n; ++i) {
+		const Vec3 r = unit();
+		sensors.emplace_back(alglin::normalize(Vec3(A * r + 1E-4 * unit())), r, 1.);
+	}
+	sensors[n / 2].measure =
+	  alglin::normalize(Vec3(sensors[n / 2].measure + 0.5 * unit()));
+	return sensors;
+}
+
+static void BM_QUEST_N(benchmark::State &state) {
+	const auto sensors = gen_outlier_set(static_cast<std::size_t>(state.range(0)));
+	Quat q;
+	benchmark::DoNotOptimize(q);
+	for (auto _ : state) {
+		q = attdet::quest(sensors.data(), sensors.data() + sensors.size());
+	}
+}
+BENCHMARK(BM_QUEST_N)->Arg(4)->Arg(8)->Arg(16)->Arg(64);
+
+static void BM_QUEST_Robust(benchmark::State &state) {
+	const auto sensors = gen_outlier_set(static_cast<std::size_t>(state.range(0)));
+	const attdet::RobustOptions options(0.0087,
+	  static_cast<std::size_t>(state.range(1)),
+	  static_cast<unsigned>(state.range(2)));
+	attdet::RobustResult r;
+	for (auto _ : state) {
+		r = attdet::quest_robust(
+		  sensors.data(), sensors.data() + sensors.size(), options);
+		benchmark::DoNotOptimize(r.attitude);
+	}
+	state.counters["inliers"] = static_cast<double>(r.inlier_count);
+}
+BENCHMARK(BM_QUEST_Robust)
+  ->Args({ 4, 32, 1 })
+  ->Args({ 8, 32, 1 })
+  ->Args({ 16, 32, 1 })
+  ->Args({ 64, 512, 1 })
+  ->Args({ 64, 512, 4 })
+  ->UseRealTime();
+
+// Log de 100k atitudes a ~20 Hz com jitter, reamostrado a 50 Hz
+static void BM_Resample(benchmark::State &state) {
+	using namespace attdet::timeseries;
+	std::mt19937 g(5);
+	std::uniform_real_distribution<double> jitter(-.01, .01);
+	std::vector<Sample> log(100000);
+	for (std::size_t i = 0; i < log.size(); ++i) {
+		const double t = .05 * static_cast<double>(i) + jitter(g);
+		log[i] = { t, Quat({ 0., std::sin(.3 * t), 0., std::cos(.3 * t) }) };
+	}
+	Options options(50., state.range(0) ? Interpolation::Squad : Interpolation::Slerp);
+	options.smoothing = state.range(1) ? .1 : 0.;
+	options.threads = static_cast<unsigned>(state.range(2));
+	std::size_t outputs = 0;
+	for (auto _ : state) {
+		outputs = 0;
+		resample(log.data(), log.data() + log.size(), options,
+		  [&](const Sample *first, const Sample *last) {
+			  outputs += static_cast<std::size_t>(last - first);
+			  benchmark::DoNotOptimize(first);
+		  });
+	}
+	state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * outputs));
+}
+BENCHMARK(BM_Resample)
+  ->Args({ 0, 0, 1 })
+  ->Args({ 1, 0, 1 })
+  ->Args({ 1, 1, 1 })
+  ->Args({ 1, 1, 4 })
+  ->Unit(benchmark::kMillisecond)
+  ->UseRealTime();
+
+// Estrela + sol + magnetômetro, atitude uniforme, QUEST; ensaios por segundo
+static void BM_MonteCarlo(benchmark::State &state) {
+	using namespace attdet::montecarlo;
+	const std::vector<SensorModel> suite = { SensorModel(5E-5),
+		SensorModel(2E-3, Vec3({ 0.3, 0.5, 0.81 })),
+		SensorModel(1E-2, Vec3({ 0.2, -0.1, 0.97 })) };
+	Options options(static_cast<std::uint64_t>(state.range(0)));
+	options.threads = static_cast<unsigned>(state.range(1));
+	Statistics stats;
+	for (auto _ : state) {
+		stats = run(suite, options);
+		benchmark::DoNotOptimize(stats.sum);
+	}
+	state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * stats.trials));
+	state.counters["p99_arcsec"] = stats.percentile(.99) * 206264.8;
+}
+BENCHMARK(BM_MonteCarlo)
+  ->Args({ 1 << 20, 1 })
+  ->Args({ 1 << 20, 0 })
+  ->Unit(benchmark::kMillisecond)
+  ->UseRealTime();
+
+// Leitura da última atitude em /dev/shm; Arg 1 = outra thread publicando sem parar
+static void BM_Shm_Read(benchmark::State &state) {
+	const std::string name = "/attdet-bench-" + std::to_string(::getpid());
+	auto publisher = attdet::shm::Publisher::create(name);
+	auto reader = attdet::shm::Reader::open(name);
+	publisher.publish(attdet::shm::State{});
+	std::atomic<bool> done{ false };
+	std::atomic<std::uint64_t> writes{ 0 };
+	std::thread writer;
+	if (state.range(0)) {
+		writer = std::thread([&]() {
+			const auto s = gen_sensor();
+			auto snapshot = attdet::shm::snapshot(0, Quat({ 0., 0., 0., 1. }), nullptr, &s, &s + 1);
+			while (!done) {
+				++snapshot.time;
+				publisher.publish(snapshot);
+				writes.fetch_add(1, std::memory_order_relaxed);
+			}
+		});
+	}
+	attdet::shm::State s;
+	for (auto _ : state) {
+		reader.read(s);
+		benchmark::DoNotOptimize(s);
+	}
+	done = true;
+	if (writer.joinable()) { writer.join(); }
+	state.counters["writes"] = benchmark::Counter(static_cast<double>(writes), benchmark::Counter::kIsRate);
+	attdet::shm::Publisher::unlink(name);
+}
+BENCHMARK(BM_Shm_Read)->Arg(0)->Arg(1)->UseRealTime();
+
+static void BM_Shm_Publish(benchmark::State &state) {
+	const std::string name = "/attdet-bench-" + std::to_string(::getpid());
+	auto publisher = attdet::shm::Publisher::create(name);
+	const auto sensor = gen_sensor();
+	auto snapshot = attdet::shm::snapshot(0, Quat({ 0., 0., 0., 1. }), nullptr, &sensor, &sensor + 1);
+	for (auto _ : state) {
+		++snapshot.time;
+		publisher.publish(snapshot);
+	}
+	attdet::shm::Publisher::unlink(name);
+}
+BENCHMARK(BM_Shm_Publish);
+
+// Custo por amostra no laço de solução: acumular (Arg 1 = com esquecimento)
+static void BM_Calibration_Add(benchmark::State &state) {
+	attdet::calibration::Accumulator acc(50., state.range(0) ? .999 : 1.);
+	attdet::montecarlo::Stream rng(3, 0);
+	std::vector<Vec3> raw(1024);
+	for (auto &x : raw) { x = 40. * rng.direction(); }
+	std::size_t i = 0;
+	for (auto _ : state) { acc.add(raw[i++ % raw.size()]); }
+	benchmark::DoNotOptimize(acc);
+}
+BENCHMARK(BM_Calibration_Add)->Arg(0)->Arg(1);
+
+static void BM_Calibration_Fit(benchmark::State &state) {
+	attdet::calibration::Accumulator acc(50.);
+	attdet::montecarlo::Stream rng(3, 0);
+	for (int i = 0; i < 1000; ++i) { acc.add(Vec3(40. * rng.direction())); }
+	attdet::calibration::Correction c;
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(acc.fit(c));
+		benchmark::ClobberMemory();
+	}
+}
+BENCHMARK(BM_Calibration_Fit);
+
+// Correção de 1024 amostras: Arg 0 = uma a uma, Arg 1 = apply() em lote
+static void BM_Calibration_Apply(benchmark::State &state) {
+	attdet::calibration::Accumulator acc(50.);
+	attdet::montecarlo::Stream rng(3, 0);
+	std::vector<Vec3> raw(1024), out(1024);
+	for (auto &x : raw) { x = 40. * rng.direction(); }
+	acc.add(raw.data(), raw.data() + raw.size());
+	attdet::calibration::Correction c;
+	acc.fit(c);
+	for (auto _ : state) {
+		if (state.range(0)) {
+			attdet::calibration::apply(c, raw.data(), raw.data() + raw.size(), out.data());
+		} else {
+			for (std::size_t i = 0; i < raw.size(); ++i) { out[i] = c(raw[i]); }
+		}
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * raw.size()));
+}
+BENCHMARK(BM_Calibration_Apply)->Arg(0)->Arg(1);
+
+// Lote de 4096 atitudes; Arg = bits por registro, delta no segundo argumento
+static void BM_Codec_Encode(benchmark::State &state) {
+	const attdet::codec::Format format(static_cast<unsigned>(state.range(0)), state.range(1) != 0);
+	std::vector<Quat> q(4096);
+	attdet::montecarlo::Stream rng(1, 0);
+	for (auto &x : q) { x = rng.attitude(); }
+	if (format.delta) {
+		// Trajetória suave: quase tudo vai como delta
+		for (std::size_t i = 1; i < q.size(); ++i) {
+			q[i] = alglin::normalize(Quat(q[i - 1] + 1E-3 * Quat(rng.attitude())));
+		}
+	}
+	std::vector<unsigned char> buffer(q.size() * format.bytes());
+	attdet::codec::Encoder encoder(format);
+	for (auto _ : state) {
+		encoder.reset();
+		encoder.encode(q.data(), q.data() + q.size(), buffer.data());
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * q.size()));
+}
+BENCHMARK(BM_Codec_Encode)->Args({ 32, 0 })->Args({ 64, 0 })->Args({ 32, 1 });
+
+static void BM_Codec_Decode(benchmark::State &state) {
+	const attdet::codec::Format format(static_cast<unsigned>(state.range(0)), state.range(1) != 0);
+	std::vector<Quat> q(4096);
+	attdet::montecarlo::Stream rng(1, 0);
+	for (auto &x : q) { x = rng.attitude(); }
+	std::vector<unsigned char> buffer(q.size() * format.bytes());
+	attdet::codec::Encoder(format).encode(q.data(), q.data() + q.size(), buffer.data());
+	attdet::codec::Decoder decoder(format);
+	for (auto _ : state) {
+		decoder.reset();
+		decoder.decode(buffer.data(), q.size(), q.data());
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * q.size()));
+}
+BENCHMARK(BM_Codec_Decode)->Args({ 32, 0 })->Args({ 64, 0 })->Args({ 32, 1 });
+
+static void BM_QMETHOD(benchmark::State &state) {
+	constexpr auto shelf = 10000;
+	std::vector<std::array<attdet::Sensor, 2>> sensors(shelf);
+	auto gen = []() {
+		return std::array<attdet::Sensor, 2>{ gen_sensor(), gen_sensor() };
+	};
+	std::generate(sensors.begin(), sensors.end(), gen);
+	Quat q;
+	benchmark::DoNotOptimize(q);
+	std::size_t i = 0;
+	for (auto _ : state) {
+		const auto &s = sensors[i++ % shelf];
+		q = attdet::qmethod({ s[0], s[1] });
+	}
+}
+BENCHMARK(BM_QMETHOD);
+
+static void BM_EIGEN4_Jacobi(benchmark::State &state) {
+	const auto s = gen_sensor();
+	const auto t = gen_sensor();
+	const auto K = attdet::davenport_matrix({ s, t });
+	alglin::EigenDecomposition<double, 4> E;
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(K);
+		E = alglin::eigen_symmetric(K);
+		benchmark::DoNotOptimize(E);
+	}
+}
+BENCHMARK(BM_EIGEN4_Jacobi);
+
+static void BM_EIGEN4_Batch(benchmark::State &state) {
+	constexpr int batch = 16;
+	alglin::SymmetricBatch<double, 4, batch> K{};
+	for (int l = 0; l < batch; ++l) {
+		K.set(l, attdet::davenport_matrix({ gen_sensor(), gen_sensor() }));
+	}
+	alglin::EigenPairBatch<double, 4, batch> E;
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(K);
+		E = alglin::dominant_eigen(K);
+		benchmark::DoNotOptimize(E);
+	}
+	// Tempo por matriz: items_per_second
+	state.SetItemsProcessed(state.iterations() * batch);
+}
+BENCHMARK(BM_EIGEN4_Batch);
+
+
+namespace {
+// Coeficientes com o tamanho do WMM (grau 12); só o custo importa aqui
+attdet::refmodel::GaussCoefficients gen_coefficients(int degree) {
+	using attdet::refmodel::GaussCoefficients;
+	if (degree <= 3) { return GaussCoefficients::igrf13_degree3(); }
+	std::mt19937 g(5);
+	std::uniform_real_distribution<double> vals(-100., 100.);
+	GaussCoefficients out = GaussCoefficients::igrf13_degree3();
+	const auto size = GaussCoefficients::index(degree, degree) + 1;
+	out.degree = degree;
+	for (auto *v : { &out.g, &out.h, &out.dg, &out.dh }) {
+		const auto known = v->size();
+		v->resize(size);
+		for (auto i = known; i < v->size(); ++i) { (*v)[i] = vals(g); }
+	}
+	return out;
+}
+
+std::vector<attdet::refmodel::Geodetic> gen_positions() {
+	std::mt19937 g(6);
+	std::uniform_real_distribution<double> lat(-50., 50.), lon(-180., 180.),
+	  alt(300., 700.);
+	std::vector<attdet::refmodel::Geodetic> out(1024);
+	for (auto &p : out) { p = { lat(g), lon(g), alt(g) }; }
+	return out;
+}
+constexpr double t2021 = 1609459200.;
+}// namespace
+
+static void BM_Magnetic_Full(benchmark::State &state) {
+	const auto model = gen_coefficients(static_cast<int>(state.range(0)));
+	const auto positions = gen_positions();
+	Vec3 b;
+	benchmark::DoNotOptimize(b);
+	std::size_t n = 0;
+	for (auto _ : state) {
+		const auto i = n++ % positions.size();
+		b = attdet::refmodel::magnetic_field(model, positions[i], t2021 + i);
+	}
+}
+BENCHMARK(BM_Magnetic_Full)->Arg(3)->Arg(12);
+
+static void BM_Magnetic_Grid(benchmark::State &state) {
+	attdet::refmodel::ReferenceModel model(
+	  gen_coefficients(static_cast<int>(state.range(0))));
+	const double err =
+	  model.build_grid({ -50., 50., 2., -180., 180., 2., 300., 700., 100., t2021 });
+	const auto positions = gen_positions();
+	Vec3 b;
+	benchmark::DoNotOptimize(b);
+	std::size_t n = 0;
+	for (auto _ : state) {
+		const auto i = n++ % positions.size();
+		b = model.magnetic_field(positions[i], t2021 + i);
+	}
+	state.counters["max_err_nT"] = err;
+}
+BENCHMARK(BM_Magnetic_Grid)->Arg(3)->Arg(12);
+
+static void BM_Sun(benchmark::State &state) {
+	attdet::refmodel::ReferenceModel model(
+	  attdet::refmodel::GaussCoefficients::igrf13_degree3());
+	const auto positions = gen_positions();
+	Vec3 s;
+	benchmark::DoNotOptimize(s);
+	std::size_t n = 0;
+	for (auto _ : state) {
+		const auto i = n % positions.size();
+		// 10 Hz: o cache de ECI só expira a cada 600 amostras
+		s = model.sun_direction(positions[i], t2021 + 0.1 * static_cast<double>(n++));
+	}
+}
+BENCHMARK(BM_Sun);
 
 static void BM_TRIAD(benchmark::State &state) {
 	constexpr auto shelf = 10000;
@@ -67,5 +656,64 @@ static void BM_TRIAD(benchmark::State &state) {
 }
 BENCHMARK(BM_TRIAD);
 
+static void BM_Inverse3_Cofactor(benchmark::State &state) {
+	const auto A = gen_matrix<3>();
+	Matrix3 X;
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(A);
+		X = alglin::inverse(A);
+		benchmark::DoNotOptimize(X);
+	}
+}
+BENCHMARK(BM_Inverse3_Cofactor);
+
+static void BM_Inverse3_LU(benchmark::State &state) {
+	const auto A = gen_matrix<3>();
+	Matrix3 X;
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(A);
+		X = alglin::inverse(alglin::lu(A));
+		benchmark::DoNotOptimize(X);
+	}
+}
+BENCHMARK(BM_Inverse3_LU);
+
+template<int N> static void BM_InverseN_LU(benchmark::State &state) {
+	const auto A = gen_matrix<N>();
+	alglin::SquareMatrix<double, N> X;
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(A);
+		X = alglin::inverse(A);
+		benchmark::DoNotOptimize(X);
+	}
+}
+BENCHMARK_TEMPLATE(BM_InverseN_LU, 4);
+BENCHMARK_TEMPLATE(BM_InverseN_LU, 5);
+BENCHMARK_TEMPLATE(BM_InverseN_LU, 6);
+BENCHMARK_TEMPLATE(BM_InverseN_LU, 7);
+BENCHMARK_TEMPLATE(BM_InverseN_LU, 8);
+BENCHMARK_TEMPLATE(BM_InverseN_LU, 9);
+
+template<int N> static void BM_InverseN_Generic(benchmark::State &state) {
+	const auto A = gen_matrix<N>();
+	std::vector<double> a(N * N);
+	std::vector<double> x(N * N);
+	for (int i = 0; i < N; ++i) {
+		for (int j = 0; j < N; ++j) { a[i * N + j] = A[i][j]; }
+	}
+	LUScratch scratch(N);
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(a.data());
+		inverse_dynamic(a.data(), x.data(), N, scratch);
+		benchmark::DoNotOptimize(x.data());
+	}
+}
+BENCHMARK_TEMPLATE(BM_InverseN_Generic, 4);
+BENCHMARK_TEMPLATE(BM_InverseN_Generic, 5);
+BENCHMARK_TEMPLATE(BM_InverseN_Generic, 6);
+BENCHMARK_TEMPLATE(BM_InverseN_Generic, 7);
+BENCHMARK_TEMPLATE(BM_InverseN_Generic, 8);
+BENCHMARK_TEMPLATE(BM_InverseN_Generic, 9);
+
 // Run the benchmark
 BENCHMARK_MAIN();
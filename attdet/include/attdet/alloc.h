@@ -0,0 +1,64 @@
+#if !defined(_ATT_DET_ALLOC_H_)
+#define _ATT_DET_ALLOC_H_
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+/**
+ * Heap-allocation accounting, for certifying that the per-sample paths
+ * (quest, triad, attdet::io) do not allocate once warmed up.
+ *
+ * The counting operator new/delete live in src/alloc.cpp, built as the
+ * separate `attdet-alloc` target: linking it replaces the global operators
+ * for the whole program and defines ATTDET_COUNT_ALLOCATIONS=1. Without it,
+ * nothing here is linked and the library allocates through the default
+ * operators. Counters are per thread.
+ */
+namespace attdet {
+namespace alloc {
+
+	struct Counts {
+		std::uint64_t allocations;
+		std::uint64_t deallocations;
+		std::uint64_t bytes;// requested by allocations
+	};
+
+	// Totals of the calling thread since it started
+	Counts counts();
+
+	/**
+	 * Allocations of one named stage of a loop, e.g. "parse", "quest"
+	 */
+	struct StageStats {
+		const char *name;
+		std::uint64_t calls;
+		std::uint64_t allocations;
+		std::uint64_t bytes;
+	};
+
+	// Adds what was allocated during its lifetime to a StageStats
+	class Stage {
+	  public:
+		explicit Stage(StageStats &stats) : stats_(stats), start_(counts()) {}
+		~Stage() {
+			const auto end = counts();
+			++stats_.calls;
+			stats_.allocations += end.allocations - start_.allocations;
+			stats_.bytes += end.bytes - start_.bytes;
+		}
+		Stage(const Stage &) = delete;
+		Stage &operator=(const Stage &) = delete;
+
+	  private:
+		StageStats &stats_;
+		Counts start_;
+	};
+
+	// One line per stage: name, calls, allocations, allocations per call, bytes
+	void report(const StageStats *first, const StageStats *last,
+	  std::FILE *out = stderr);
+
+}// namespace alloc
+}// namespace attdet
+
+#endif// _ATT_DET_ALLOC_H_
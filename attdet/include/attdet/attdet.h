@@ -4,7 +4,9 @@
 #define ALGLIN_PRECISION (1E-6)
 #include <alglin/alglin.hpp>
 #include <alglin/array.hpp>
+#include <alglin/fixed.hpp>
 #include <array>
+#include <cstddef>
 #include <initializer_list>
 namespace attdet {
 struct Sensor {
@@ -27,9 +29,124 @@ Matrix3 block_matrix(const Vec3 &a, const Vec3 &b, const Vec3 &c);
 
 enum class Rotations { X, Y, Z, None };
 Quat quest(const std::initializer_list<Sensor> &sensors);
+// Same as above, for lists built at run time (e.g. attdet::starid)
+Quat quest(const Sensor *first, const Sensor *last);
+// QUEST on B = sum(w * measure * reference^T), lambda = sum(w)
+Quat quest_profile(const Matrix3 &B, double lambda);
+
+namespace detail {
+	// B += w * measure * reference^T, one sensor per instantiation
+	template<std::size_t K> struct Accumulate {
+		static void run(const Sensor *sensors, Matrix3 &B, double &lambda) {
+			Accumulate<K - 1>::run(sensors, B, lambda);
+			const Sensor &s = sensors[K - 1];
+			for (int i = 0; i < 3; ++i) {
+				const double wm = s.weight * s.measure[i];
+				for (int j = 0; j < 3; ++j) { B[i][j] += wm * s.reference[j]; }
+			}
+			lambda += s.weight;
+		}
+	};
+	template<> struct Accumulate<0> {
+		static void run(const Sensor *, Matrix3 &, double &) {}
+	};
+}// namespace detail
+
+/**
+ * Sensor suite fixed at compile time (acc + mag, acc + mag + sun): kept by
+ * the caller and updated in place, so no Sensor is copied per sample, and
+ * B is accumulated without a loop.
+ */
+template<std::size_t N> using SensorSet = std::array<Sensor, N>;
+
+template<std::size_t N> Quat quest(const SensorSet<N> &sensors) {
+	static_assert(N >= 2, "QUEST needs at least 2 sensors");
+	Matrix3 B{};
+	double lambda{};
+	detail::Accumulate<N>::run(sensors.data(), B, lambda);
+	return quest_profile(B, lambda);
+}
+
+/**
+ * Two sensors: closed-form optimum (Markley, "Optimal attitude matrix from
+ * two vector measurements", 2008), with neither B nor the Newton step.
+ * Falls back to the general path for parallel vectors or a rotation near
+ * 180 deg about an axis normal to both pairs; built with
+ * ATTDET_QUEST_BRANCHLESS it runs both and masks one out.
+ */
+template<> Quat quest<2>(const SensorSet<2> &sensors);
+
+/**
+ * QUEST over a stream of samples: consecutive attitudes are close, so
+ * Newton starts from the previous lambda_max (scaled by the change in the
+ * sum of weights) and only the previously chosen rotation frame is solved.
+ * The four-frame search of quest() runs again only when the attitude in
+ * that frame nears its singularity (a 180 deg rotation): det(Y) over the
+ * norm of [adj(Y) Z; det(Y)], which is the scalar part of the attitude in
+ * that frame, falls below threshold. Some frame always has it >= 0.5, so
+ * any threshold <= 0.5 ends a search in a valid frame.
+ */
+class StreamingQuest {
+  public:
+	explicit StreamingQuest(double threshold = .25) : threshold_(threshold) {}
+
+	Quat update(const std::initializer_list<Sensor> &sensors);
+	Quat update(const Sensor *first, const Sensor *last);
+	Quat update_profile(const Matrix3 &B, double lambda);
+	// Forgets lambda and the frame: the next update searches, as quest()
+	void reset();
+
+	Rotations frame() const { return static_cast<Rotations>(frame_ < 0 ? 3 : frame_); }
+	double lambda() const { return lambda_; }
+	// Full four-frame searches so far
+	unsigned long long searches() const { return searches_; }
+
+  private:
+	Quat search(const Matrix3 &B, double lambda);
+
+	double threshold_;
+	int frame_ = -1;// index in the rotation table, -1 before the first search
+	double lambda_ = 0.;// last lambda_max
+	double weights_ = 0.;// sum of weights of that sample
+	unsigned long long searches_ = 0;
+};
+
+Matrix4 davenport_matrix(const std::initializer_list<Sensor> &sensors);
+Quat qmethod(const std::initializer_list<Sensor> &sensors);
+/**
+ * QUEST measurement model (Shuster & Oh, 1981): with weights 1 / sigma^2,
+ * the attitude error covariance in the body frame is
+ * P = [sum(w * (I - measure * measure^T))]^-1, rad^2.
+ */
+Matrix3 quest_covariance(const Sensor *first, const Sensor *last);
+
+/**
+ * Fixed-point QUEST for targets without an FPU. Vectors are Q16.16, the
+ * output quaternion is Q2.30 (see alglin/fixed.hpp).
+ */
+using Vec3Q = alglin::Vector<alglin::Q16_16, 3>;
+using QuatQ = alglin::Vector<alglin::Q2_30, 4>;
+
+struct SensorQ {
+	constexpr SensorQ() = default;
+	SensorQ(const Vec3Q &measure_, const Vec3Q &reference_,
+	  alglin::Q16_16 weight_)
+	  : measure(measure_), reference(reference_), weight(weight_) {}
+	// Conversion from double, meant for tests and offline tables
+	explicit SensorQ(const Sensor &sensor);
+	Vec3Q measure{};
+	Vec3Q reference{};
+	alglin::Q16_16 weight{};
+};
+
+QuatQ quest_fixed(const std::initializer_list<SensorQ> &sensors);
+QuatQ quest_fixed(const SensorQ *first, const SensorQ *last);
+Quat to_double(const QuatQ &q);
 
 Matrix3 triad( Sensor const& sensor, Sensor const& sensor2) ;
 Vec3 DCM2Euler(const Matrix3 &A);
+// Rotation matrix of q, such that measure = Quat2DCM(q) * reference
+Matrix3 Quat2DCM(const Quat &q);
 Vec3 Quat2Euler(const Quat &q);
 }// namespace attdet
 
@@ -0,0 +1,104 @@
+#if !defined(_ATT_DET_C_H_)
+#define _ATT_DET_C_H_
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * C interface to attdet, for flight software and other runtimes.
+ *
+ * Plain structs, caller-owned inputs and outputs, status codes. No call
+ * allocates, throws or keeps a pointer after returning, and all are safe
+ * to call concurrently on distinct outputs. Quaternions are (x, y, z, w),
+ * scalar last, with measure = A(q) * reference as in attdet.h.
+ *
+ * Layout and numbering only grow: new members and codes are appended and
+ * ATTDET_C_ABI_VERSION is bumped; check attdet_abi_version() at startup.
+ */
+#define ATTDET_C_ABI_VERSION 1
+#define ATTDET_FIXED_MAX_SENSORS 32
+
+#if defined(__cplusplus)
+#define ATTDET_NOEXCEPT noexcept
+extern "C" {
+#else
+#define ATTDET_NOEXCEPT
+#endif
+
+typedef struct {
+	double x, y, z;
+} attdet_vec3;
+
+typedef struct {
+	double x, y, z, w;
+} attdet_quat;
+
+typedef struct {
+	attdet_vec3 measure;// body frame
+	attdet_vec3 reference;// inertial frame
+	double weight;
+} attdet_sensor;
+
+// Fixed point: vectors and weight Q16.16, quaternion Q2.30 (no FPU needed)
+typedef struct {
+	int32_t measure[3];
+	int32_t reference[3];
+	int32_t weight;
+} attdet_sensor_q;
+
+typedef struct {
+	int32_t x, y, z, w;
+} attdet_quat_q;
+
+typedef enum {
+	ATTDET_OK = 0,
+	ATTDET_ERR_NULL = 1,// required pointer is NULL
+	ATTDET_ERR_COUNT = 2,// fewer than 2 sensors (or too many, fixed point)
+	ATTDET_ERR_WEIGHT = 3,// weights do not sum to a positive value
+	ATTDET_ERR_DEGENERATE = 4// no finite unit solution (e.g. collinear)
+} attdet_status;
+
+int attdet_abi_version(void) ATTDET_NOEXCEPT;
+// Static string for a status, never NULL
+const char *attdet_status_string(attdet_status status) ATTDET_NOEXCEPT;
+
+/**
+ * @brief QUEST on count sensors
+ */
+attdet_status attdet_quest(const attdet_sensor *sensors, size_t count,
+  attdet_quat *out) ATTDET_NOEXCEPT;
+
+/**
+ * @brief QUEST on `samples` independent problems of `count` sensors each,
+ * stored back to back: sample i is sensors[i * count, (i + 1) * count).
+ * @param out samples quaternions
+ * @param status samples codes, or NULL if not needed
+ * @return ATTDET_OK, or the first failing sample's code (that sample's
+ * output is set to the identity and the batch continues)
+ */
+attdet_status attdet_quest_batch(const attdet_sensor *sensors, size_t count,
+  size_t samples, attdet_quat *out, attdet_status *status) ATTDET_NOEXCEPT;
+
+/**
+ * @brief Fixed-point QUEST (attdet::quest_fixed), 2 to
+ * ATTDET_FIXED_MAX_SENSORS sensors
+ */
+attdet_status attdet_quest_fixed(const attdet_sensor_q *sensors, size_t count,
+  attdet_quat_q *out) ATTDET_NOEXCEPT;
+
+/**
+ * @brief TRIAD from two sensors (first is the more accurate one)
+ * @param dcm Row-major 3x3 rotation matrix
+ */
+attdet_status attdet_triad(const attdet_sensor *first,
+  const attdet_sensor *second, double dcm[9]) ATTDET_NOEXCEPT;
+
+attdet_status attdet_quat_to_dcm(const attdet_quat *q, double dcm[9]) ATTDET_NOEXCEPT;
+// Euler angles in degrees, as attdet::Quat2Euler
+attdet_status attdet_quat_to_euler(const attdet_quat *q,
+  attdet_vec3 *out) ATTDET_NOEXCEPT;
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif// _ATT_DET_C_H_
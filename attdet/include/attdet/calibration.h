@@ -0,0 +1,158 @@
+#if !defined(_ATT_DET_CALIBRATION_H_)
+#define _ATT_DET_CALIBRATION_H_
+#include <atomic>
+#include <attdet/attdet.h>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+/**
+ * Hard/soft-iron calibration of a magnetometer (or bias/scale of an
+ * accelerometer at rest): raw samples of a constant field lie on an
+ * ellipsoid (raw - offset)^T A (raw - offset) = 1, and the correction
+ * W = sqrt(A) maps them back to the unit sphere.
+ *
+ * The ellipsoid is fitted as the quadric
+ *   a x^2 + b y^2 + c z^2 + 2f yz + 2g xz + 2h xy + 2p x + 2q y + 2r z = 1
+ * by linear least squares. Only the normal equations are kept (9x9
+ * symmetric plus 9 sums): a sample is one rank-1 update, memory does not
+ * grow with the stream, accumulators can be merged and an exponential
+ * forgetting factor lets the fit follow slow drift.
+ *
+ * Samples are divided by Accumulator's scale (the expected field
+ * magnitude, e.g. 50 uT) before squaring, to keep the normal equations
+ * well conditioned.
+ */
+namespace attdet {
+namespace calibration {
+
+	// corrected = W * (raw - offset), unit length for a fitted field
+	struct Correction {
+		Correction() : offset{}, W(alglin::eye<double, 3>()), radius(1.), residual(0.) {}
+		Vec3 offset;// hard iron / bias, raw units
+		Matrix3 W;// soft iron / scale and misalignment, symmetric
+		double radius;// field magnitude, raw units (mean semi-axis)
+		double residual;// RMS algebraic residual of the fit
+
+		// Corrected unit direction, ready for Sensor::measure
+		Vec3 operator()(const Vec3 &raw) const;
+	};
+
+	/**
+	 * @brief Corrects n samples at once: out[i] = normalize(W (raw[i] -
+	 * offset)). A single branch-free pass (subtract, 3x3 product, 1/sqrt),
+	 * so the compiler vectorizes it across samples. out may alias raw.
+	 */
+	void apply(const Correction &correction, const Vec3 *first, const Vec3 *last,
+	  Vec3 *out);
+
+	class Accumulator {
+	  public:
+		/**
+		 * @param scale Expected field magnitude, raw units
+		 * @param forgetting Weight of the past per sample, (0, 1]; 1 keeps
+		 * every sample, 0.999 remembers roughly the last 1000
+		 */
+		explicit Accumulator(double scale = 1., double forgetting = 1.)
+		  : scale_(scale), inverse_scale_(1. / scale), forgetting_(forgetting) {}
+
+		void add(const Vec3 &raw);
+		void add(const Vec3 *first, const Vec3 *last);
+		// Merges samples gathered elsewhere (same scale); no forgetting applied
+		Accumulator &operator+=(const Accumulator &other);
+		void reset();
+
+		// Effective number of samples
+		double weight() const { return weight_; }
+
+		/**
+		 * @brief Fits the ellipsoid
+		 * @return false with fewer than 9 samples, a quadric that is not an
+		 * ellipsoid, a radius more than a factor 2 away from scale, or
+		 * samples that do not cover the sphere: after correction their
+		 * variance along some axis is below 0.04 (a full sphere gives 1/3,
+		 * a cap of half-angle 1.3 rad about 0.045). out is left untouched.
+		 */
+		bool fit(Correction &out) const;
+
+	  private:
+		alglin::SymmetricMatrix<double, 9> normal_{};// sum d d^T
+		alglin::Vector<double, 9> rhs_{};// sum d
+		double weight_ = 0.;
+		double scale_, inverse_scale_, forgetting_;
+	};
+
+	struct CalibratorOptions {
+		/**
+		 * @param scale_ See Accumulator
+		 * @param forgetting_ See Accumulator
+		 * @param refit_interval_ Samples between fits
+		 * @param min_samples_ No fit before this many samples
+		 * @param background_ Fit on a worker thread instead of inside add()
+		 */
+		explicit CalibratorOptions(double scale_ = 1., double forgetting_ = 1.,
+		  std::size_t refit_interval_ = 500, std::size_t min_samples_ = 100,
+		  bool background_ = true)
+		  : scale(scale_), forgetting(forgetting_), refit_interval(refit_interval_),
+			min_samples(min_samples_), background(background_) {}
+		double scale;
+		double forgetting;
+		std::size_t refit_interval;
+		std::size_t min_samples;
+		bool background;
+	};
+
+	/**
+	 * Accumulates the samples of one sensor in the solve loop and refits
+	 * every refit_interval samples. In background mode add() hands a copy
+	 * of the accumulator to a worker thread and returns: the loop pays one
+	 * rank-1 update per sample, a ~500-byte copy per refit and one atomic
+	 * load to pick up a finished fit, which it adopts on its own thread.
+	 * All calls except fits() must come from one thread.
+	 */
+	class Calibrator {
+	  public:
+		explicit Calibrator(const CalibratorOptions &options = CalibratorOptions());
+		Calibrator(const Calibrator &) = delete;
+		Calibrator &operator=(const Calibrator &) = delete;
+		~Calibrator();
+
+		void add(const Vec3 &raw);
+		// add(raw), then the corrected direction
+		Vec3 update(const Vec3 &raw) {
+			add(raw);
+			return correction_(raw);
+		}
+		Vec3 correct(const Vec3 &raw) const { return correction_(raw); }
+		const Correction &correction() const { return correction_; }
+		// Fits now, on the calling thread; true if the correction changed
+		bool refit();
+		// Fits accepted so far
+		std::uint64_t fits() const { return fits_.load(std::memory_order_relaxed); }
+
+	  private:
+		enum State : int { Idle, Pending, Done, Stop };
+		void work();
+		void collect();
+
+		CalibratorOptions options_;
+		Accumulator accumulator_;
+		Correction correction_;
+		std::size_t since_fit_ = 0;
+		std::atomic<std::uint64_t> fits_{ 0 };
+		// Worker hand-off: Pending -> (worker) -> Done -> (add) -> Idle
+		std::atomic<int> state_{ Idle };
+		Accumulator job_;
+		Correction result_;
+		bool result_ok_ = false;
+		std::mutex mutex_;
+		std::condition_variable wake_;
+		std::thread worker_;
+	};
+
+}// namespace calibration
+}// namespace attdet
+
+#endif// _ATT_DET_CALIBRATION_H_
@@ -0,0 +1,127 @@
+#if !defined(_ATT_DET_CODEC_H_)
+#define _ATT_DET_CODEC_H_
+#include <attdet/attdet.h>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Compact attitude encoding for telemetry and archives.
+ *
+ * Smallest-three: q and -q are the same attitude, so the largest
+ * component (|.| >= 1/2) is made positive and dropped; its index takes 2
+ * bits and the other three, all in [-1/sqrt(2), 1/sqrt(2)], are quantized
+ * uniformly to b = (bits - 2) / 3 bits. The decoder rebuilds the dropped
+ * component from the unit norm. Worst-case rotation error, from rounding
+ * each component by half a step d = sqrt(2) / (2^b - 1):
+ *
+ *   bits  b   max_error
+ *   32   10   4.8E-3 rad (0.27 deg)
+ *   48   15   1.5E-4 rad (0.0086 deg)
+ *   64   20   4.7E-6 rad (0.00027 deg)
+ *
+ * Delta mode (Format::delta) sends the rotation from the previously
+ * *decoded* sample, so errors do not accumulate. Its vector part is
+ * quantized over [-sin(max_step / 2), sin(max_step / 2)] with
+ * (bits - 1) / 3 bits, much finer than a key frame at the same size. A
+ * sample that moved more than max_step, the first one, and every
+ * key_interval-th one go as key frames: smallest-three with (bits - 3) / 3
+ * bits. The first bit of each record tells them apart. max_step must stay
+ * below max_delta_step: past it a delta with all three components at the
+ * range edge has |v|^2 = 3 sin^2(max_step / 2) >= 1 and w is lost.
+ *
+ * Records are bytes() long, little-endian, back to back. Fields from the
+ * least significant bit: [index:2][c0:b][c1:b][c2:b], or in delta mode
+ * [0][index:2][c0..c2] for a key frame and [1][v0..v2] for a delta.
+ *
+ * Batches without delta run through block kernels over SoA arrays; with
+ * USE_SIMD=1 on x86 an AVX2 version is picked at run time (as in
+ * alglin/simd.hpp), giving the same bits as the scalar one.
+ */
+namespace attdet {
+namespace codec {
+
+	// 2 asin(1 / sqrt(3)), rad: largest max_step a delta format accepts
+	constexpr double max_delta_step = 1.2309594173407747;
+
+	struct Format {
+		/**
+		 * @param bits_ Bits per record, 8 to 64 (e.g. 32, 48, 64)
+		 * @param delta_ Delta-encode consecutive samples
+		 * @param max_step_ Largest rotation between samples sent as a
+		 * delta, rad; below max_delta_step in delta mode
+		 * @param key_interval_ Force a key frame every key_interval_
+		 * records so a receiver can join or recover from a loss; 0 = only
+		 * when needed
+		 */
+		explicit Format(unsigned bits_ = 32, bool delta_ = false,
+		  double max_step_ = .05, unsigned key_interval_ = 0)
+		  : bits(bits_), delta(delta_), max_step(max_step_),
+			key_interval(key_interval_) {}
+		unsigned bits;
+		bool delta;
+		double max_step;
+		unsigned key_interval;
+
+		std::size_t bytes() const { return (bits + 7) / 8; }
+		bool valid() const {
+			return bits >= 8 && bits <= 64 && max_step > 0.
+				   && (!delta || max_step < max_delta_step);
+		}
+	};
+
+	/**
+	 * @brief Worst-case rotation angle between q and its decoded value, rad;
+	 * NaN if !format.valid()
+	 * @param key Key frame (or no delta); false for a delta record
+	 */
+	double max_error(const Format &format, bool key = true);
+
+	// Smallest-three with b bits per component (2 to 20), [index:2][c0][c1][c2]
+	std::uint64_t pack(const Quat &q, unsigned b);
+	// Unit quaternion with the dropped component positive
+	Quat unpack(std::uint64_t code, unsigned b);
+
+	// An Encoder or Decoder built with !format.valid() does nothing
+	class Encoder {
+	  public:
+		explicit Encoder(const Format &format) : format_(format) {}
+		bool valid() const { return format_.valid(); }
+		/**
+		 * @brief Writes (last - first) * bytes() bytes to out
+		 * @return Bytes written, 0 if !valid()
+		 */
+		std::size_t encode(const Quat *first, const Quat *last, unsigned char *out);
+		// Next record is a key frame
+		void reset() { count_ = 0; }
+
+	  private:
+		std::uint64_t next(const Quat &q);
+		Format format_;
+		Quat previous_{};// as the decoder sees it
+		unsigned long long count_ = 0;
+	};
+
+	class Decoder {
+	  public:
+		explicit Decoder(const Format &format) : format_(format) {}
+		bool valid() const { return format_.valid(); }
+		/**
+		 * @brief Reads count records from in. A delta record before any key
+		 * frame has no reference and decodes to NaN, as does every record
+		 * if !valid().
+		 * @return Records decoded with a valid attitude
+		 */
+		std::size_t decode(const unsigned char *in, std::size_t count, Quat *out);
+		void reset() { has_previous_ = false; }
+
+	  private:
+		Quat next(std::uint64_t code);
+		Format format_;
+		Quat previous_{};
+		bool has_previous_ = false;
+	};
+
+}// namespace codec
+}// namespace attdet
+
+#endif// _ATT_DET_CODEC_H_
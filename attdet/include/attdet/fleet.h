@@ -0,0 +1,164 @@
+#if !defined(_ATT_DET_FLEET_H_)
+#define _ATT_DET_FLEET_H_
+#include <array>
+#include <atomic>
+#include <attdet/attdet.h>
+#include <attdet/calibration.h>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Ground-station core for many vehicles at once. One ingest thread polls
+ * every input stream (serial port, pty, pipe, file), parses the lines and
+ * routes each sample to the worker that owns its vehicle
+ * (vehicle % workers). A worker keeps all state of its vehicles (sensor
+ * set, magnetometer calibration, metrics) and is the only thread that
+ * touches it, so the hot path takes no lock: ingest and worker meet in a
+ * single-producer/single-consumer ring, and a worker that ran dry is woken
+ * only when it said it was going to sleep. A full ring pushes back: the
+ * stream holding the line is not read again until the worker made room,
+ * so a file is replayed without losing samples.
+ *
+ * Lines are the "ax,ay,az,gx,gy,gz,mx,my,mz" of the serial examples. A
+ * stream added with a vehicle carries that vehicle only; a multiplexed
+ * stream prefixes every line with the vehicle ID: "id,ax,...,mz".
+ *
+ * Metrics are written by the owning worker with relaxed atomics and read
+ * from any thread through metrics().
+ *
+ * Streams are polled with poll(2): outside POSIX the Scheduler builds but
+ * start() returns false.
+ */
+namespace attdet {
+namespace fleet {
+
+	using VehicleId = std::uint32_t;
+
+	struct VehicleConfig {
+		/**
+		 * @param acc_reference_ Gravity in the inertial frame (not normalized)
+		 * @param mag_reference_ Magnetic field in the inertial frame, same
+		 * units as the magnetometer
+		 * @param calibrate_ Fit hard/soft iron on the magnetometer stream
+		 */
+		explicit VehicleConfig(const Vec3 &acc_reference_ = Vec3({ 0., 0., -1. }),
+		  const Vec3 &mag_reference_ = Vec3({ 1., 0., 0. }), double acc_weight_ = .6,
+		  double mag_weight_ = .4, bool calibrate_ = true)
+		  : acc_reference(acc_reference_), mag_reference(mag_reference_),
+			acc_weight(acc_weight_), mag_weight(mag_weight_), calibrate(calibrate_) {}
+		Vec3 acc_reference;
+		Vec3 mag_reference;
+		double acc_weight;
+		double mag_weight;
+		bool calibrate;
+		// Refit every refit_interval samples, inline on the worker (~1 us)
+		std::size_t refit_interval = 500;
+	};
+
+	struct Options {
+		explicit Options(unsigned workers_ = 1) : workers(workers_) {}
+		unsigned workers;// 0 = std::thread::hardware_concurrency()
+		std::size_t queue = 1024;// samples per worker, power of two
+		bool pin = true;// worker i on CPU i % CPUs (Linux)
+		std::size_t max_vehicles = 256;// per worker
+		VehicleConfig defaults{};// vehicles without configure()
+	};
+
+	/**
+	 * Per vehicle. Latency is from the moment the ingest thread parsed the
+	 * line to the end of the solve, in ns; percentiles are the upper edge
+	 * of a power-of-two bin.
+	 */
+	struct VehicleMetrics {
+		VehicleId vehicle;
+		unsigned worker;
+		std::uint64_t samples;
+		double rate;// samples / s between the first and last sample
+		double latency_mean;
+		double latency_p50;
+		double latency_p99;
+		double latency_max;
+	};
+
+	struct Totals {
+		std::uint64_t lines;// complete lines read
+		std::uint64_t malformed;// wrong field count or vehicle ID
+		std::uint64_t dropped;// waiting for a full worker ring at stop()
+		std::uint64_t rejected;// vehicle over max_vehicles
+		std::uint64_t streams_open;
+	};
+
+	namespace detail {
+		struct Worker;
+		struct Vehicle;
+	}// namespace detail
+
+	class Scheduler {
+	  public:
+		// On the worker thread, in sample order per vehicle
+		using Callback = std::function<void(VehicleId vehicle, std::uint64_t sample,
+		  const Quat &attitude)>;
+
+		explicit Scheduler(const Options &options = Options(), Callback callback = nullptr);
+		Scheduler(const Scheduler &) = delete;
+		Scheduler &operator=(const Scheduler &) = delete;
+		// stop()
+		~Scheduler();
+
+		// Setup, before start()
+		void configure(VehicleId vehicle, const VehicleConfig &config);
+		// Every line of fd belongs to vehicle; fd is not closed by the Scheduler
+		bool add_stream(int fd, VehicleId vehicle);
+		// Lines of fd start with the vehicle ID
+		bool add_multiplexed_stream(int fd);
+
+		bool start();
+		/**
+		 * @brief Blocks until every stream reached end of file (or hang-up,
+		 * for a pty whose other side closed) and every sample was solved
+		 */
+		void wait();
+		// Stops reading now, solves what is queued and joins the threads
+		void stop();
+
+		// Snapshot, from any thread
+		std::vector<VehicleMetrics> metrics() const;
+		Totals totals() const;
+		unsigned workers() const { return static_cast<unsigned>(workers_.size()); }
+
+	  private:
+		struct Input {
+			int fd;
+			bool multiplexed;
+			VehicleId vehicle;
+			std::array<char, 256> buffer;
+			std::size_t used;
+			bool blocked;// a line waits for room in a worker ring
+			bool eof;
+		};
+		void ingest();
+		// false: the target ring is full, the line was not consumed
+		bool line(Input &input, const char *text, std::int64_t now);
+		bool drain(Input &input, std::int64_t now);
+		void finish();
+
+		Options options_;
+		Callback callback_;
+		std::unordered_map<VehicleId, VehicleConfig> configs_;
+		std::vector<Input> inputs_;
+		std::vector<std::unique_ptr<detail::Worker>> workers_;
+		std::thread ingest_;
+		std::atomic<bool> stopping_{ false };
+		bool started_ = false, finished_ = false;
+		std::atomic<std::uint64_t> lines_{ 0 }, malformed_{ 0 }, dropped_{ 0 }, streams_open_{ 0 };
+	};
+
+}// namespace fleet
+}// namespace attdet
+
+#endif// _ATT_DET_FLEET_H_
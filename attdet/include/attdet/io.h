@@ -0,0 +1,31 @@
+#if !defined(_ATT_DET_IO_H_)
+#define _ATT_DET_IO_H_
+#include <attdet/attdet.h>
+#include <cstddef>
+
+/**
+ * Per-sample text I/O of the examples, without heap allocation: parsing
+ * works in place on the line buffer and formatting writes into a
+ * caller-provided buffer.
+ */
+namespace attdet {
+namespace io {
+
+	/**
+	 * @brief Reads `count` comma-separated decimal numbers, e.g. the
+	 * "ax,ay,az,gx,gy,gz,mx,my,mz" lines of the serial examples.
+	 * Trailing characters after the last number are ignored.
+	 * @return Numbers read; the line is valid only if it equals count
+	 */
+	std::size_t parse_csv(const char *line, double *out, std::size_t count);
+
+	/**
+	 * @brief Writes "x,y,z,w\n" with 8 decimals into buffer, nul-terminated
+	 * @return Length written, or 0 if it does not fit
+	 */
+	std::size_t format_quat(const Quat &q, char *buffer, std::size_t size);
+
+}// namespace io
+}// namespace attdet
+
+#endif// _ATT_DET_IO_H_
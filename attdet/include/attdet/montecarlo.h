@@ -0,0 +1,117 @@
+#if !defined(_ATT_DET_MONTECARLO_H_)
+#define _ATT_DET_MONTECARLO_H_
+#include <array>
+#include <attdet/attdet.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Monte-Carlo engine for sizing sensors: draws a true attitude, generates
+ * noisy observations for a sensor suite, runs a solver and accumulates the
+ * attitude error.
+ *
+ * Random numbers come from Philox4x32-10, a counter-based generator: trial
+ * i draws from the stream (seed, i), so a trial's numbers do not depend on
+ * which thread runs it or in which order. Trials are grouped in chunks,
+ * each chunk keeps its own Statistics and the chunks are merged in index
+ * order, so results are bit-identical for any thread count.
+ */
+namespace attdet {
+namespace montecarlo {
+
+	/**
+	 * Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as
+	 * 1, 2, 3", SC'11): 128-bit counter and 64-bit key to 4 x 32 bits
+	 */
+	std::array<std::uint32_t, 4> philox(
+	  std::uint64_t key, std::uint64_t counter_hi, std::uint64_t counter_lo);
+
+	class Stream {
+	  public:
+		Stream(std::uint64_t seed, std::uint64_t stream)
+		  : seed_(seed), stream_(stream) {}
+
+		std::uint32_t next();
+		double uniform();// [0, 1), 53 bits
+		double normal();// N(0, 1), Box-Muller
+		Vec3 direction();// uniform on the sphere
+		Quat attitude();// uniform on SO(3) (Shoemake)
+
+	  private:
+		std::uint64_t seed_, stream_;
+		std::uint64_t counter_ = 0;
+		std::array<std::uint32_t, 4> block_{};
+		int used_ = 4;
+		bool has_spare_ = false;
+		double spare_ = 0.;
+	};
+
+	struct SensorModel {
+		/**
+		 * @param noise_ 1-sigma angular noise per axis, rad
+		 * @param reference_ Fixed reference direction; zero draws a random
+		 * one per trial (e.g. stars)
+		 * @param weight_ QUEST weight; 0 uses 1 / noise^2
+		 */
+		explicit SensorModel(double noise_, const Vec3 &reference_ = Vec3{},
+		  double weight_ = 0.)
+		  : noise(noise_), reference(reference_), weight(weight_) {}
+		double noise;
+		Vec3 reference;
+		double weight;
+	};
+
+	enum class Attitudes {
+		Uniform,// whole SO(3)
+		Cone// rotation angle uniform in [0, cone], axis uniform
+	};
+
+	using Solver = Quat (*)(const Sensor *first, const Sensor *last);
+
+	struct Options {
+		explicit Options(std::uint64_t trials_ = 1000000, std::uint64_t seed_ = 1)
+		  : trials(trials_), seed(seed_) {}
+		std::uint64_t trials;
+		std::uint64_t seed;
+		unsigned threads = 0;// 0 = std::thread::hardware_concurrency()
+		std::uint64_t chunk = 65536;// trials per work item
+		Attitudes attitudes = Attitudes::Uniform;
+		double cone = 0.;// rad, for Attitudes::Cone
+		Solver solver = nullptr;// nullptr = quest
+	};
+
+	/**
+	 * Attitude error (rotation angle between estimate and truth, rad)
+	 */
+	struct Statistics {
+		// Log-spaced histogram: bins_per_decade from 1E-9 rad up to pi
+		static constexpr int bins_per_decade = 32;
+		static constexpr int bins = 10 * bins_per_decade;
+
+		std::uint64_t trials = 0;
+		std::uint64_t failures = 0;// non-finite estimate
+		double sum = 0., sum_squares = 0., max = 0.;
+		std::array<std::uint64_t, bins> histogram{};
+
+		void add(double error);
+		void merge(const Statistics &other);
+		double mean() const;
+		double rms() const;
+		// Upper edge of the bin holding the p-th fraction, p in [0, 1]
+		double percentile(double p) const;
+	};
+
+	/**
+	 * @brief One trial: draws the truth and fills out[k] for suite[k]
+	 * @return True attitude, measure = Quat2DCM(q) * reference + noise
+	 */
+	Quat observe(Stream &stream, const SensorModel *first,
+	  const SensorModel *last, Sensor *out, const Options &options);
+
+	Statistics run(const std::vector<SensorModel> &suite, const Options &options);
+
+}// namespace montecarlo
+}// namespace attdet
+
+#endif// _ATT_DET_MONTECARLO_H_
@@ -0,0 +1,129 @@
+#if !defined(_ATT_DET_REFMODEL_H_)
+#define _ATT_DET_REFMODEL_H_
+#include <attdet/attdet.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Reference vectors for Sensor::reference, in the local NED frame
+ * (north, east, down) at the vehicle position:
+ *  - geomagnetic field from a spherical-harmonic model (IGRF/WMM Gauss
+ *    coefficients, .COF files), in nT;
+ *  - sun direction from a low-precision ephemeris (~0.01 deg).
+ *
+ * Full evaluation costs O(degree^2) trig-free recurrences per sample. For
+ * vehicles that stay inside a known region, build_grid() tabulates the field
+ * and its secular variation once; evaluation is then a trilinear lookup, with
+ * the worst interpolation error measured at build time.
+ *
+ * Time is UTC seconds since 1970-01-01 (Unix time).
+ */
+namespace attdet {
+namespace refmodel {
+
+	struct Geodetic {
+		double latitude;// deg
+		double longitude;// deg
+		double altitude;// km above the WGS84 ellipsoid
+	};
+
+	/**
+	 * Schmidt semi-normalized Gauss coefficients, nT and nT/year, stored
+	 * by (n, m) at n * (n + 1) / 2 + m.
+	 */
+	struct GaussCoefficients {
+		int degree{};
+		double epoch{};// decimal year
+		std::vector<double> g{}, h{}, dg{}, dh{};
+
+		static int index(int n, int m) { return n * (n + 1) / 2 + m; }
+		bool valid() const { return degree > 0; }
+		/**
+		 * @brief Reads a WMM/IGRF-style .COF file ("n m g h dg dh" lines).
+		 * Returns invalid coefficients (degree 0) on error.
+		 */
+		static GaussCoefficients load(const std::string &path);
+		/**
+		 * @brief IGRF-13 truncated to degree 3, epoch 2020. Only a fallback:
+		 * it misses the crustal and higher-order terms (a few degrees of
+		 * direction error); load a full .COF for flight.
+		 */
+		static GaussCoefficients igrf13_degree3();
+	};
+
+	/**
+	 * @brief Full spherical-harmonic evaluation
+	 * @return Field in NED, nT
+	 */
+	Vec3 magnetic_field(const GaussCoefficients &model, const Geodetic &position,
+	  double time);
+
+	/**
+	 * @brief Unit vector to the sun in ECI (mean equator and equinox of date)
+	 */
+	Vec3 sun_eci(double time);
+	/**
+	 * @brief Unit vector to the sun in NED
+	 */
+	Vec3 sun_direction(const Geodetic &position, double time);
+
+	/**
+	 * Grid bounds and steps, e.g. a LEO band around the launch epoch:
+	 *   { -60, 60, 2, -180, 180, 2, 0, 1000, 250, epoch }
+	 */
+	struct GridSpec {
+		double lat_min, lat_max, lat_step;// deg
+		double lon_min, lon_max, lon_step;// deg
+		double alt_min, alt_max, alt_step;// km
+		double epoch;// Unix time where the grid is exact in time
+	};
+
+	struct ReferenceVectors {
+		Vec3 magnetic;// nT, NED
+		Vec3 sun;// unit, NED
+	};
+
+	class ReferenceModel {
+	  public:
+		explicit ReferenceModel(GaussCoefficients coefficients)
+		  : model_(std::move(coefficients)) {}
+
+		/**
+		 * @brief Tabulates the field (and its secular variation) over spec.
+		 * Positions outside the grid fall back to full evaluation.
+		 * @return Bound on the interpolation error, nT, for times from
+		 * spec.epoch to one year later: per cell, the trilinear error bound
+		 * sum(h^2 |f''|) / 8 with the curvature taken from second
+		 * differences at the corners (2x margin), and never below the error
+		 * measured at the cell center
+		 */
+		double build_grid(const GridSpec &spec);
+		bool has_grid() const { return !grid_.empty(); }
+		double grid_error() const { return grid_error_; }
+
+		Vec3 magnetic_field(const Geodetic &position, double time) const;
+		// Sun in ECI is cached and only recomputed after sun_cache seconds
+		Vec3 sun_direction(const Geodetic &position, double time);
+		ReferenceVectors evaluate(const Geodetic &position, double time);
+
+		static constexpr double sun_cache = 60.;
+
+	  private:
+		bool inside(const Geodetic &position) const;
+		Vec3 interpolate(const Geodetic &position, double time) const;
+
+		GaussCoefficients model_;
+		GridSpec spec_{};
+		int nlat_{}, nlon_{}, nalt_{};
+		// Per node: field at spec_.epoch and its rate (nT/s), 6 doubles
+		std::vector<double> grid_{};
+		double grid_error_{};
+		double sun_time_{ -1E300 };
+		Vec3 sun_eci_{};
+	};
+
+}// namespace refmodel
+}// namespace attdet
+
+#endif// _ATT_DET_REFMODEL_H_
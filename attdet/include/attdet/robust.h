@@ -0,0 +1,56 @@
+#if !defined(_ATT_DET_ROBUST_H_)
+#define _ATT_DET_ROBUST_H_
+#include <attdet/attdet.h>
+#include <cstddef>
+#include <initializer_list>
+#include <vector>
+
+/**
+ * Robust QUEST: RANSAC over pairs of observations.
+ *
+ * Each pair gives a candidate attitude; the candidate is scored by how many
+ * observations agree with it (residual angle below threshold) and, among
+ * those, by their Wahba loss. The best candidate's inliers are re-solved
+ * with plain QUEST. If no candidate has 2 inliers (every observation
+ * disagrees), the attitude is QUEST over all observations and
+ * inlier_count reports how few agree with it.
+ *
+ * The per-observation terms w * measure * reference^T are computed once and
+ * shared: a subset B is the sum of its members' terms, and the final B is
+ * the full B minus the outliers' terms. Cost is bounded by max_subsets
+ * QUEST solves plus one, split into `threads` batches.
+ */
+namespace attdet {
+
+struct RobustOptions {
+	explicit RobustOptions(double threshold_ = 0.0087,
+	  std::size_t max_subsets_ = 32, unsigned threads_ = 1)
+	  : threshold(threshold_), max_subsets(max_subsets_), threads(threads_) {}
+	double threshold;// rad, largest residual of an inlier (default 0.5 deg)
+	std::size_t max_subsets;// pairs evaluated, at most
+	/**
+	 * Parallel batches, 1 = run on the calling thread. Each batch is a
+	 * thread created and joined per call, which costs about as much as 100
+	 * pair solves, so batches are never smaller than min_batch pairs: with
+	 * the default max_subsets everything runs on the calling thread, and
+	 * threads only pays off from several hundred subsets.
+	 */
+	unsigned threads;
+	static constexpr std::size_t min_batch = 128;
+};
+
+struct RobustResult {
+	Quat attitude{};
+	std::vector<bool> inliers{};// one per Sensor, in input order
+	std::size_t inlier_count{};
+	double loss{};// Wahba loss of the inliers, sum(w * (1 - cos(residual)))
+};
+
+RobustResult quest_robust(const Sensor *first, const Sensor *last,
+  const RobustOptions &options = RobustOptions());
+RobustResult quest_robust(const std::initializer_list<Sensor> &sensors,
+  const RobustOptions &options = RobustOptions());
+
+}// namespace attdet
+
+#endif// _ATT_DET_ROBUST_H_
@@ -0,0 +1,121 @@
+#if !defined(_ATT_DET_SHM_H_)
+#define _ATT_DET_SHM_H_
+#include <attdet/attdet.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * Latest attitude in POSIX shared memory (/dev/shm), for local consumers
+ * (controller, logger, camera trigger) that need it in well under a
+ * microsecond instead of through a socket.
+ *
+ * One Publisher per segment writes a State under a seqlock: the sequence
+ * is odd while a write is in progress, and readers copy the State and
+ * retry if the sequence changed meanwhile. Readers map the segment
+ * read-only and never write to it, so they cannot block or slow down the
+ * writer; a write is a copy of State (under 1 KB) and two stores.
+ *
+ * State is copied as 64-bit words through relaxed atomics, so the layout
+ * is native (endianness and alignment of the host) and both sides must be
+ * built with the same ATTDET_SHM_MAX_SENSORS.
+ */
+#if !defined(ATTDET_SHM_MAX_SENSORS)
+#define ATTDET_SHM_MAX_SENSORS 8
+#endif
+
+namespace attdet {
+namespace shm {
+
+	constexpr std::size_t max_sensors = ATTDET_SHM_MAX_SENSORS;
+
+	struct SensorSnapshot {
+		double measure[3];// body frame
+		double reference[3];// inertial frame
+		double weight;
+	};
+
+	struct State {
+		std::uint64_t time;// ns, std::chrono::steady_clock (CLOCK_MONOTONIC)
+		std::uint64_t sample;// set by Publisher::publish(), 1, 2, ...
+		double attitude[4];// x, y, z, w
+		double covariance[9];// attitude error, rad^2, row-major
+		std::uint64_t sensor_count;
+		SensorSnapshot sensors[max_sensors];
+	};
+
+	/**
+	 * @brief Fills a State from a solution; keeps the first max_sensors
+	 * sensors. covariance may be nullptr (left zero).
+	 */
+	State snapshot(std::uint64_t time, const Quat &attitude,
+	  const Matrix3 *covariance, const Sensor *first, const Sensor *last);
+
+	struct Segment;// layout in shm.cpp
+
+	class Publisher {
+	  public:
+		Publisher() = default;
+		Publisher(Publisher &&other) noexcept;
+		Publisher &operator=(Publisher &&other) noexcept;
+		Publisher(const Publisher &) = delete;
+		Publisher &operator=(const Publisher &) = delete;
+		// Unmaps; the segment stays until unlink() so readers keep the last State
+		~Publisher();
+
+		/**
+		 * @brief Creates (or takes over) the segment, e.g. "/attdet" for
+		 * /dev/shm/attdet. Returns an invalid Publisher on failure. Taking
+		 * over a segment whose previous writer died mid-write discards the
+		 * half-written State: readers see nothing published until the next
+		 * publish().
+		 */
+		static Publisher create(const std::string &name, unsigned mode = 0644);
+		static bool unlink(const std::string &name);
+
+		bool valid() const { return segment_ != nullptr; }
+		// Never blocks; state.sample is overwritten with the running count
+		void publish(const State &state) noexcept;
+
+	  private:
+		void release();
+		Segment *segment_{ nullptr };
+		std::uint64_t sample_{};
+	};
+
+	class Reader {
+	  public:
+		Reader() = default;
+		Reader(Reader &&other) noexcept;
+		Reader &operator=(Reader &&other) noexcept;
+		Reader(const Reader &) = delete;
+		Reader &operator=(const Reader &) = delete;
+		~Reader();
+
+		// Maps an existing segment read-only; invalid if missing or malformed
+		static Reader open(const std::string &name);
+
+		bool valid() const { return segment_ != nullptr; }
+		/**
+		 * @brief Consistent copy of the latest State, spinning while a
+		 * write is in progress (a few tens of ns), then sleeping in short
+		 * steps if the publisher was preempted mid-write
+		 * @return false if nothing was published yet, or if a write stayed
+		 * in progress for about 5 ms (a publisher killed mid-write); out
+		 * may then be partly overwritten
+		 */
+		bool read(State &out) const noexcept;
+		// Single attempt: false if nothing published or a write overlapped
+		bool try_read(State &out) const noexcept;
+		// Changes on every publish(): poll this before copying the State
+		std::uint64_t sequence() const noexcept;
+
+	  private:
+		void release();
+		const Segment *segment_{ nullptr };
+	};
+
+}// namespace shm
+}// namespace attdet
+
+#endif// _ATT_DET_SHM_H_
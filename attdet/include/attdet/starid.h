@@ -0,0 +1,129 @@
+#if !defined(_ATT_DET_STARID_H_)
+#define _ATT_DET_STARID_H_
+#include <attdet/attdet.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Star identification (lost-in-space) for star trackers.
+ *
+ * The catalog index is a k-vector (Mortari) over the angular distance of
+ * every catalog star pair closer than the field of view: a sorted pair list
+ * plus a lookup table that turns "pairs with angle in [a, b]" into an index
+ * range in O(1), without binary search.
+ *
+ * The index is built offline (build() + save()) and loaded with load(),
+ * which maps the file read-only and makes one pass over the pair and
+ * k-vector tables to check them. The file layout is native (endianness
+ * and alignment of the host that built it).
+ *
+ * identify() matches observed body-frame vectors to catalog stars with the
+ * pyramid scheme (triangle + one confirming star) and returns the list of
+ * Sensor ready for attdet::quest().
+ */
+namespace attdet {
+namespace starid {
+
+	struct CatalogStar {
+		std::uint32_t id;
+		Vec3 direction;// Unit vector, inertial frame
+	};
+
+	// Records as stored in the index file
+	struct StarRecord {
+		std::uint32_t id;
+		std::uint32_t reserved;
+		double direction[3];
+	};
+	struct PairRecord {
+		double angle;// rad
+		std::uint32_t a;// indices into the star table
+		std::uint32_t b;
+	};
+
+	class StarIndex {
+	  public:
+		StarIndex() = default;
+		StarIndex(StarIndex &&other) noexcept;
+		StarIndex &operator=(StarIndex &&other) noexcept;
+		StarIndex(const StarIndex &) = delete;
+		StarIndex &operator=(const StarIndex &) = delete;
+		~StarIndex();
+
+		/**
+		 * @brief Builds the index in memory
+		 * @param catalog Catalog stars (directions must be unit vectors)
+		 * @param fov Largest pair angle kept, rad (the sensor field of view)
+		 */
+		static StarIndex build(const std::vector<CatalogStar> &catalog,
+		  double fov);
+		/**
+		 * @brief Maps an index file written by save(). Returns an invalid
+		 * index (valid() == false) if the file is missing or malformed.
+		 */
+		static StarIndex load(const std::string &path);
+		bool save(const std::string &path) const;
+
+		bool valid() const { return header() != nullptr; }
+		bool mapped() const { return map_ != nullptr; }
+		double fov() const;
+		std::size_t stars() const;
+		std::size_t pairs() const;
+
+		const StarRecord &star(std::size_t i) const { return stars_[i]; }
+		Vec3 direction(std::size_t i) const;
+		const PairRecord *pair_data() const { return pairs_; }
+
+		/**
+		 * @brief Pairs with angle in [lo, hi], in O(1) plus the size of
+		 * the answer
+		 */
+		void range(double lo, double hi, const PairRecord *&first,
+		  const PairRecord *&last) const;
+
+		struct Header;// File header, layout in starid.cpp
+
+	  private:
+		const Header *header() const;
+		void bind(const unsigned char *blob, std::size_t size);
+		void release();
+
+		std::vector<unsigned char> owned_{};
+		void *map_{ nullptr };
+		std::size_t map_size_{};
+		const unsigned char *blob_{ nullptr };
+		const StarRecord *stars_{ nullptr };
+		const PairRecord *pairs_{ nullptr };
+		const std::uint32_t *k_{ nullptr };
+	};
+
+	struct Match {
+		std::size_t observed;// index into the observed list
+		std::size_t star;// index into the catalog (StarIndex::star())
+	};
+
+	/**
+	 * @brief Lost-in-space identification.
+	 *
+	 * @param index Catalog index
+	 * @param observed Body-frame unit vectors from the star tracker
+	 * @param tolerance Angular tolerance for a pair match, rad
+	 * @return Matches for every observed star that could be confirmed,
+	 * empty if no unambiguous pyramid (or triangle, for 3 stars) was found
+	 */
+	std::vector<Match> identify(const StarIndex &index,
+	  const std::vector<Vec3> &observed, double tolerance);
+
+	/**
+	 * @brief Matches as Sensor (measure = observed, reference = catalog),
+	 * weights summing to 1. Feed with quest(s.data(), s.data() + s.size()).
+	 */
+	std::vector<Sensor> to_sensors(const StarIndex &index,
+	  const std::vector<Vec3> &observed, const std::vector<Match> &matches);
+
+}// namespace starid
+}// namespace attdet
+
+#endif// _ATT_DET_STARID_H_
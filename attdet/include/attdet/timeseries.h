@@ -0,0 +1,71 @@
+#if !defined(_ATT_DET_TIMESERIES_H_)
+#define _ATT_DET_TIMESERIES_H_
+#include <attdet/attdet.h>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+/**
+ * Resampling of timestamped attitudes onto a fixed-rate grid.
+ *
+ * Input samples must be sorted by time. Output times are the multiples of
+ * 1 / rate between the first and last input times. Each output interpolates
+ * the two inputs around it, by SLERP or by SQUAD (C1 across samples). An
+ * optional on-manifold smoothing then replaces it with a Gaussian-weighted
+ * local linear fit of the nearby inputs, in the tangent space at the
+ * interpolated value; the fit keeps uniform rotation unbiased, also at the
+ * ends of the log where the window is one-sided.
+ *
+ * q and -q are the same attitude: inputs are aligned to a common hemisphere
+ * locally before interpolating, and the output is kept continuous, so a sign
+ * flip in the log never shows up as a spin.
+ *
+ * Outputs are produced in chunks of `chunk` samples, `threads` chunks at a
+ * time, and handed to the sink in time order; memory is threads * chunk
+ * samples whatever the log length.
+ */
+namespace attdet {
+namespace timeseries {
+
+	struct Sample {
+		double time;// s
+		Quat attitude;// unit, (x, y, z, w)
+	};
+
+	enum class Interpolation { Slerp, Squad };
+
+	struct Options {
+		explicit Options(double rate_ = 10.,
+		  Interpolation interpolation_ = Interpolation::Squad)
+		  : rate(rate_), interpolation(interpolation_) {}
+		double rate;// Hz
+		Interpolation interpolation;
+		double smoothing = 0.;// s, Gaussian sigma; 0 = off
+		double max_gap = 0.;// s; no output across larger input gaps; 0 = off
+		std::size_t chunk = 4096;// outputs per work item
+		unsigned threads = 1;// chunks in flight, 1 = calling thread only
+	};
+
+	// Receives consecutive outputs, [first, last), in time order
+	using Sink = std::function<void(const Sample *first, const Sample *last)>;
+
+	void resample(const Sample *first, const Sample *last,
+	  const Options &options, const Sink &sink);
+	std::vector<Sample> resample(
+	  const Sample *first, const Sample *last, const Options &options);
+
+	// Shortest-path spherical interpolation, t in [0, 1]
+	Quat slerp(const Quat &a, const Quat &b, double t);
+	/**
+	 * @brief SQUAD between q1 and q2 with control points s1 and s2
+	 * (see squad_control)
+	 */
+	Quat squad(const Quat &q1, const Quat &q2, const Quat &s1, const Quat &s2,
+	  double t);
+	// Control point at q1 from its neighbours, all in q1's hemisphere
+	Quat squad_control(const Quat &q0, const Quat &q1, const Quat &q2);
+
+}// namespace timeseries
+}// namespace attdet
+
+#endif// _ATT_DET_TIMESERIES_H_
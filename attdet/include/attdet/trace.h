@@ -0,0 +1,98 @@
+#if !defined(_ATT_DET_TRACE_H_)
+#define _ATT_DET_TRACE_H_
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+/**
+ * Solver tracepoints: which rotation candidate quest() chose, its distance
+ * to the singularity (det Y) and the Newton residual, recorded under load
+ * for post-mortem analysis.
+ *
+ * ATTDET_TRACE selects what ATTDET_TRACE_POINT expands to when the library
+ * is compiled (cmake -DATTDET_TRACE=OFF|RING|USDT):
+ *  - 0 (default): nothing, the arguments are not even evaluated;
+ *  - 1: a fixed-size Record in a per-thread ring buffer. Rings come from a
+ *    static pool, one per live thread: no locks and no heap allocation.
+ *    The oldest records are overwritten; snapshot()/dump() read all rings
+ *    from any thread and `attdet-trace` decodes a dump;
+ *  - 2: USDT probes (provider "attdet", one probe per Event), for perf or
+ *    bpftrace. Needs <sys/sdt.h>; the doubles arrive as raw bits.
+ */
+#if !defined(ATTDET_TRACE)
+#define ATTDET_TRACE 0
+#endif
+// Ring capacity (power of two) and number of rings, for ATTDET_TRACE=1
+#if !defined(ATTDET_TRACE_RECORDS)
+#define ATTDET_TRACE_RECORDS 256
+#endif
+#if !defined(ATTDET_TRACE_THREADS)
+#define ATTDET_TRACE_THREADS 16
+#endif
+
+namespace attdet {
+namespace trace {
+
+	enum class Event : std::uint16_t {
+		// tag: rotation (0 X, 1 Y, 2 Z, 3 None); det Y, lambda, f(lambda),
+		// 1 if it became the selection
+		QuestCandidate = 1,
+		// tag: chosen rotation (StreamingQuest searches, 0 from quest());
+		// best det Y, lambda, |q| before normalization, 0
+		QuestResult = 2,
+	};
+
+	struct Record {
+		std::uint64_t sequence;// per ring, gaps mean overwritten records
+		std::uint64_t time;// steady_clock, ns
+		Event event;
+		std::uint16_t tag;
+		std::uint32_t thread;// ring index
+		double value[4];
+	};
+
+	void emit(Event event, std::uint16_t tag, double a, double b, double c,
+	  double d) noexcept;
+
+	/**
+	 * @brief Copies the records still held by every ring, sorted by time.
+	 * Safe while other threads keep emitting: records overwritten during
+	 * the copy are left out.
+	 * @return Records written to out, at most capacity
+	 */
+	std::size_t snapshot(Record *out, std::size_t capacity);
+
+	// Records lost because every ring was taken by a live thread
+	std::uint64_t dropped();
+
+	const char *event_name(Event event);
+
+	/**
+	 * @brief Binary dump of snapshot(): header ("ATTDTRC", version, record
+	 * size) followed by the records, in host byte order
+	 * @return Records written, or -1 on write error
+	 */
+	long dump(std::FILE *out);
+
+	/**
+	 * @brief Dump to text, one line per record
+	 * @return Records decoded, or -1 if the header does not match
+	 */
+	long decode(std::FILE *in, std::FILE *out);
+
+}// namespace trace
+}// namespace attdet
+
+#if ATTDET_TRACE == 1
+#define ATTDET_TRACE_POINT(event, tag, a, b, c, d)                              \
+	::attdet::trace::emit(::attdet::trace::Event::event,                        \
+	  static_cast<std::uint16_t>(tag), a, b, c, d)
+#elif ATTDET_TRACE == 2
+#include <sys/sdt.h>
+#define ATTDET_TRACE_POINT(event, tag, a, b, c, d)                              \
+	DTRACE_PROBE5(attdet, event, tag, a, b, c, d)
+#else
+#define ATTDET_TRACE_POINT(event, tag, a, b, c, d) ((void)0)
+#endif
+
+#endif// _ATT_DET_TRACE_H_
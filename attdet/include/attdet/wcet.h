@@ -0,0 +1,95 @@
+#if !defined(_ATT_DET_WCET_H_)
+#define _ATT_DET_WCET_H_
+#include <array>
+#include <attdet/attdet.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Worst-case execution time profile of a solver. The mean of BM_QUEST
+ * hides the inputs that take the data-dependent paths: det(Y) == 0,
+ * frame selection near a 180 deg rotation, the fallback of quest<2>,
+ * subnormal or non-finite arithmetic. profile() times the solver on
+ * random geometries and on generators aimed at those paths, then climbs
+ * from the slowest inputs found by perturbing them, and keeps the worst
+ * ones so they can be pasted into a regression test (to_cpp()).
+ *
+ * An input's cost is the minimum over repeats back-to-back runs. This
+ * filters interrupts and cache misses of the harness itself, so what is
+ * left is the cost of the input. Ticks are those of cycles(): the TSC
+ * (constant-rate reference cycles) on x86, CNTVCT on AArch64, ns
+ * elsewhere. Pin the thread and fix the CPU frequency for numbers that
+ * mean anything.
+ */
+namespace attdet {
+namespace wcet {
+
+	// Serialized read of the CPU counter
+	std::uint64_t cycles();
+
+	enum class Geometry {
+		Random,// uniform attitude and directions
+		NearParallel,// angle between the two references down to 1E-8 rad
+		AntiParallel,// same, around 180 deg
+		Rotation180,// attitude near 180 deg, often about a coordinate axis
+		Degenerate,// zero vector, zero weight, identical pairs
+		Scale,// huge, tiny and subnormal magnitudes
+		NonFinite,// NaN and inf components
+		Search// perturbation of a slow input
+	};
+	constexpr int geometries = 8;
+	const char *name(Geometry geometry);
+
+	using Solver = Quat (*)(const Sensor *first, const Sensor *last);
+
+	struct Options {
+		explicit Options(std::uint64_t inputs_ = 100000, std::uint64_t seed_ = 1)
+		  : inputs(inputs_), seed(seed_) {}
+		std::uint64_t inputs;// generated, spread over every Geometry but Search
+		std::uint64_t seed;
+		std::size_t sensors = 2;// per input, >= 2
+		int repeats = 5;// runs per input, the minimum is kept
+		std::uint64_t search_steps = 2000;// perturbations, spread over the worst
+		std::size_t worst = 16;// inputs kept
+		Solver solver = nullptr;// nullptr = quest
+	};
+
+	struct Case {
+		Geometry geometry;
+		std::uint64_t ticks;
+		std::vector<Sensor> sensors;
+		Quat attitude;// solver output
+	};
+
+	struct Profile {
+		// Log-spaced histogram of ticks per input: bins_per_octave up to 2^32
+		static constexpr int bins_per_octave = 8;
+		static constexpr int bins = 32 * bins_per_octave;
+
+		std::uint64_t inputs = 0;
+		std::uint64_t overhead = 0;// ticks of an empty timed region, subtracted
+		std::uint64_t min = 0, max = 0;
+		double mean = 0.;
+		std::array<std::uint64_t, bins> histogram{};
+		// Slowest input per geometry
+		std::array<std::uint64_t, geometries> max_by_geometry{};
+		std::vector<Case> worst;// slowest first
+
+		// Upper edge of the bin holding the p-th fraction, p in [0, 1]
+		double percentile(double p) const;
+	};
+
+	Profile profile(const Options &options = Options());
+
+	/**
+	 * @brief The case as C++: a commented std::vector<attdet::Sensor>
+	 * initializer with every double printed to round-trip exactly
+	 */
+	std::string to_cpp(const Case &c);
+
+}// namespace wcet
+}// namespace attdet
+
+#endif// _ATT_DET_WCET_H_
@@ -0,0 +1,269 @@
+/**
+ * @file attdet_py.cpp
+ * @brief Módulo Python: QUEST em lote sobre buffers (NumPy) sem cópia
+ *
+ * Python:
+ *   import attdet
+ *   q = attdet.quest_batch(measure, reference, weights=None, out=None)
+ *
+ *   measure    (N, k, 3) float64, body frame
+ *   reference  (N, k, 3) or (k, 3) float64, inertial frame
+ *   weights    (k,) or (N, k) float64, default 1/k each
+ *   out        (N, 4) float64, writable; allocated when omitted
+ *   q          (N, 4) quaternions (x, y, z, w), measure = A(q) reference
+ *
+ *   e = attdet.quat_to_euler_batch(q, out=None)   # (N, 4) -> (N, 3), deg
+ *
+ * Inputs are read through the buffer protocol with their own strides, so
+ * slices and transposed views are not copied. The GIL is released while
+ * solving. The result is a numpy.ndarray when NumPy is importable, a
+ * memoryview otherwise.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <attdet/attdet.h>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+// Buffer liberado no destrutor, para todos os caminhos de erro
+struct Buffer {
+	Py_buffer view{};
+	bool held = false;
+	~Buffer() {
+		if (held) { PyBuffer_Release(&view); }
+	}
+	double at(Py_ssize_t i) const {
+		return *reinterpret_cast<const double *>(
+		  static_cast<const char *>(view.buf) + i * view.strides[0]);
+	}
+	double at(Py_ssize_t i, Py_ssize_t j) const {
+		return *reinterpret_cast<const double *>(static_cast<const char *>(view.buf)
+												 + i * view.strides[0]
+												 + j * view.strides[1]);
+	}
+	double at(Py_ssize_t i, Py_ssize_t j, Py_ssize_t l) const {
+		return *reinterpret_cast<const double *>(
+		  static_cast<const char *>(view.buf) + i * view.strides[0]
+		  + j * view.strides[1] + l * view.strides[2]);
+	}
+	double &ref(Py_ssize_t i, Py_ssize_t j) {
+		return *reinterpret_cast<double *>(
+		  static_cast<char *>(view.buf) + i * view.strides[0] + j * view.strides[1]);
+	}
+};
+
+bool is_float64(const Py_buffer &view) {
+	const char *f = view.format;
+	if (f == nullptr) { return false; }
+	if (*f == '@' || *f == '=' || *f == '<' || *f == '!' || *f == '>') {
+		// Só a ordem nativa
+		const bool little = PY_LITTLE_ENDIAN;
+		if ((*f == '<' && !little) || ((*f == '>' || *f == '!') && little)) {
+			return false;
+		}
+		++f;
+	}
+	return std::strcmp(f, "d") == 0;
+}
+
+// Buffer float64 de qualquer forma, com strides
+bool acquire(PyObject *object, Buffer &buffer, const char *name,
+  bool writable = false) {
+	const int flags =
+	  (writable ? PyBUF_WRITABLE : 0) | PyBUF_STRIDES | PyBUF_FORMAT;
+	if (PyObject_GetBuffer(object, &buffer.view, flags) != 0) { return false; }
+	buffer.held = true;
+	if (!is_float64(buffer.view)) {
+		PyErr_Format(PyExc_TypeError, "%s: expected float64", name);
+		return false;
+	}
+	return true;
+}
+
+// shape -1 aceita qualquer tamanho
+bool has_shape(const Buffer &buffer, int ndim, const Py_ssize_t *shape) {
+	if (buffer.view.ndim != ndim) { return false; }
+	for (int d = 0; d < ndim; ++d) {
+		if (shape[d] >= 0 && buffer.view.shape[d] != shape[d]) { return false; }
+	}
+	return true;
+}
+
+/**
+ * @brief New (rows, cols) float64 array: numpy.empty, or a memoryview
+ * over a bytearray when NumPy is missing
+ */
+PyObject *new_array(Py_ssize_t rows, Py_ssize_t cols) {
+	PyObject *numpy = PyImport_ImportModule("numpy");
+	if (numpy != nullptr) {
+		PyObject *out = PyObject_CallMethod(numpy, "empty", "((nn))", rows, cols);
+		Py_DECREF(numpy);
+		return out;
+	}
+	PyErr_Clear();
+	PyObject *bytes = PyByteArray_FromStringAndSize(
+	  nullptr, rows * cols * static_cast<Py_ssize_t>(sizeof(double)));
+	if (bytes == nullptr) { return nullptr; }
+	PyObject *view = PyMemoryView_FromObject(bytes);
+	Py_DECREF(bytes);
+	if (view == nullptr) { return nullptr; }
+	PyObject *out = PyObject_CallMethod(view, "cast", "s(nn)", "d", rows, cols);
+	Py_DECREF(view);
+	return out;
+}
+
+// Usa `out` do chamador ou cria um novo; devolve nova referência
+PyObject *output(PyObject *out, Py_ssize_t rows, Py_ssize_t cols) {
+	if (out == nullptr || out == Py_None) { return new_array(rows, cols); }
+	Py_INCREF(out);
+	return out;
+}
+
+PyObject *quest_batch(PyObject *, PyObject *args, PyObject *kwargs) {
+	static const char *keywords[] = { "measure", "reference", "weights", "out",
+		nullptr };
+	PyObject *measure_obj = nullptr, *reference_obj = nullptr;
+	PyObject *weights_obj = Py_None, *out_obj = Py_None;
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OO|OO",
+		  const_cast<char **>(keywords), &measure_obj, &reference_obj,
+		  &weights_obj, &out_obj)) {
+		return nullptr;
+	}
+
+	Buffer measure, reference, weights;
+	if (!acquire(measure_obj, measure, "measure")) { return nullptr; }
+	const Py_ssize_t any[] = { -1, -1, 3 };
+	if (!has_shape(measure, 3, any)) {
+		PyErr_SetString(PyExc_ValueError, "measure: expected shape (N, k, 3)");
+		return nullptr;
+	}
+	const Py_ssize_t n = measure.view.shape[0];
+	const Py_ssize_t k = measure.view.shape[1];
+	if (k < 2) {
+		PyErr_SetString(PyExc_ValueError, "measure: need k >= 2 vectors per sample");
+		return nullptr;
+	}
+
+	// reference (N, k, 3), ou (k, 3) comum a todas as amostras
+	if (!acquire(reference_obj, reference, "reference")) { return nullptr; }
+	const Py_ssize_t per_sample[] = { n, k, 3 }, shared[] = { k, 3 };
+	const bool shared_reference = has_shape(reference, 2, shared);
+	if (!shared_reference && !has_shape(reference, 3, per_sample)) {
+		PyErr_SetString(
+		  PyExc_ValueError, "reference: expected shape (N, k, 3) or (k, 3)");
+		return nullptr;
+	}
+
+	// weights (k,), (N, k) ou None
+	int weights_ndim = 0;
+	if (weights_obj != Py_None) {
+		if (!acquire(weights_obj, weights, "weights")) { return nullptr; }
+		const Py_ssize_t w1[] = { k }, w2[] = { n, k };
+		weights_ndim = has_shape(weights, 1, w1) ? 1 : has_shape(weights, 2, w2) ? 2 : -1;
+		if (weights_ndim < 0) {
+			PyErr_SetString(PyExc_ValueError, "weights: expected shape (k,) or (N, k)");
+			return nullptr;
+		}
+	}
+
+	PyObject *result = output(out_obj, n, 4);
+	if (result == nullptr) { return nullptr; }
+	{
+		Buffer out;
+		const Py_ssize_t quat[] = { n, 4 };
+		if (!acquire(result, out, "out", true) || !has_shape(out, 2, quat)) {
+			if (!PyErr_Occurred()) {
+				PyErr_SetString(PyExc_ValueError, "out: expected shape (N, 4)");
+			}
+			Py_DECREF(result);
+			return nullptr;
+		}
+
+		std::vector<attdet::Sensor> sensors(static_cast<std::size_t>(k));
+		Py_BEGIN_ALLOW_THREADS;
+		for (Py_ssize_t i = 0; i < n; ++i) {
+			for (Py_ssize_t j = 0; j < k; ++j) {
+				auto &s = sensors[static_cast<std::size_t>(j)];
+				for (Py_ssize_t l = 0; l < 3; ++l) {
+					s.measure[l] = measure.at(i, j, l);
+					s.reference[l] =
+					  shared_reference ? reference.at(j, l) : reference.at(i, j, l);
+				}
+				s.weight = weights_ndim == 0 ? 1. / static_cast<double>(k)
+						   : weights_ndim == 1 ? weights.at(j)
+											   : weights.at(i, j);
+			}
+			const auto q = attdet::quest(sensors.data(), sensors.data() + k);
+			for (Py_ssize_t l = 0; l < 4; ++l) { out.ref(i, l) = q[l]; }
+		}
+		Py_END_ALLOW_THREADS;
+	}
+	return result;
+}
+
+PyObject *quat_to_euler_batch(PyObject *, PyObject *args, PyObject *kwargs) {
+	static const char *keywords[] = { "q", "out", nullptr };
+	PyObject *q_obj = nullptr, *out_obj = Py_None;
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|O",
+		  const_cast<char **>(keywords), &q_obj, &out_obj)) {
+		return nullptr;
+	}
+	Buffer q;
+	if (!acquire(q_obj, q, "q")) { return nullptr; }
+	const Py_ssize_t quat[] = { -1, 4 };
+	if (!has_shape(q, 2, quat)) {
+		PyErr_SetString(PyExc_ValueError, "q: expected shape (N, 4)");
+		return nullptr;
+	}
+	const Py_ssize_t n = q.view.shape[0];
+
+	PyObject *result = output(out_obj, n, 3);
+	if (result == nullptr) { return nullptr; }
+	{
+		Buffer out;
+		const Py_ssize_t euler[] = { n, 3 };
+		if (!acquire(result, out, "out", true) || !has_shape(out, 2, euler)) {
+			if (!PyErr_Occurred()) {
+				PyErr_SetString(PyExc_ValueError, "out: expected shape (N, 3)");
+			}
+			Py_DECREF(result);
+			return nullptr;
+		}
+		Py_BEGIN_ALLOW_THREADS;
+		for (Py_ssize_t i = 0; i < n; ++i) {
+			const auto e = attdet::Quat2Euler(
+			  Quat({ q.at(i, 0), q.at(i, 1), q.at(i, 2), q.at(i, 3) }));
+			for (Py_ssize_t l = 0; l < 3; ++l) { out.ref(i, l) = e[l]; }
+		}
+		Py_END_ALLOW_THREADS;
+	}
+	return result;
+}
+
+PyMethodDef methods[] = {
+	{ "quest_batch", reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)()>(quest_batch)),
+	  METH_VARARGS | METH_KEYWORDS,
+	  "quest_batch(measure, reference, weights=None, out=None) -> (N, 4)\n\n"
+	  "QUEST for each of N samples of k vector pairs (float64).\n"
+	  "measure: (N, k, 3); reference: (N, k, 3) or (k, 3);\n"
+	  "weights: (k,) or (N, k), default 1/k. Quaternions are (x, y, z, w)." },
+	{ "quat_to_euler_batch",
+	  reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)()>(quat_to_euler_batch)),
+	  METH_VARARGS | METH_KEYWORDS,
+	  "quat_to_euler_batch(q, out=None) -> (N, 3)\n\n"
+	  "Euler angles in degrees, as attdet::Quat2Euler." },
+	{ nullptr, nullptr, 0, nullptr }
+};
+
+PyModuleDef module = { PyModuleDef_HEAD_INIT, "attdet",
+	"Batch attitude determination over NumPy arrays (zero-copy).", -1, methods,
+	nullptr, nullptr, nullptr, nullptr };
+
+}// namespace
+
+PyMODINIT_FUNC PyInit_attdet() { return PyModule_Create(&module); }
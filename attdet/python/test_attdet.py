@@ -0,0 +1,104 @@
+#!/usr/bin/python3
+# Testes do módulo Python. Só a biblioteca padrão (array + memoryview);
+# com NumPy instalado, testa também arrays e views não contíguas.
+#   PYTHONPATH=<diretório do attdet*.so> python3 test_attdet.py
+
+import array
+import math
+import random
+import unittest
+
+import attdet
+
+try:
+    import numpy as np
+except ImportError:
+    np = None
+
+
+def dcm(q):
+    # Igual a attdet::Quat2DCM: measure = A(q) reference
+    x, y, z, w = q
+    return [[1 - 2*(y*y + z*z), 2*(x*y + z*w), 2*(x*z - y*w)],
+            [2*(x*y - z*w), 1 - 2*(x*x + z*z), 2*(y*z + x*w)],
+            [2*(x*z + y*w), 2*(y*z - x*w), 1 - 2*(x*x + y*y)]]
+
+
+def unit(v):
+    n = math.sqrt(sum(c*c for c in v))
+    return [c/n for c in v]
+
+
+def angle(p, q):
+    c = min(1., abs(sum(a*b for a, b in zip(p, q))))
+    return math.degrees(2*math.acos(c))
+
+
+def scene(n, k, seed=7):
+    g = random.Random(seed)
+    truth, measure, reference = [], [], []
+    for _ in range(n):
+        q = unit([g.gauss(0, 1) for _ in range(4)])
+        A = dcm(q)
+        truth.append(q)
+        for _ in range(k):
+            r = unit([g.gauss(0, 1) for _ in range(3)])
+            reference.extend(r)
+            measure.extend(sum(A[i][j]*r[j] for j in range(3)) for i in range(3))
+    return truth, measure, reference
+
+
+def view(values, shape):
+    return memoryview(array.array('d', values)).cast('B').cast('d', shape)
+
+
+class QuestBatch(unittest.TestCase):
+    def test_memoryview(self):
+        truth, measure, reference = scene(50, 3)
+        q = attdet.quest_batch(view(measure, [50, 3, 3]),
+                               view(reference, [50, 3, 3]))
+        self.assertEqual(q.shape, (50, 4))
+        for i in range(50):
+            self.assertLess(angle([q[i, j] for j in range(4)], truth[i]), 1E-3)
+
+    def test_shared_reference_and_out(self):
+        truth, measure, reference = scene(1, 2)
+        measure = measure * 10
+        out = view([0.]*40, [10, 4])
+        result = attdet.quest_batch(view(measure, [10, 2, 3]),
+                                    view(reference, [2, 3]),
+                                    weights=view([.6, .4], [2]), out=out)
+        self.assertIs(result, out)
+        for i in range(10):
+            self.assertLess(angle([out[i, j] for j in range(4)], truth[0]), 1E-3)
+
+    def test_errors(self):
+        _, measure, reference = scene(2, 2)
+        with self.assertRaises(ValueError):
+            attdet.quest_batch(view(measure, [2, 2, 3]), view(reference, [3, 4]))
+        with self.assertRaises(TypeError):
+            attdet.quest_batch(array.array('f', measure), view(reference, [2, 2, 3]))
+        with self.assertRaises(BufferError):
+            attdet.quest_batch(view(measure, [2, 2, 3]), view(reference, [2, 2, 3]),
+                               out=bytes(64))
+
+    def test_euler(self):
+        e = attdet.quat_to_euler_batch(view([0., 0., 0., 1.]*3, [3, 4]))
+        self.assertEqual([e[i, j] for i in range(3) for j in range(3)], [0.]*9)
+
+    @unittest.skipIf(np is None, "NumPy not installed")
+    def test_numpy_views(self):
+        truth, measure, reference = scene(100, 4)
+        m = np.array(measure).reshape(100, 4, 3)
+        r = np.array(reference).reshape(100, 4, 3)
+        # Views com strides: sem cópia do lado C++
+        padded = np.zeros((100, 4, 6))
+        padded[:, :, ::2] = m
+        q = attdet.quest_batch(padded[:, :, ::2], r)
+        self.assertIsInstance(q, np.ndarray)
+        for i in range(100):
+            self.assertLess(angle(q[i], truth[i]), 1E-3)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,74 @@
+/**
+ * @file alloc.cpp
+ * @brief operator new/delete com contagem (alvo attdet-alloc)
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#include <attdet/alloc.h>
+#include <cstdlib>
+#include <new>
+
+namespace {
+// Só tipos triviais: são usados dentro do próprio operator new
+thread_local attdet::alloc::Counts thread_counts{};
+
+void *allocate(std::size_t size) {
+	++thread_counts.allocations;
+	thread_counts.bytes += size;
+	if (size == 0) { size = 1; }
+	while (true) {
+		if (void *p = std::malloc(size)) { return p; }
+		auto handler = std::get_new_handler();
+		if (handler == nullptr) { throw std::bad_alloc(); }
+		handler();
+	}
+}
+
+void release(void *p) noexcept {
+	if (p == nullptr) { return; }
+	++thread_counts.deallocations;
+	std::free(p);
+}
+}// namespace
+
+void *operator new(std::size_t size) { return allocate(size); }
+void *operator new[](std::size_t size) { return allocate(size); }
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+	try {
+		return allocate(size);
+	} catch (...) { return nullptr; }
+}
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+	try {
+		return allocate(size);
+	} catch (...) { return nullptr; }
+}
+void operator delete(void *p) noexcept { release(p); }
+void operator delete[](void *p) noexcept { release(p); }
+void operator delete(void *p, std::size_t) noexcept { release(p); }
+void operator delete[](void *p, std::size_t) noexcept { release(p); }
+void operator delete(void *p, const std::nothrow_t &) noexcept { release(p); }
+void operator delete[](void *p, const std::nothrow_t &) noexcept {
+	release(p);
+}
+
+namespace attdet {
+namespace alloc {
+
+	Counts counts() { return thread_counts; }
+
+	void report(const StageStats *first, const StageStats *last, std::FILE *out) {
+		std::fprintf(out, "%-16s %12s %12s %10s %12s\n", "stage", "calls",
+		  "allocs", "allocs/call", "bytes");
+		for (auto s = first; s != last; ++s) {
+			std::fprintf(out, "%-16s %12llu %12llu %10.3f %12llu\n", s->name,
+			  static_cast<unsigned long long>(s->calls),
+			  static_cast<unsigned long long>(s->allocations),
+			  s->calls ? static_cast<double>(s->allocations) / s->calls : 0.,
+			  static_cast<unsigned long long>(s->bytes));
+		}
+	}
+
+}// namespace alloc
+}// namespace attdet
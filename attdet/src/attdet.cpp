@@ -32,9 +32,34 @@
 #include "alglin/alglin.hpp"
 #include <algorithm>
 #include <attdet/attdet.h>
+#include <attdet/trace.h>
+#include <cstdint>
+#include <cstring>
 #include <numeric>
 
 #define QUEST_ALT 0
+/**
+ * QUEST_BRANCHLESS=1 (cmake -DATTDET_QUEST_BRANCHLESS=ON): quest_profile()
+ * and quest<2> run the same instructions for every input. Frame selection
+ * and the det(Y) == 0 guard become bit masks, and quest<2> computes both
+ * the closed form and the general path and masks one out, so no branch
+ * depends on the data. The cost is that quest<2> is as slow as quest().
+ * StreamingQuest stays data-dependent by design.
+ */
+#if !defined(QUEST_BRANCHLESS)
+#define QUEST_BRANCHLESS 0
+#endif
+/**
+ * QUEST_FUSED=1 (default; cmake -DATTDET_QUEST_FUSED=OFF keeps the matrix
+ * kernel as a reference): each rotated frame is solved on scalars. The
+ * polynomial coefficients come from the six entries of S, and the Gibbs
+ * vector from adj(Y) Z written out. No 3x3 temporary is built and Y is
+ * never inverted. Same arithmetic as the matrix kernel in a different
+ * order, at about half its latency.
+ */
+#if !defined(QUEST_FUSED)
+#define QUEST_FUSED 1
+#endif
 
 namespace attdet {
 
@@ -53,61 +78,201 @@ Matrix3 block_matrix(const Vec3 &a, const Vec3 &b, const Vec3 &c) {
  * @param sensors List of Sensor() with at least 2 Sensors
  * @return Quat  Attitude as Unit Quaternion
  */
-#if !QUEST_ALT
 Quat quest(const std::initializer_list<Sensor> &sensors) {
-	if (sensors.size() < 2) { return {}; }
-	alglin::array<Quat, 4> candidateQuats{};
-	alglin::array<double, 4> distanceToSing{};
-	std::initializer_list<Rotations> rotations{
-		Rotations::X, Rotations::Y, Rotations::Z,
-         Rotations::None
-	};
+	return quest(sensors.begin(), sensors.end());
+}
 
+Quat quest(const Sensor *first, const Sensor *last) {
+	if (last - first < 2) { return {}; }
 	double lambda{};
-	Matrix3 B_{};
-	for (const auto &sensor : sensors) {
-		B_ =
-		  B_
-		  + (sensor.weight * alglin::outer(sensor.measure, sensor.reference));
-		lambda += sensor.weight;
+	Matrix3 B{};
+	for (auto sensor = first; sensor != last; ++sensor) {
+		B = B
+			+ (sensor->weight * alglin::outer(sensor->measure, sensor->reference));
+		lambda += sensor->weight;
 	}
-	for (const auto rot : rotations) {
-		Matrix3 B{ B_ };
+	return quest_profile(B, lambda);
+}
 
-		auto rotate = [&B](int n, int m) -> void {
-			for (int i = 0; i < 3; ++i) {
-				B[i][n] = -B[i][n];
-				B[i][m] = -B[i][m];
-			}
-		};
+namespace detail {
+#if QUEST_BRANCHLESS
+	// take ? a : b on the bits, so the compiler cannot turn it into a jump
+	inline double select(bool take, double a, double b) {
+		std::uint64_t ua, ub;
+		std::memcpy(&ua, &a, sizeof ua);
+		std::memcpy(&ub, &b, sizeof ub);
+		const std::uint64_t mask = 0 - static_cast<std::uint64_t>(take);
+		const std::uint64_t u = (ua & mask) | (ub & ~mask);
+		double out;
+		std::memcpy(&out, &u, sizeof out);
+		return out;
+	}
+#endif
 
-		switch (rot) {
-			case Rotations::X:
-				rotate(1, 2);
-				break;
-			case Rotations::Y:
-				rotate(0, 2);
-				break;
-			case Rotations::Z:
-				rotate(0, 1);
-				break;
-			default:
-				break;
+	/**
+	 * Markley's closed form from the unit normals b3 = b1 x b2 and
+	 * r3 = r1 x r2 of the two pairs, with mu = 1 + b3 . r3 > 0.
+	 */
+	inline Quat two_vector(const Sensor &s1, const Sensor &s2, const Vec3 &b3,
+	  const Vec3 &r3, double mu) {
+		const Vec3 c1 = alglin::cross(s1.measure, s1.reference);
+		const Vec3 c2 = alglin::cross(s2.measure, s2.reference);
+		const Vec3 c({ s1.weight * c1[0] + s2.weight * c2[0],
+		  s1.weight * c1[1] + s2.weight * c2[1], s1.weight * c1[2] + s2.weight * c2[2] });
+		const Vec3 cross3 = alglin::cross(b3, r3);
+		const Vec3 sum3({ b3[0] + r3[0], b3[1] + r3[1], b3[2] + r3[2] });
+		const double alpha = mu
+							   * (s1.weight * (s1.measure * s1.reference)
+								  + s2.weight * (s2.measure * s2.reference))
+							 + cross3 * c;
+		const double beta = sum3 * c;
+		const double gamma = std::sqrt(alpha * alpha + beta * beta);
+		// Os dois ramos dão o mesmo q; escolhe o sem cancelamento
+#if QUEST_BRANCHLESS
+		const double p = select(alpha >= 0., gamma + alpha, beta);
+		const double t = select(alpha >= 0., beta, gamma - alpha);
+#else
+		const double p = (alpha >= 0.) ? gamma + alpha : beta;
+		const double t = (alpha >= 0.) ? beta : gamma - alpha;
+#endif
+		return alglin::normalize(Quat({ p * cross3[0] + t * sum3[0],
+		  p * cross3[1] + t * sum3[1], p * cross3[2] + t * sum3[2], p * mu }));
+	}
+}// namespace detail
+
+template<> Quat quest<2>(const SensorSet<2> &sensors) {
+	const Sensor &s1 = sensors[0];
+	const Sensor &s2 = sensors[1];
+	const Vec3 b = alglin::cross(s1.measure, s2.measure);
+	const Vec3 r = alglin::cross(s1.reference, s2.reference);
+	const double bb = b * b, rr = r * r;
+	Matrix3 B{};
+	double lambda{};
+#if QUEST_BRANCHLESS
+	// Os dois caminhos sempre; a máscara escolhe sem desvio
+	const double nb = 1. / std::sqrt(bb), nr = 1. / std::sqrt(rr);
+	const Vec3 b3 = nb * b, r3 = nr * r;
+	const double mu = 1. + b3 * r3;
+	const bool closed_form = (bb > 0.) & (rr > 0.) & (mu > 1E-6);
+	const Quat closed = detail::two_vector(s1, s2, b3, r3, mu);
+	detail::Accumulate<2>::run(sensors.data(), B, lambda);
+	const Quat general = quest_profile(B, lambda);
+	Quat out;
+	for (int i = 0; i < 4; ++i) { out[i] = detail::select(closed_form, closed[i], general[i]); }
+	return out;
+#else
+	if (bb > 0. && rr > 0.) {
+		const double nb = 1. / std::sqrt(bb), nr = 1. / std::sqrt(rr);
+		const Vec3 b3 = nb * b, r3 = nr * r;
+		const double mu = 1. + b3 * r3;
+		if (mu > 1E-6) { return detail::two_vector(s1, s2, b3, r3, mu); }
+	}
+	detail::Accumulate<2>::run(sensors.data(), B, lambda);
+	return quest_profile(B, lambda);
+#endif
+}
+
+namespace detail {
+	/**
+	 * Sequential rotations of the reference frame (Shuster & Oh): flip two
+	 * columns of B, solve, and map the candidate back with a signed
+	 * permutation. Kept as data so there is one copy of the solve loop.
+	 */
+	struct FrameRotation {
+		double flip[3];
+		int perm[4];
+		double sign[4];
+	};
+	constexpr FrameRotation rotations[4] = {
+		{ { 1., -1., -1. }, { 3, 2, 1, 0 }, { 1., -1., 1., -1. } },// X
+		{ { -1., 1., -1. }, { 2, 3, 0, 1 }, { 1., 1., -1., -1. } },// Y
+		{ { -1., -1., 1. }, { 1, 0, 3, 2 }, { -1., 1., 1., -1. } },// Z
+		{ { 1., 1., 1. }, { 0, 1, 2, 3 }, { 1., 1., 1., 1. } },// None
+	};
+
+	/**
+	 * The signs of rotations as bit masks (bit i set: entry i is negative),
+	 * for quest_fixed(): on targets without an FPU every double comparison
+	 * there would be a soft-float call. Folded at compile time.
+	 */
+	struct FrameSigns {
+		unsigned flip;
+		unsigned sign;
+	};
+	constexpr unsigned negative_bits(const double *v, int n) {
+		return n == 0 ? 0u : ((v[n - 1] < 0.) ? 1u << (n - 1) : 0u) | negative_bits(v, n - 1);
+	}
+	constexpr FrameSigns frame_signs[4] = {
+		{ negative_bits(rotations[0].flip, 3), negative_bits(rotations[0].sign, 4) },
+		{ negative_bits(rotations[1].flip, 3), negative_bits(rotations[1].sign, 4) },
+		{ negative_bits(rotations[2].flip, 3), negative_bits(rotations[2].sign, 4) },
+		{ negative_bits(rotations[3].flip, 3), negative_bits(rotations[3].sign, 4) },
+	};
+}// namespace detail
+
+namespace detail {
+	struct Candidate {
+		Quat q;// original frame, not normalized
+		double dY;// det(Y): distance to the frame's singularity
+		double lambda;// after the Newton step
+		double residual;// characteristic polynomial at lambda
+		// Scalar part in the rotated frame, det(Y) / |[adj(Y) Z; det(Y)]|
+		double scalar;
+	};
+
+	/**
+	 * One Newton step from lambda and the CRP solve in a rotated frame,
+	 * shared by quest_profile() and StreamingQuest.
+	 */
+	inline Candidate solve_frame(const Matrix3 &B_, const FrameRotation &rot, double lambda) {
+#if QUEST_FUSED
+		// Só escalares: S, adj(S), Y e adj(Y) nunca são montadas
+		const double f0 = rot.flip[0], f1 = rot.flip[1], f2 = rot.flip[2];
+		const double b00 = B_[0][0] * f0, b01 = B_[0][1] * f1, b02 = B_[0][2] * f2;
+		const double b10 = B_[1][0] * f0, b11 = B_[1][1] * f1, b12 = B_[1][2] * f2;
+		const double b20 = B_[2][0] * f0, b21 = B_[2][1] * f1, b22 = B_[2][2] * f2;
+
+		const double s00 = 2. * b00, s11 = 2. * b11, s22 = 2. * b22;
+		const double s01 = b01 + b10, s02 = b02 + b20, s12 = b12 + b21;
+		const double sigma = b00 + b11 + b22;
+		const double z0 = b12 - b21, z1 = b20 - b02, z2 = b01 - b10;
+
+		// Menores da diagonal de S: trace(adj(S)) e det(S) pela primeira linha
+		const double m00 = s11 * s22 - s12 * s12;
+		const double m11 = s00 * s22 - s02 * s02;
+		const double m22 = s00 * s11 - s01 * s01;
+		const double k = m00 + m11 + m22;
+		const double delta = s00 * m00 + s01 * (s12 * s02 - s01 * s22)
+							 + s02 * (s01 * s12 - s11 * s02);
+		const double sz0 = s00 * z0 + s01 * z1 + s02 * z2;
+		const double sz1 = s01 * z0 + s11 * z1 + s12 * z2;
+		const double sz2 = s02 * z0 + s12 * z1 + s22 * z2;
+		const double a = sigma * sigma - k;
+		const double b = sigma * sigma + (z0 * z0 + z1 * z1 + z2 * z2);
+		const double c = delta + (z0 * sz0 + z1 * sz1 + z2 * sz2);
+		const double d = sz0 * sz0 + sz1 * sz1 + sz2 * sz2;
+#else
+		Matrix3 B{ B_ };
+		for (int i = 0; i < 3; ++i) {
+			for (int j = 0; j < 3; ++j) { B[i][j] *= rot.flip[j]; }
 		}
 
-		const Matrix3 S = B + alglin::transpose(B);
+		// S = B + B^T is symmetric: only 6 unique entries
+		const auto S = alglin::plus_transpose(B);
 		const auto sigma = alglin::trace(B);
 
 		const Vec3 Z(
 		  { (B[1][2] - B[2][1]), (B[2][0] - B[0][2]), (B[0][1] - B[1][0]) });
 
-		const auto k = alglin::trace(alglin::fast_adjugate(S));
+		const auto k = alglin::trace(alglin::adjugate(S));
 		const auto delta = alglin::det(S);
-		const auto ZT = alglin::transpose(Z);
+		const Vec3 SZ = S * Z;
 		const auto a = (sigma * sigma) - k;
-		const auto b = sigma * sigma + (Z * ZT)[0][0];
-		const auto c = delta + (Z * S * ZT)[0][0];
-		const auto d = (Z * (S * S) * ZT)[0][0];
+		const auto b = sigma * sigma + Z * Z;
+		const auto c = delta + Z * SZ;
+		// Z^T S^2 Z = |S Z|^2
+		const auto d = SZ * SZ;
+#endif
 
 		auto f = [a, b, c, d, sigma](const double t) {
 			return (((1 * t * t) - (a + b)) * t - c) * t
@@ -119,45 +284,143 @@ Quat quest(const std::initializer_list<Sensor> &sensors) {
 
 		lambda -= f(lambda) / df(lambda);
 
-		const auto identity = alglin::eye<double, 3>();
-		const Matrix3 Y = ((lambda + sigma) * identity) - S;
-		const Vec3 crp_ = alglin::transpose(alglin::inverse(Y) * ZT);
-		const auto w = 1. / (std::sqrt((crp_ * alglin::transpose(crp_))[0][0]));
+#if QUEST_FUSED
+		// Y = (lambda + sigma) I - S; fora da diagonal, Y = -S
+		const double ls = lambda + sigma;
+		const double y00 = ls - s00, y11 = ls - s11, y22 = ls - s22;
+		const double a00 = y11 * y22 - s12 * s12;
+		const double a11 = y00 * y22 - s02 * s02;
+		const double a22 = y00 * y11 - s01 * s01;
+		const double a01 = s02 * s12 + s01 * y22;
+		const double a02 = s01 * s12 + s02 * y11;
+		const double a12 = s01 * s02 + s12 * y00;
+		const double dY = y00 * a00 - s01 * a01 - s02 * a02;
+		// adj(Y) Z: o numerador do vetor de Gibbs, sem inverter Y
+		const Vec3 g({ a00 * z0 + a01 * z1 + a02 * z2, a01 * z0 + a11 * z1 + a12 * z2,
+		  a02 * z0 + a12 * z1 + a22 * z2 });
+#else
+		auto Y = -1. * S;
+		for (int i = 0; i < 3; ++i) { Y(i, i) += lambda + sigma; }
+		// inverse(Y) = adjugate(Y) / det(Y), sharing the cofactors
+		const auto adjY = alglin::adjugate(Y);
+		const auto dY = Y(0, 0) * adjY(0, 0) + Y(0, 1) * adjY(0, 1)
+						+ Y(0, 2) * adjY(0, 2);
+		const Vec3 g = adjY * Z;
+#endif
+#if QUEST_BRANCHLESS
+		const double nonzero = static_cast<double>(dY != 0.);
+		const Vec3 crp_ = (nonzero / (dY + (1. - nonzero))) * g;
+#else
+		const Vec3 crp_ = (dY == 0.) ? Vec3{} : (1. / dY) * g;
+#endif
+		const auto w = 1. / (std::sqrt(crp_ * crp_));
 		const Quat q({ w * crp_[0], w * crp_[1], w * crp_[2], w });
-		const auto dY = alglin::det(Y);
-
-		switch (rot) {
-			case Rotations::X:
-				candidateQuats[0] = { q[3], -q[2], q[1], -q[0] };
-				distanceToSing[0] = dY;
-				break;
-			case Rotations::Y:
-				candidateQuats[1] = { q[2], q[3], -q[0], -q[1] };
-				distanceToSing[1] = dY;
-				break;
-			case Rotations::Z:
-				candidateQuats[2] = { -q[1], q[0], q[3], -q[2] };
-				distanceToSing[2] = dY;
-				break;
-			default:
-			case Rotations::None:
-				candidateQuats[3] = { q[0], q[1], q[2], q[3] };
-				distanceToSing[3] = dY;
-				break;
-		}
+
+#if QUEST_BRANCHLESS
+		Candidate out{ Quat{}, dY, lambda, f(lambda),
+			select(dY > 0., 1. / std::sqrt(1. + crp_ * crp_), 0.) };
+#else
+		Candidate out{ Quat{}, dY, lambda, f(lambda),
+			(dY > 0.) ? 1. / std::sqrt(1. + crp_ * crp_) : 0. };
+#endif
+		for (int i = 0; i < 4; ++i) { out.q[i] = rot.sign[i] * q[rot.perm[i]]; }
+		return out;
+	}
+}// namespace detail
+
+#if !QUEST_ALT
+/**
+ * @brief QUEST from an already accumulated attitude profile matrix
+ * B = sum(w * measure * reference^T).
+ *
+ * @param B_ Attitude profile matrix
+ * @param lambda Sum of the weights (Newton starting point)
+ * @return Quat  Attitude as Unit Quaternion
+ */
+Quat quest_profile(const Matrix3 &B_, double lambda) {
+	Quat selected{};
+	double best{};
+	for (int r = 0; r < 4; ++r) {
+		const auto c = detail::solve_frame(B_, detail::rotations[r], lambda);
+		lambda = c.lambda;
+		ATTDET_TRACE_POINT(QuestCandidate, r, c.dY, c.lambda, c.residual,
+		  (r == 0 || c.dY > best) ? 1. : 0.);
+		// The first candidate (X) is the fallback when no dY is positive
+#if QUEST_BRANCHLESS
+		const bool take = (r == 0) | (c.dY > best);
+		for (int i = 0; i < 4; ++i) { selected[i] = detail::select(take, c.q[i], selected[i]); }
+		best = detail::select(c.dY > best, c.dY, best);
+#else
+		if (r == 0 || c.dY > best) { selected = c.q; }
+		best = std::max(best, c.dY);
+#endif
+	}
+	ATTDET_TRACE_POINT(QuestResult, 0, best, lambda,
+	  std::sqrt(selected * selected), 0.);
+	return alglin::normalize(selected);
+}
+#endif
+
+Quat StreamingQuest::update(const std::initializer_list<Sensor> &sensors) {
+	return update(sensors.begin(), sensors.end());
+}
+
+Quat StreamingQuest::update(const Sensor *first, const Sensor *last) {
+	if (last - first < 2) { return {}; }
+	double lambda{};
+	Matrix3 B{};
+	for (auto sensor = first; sensor != last; ++sensor) {
+		B = B
+			+ (sensor->weight * alglin::outer(sensor->measure, sensor->reference));
+		lambda += sensor->weight;
 	}
-	double d{};
-	int idx{};
-	for (int i = 0; i < 4; i++) {
-		if (distanceToSing[i] > d) {
-			d = distanceToSing[i];
-			idx = i;
+	return update_profile(B, lambda);
+}
+
+Quat StreamingQuest::update_profile(const Matrix3 &B, double lambda) {
+	if (frame_ < 0 || !(weights_ > 0.)) { return search(B, lambda); }
+	// lambda_max <= sum of weights; a start above it is already stale
+	const double start = std::min(lambda, lambda_ * (lambda / weights_));
+	const auto c = detail::solve_frame(B, detail::rotations[frame_], start);
+	ATTDET_TRACE_POINT(QuestCandidate, frame_, c.dY, c.lambda, c.residual, 1.);
+	if (!(c.lambda > 0. && c.lambda <= lambda) || !(c.scalar >= threshold_)) {
+		return search(B, lambda);
+	}
+	lambda_ = c.lambda;
+	weights_ = lambda;
+	return alglin::normalize(c.q);
+}
+
+// Same four frames and selection as quest_profile(), keeping the winner
+Quat StreamingQuest::search(const Matrix3 &B, double lambda) {
+	++searches_;
+	weights_ = lambda;
+	Quat selected{};
+	double best{};
+	for (int r = 0; r < 4; ++r) {
+		const auto c = detail::solve_frame(B, detail::rotations[r], lambda);
+		lambda = c.lambda;
+		ATTDET_TRACE_POINT(QuestCandidate, r, c.dY, c.lambda, c.residual,
+		  (r == 0 || c.dY > best) ? 1. : 0.);
+		if (r == 0 || c.dY > best) {
+			selected = c.q;
+			frame_ = r;
 		}
+		best = std::max(best, c.dY);
 	}
-	auto selected = candidateQuats[idx];
+	lambda_ = lambda;
+	ATTDET_TRACE_POINT(QuestResult, frame_, best, lambda,
+	  std::sqrt(selected * selected), 0.);
 	return alglin::normalize(selected);
 }
-#else
+
+void StreamingQuest::reset() {
+	frame_ = -1;
+	lambda_ = 0.;
+	weights_ = 0.;
+}
+
+#if QUEST_ALT
 /**
  * @brief QUEST algorithm implementation.
  * Computes the attitude given sensor body and inertial values.
@@ -168,18 +431,18 @@ Quat quest(const std::initializer_list<Sensor> &sensors) {
  */
 namespace {
 	Quat quest_unsafe(const Matrix3 &B, double lambda) {
-		const Matrix3 S = B + alglin::transpose(B);
+		const auto S = alglin::plus_transpose(B);
 		const auto sigma = alglin::trace(B);
 		const Vec3 Z(
 		  { (B[1][2] - B[2][1]), (B[2][0] - B[0][2]), (B[0][1] - B[1][0]) });
 
-		const auto k = alglin::trace(alglin::fast_adjugate(S));
+		const auto k = alglin::trace(alglin::adjugate(S));
 		const auto delta = alglin::det(S);
-		const auto ZT = alglin::transpose(Z);
+		const Vec3 SZ = S * Z;
 		const auto a = (sigma * sigma) - k;
-		const auto b = sigma * sigma + (Z * ZT)[0][0];
-		const auto c = delta + (Z * S * ZT)[0][0];
-		const auto d = (Z * (S * S) * ZT)[0][0];
+		const auto b = sigma * sigma + Z * Z;
+		const auto c = delta + Z * SZ;
+		const auto d = SZ * SZ;
 
 		auto f = [a, b, c, d, sigma](const double t) {
 			return (((1 * t * t) - (a + b)) * t - c) * t
@@ -191,28 +454,18 @@ namespace {
 
 		lambda -= f(lambda) / df(lambda);
 
-		const auto identity = alglin::eye<double, 3>();
-		const Matrix3 Y = ((lambda + sigma) * identity) - S;
+		auto Y = -1. * S;
+		for (int i = 0; i < 3; ++i) { Y(i, i) += lambda + sigma; }
 
-		const Vec3 crp_ = alglin::transpose(alglin::inverse(Y) * ZT);
+		const Vec3 crp_ = alglin::inverse(Y) * Z;
 
-		const auto w = 1 / (std::sqrt((crp_ * alglin::transpose(crp_))[0][0]));
+		const auto w = 1 / (std::sqrt(crp_ * crp_));
 		const Quat q({ w * crp_[0], w * crp_[1], w * crp_[2], w });
 		return alglin::normalize(q) * alglin::det(Y);
 	}
 }// namespace
-Quat quest(const std::initializer_list<Sensor> &sensors) {
-
-	const double lambda = std::accumulate(sensors.begin(),
-	  sensors.end(),
-	  0.f,
-	  [](const double prev, const Sensor &s) { return prev + s.weight; });
-
-	Matrix3 B{};
-	std::for_each(sensors.begin(), sensors.end(), [&B](const Sensor& sensor) {
-		B =
-		  B + (sensor.weight * alglin::outer(sensor.measure, sensor.reference));
-	});
+Quat quest_profile(const Matrix3 &B_, double lambda) {
+	Matrix3 B{ B_ };
 
 	auto rotate = [](Matrix3 &M, int n, int m) -> void {
 		for (int i = 0; i < 3; ++i) {
@@ -249,6 +502,175 @@ Quat quest(const std::initializer_list<Sensor> &sensors) {
 
 #endif
 
+SensorQ::SensorQ(const Sensor &sensor) : weight(sensor.weight) {
+	for (int i = 0; i < 3; ++i) {
+		measure[i] = alglin::Q16_16(sensor.measure[i]);
+		reference[i] = alglin::Q16_16(sensor.reference[i]);
+	}
+}
+
+Quat to_double(const QuatQ &q) {
+	return { static_cast<double>(q[0]),
+		static_cast<double>(q[1]),
+		static_cast<double>(q[2]),
+		static_cast<double>(q[3]) };
+}
+
+/**
+ * @brief Fixed-point QUEST.
+ * Same rotation sequence as quest(), computed in Q8.24 with the scaling
+ * chosen so that every intermediate stays bounded for unit vectors:
+ *  - weights are normalized to sum 1, so |B_ij| <= 1, |S_ij| <= 2,
+ *    |sigma| <= 1, |Z| <= 1 and lambda_max <= 1 (Newton starts at 1);
+ *  - the quaternion is taken as [adjugate(Y) Z; det(Y)] instead of
+ *    [inverse(Y) Z; 1], so there is no division by det(Y) and the
+ *    candidate is at most ~64 in each component before normalization;
+ *  - the candidate is normalized on the raw 64-bit values
+ *    (alglin::fixed_normalize), so small candidates keep their precision.
+ * Against quest() the error stays below 0.01 deg for non-collinear pairs
+ * (see attdet-tests).
+ *
+ * @param sensors List of SensorQ() with at least 2 Sensors
+ * @return QuatQ Attitude as Unit Quaternion (Q2.30)
+ */
+QuatQ quest_fixed(const std::initializer_list<SensorQ> &sensors) {
+	return quest_fixed(sensors.begin(), sensors.end());
+}
+
+QuatQ quest_fixed(const SensorQ *first, const SensorQ *last) {
+	using Q = alglin::Fixed<24>;
+	using Vec3W = alglin::Vector<Q, 3>;
+	using QuatW = alglin::Vector<Q, 4>;
+	if (last - first < 2) { return {}; }
+
+	alglin::Q16_16 total{};
+	for (auto sensor = first; sensor != last; ++sensor) { total += sensor->weight; }
+	if (total <= alglin::Q16_16{}) { return {}; }
+
+	auto widen = [](const Vec3Q &v) -> Vec3W {
+		return { alglin::fixed_cast<24>(v[0]), alglin::fixed_cast<24>(v[1]),
+			alglin::fixed_cast<24>(v[2]) };
+	};
+	alglin::SquareMatrix<Q, 3> B_{};
+	for (auto sensor = first; sensor != last; ++sensor) {
+		B_ = B_
+			 + (alglin::fixed_ratio<24>(sensor->weight, total)
+				* alglin::outer(widen(sensor->measure), widen(sensor->reference)));
+	}
+
+	QuatW selected{};
+	Q best{};
+	for (int r = 0; r < 4; ++r) {
+		const auto &rot = detail::rotations[r];
+		const auto &signs = detail::frame_signs[r];
+		auto B = B_;
+		for (int i = 0; i < 3; ++i) {
+			for (int j = 0; j < 3; ++j) {
+				if (signs.flip & (1u << j)) { B[i][j] = -B[i][j]; }
+			}
+		}
+
+		const auto S = alglin::plus_transpose(B);
+		const Q sigma = alglin::trace(B);
+		const Vec3W Z(
+		  { (B[1][2] - B[2][1]), (B[2][0] - B[0][2]), (B[0][1] - B[1][0]) });
+
+		const Q k = alglin::trace(alglin::adjugate(S));
+		const Q delta = alglin::det(S);
+		const Vec3W SZ = S * Z;
+		const Q a = (sigma * sigma) - k;
+		const Q b = sigma * sigma + Z * Z;
+		const Q c = delta + Z * SZ;
+		const Q d = SZ * SZ;
+
+		Q lambda(1);
+		const Q f = (((lambda * lambda) - (a + b)) * lambda - c) * lambda
+					+ (a * b + c * sigma - d);
+		const Q df = (Q(4) * lambda * lambda - Q(2) * (a + b)) * lambda - c;
+		lambda -= f / df;
+
+		auto Y = Q(-1) * S;
+		for (int i = 0; i < 3; ++i) { Y(i, i) += lambda + sigma; }
+		const auto adjY = alglin::adjugate(Y);
+		const Q dY = Y(0, 0) * adjY(0, 0) + Y(0, 1) * adjY(0, 1)
+					 + Y(0, 2) * adjY(0, 2);
+		const Vec3W x = adjY * Z;
+		const QuatW q({ x[0], x[1], x[2], dY });
+
+		if (r == 0 || dY > best) {
+			for (int i = 0; i < 4; ++i) {
+				selected[i] = (signs.sign & (1u << i)) ? -q[rot.perm[i]] : q[rot.perm[i]];
+			}
+		}
+		best = std::max(best, dY);
+	}
+	return alglin::fixed_normalize<30>(selected);
+}
+
+/**
+ * @brief Davenport K matrix. With q = (q1, q2, q3, q4), scalar last, the
+ * Wahba loss is minimized by the eigenvector of K with the largest
+ * eigenvalue.
+ *
+ * @param sensors List of Sensor()
+ * @return Matrix4 K = [[S - sigma I, Z], [Z^T, sigma]]
+ */
+Matrix4 davenport_matrix(const std::initializer_list<Sensor> &sensors) {
+	Matrix3 B{};
+	for (const auto &sensor : sensors) {
+		B = B + (sensor.weight * alglin::outer(sensor.measure, sensor.reference));
+	}
+	const Matrix3 S = B + alglin::transpose(B);
+	const auto sigma = alglin::trace(B);
+	const Vec3 Z(
+	  { (B[1][2] - B[2][1]), (B[2][0] - B[0][2]), (B[0][1] - B[1][0]) });
+
+	Matrix4 K{};
+	for (int i = 0; i < 3; ++i) {
+		for (int j = 0; j < 3; ++j) { K[i][j] = S[i][j]; }
+		K[i][i] -= sigma;
+		K[i][3] = Z[i];
+		K[3][i] = Z[i];
+	}
+	K[3][3] = sigma;
+	return K;
+}
+
+/**
+ * @brief Davenport q-method. Solves the eigenproblem of K directly instead
+ * of QUEST's characteristic polynomial, so it has no singularity to rotate
+ * away from and serves as a reference/fallback for quest().
+ * The sum of weights bounds the largest eigenvalue, so inverse iteration
+ * shifted by it converges in a few steps.
+ *
+ * @param sensors List of Sensor() with at least 2 Sensors
+ * @return Quat Attitude as Unit Quaternion, scalar part >= 0
+ */
+Quat qmethod(const std::initializer_list<Sensor> &sensors) {
+	if (sensors.size() < 2) { return {}; }
+	double lambda{};
+	for (const auto &sensor : sensors) { lambda += sensor.weight; }
+
+	const auto K = davenport_matrix(sensors);
+	const auto e = alglin::dominant_eigen(K, lambda);
+	Quat q = e.vector;
+	if (q[3] < 0.) { q = -1. * q; }
+	return alglin::normalize(q);
+}
+
+Matrix3 quest_covariance(const Sensor *first, const Sensor *last) {
+	Matrix3 F{};
+	for (auto sensor = first; sensor != last; ++sensor) {
+		const auto &b = sensor->measure;
+		for (int i = 0; i < 3; ++i) {
+			for (int j = 0; j < 3; ++j) {
+				F[i][j] += sensor->weight * ((i == j ? 1. : 0.) - b[i] * b[j]);
+			}
+		}
+	}
+	return alglin::inverse(F);
+}
+
 Matrix3 triad(const Sensor &sensor1, const Sensor &sensor2) {
 
 	auto t_1b = sensor1.measure;
@@ -271,6 +693,13 @@ Vec3 DCM2Euler(const Matrix3 &A) {
 	return { r * phi, r * theta, r * psi };
 }
 
+Matrix3 Quat2DCM(const Quat &q) {
+	const auto x = q[0], y = q[1], z = q[2], w = q[3];
+	return { { 1 - 2 * (y * y + z * z), 2 * (x * y + z * w), 2 * (x * z - y * w) },
+		{ 2 * (x * y - z * w), 1 - 2 * (x * x + z * z), 2 * (y * z + x * w) },
+		{ 2 * (x * z + y * w), 2 * (y * z - x * w), 1 - 2 * (x * x + y * y) } };
+}
+
 Vec3 Quat2Euler(const Quat &q) {
 	constexpr auto r = static_cast<double>(180.0 / 3.141592);
 	const auto phi = std::atan2(2.0f * (q[3] * q[0] - q[1] * q[2]),
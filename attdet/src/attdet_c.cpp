@@ -0,0 +1,148 @@
+/**
+ * @file attdet_c.cpp
+ * @brief Interface C (attdet_c.h): sem alocação, sem exceções
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#include <attdet/attdet.h>
+#include <attdet/attdet_c.h>
+#include <cmath>
+
+namespace {
+using namespace attdet;
+
+Vec3 vec(const attdet_vec3 &v) { return { v.x, v.y, v.z }; }
+
+void identity(attdet_quat *out) { *out = { 0., 0., 0., 1. }; }
+
+// B e lambda direto das structs C, sem cópia para Sensor
+attdet_status solve(const attdet_sensor *sensors, size_t count, attdet_quat *out) {
+	if (count < 2) { return ATTDET_ERR_COUNT; }
+	Matrix3 B{};
+	double lambda{};
+	for (size_t k = 0; k < count; ++k) {
+		const auto &s = sensors[k];
+		const double m[3] = { s.measure.x, s.measure.y, s.measure.z };
+		const double r[3] = { s.reference.x, s.reference.y, s.reference.z };
+		for (int i = 0; i < 3; ++i) {
+			for (int j = 0; j < 3; ++j) { B[i][j] += s.weight * m[i] * r[j]; }
+		}
+		lambda += s.weight;
+	}
+	if (!(lambda > 0.)) { return ATTDET_ERR_WEIGHT; }
+
+	const Quat q = quest_profile(B, lambda);
+	const double norm = q * q;
+	if (!std::isfinite(norm) || std::abs(norm - 1.) > 1E-3) {
+		return ATTDET_ERR_DEGENERATE;
+	}
+	*out = { q[0], q[1], q[2], q[3] };
+	return ATTDET_OK;
+}
+
+void store(const Matrix3 &A, double dcm[9]) {
+	for (int i = 0; i < 3; ++i) {
+		for (int j = 0; j < 3; ++j) { dcm[3 * i + j] = A[i][j]; }
+	}
+}
+}// namespace
+
+extern "C" {
+
+int attdet_abi_version(void) noexcept { return ATTDET_C_ABI_VERSION; }
+
+const char *attdet_status_string(attdet_status status) noexcept {
+	switch (status) {
+	case ATTDET_OK: return "ok";
+	case ATTDET_ERR_NULL: return "null pointer";
+	case ATTDET_ERR_COUNT: return "sensor count out of range";
+	case ATTDET_ERR_WEIGHT: return "weights do not sum to a positive value";
+	case ATTDET_ERR_DEGENERATE: return "degenerate geometry";
+	}
+	return "unknown status";
+}
+
+attdet_status attdet_quest(
+  const attdet_sensor *sensors, size_t count, attdet_quat *out) noexcept {
+	if (sensors == nullptr || out == nullptr) { return ATTDET_ERR_NULL; }
+	const auto status = solve(sensors, count, out);
+	if (status != ATTDET_OK) { identity(out); }
+	return status;
+}
+
+attdet_status attdet_quest_batch(const attdet_sensor *sensors, size_t count,
+  size_t samples, attdet_quat *out, attdet_status *status) noexcept {
+	if (samples == 0) { return ATTDET_OK; }
+	if (sensors == nullptr || out == nullptr) { return ATTDET_ERR_NULL; }
+	attdet_status first = ATTDET_OK;
+	for (size_t i = 0; i < samples; ++i) {
+		const auto s = solve(sensors + i * count, count, out + i);
+		if (s != ATTDET_OK) {
+			identity(out + i);
+			if (first == ATTDET_OK) { first = s; }
+		}
+		if (status != nullptr) { status[i] = s; }
+	}
+	return first;
+}
+
+attdet_status attdet_quest_fixed(
+  const attdet_sensor_q *sensors, size_t count, attdet_quat_q *out) noexcept {
+	using alglin::Q16_16;
+	if (sensors == nullptr || out == nullptr) { return ATTDET_ERR_NULL; }
+	*out = { 0, 0, 0, INT32_C(1) << 30 };
+	if (count < 2) { return ATTDET_ERR_COUNT; }
+	int64_t total = 0;
+	for (size_t k = 0; k < count; ++k) { total += sensors[k].weight; }
+	if (total <= 0 || total > INT32_MAX) { return ATTDET_ERR_WEIGHT; }
+
+	// Cópia para SensorQ numa pilha de tamanho fixo, em vez de alocar
+	if (count > ATTDET_FIXED_MAX_SENSORS) { return ATTDET_ERR_COUNT; }
+	SensorQ local[ATTDET_FIXED_MAX_SENSORS];
+	for (size_t k = 0; k < count; ++k) {
+		for (int i = 0; i < 3; ++i) {
+			local[k].measure[i] = Q16_16::from_raw(sensors[k].measure[i]);
+			local[k].reference[i] = Q16_16::from_raw(sensors[k].reference[i]);
+		}
+		local[k].weight = Q16_16::from_raw(sensors[k].weight);
+	}
+	const QuatQ q = quest_fixed(local, local + count);
+	if (q[0].raw == 0 && q[1].raw == 0 && q[2].raw == 0 && q[3].raw == 0) {
+		return ATTDET_ERR_DEGENERATE;
+	}
+	*out = { q[0].raw, q[1].raw, q[2].raw, q[3].raw };
+	return ATTDET_OK;
+}
+
+attdet_status attdet_triad(const attdet_sensor *first,
+  const attdet_sensor *second, double dcm[9]) noexcept {
+	if (first == nullptr || second == nullptr || dcm == nullptr) {
+		return ATTDET_ERR_NULL;
+	}
+	const Sensor a(vec(first->measure), vec(first->reference), first->weight);
+	const Sensor b(vec(second->measure), vec(second->reference), second->weight);
+	const Matrix3 A = triad(a, b);
+	for (int i = 0; i < 3; ++i) {
+		for (int j = 0; j < 3; ++j) {
+			if (!std::isfinite(A[i][j])) { return ATTDET_ERR_DEGENERATE; }
+		}
+	}
+	store(A, dcm);
+	return ATTDET_OK;
+}
+
+attdet_status attdet_quat_to_dcm(const attdet_quat *q, double dcm[9]) noexcept {
+	if (q == nullptr || dcm == nullptr) { return ATTDET_ERR_NULL; }
+	store(Quat2DCM({ q->x, q->y, q->z, q->w }), dcm);
+	return ATTDET_OK;
+}
+
+attdet_status attdet_quat_to_euler(const attdet_quat *q, attdet_vec3 *out) noexcept {
+	if (q == nullptr || out == nullptr) { return ATTDET_ERR_NULL; }
+	const Vec3 e = Quat2Euler({ q->x, q->y, q->z, q->w });
+	*out = { e[0], e[1], e[2] };
+	return ATTDET_OK;
+}
+
+}// extern "C"
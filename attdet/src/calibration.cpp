@@ -0,0 +1,233 @@
+/**
+ * @file calibration.cpp
+ * @brief Ajuste de elipsoide (hard/soft iron) por equações normais
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#include <algorithm>
+#include <attdet/calibration.h>
+#include <cmath>
+
+namespace attdet {
+namespace calibration {
+
+	namespace {
+		// Menor variância aceita das amostras corrigidas em qualquer eixo
+		constexpr double min_spread = .04;
+
+		// Sem desvios: o laço de apply() vetoriza
+		inline void correct(const Correction &c, const Vec3 &raw, Vec3 &out) {
+			const double x = raw[0] - c.offset[0];
+			const double y = raw[1] - c.offset[1];
+			const double z = raw[2] - c.offset[2];
+			const double cx = c.W[0][0] * x + c.W[0][1] * y + c.W[0][2] * z;
+			const double cy = c.W[1][0] * x + c.W[1][1] * y + c.W[1][2] * z;
+			const double cz = c.W[2][0] * x + c.W[2][1] * y + c.W[2][2] * z;
+			const double inv = 1. / std::sqrt(cx * cx + cy * cy + cz * cz);
+			out[0] = cx * inv;
+			out[1] = cy * inv;
+			out[2] = cz * inv;
+		}
+	}// namespace
+
+	Vec3 Correction::operator()(const Vec3 &raw) const {
+		Vec3 out;
+		correct(*this, raw, out);
+		return out;
+	}
+
+	void apply(const Correction &correction, const Vec3 *first, const Vec3 *last,
+	  Vec3 *out) {
+		// Cópia local: o compilador não precisa recarregar W a cada amostra
+		const Correction c = correction;
+		const auto n = last - first;
+		for (std::ptrdiff_t i = 0; i < n; ++i) { correct(c, first[i], out[i]); }
+	}
+
+	void Accumulator::add(const Vec3 &raw) {
+		const double x = raw[0] * inverse_scale_;
+		const double y = raw[1] * inverse_scale_;
+		const double z = raw[2] * inverse_scale_;
+		const alglin::Vector<double, 9> d(
+		  { x * x, y * y, z * z, 2. * y * z, 2. * x * z, 2. * x * y, 2. * x, 2. * y, 2. * z });
+		if (forgetting_ < 1.) {
+			for (auto &e : normal_.data()) { e *= forgetting_; }
+			for (int i = 0; i < 9; ++i) { rhs_[i] *= forgetting_; }
+			weight_ *= forgetting_;
+		}
+		// rank1_update direto no armazenamento empacotado, linha a linha
+		auto *packed = normal_.data().data();
+		for (int i = 0; i < 9; ++i) {
+			for (int j = i; j < 9; ++j) { *packed++ += d[i] * d[j]; }
+			rhs_[i] += d[i];
+		}
+		weight_ += 1.;
+	}
+
+	void Accumulator::add(const Vec3 *first, const Vec3 *last) {
+		for (; first != last; ++first) { add(*first); }
+	}
+
+	Accumulator &Accumulator::operator+=(const Accumulator &other) {
+		normal_ = normal_ + other.normal_;
+		for (int i = 0; i < 9; ++i) { rhs_[i] += other.rhs_[i]; }
+		weight_ += other.weight_;
+		return *this;
+	}
+
+	void Accumulator::reset() {
+		normal_ = {};
+		rhs_ = {};
+		weight_ = 0.;
+	}
+
+	bool Accumulator::fit(Correction &out) const {
+		if (weight_ < 9.) { return false; }
+		const auto F = alglin::cholesky(normal_.full());
+		if (!F.ok) { return false; }
+		const auto p = alglin::solve(F, rhs_);
+		// x^T M x + 2 u^T x = 1
+		Matrix3 M;
+		M[0][0] = p[0];
+		M[1][1] = p[1];
+		M[2][2] = p[2];
+		M[1][2] = M[2][1] = p[3];
+		M[0][2] = M[2][0] = p[4];
+		M[0][1] = M[1][0] = p[5];
+		const auto E = alglin::eigen_symmetric(M);
+		for (int k = 0; k < 3; ++k) {
+			if (!(E.values[k] > 0.)) { return false; }
+		}
+		// Centro o = -M^-1 u; (x - o)^T M (x - o) = 1 + o^T M o = 1 - o^T u
+		Vec3 o{};
+		for (int k = 0; k < 3; ++k) {
+			double vu = 0.;
+			for (int i = 0; i < 3; ++i) { vu += E.vectors[i][k] * p[6 + i]; }
+			for (int i = 0; i < 3; ++i) { o[i] -= E.vectors[i][k] * vu / E.values[k]; }
+		}
+		const double level = 1. - (o[0] * p[6] + o[1] * p[7] + o[2] * p[8]);
+		if (!(level > 0.)) { return false; }
+
+		// W = sqrt(M / level), nas unidades originais
+		Correction c;
+		double semi_axes = 1.;
+		for (int i = 0; i < 3; ++i) {
+			for (int j = 0; j < 3; ++j) { c.W[i][j] = 0.; }
+		}
+		for (int k = 0; k < 3; ++k) {
+			const double s = std::sqrt(E.values[k] / level);
+			semi_axes /= s;
+			for (int i = 0; i < 3; ++i) {
+				for (int j = 0; j < 3; ++j) {
+					c.W[i][j] += s * inverse_scale_ * E.vectors[i][k] * E.vectors[j][k];
+				}
+			}
+		}
+		for (int i = 0; i < 3; ++i) { c.offset[i] = scale_ * o[i]; }
+		c.radius = scale_ * std::cbrt(semi_axes);
+		// Um arco ou uma calota estreita também dão um elipsoide, com o
+		// centro deslocado ao longo do eixo que as amostras não percorrem
+		if (!(c.radius > .5 * scale_ && c.radius < 2. * scale_)) { return false; }
+
+		// Cobertura: covariância das amostras corrigidas, de rhs_ (sum d).
+		// Esfera inteira dá I / 3; calota de meio-ângulo a dá, ao longo do
+		// eixo, var(cos) = 0.018 a 1 rad, 0.045 a 1.3 rad, 1 / 12 a pi / 2
+		Matrix3 C;
+		Vec3 mean;
+		for (int i = 0; i < 3; ++i) { mean[i] = .5 * rhs_[6 + i] / weight_; }
+		C[0][0] = rhs_[0] / weight_;
+		C[1][1] = rhs_[1] / weight_;
+		C[2][2] = rhs_[2] / weight_;
+		C[1][2] = C[2][1] = .5 * rhs_[3] / weight_;
+		C[0][2] = C[2][0] = .5 * rhs_[4] / weight_;
+		C[0][1] = C[1][0] = .5 * rhs_[5] / weight_;
+		for (int i = 0; i < 3; ++i) {
+			for (int j = 0; j < 3; ++j) { C[i][j] -= mean[i] * mean[j]; }
+		}
+		const Matrix3 Ws = scale_ * c.W;
+		const auto spread = alglin::eigen_symmetric(Matrix3(Ws * C * Ws));
+		for (int k = 0; k < 3; ++k) {
+			if (!(spread.values[k] > min_spread)) { return false; }
+		}
+		// sum (d^T p - 1)^2 = p^T N p - 2 p^T r + weight
+		double r = weight_ + alglin::quadratic_form(normal_, p);
+		for (int i = 0; i < 9; ++i) { r -= 2. * p[i] * rhs_[i]; }
+		c.residual = std::sqrt(std::max(0., r) / weight_);
+		out = c;
+		return true;
+	}
+
+	Calibrator::Calibrator(const CalibratorOptions &options)
+	  : options_(options), accumulator_(options.scale, options.forgetting),
+		job_(options.scale, options.forgetting) {
+		if (options_.background) { worker_ = std::thread(&Calibrator::work, this); }
+	}
+
+	Calibrator::~Calibrator() {
+		if (!worker_.joinable()) { return; }
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			state_.store(Stop, std::memory_order_relaxed);
+		}
+		wake_.notify_one();
+		worker_.join();
+	}
+
+	void Calibrator::add(const Vec3 &raw) {
+		accumulator_.add(raw);
+		if (options_.background) { collect(); }
+		if (++since_fit_ < options_.refit_interval
+			|| accumulator_.weight() < static_cast<double>(options_.min_samples)) {
+			return;
+		}
+		if (!options_.background) {
+			refit();
+			return;
+		}
+		// Ajuste anterior ainda em curso: tenta na próxima amostra
+		if (state_.load(std::memory_order_acquire) != Idle) { return; }
+		job_ = accumulator_;
+		since_fit_ = 0;
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			state_.store(Pending, std::memory_order_relaxed);
+		}
+		wake_.notify_one();
+	}
+
+	bool Calibrator::refit() {
+		since_fit_ = 0;
+		if (!accumulator_.fit(correction_)) { return false; }
+		fits_.fetch_add(1, std::memory_order_relaxed);
+		return true;
+	}
+
+	void Calibrator::collect() {
+		if (state_.load(std::memory_order_acquire) != Done) { return; }
+		if (result_ok_) {
+			correction_ = result_;
+			fits_.fetch_add(1, std::memory_order_relaxed);
+		}
+		state_.store(Idle, std::memory_order_relaxed);
+	}
+
+	void Calibrator::work() {
+		std::unique_lock<std::mutex> lock(mutex_);
+		for (;;) {
+			wake_.wait(lock, [this]() {
+				const int s = state_.load(std::memory_order_relaxed);
+				return s == Pending || s == Stop;
+			});
+			if (state_.load(std::memory_order_relaxed) == Stop) { return; }
+			lock.unlock();
+			result_ok_ = job_.fit(result_);
+			lock.lock();
+			// Não sobrescreve Stop
+			int expected = Pending;
+			state_.compare_exchange_strong(expected, Done, std::memory_order_release);
+		}
+	}
+
+}// namespace calibration
+}// namespace attdet
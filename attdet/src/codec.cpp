@@ -0,0 +1,368 @@
+/**
+ * @file codec.cpp
+ * @brief Codificação compacta de quatérnios (smallest-three e delta)
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#include <algorithm>
+#include <attdet/codec.h>
+#include <cmath>
+#include <limits>
+
+#if ALGLIN_SIMD
+#include <immintrin.h>
+#endif
+
+namespace attdet {
+namespace codec {
+
+	namespace {
+		constexpr double half_sqrt2 = 0.70710678118654752440;// maior componente descartada
+		constexpr std::size_t block = 256;
+
+		/**
+		 * Quantização uniforme de [-r, r] em 2^b - 1 passos. Só operações
+		 * cujo resultado não muda com FMA: s * c é exato (s = +-1) e u - h é
+		 * exato, então os kernels escalar e AVX2 dão os mesmos bits.
+		 */
+		struct Quantizer {
+			Quantizer(unsigned b, double r)
+			  : top(static_cast<double>((std::uint64_t(1) << b) - 1)), range(r),
+				scale(top / (2. * r)), step(2. * r / top), half(top / 2.),
+				mask((std::uint64_t(1) << b) - 1), bits(b) {}
+			double top, range, scale, step, half;
+			std::uint64_t mask;
+			unsigned bits;
+
+			std::uint64_t quantize(double v) const {
+				const double u = std::nearbyint((v + range) * scale);
+				return static_cast<std::uint64_t>(std::min(top, std::max(0., u)));
+			}
+			double value(std::uint64_t u) const {
+				return (static_cast<double>(u) - half) * step;
+			}
+		};
+
+		inline std::uint64_t encode_one(const Quantizer &Q, double x, double y,
+		  double z, double w) {
+			const double ax = std::abs(x), ay = std::abs(y), az = std::abs(z), aw = std::abs(w);
+			const double m = std::max(std::max(ax, ay), std::max(az, aw));
+			const unsigned idx = (ax == m) ? 0 : (ay == m) ? 1 : (az == m) ? 2 : 3;
+			const double big = (idx == 0) ? x : (idx == 1) ? y : (idx == 2) ? z : w;
+			const double s = (big < 0.) ? -1. : 1.;
+			// As três restantes, na ordem
+			const double c0 = (idx == 0) ? y : x;
+			const double c1 = (idx <= 1) ? z : y;
+			const double c2 = (idx <= 2) ? w : z;
+			return idx | (Q.quantize(s * c0) << 2) | (Q.quantize(s * c1) << (2 + Q.bits))
+				   | (Q.quantize(s * c2) << (2 + 2 * Q.bits));
+		}
+
+		inline void decode_one(const Quantizer &Q, std::uint64_t code, double &x,
+		  double &y, double &z, double &w) {
+			const unsigned idx = code & 3;
+			const double c0 = Q.value((code >> 2) & Q.mask);
+			const double c1 = Q.value((code >> (2 + Q.bits)) & Q.mask);
+			const double c2 = Q.value((code >> (2 + 2 * Q.bits)) & Q.mask);
+			const double big = std::sqrt(std::max(0., 1. - (c0 * c0 + c1 * c1 + c2 * c2)));
+			x = (idx == 0) ? big : c0;
+			y = (idx == 0) ? c0 : (idx == 1) ? big : c1;
+			z = (idx <= 1) ? c1 : (idx == 2) ? big : c2;
+			w = (idx == 3) ? big : c2;
+		}
+
+		void encode_block_scalar(const Quantizer &Q, const double *const soa[4],
+		  std::size_t n, std::uint64_t *out) {
+			for (std::size_t i = 0; i < n; ++i) {
+				out[i] = encode_one(Q, soa[0][i], soa[1][i], soa[2][i], soa[3][i]);
+			}
+		}
+
+		void decode_block_scalar(const Quantizer &Q, const std::uint64_t *in,
+		  std::size_t n, double *const soa[4]) {
+			for (std::size_t i = 0; i < n; ++i) {
+				decode_one(Q, in[i], soa[0][i], soa[1][i], soa[2][i], soa[3][i]);
+			}
+		}
+
+#if ALGLIN_SIMD
+		// Lambdas não herdam target("avx2"): auxiliares como funções
+		__attribute__((target("avx2"))) inline __m256i to_u64(__m256d v) {
+			return _mm256_cvtepu32_epi64(_mm256_cvtpd_epi32(v));
+		}
+
+		__attribute__((target("avx2"))) inline __m256i quantize(__m256d v, __m256d range,
+		  __m256d scale, __m256d top) {
+			const __m256d u = _mm256_round_pd(_mm256_mul_pd(_mm256_add_pd(v, range), scale),
+			  _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+			return to_u64(_mm256_min_pd(top, _mm256_max_pd(_mm256_setzero_pd(), u)));
+		}
+
+		// Campos < 2^31: os 32 bits baixos de cada lane bastam
+		__attribute__((target("avx2"))) inline __m256d value(__m256i code, __m128i shift,
+		  __m256i mask, __m256d half, __m256d step) {
+			const __m256i u = _mm256_and_si256(_mm256_srl_epi64(code, shift), mask);
+			const __m256i low = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+			const __m256d d = _mm256_cvtepi32_pd(
+			  _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(u, low)));
+			return _mm256_mul_pd(_mm256_sub_pd(d, half), step);
+		}
+
+		// 4 quatérnios por iteração; o resto vai pelo escalar
+		__attribute__((target("avx2"))) void encode_block_avx2(const Quantizer &Q,
+		  const double *const soa[4], std::size_t n, std::uint64_t *out) {
+			const __m256d sign_bit = _mm256_set1_pd(-0.);
+			const __m256d zero = _mm256_setzero_pd(), one = _mm256_set1_pd(1.);
+			const __m256d range = _mm256_set1_pd(Q.range), scale = _mm256_set1_pd(Q.scale);
+			const __m256d top = _mm256_set1_pd(Q.top);
+			const __m128i shift1 = _mm_cvtsi32_si128(2);
+			const __m128i shift2 = _mm_cvtsi32_si128(static_cast<int>(2 + Q.bits));
+			const __m128i shift3 = _mm_cvtsi32_si128(static_cast<int>(2 + 2 * Q.bits));
+			std::size_t i = 0;
+			for (; i + 4 <= n; i += 4) {
+				const __m256d x = _mm256_loadu_pd(soa[0] + i), y = _mm256_loadu_pd(soa[1] + i);
+				const __m256d z = _mm256_loadu_pd(soa[2] + i), w = _mm256_loadu_pd(soa[3] + i);
+				const __m256d ax = _mm256_andnot_pd(sign_bit, x), ay = _mm256_andnot_pd(sign_bit, y);
+				const __m256d az = _mm256_andnot_pd(sign_bit, z), aw = _mm256_andnot_pd(sign_bit, w);
+				const __m256d m = _mm256_max_pd(_mm256_max_pd(ax, ay), _mm256_max_pd(az, aw));
+				const __m256d is0 = _mm256_cmp_pd(ax, m, _CMP_EQ_OQ);
+				const __m256d is1 = _mm256_andnot_pd(is0, _mm256_cmp_pd(ay, m, _CMP_EQ_OQ));
+				const __m256d le1 = _mm256_or_pd(is0, is1);
+				const __m256d is2 = _mm256_andnot_pd(le1, _mm256_cmp_pd(az, m, _CMP_EQ_OQ));
+				const __m256d le2 = _mm256_or_pd(le1, is2);
+				const __m256d idx = _mm256_blendv_pd(
+				  _mm256_blendv_pd(_mm256_blendv_pd(_mm256_set1_pd(3.), _mm256_set1_pd(2.), is2),
+					one, is1),
+				  zero, is0);
+				const __m256d big = _mm256_blendv_pd(
+				  _mm256_blendv_pd(_mm256_blendv_pd(w, z, is2), y, is1), x, is0);
+				const __m256d s = _mm256_blendv_pd(one, _mm256_set1_pd(-1.),
+				  _mm256_cmp_pd(big, zero, _CMP_LT_OQ));
+				const __m256d c0 = _mm256_mul_pd(s, _mm256_blendv_pd(x, y, is0));
+				const __m256d c1 = _mm256_mul_pd(s, _mm256_blendv_pd(y, z, le1));
+				const __m256d c2 = _mm256_mul_pd(s, _mm256_blendv_pd(z, w, le2));
+				__m256i code = to_u64(idx);
+				code = _mm256_or_si256(code, _mm256_sll_epi64(quantize(c0, range, scale, top), shift1));
+				code = _mm256_or_si256(code, _mm256_sll_epi64(quantize(c1, range, scale, top), shift2));
+				code = _mm256_or_si256(code, _mm256_sll_epi64(quantize(c2, range, scale, top), shift3));
+				_mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), code);
+			}
+			const double *const rest[4] = { soa[0] + i, soa[1] + i, soa[2] + i, soa[3] + i };
+			encode_block_scalar(Q, rest, n - i, out + i);
+		}
+
+		__attribute__((target("avx2"))) void decode_block_avx2(const Quantizer &Q,
+		  const std::uint64_t *in, std::size_t n, double *const soa[4]) {
+			const __m256i mask = _mm256_set1_epi64x(static_cast<long long>(Q.mask));
+			const __m256d half = _mm256_set1_pd(Q.half), step = _mm256_set1_pd(Q.step);
+			const __m256d zero = _mm256_setzero_pd(), one = _mm256_set1_pd(1.);
+			const __m128i shift1 = _mm_cvtsi32_si128(2);
+			const __m128i shift2 = _mm_cvtsi32_si128(static_cast<int>(2 + Q.bits));
+			const __m128i shift3 = _mm_cvtsi32_si128(static_cast<int>(2 + 2 * Q.bits));
+			std::size_t i = 0;
+			for (; i + 4 <= n; i += 4) {
+				const __m256i code = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + i));
+				const __m256i idx = _mm256_and_si256(code, _mm256_set1_epi64x(3));
+				const __m256d is0 = _mm256_castsi256_pd(_mm256_cmpeq_epi64(idx, _mm256_set1_epi64x(0)));
+				const __m256d is1 = _mm256_castsi256_pd(_mm256_cmpeq_epi64(idx, _mm256_set1_epi64x(1)));
+				const __m256d is2 = _mm256_castsi256_pd(_mm256_cmpeq_epi64(idx, _mm256_set1_epi64x(2)));
+				const __m256d is3 = _mm256_castsi256_pd(_mm256_cmpeq_epi64(idx, _mm256_set1_epi64x(3)));
+				const __m256d le1 = _mm256_or_pd(is0, is1);
+				const __m256d c0 = value(code, shift1, mask, half, step);
+				const __m256d c1 = value(code, shift2, mask, half, step);
+				const __m256d c2 = value(code, shift3, mask, half, step);
+				const __m256d sum = _mm256_add_pd(
+				  _mm256_add_pd(_mm256_mul_pd(c0, c0), _mm256_mul_pd(c1, c1)), _mm256_mul_pd(c2, c2));
+				const __m256d big = _mm256_sqrt_pd(_mm256_max_pd(zero, _mm256_sub_pd(one, sum)));
+				_mm256_storeu_pd(soa[0] + i, _mm256_blendv_pd(c0, big, is0));
+				_mm256_storeu_pd(soa[1] + i,
+				  _mm256_blendv_pd(_mm256_blendv_pd(c1, big, is1), c0, is0));
+				_mm256_storeu_pd(soa[2] + i,
+				  _mm256_blendv_pd(_mm256_blendv_pd(c2, big, is2), c1, le1));
+				_mm256_storeu_pd(soa[3] + i, _mm256_blendv_pd(c2, big, is3));
+			}
+			double *const rest[4] = { soa[0] + i, soa[1] + i, soa[2] + i, soa[3] + i };
+			decode_block_scalar(Q, in + i, n - i, rest);
+		}
+
+		bool has_avx2() {
+			static const bool yes = []() {
+				__builtin_cpu_init();
+				return __builtin_cpu_supports("avx2") != 0;
+			}();
+			return yes;
+		}
+#endif
+
+		void encode_block(const Quantizer &Q, const double *const soa[4],
+		  std::size_t n, std::uint64_t *out) {
+#if ALGLIN_SIMD
+			if (has_avx2()) { return encode_block_avx2(Q, soa, n, out); }
+#endif
+			encode_block_scalar(Q, soa, n, out);
+		}
+
+		void decode_block(const Quantizer &Q, const std::uint64_t *in, std::size_t n,
+		  double *const soa[4]) {
+#if ALGLIN_SIMD
+			if (has_avx2()) { return decode_block_avx2(Q, in, n, soa); }
+#endif
+			decode_block_scalar(Q, in, n, soa);
+		}
+
+		void store(std::uint64_t code, unsigned char *out, std::size_t bytes) {
+			for (std::size_t i = 0; i < bytes; ++i) {
+				out[i] = static_cast<unsigned char>(code >> (8 * i));
+			}
+		}
+
+		std::uint64_t load(const unsigned char *in, std::size_t bytes) {
+			std::uint64_t code = 0;
+			for (std::size_t i = 0; i < bytes; ++i) {
+				code |= static_cast<std::uint64_t>(in[i]) << (8 * i);
+			}
+			return code;
+		}
+
+		// Produto de Hamilton, (x, y, z, w)
+		Quat multiply(const Quat &a, const Quat &b) {
+			return { a[3] * b[0] + a[0] * b[3] + a[1] * b[2] - a[2] * b[1],
+				a[3] * b[1] - a[0] * b[2] + a[1] * b[3] + a[2] * b[0],
+				a[3] * b[2] + a[0] * b[1] - a[1] * b[0] + a[2] * b[3],
+				a[3] * b[3] - a[0] * b[0] - a[1] * b[1] - a[2] * b[2] };
+		}
+
+		Quat conjugate(const Quat &q) { return { -q[0], -q[1], -q[2], q[3] }; }
+
+		unsigned key_bits(const Format &f) { return (f.bits - 3) / 3; }
+		unsigned delta_bits(const Format &f) { return (f.bits - 1) / 3; }
+		double delta_range(const Format &f) { return std::sin(f.max_step / 2.); }
+
+		// Codificador e decodificador passam pelo mesmo caminho
+		Quat apply_delta(const Quantizer &Q, const Quat &previous, std::uint64_t code) {
+			const Vec3 v({ Q.value(code & Q.mask), Q.value((code >> Q.bits) & Q.mask),
+			  Q.value((code >> (2 * Q.bits)) & Q.mask) });
+			const Quat dq({ v[0], v[1], v[2], std::sqrt(std::max(0., 1. - v * v)) });
+			return alglin::normalize(multiply(previous, dq));
+		}
+	}// namespace
+
+	double max_error(const Format &format, bool key) {
+		if (!format.valid()) { return std::numeric_limits<double>::quiet_NaN(); }
+		if (!format.delta) {
+			const unsigned b = (format.bits - 2) / 3;
+			return 2. * std::sqrt(6.) / static_cast<double>((std::uint64_t(1) << b) - 1);
+		}
+		if (key) {
+			return 2. * std::sqrt(6.) / static_cast<double>((std::uint64_t(1) << key_bits(format)) - 1);
+		}
+		// |dv| <= sqrt(3) d / 2 e o w reconstruído amplifica por 1 / sqrt(1 - 3 r^2)
+		const double r = delta_range(format);
+		const double d = 2. * r / static_cast<double>((std::uint64_t(1) << delta_bits(format)) - 1);
+		return std::sqrt(3.) * d / std::sqrt(1. - 3. * r * r);
+	}
+
+	std::uint64_t pack(const Quat &q, unsigned b) {
+		return encode_one(Quantizer(b, half_sqrt2), q[0], q[1], q[2], q[3]);
+	}
+
+	Quat unpack(std::uint64_t code, unsigned b) {
+		Quat q;
+		decode_one(Quantizer(b, half_sqrt2), code, q[0], q[1], q[2], q[3]);
+		return q;
+	}
+
+	std::uint64_t Encoder::next(const Quat &q) {
+		const bool forced = count_ == 0
+							|| (format_.key_interval && count_ % format_.key_interval == 0);
+		++count_;
+		if (!forced) {
+			const Quantizer Q(delta_bits(format_), delta_range(format_));
+			Quat dq = multiply(conjugate(previous_), q);
+			if (dq[3] < 0.) { dq = -1. * dq; }
+			if (std::abs(dq[0]) <= Q.range && std::abs(dq[1]) <= Q.range
+				&& std::abs(dq[2]) <= Q.range) {
+				const std::uint64_t code = Q.quantize(dq[0]) | (Q.quantize(dq[1]) << Q.bits)
+										   | (Q.quantize(dq[2]) << (2 * Q.bits));
+				previous_ = apply_delta(Q, previous_, code);
+				return 1 | (code << 1);
+			}
+		}
+		const auto code = pack(q, key_bits(format_));
+		previous_ = unpack(code, key_bits(format_));
+		return code << 1;
+	}
+
+	std::size_t Encoder::encode(const Quat *first, const Quat *last, unsigned char *out) {
+		// Fora de 8..64 bits os deslocamentos dos campos não são definidos
+		if (!valid()) { return 0; }
+		const auto n = static_cast<std::size_t>(last - first);
+		const auto bytes = format_.bytes();
+		if (format_.delta) {
+			for (std::size_t i = 0; i < n; ++i) { store(next(first[i]), out + i * bytes, bytes); }
+			return n * bytes;
+		}
+		const Quantizer Q((format_.bits - 2) / 3, half_sqrt2);
+		double x[block], y[block], z[block], w[block];
+		const double *const soa[4] = { x, y, z, w };
+		std::uint64_t codes[block];
+		for (std::size_t base = 0; base < n; base += block) {
+			const auto m = std::min(block, n - base);
+			for (std::size_t i = 0; i < m; ++i) {
+				const Quat &q = first[base + i];
+				x[i] = q[0];
+				y[i] = q[1];
+				z[i] = q[2];
+				w[i] = q[3];
+			}
+			encode_block(Q, soa, m, codes);
+			for (std::size_t i = 0; i < m; ++i) { store(codes[i], out + (base + i) * bytes, bytes); }
+		}
+		return n * bytes;
+	}
+
+	Quat Decoder::next(std::uint64_t code) {
+		if ((code & 1) == 0) {
+			previous_ = unpack(code >> 1, key_bits(format_));
+			has_previous_ = true;
+		} else if (has_previous_) {
+			previous_ = apply_delta(Quantizer(delta_bits(format_), delta_range(format_)),
+			  previous_, code >> 1);
+		} else {
+			const double nan = std::numeric_limits<double>::quiet_NaN();
+			return { nan, nan, nan, nan };
+		}
+		return previous_;
+	}
+
+	std::size_t Decoder::decode(const unsigned char *in, std::size_t count, Quat *out) {
+		if (!valid()) {
+			const double nan = std::numeric_limits<double>::quiet_NaN();
+			std::fill(out, out + count, Quat({ nan, nan, nan, nan }));
+			return 0;
+		}
+		const auto bytes = format_.bytes();
+		if (format_.delta) {
+			std::size_t valid = 0;
+			for (std::size_t i = 0; i < count; ++i) {
+				out[i] = next(load(in + i * bytes, bytes));
+				valid += std::isfinite(out[i][3]) ? 1 : 0;
+			}
+			return valid;
+		}
+		const Quantizer Q((format_.bits - 2) / 3, half_sqrt2);
+		double x[block], y[block], z[block], w[block];
+		double *const soa[4] = { x, y, z, w };
+		std::uint64_t codes[block];
+		for (std::size_t base = 0; base < count; base += block) {
+			const auto m = std::min(block, count - base);
+			for (std::size_t i = 0; i < m; ++i) { codes[i] = load(in + (base + i) * bytes, bytes); }
+			decode_block(Q, codes, m, soa);
+			for (std::size_t i = 0; i < m; ++i) { out[base + i] = { x[i], y[i], z[i], w[i] }; }
+		}
+		return count;
+	}
+
+}// namespace codec
+}// namespace attdet
@@ -0,0 +1,515 @@
+/**
+ * @file fleet.cpp
+ * @brief Vários veículos: leitura multiplexada e estado particionado por
+ * worker
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#include <algorithm>
+#include <attdet/fleet.h>
+#include <attdet/io.h>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <new>
+#if defined(__unix__) || defined(__APPLE__)
+#include <poll.h>
+#include <unistd.h>
+#define ATTDET_FLEET_POSIX 1
+#else
+#define ATTDET_FLEET_POSIX 0
+#endif
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace attdet {
+namespace fleet {
+
+	namespace detail {
+		constexpr int latency_bins = 40;// 2^39 ns ~ 9 min
+
+		// Posição do bit mais alto (v > 0): floor(log2(v))
+		int highest_bit(std::uint64_t v) {
+#if defined(__GNUC__)
+			return 63 - __builtin_clzll(v);
+#else
+			int bit = 0;
+			while (v >>= 1) { ++bit; }
+			return bit;
+#endif
+		}
+
+		std::int64_t now() {
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			  std::chrono::steady_clock::now().time_since_epoch())
+			  .count();
+		}
+
+		struct Sample {
+			VehicleId vehicle;
+			std::int64_t received;// steady_clock, ns
+			double data[9];
+		};
+
+		/**
+		 * Um produtor (ingest) e um consumidor (worker). Cada lado guarda
+		 * uma cópia do índice do outro e só relê o atômico quando ela não
+		 * basta. Preenchimento em vez de alignas: Worker vem de new, que só
+		 * respeita alinhamento estendido a partir do C++17.
+		 */
+		class Ring {
+		  public:
+			explicit Ring(std::size_t capacity) : slots_(capacity), mask_(capacity - 1) {}
+
+			bool push(const Sample &sample) {
+				const auto tail = tail_.load(std::memory_order_relaxed);
+				if (tail - head_cache_ == slots_.size()) {
+					head_cache_ = head_.load(std::memory_order_acquire);
+					if (tail - head_cache_ == slots_.size()) { return false; }
+				}
+				slots_[tail & mask_] = sample;
+				tail_.store(tail + 1, std::memory_order_release);
+				return true;
+			}
+
+			bool pop(Sample &sample) {
+				const auto head = head_.load(std::memory_order_relaxed);
+				if (head == tail_cache_) {
+					tail_cache_ = tail_.load(std::memory_order_acquire);
+					if (head == tail_cache_) { return false; }
+				}
+				sample = slots_[head & mask_];
+				head_.store(head + 1, std::memory_order_release);
+				return true;
+			}
+
+			bool empty() const {
+				return head_.load(std::memory_order_relaxed) == tail_.load(std::memory_order_acquire);
+			}
+
+		  private:
+			std::vector<Sample> slots_;
+			std::size_t mask_;
+			char pad0_[64];
+			std::atomic<std::size_t> head_{ 0 };
+			std::size_t tail_cache_ = 0;// consumidor
+			char pad1_[64];
+			std::atomic<std::size_t> tail_{ 0 };
+			std::size_t head_cache_ = 0;// produtor
+			char pad2_[64];
+		};
+
+		struct Vehicle {
+			Vehicle(VehicleId id_, unsigned worker_, const VehicleConfig &config)
+			  : id(id_), worker(worker_),
+				sensors{ { Sensor({}, alglin::normalize(config.acc_reference), config.acc_weight),
+				  Sensor({}, alglin::normalize(config.mag_reference), config.mag_weight) } },
+				calibrate(config.calibrate),
+				mag(calibration::CalibratorOptions(std::sqrt(config.mag_reference * config.mag_reference),
+				  1., config.refit_interval, 100, false)) {
+				for (auto &bin : histogram) { bin.store(0, std::memory_order_relaxed); }
+			}
+			VehicleId id;
+			unsigned worker;
+			SensorSet<2> sensors;
+			bool calibrate;
+			calibration::Calibrator mag;// refit inline: sem uma thread por veículo
+			std::uint64_t sample = 0;
+			// Métricas: só o worker dono escreve
+			std::atomic<std::uint64_t> samples{ 0 }, latency_sum{ 0 }, latency_max{ 0 };
+			std::atomic<std::int64_t> first{ 0 }, last{ 0 };
+			std::array<std::atomic<std::uint64_t>, latency_bins> histogram;
+		};
+
+		/**
+		 * Vehicle tem membros alignas(32) com USE_SIMD=1, e new só respeita
+		 * alinhamento acima de max_align_t a partir do C++17: aloca à mão.
+		 */
+		struct VehicleDelete {
+			void operator()(Vehicle *v) const {
+				v->~Vehicle();
+				std::free(v);
+			}
+		};
+		using VehiclePtr = std::unique_ptr<Vehicle, VehicleDelete>;
+
+		VehiclePtr make_vehicle(VehicleId id, unsigned worker, const VehicleConfig &config) {
+#if ATTDET_FLEET_POSIX
+			void *p = nullptr;
+			const std::size_t align = std::max(alignof(Vehicle), sizeof(void *));
+			if (posix_memalign(&p, align, sizeof(Vehicle)) != 0) { return nullptr; }
+			return VehiclePtr(new (p) Vehicle(id, worker, config));
+#else
+			// Sem start() fora de POSIX, nenhum veículo é criado
+			(void)id;
+			(void)worker;
+			(void)config;
+			return nullptr;
+#endif
+		}
+
+		struct Worker {
+			Worker(unsigned index_, std::size_t queue, std::size_t max_vehicles,
+			  const std::unordered_map<VehicleId, VehicleConfig> &configs_,
+			  const VehicleConfig &defaults_, const Scheduler::Callback &callback_)
+			  : index(index_), ring(queue), vehicles(max_vehicles), configs(configs_),
+				defaults(defaults_), callback(callback_) {}
+
+			void run();
+			void process(const Sample &sample);
+			Vehicle *find(VehicleId id);
+			// Lado do ingest, depois de um push
+			void notify() {
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				if (!sleeping.load(std::memory_order_relaxed)) { return; }
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+				}
+				wake.notify_one();
+			}
+			void finish() {
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					done.store(true, std::memory_order_release);
+				}
+				wake.notify_one();
+			}
+
+			unsigned index;
+			Ring ring;
+			// Só cresce; metrics() lê [0, count)
+			std::vector<VehiclePtr> vehicles;
+			std::atomic<std::size_t> count{ 0 };
+			std::unordered_map<VehicleId, Vehicle *> lookup;// só o worker
+			const std::unordered_map<VehicleId, VehicleConfig> &configs;
+			const VehicleConfig &defaults;
+			const Scheduler::Callback &callback;
+			std::atomic<bool> sleeping{ false }, done{ false };
+			std::atomic<std::uint64_t> rejected{ 0 };
+			std::mutex mutex;
+			std::condition_variable wake;
+			std::thread thread;
+		};
+
+		Vehicle *Worker::find(VehicleId id) {
+			const auto it = lookup.find(id);
+			if (it != lookup.end()) { return it->second; }
+			const auto n = count.load(std::memory_order_relaxed);
+			if (n == vehicles.size()) { return nullptr; }
+			const auto config = configs.find(id);
+			vehicles[n] = make_vehicle(id, index, config == configs.end() ? defaults : config->second);
+			if (!vehicles[n]) { return nullptr; }
+			count.store(n + 1, std::memory_order_release);
+			return lookup[id] = vehicles[n].get();
+		}
+
+		void Worker::process(const Sample &sample) {
+			Vehicle *v = find(sample.vehicle);
+			if (v == nullptr) {
+				rejected.store(rejected.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+				return;
+			}
+			const double *d = sample.data;
+			v->sensors[0].measure = alglin::normalize(Vec3({ d[0], d[1], d[2] }));
+			const Vec3 mag({ d[6], d[7], d[8] });
+			v->sensors[1].measure = v->calibrate ? v->mag.update(mag) : alglin::normalize(mag);
+			const Quat q = quest(v->sensors);
+
+			const auto end = now();
+			const auto latency = static_cast<std::uint64_t>(std::max<std::int64_t>(1, end - sample.received));
+			const auto n = v->samples.load(std::memory_order_relaxed);
+			if (n == 0) { v->first.store(sample.received, std::memory_order_relaxed); }
+			v->last.store(sample.received, std::memory_order_relaxed);
+			v->latency_sum.store(v->latency_sum.load(std::memory_order_relaxed) + latency,
+			  std::memory_order_relaxed);
+			if (latency > v->latency_max.load(std::memory_order_relaxed)) {
+				v->latency_max.store(latency, std::memory_order_relaxed);
+			}
+			const int bin = std::min(latency_bins - 1, highest_bit(latency));
+			v->histogram[bin].store(v->histogram[bin].load(std::memory_order_relaxed) + 1,
+			  std::memory_order_relaxed);
+			v->samples.store(n + 1, std::memory_order_release);
+
+			if (callback) { callback(v->id, ++v->sample, q); }
+		}
+
+		void Worker::run() {
+			Sample sample;
+			for (;;) {
+				if (ring.pop(sample)) {
+					process(sample);
+					continue;
+				}
+				if (done.load(std::memory_order_acquire)) {
+					// O ingest não escreve mais: esvazia e sai
+					while (ring.pop(sample)) { process(sample); }
+					return;
+				}
+				std::unique_lock<std::mutex> lock(mutex);
+				sleeping.store(true, std::memory_order_relaxed);
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				if (ring.empty() && !done.load(std::memory_order_relaxed)) {
+					wake.wait_for(lock, std::chrono::milliseconds(10));
+				}
+				sleeping.store(false, std::memory_order_relaxed);
+			}
+		}
+
+		void pin(std::thread &thread, unsigned index) {
+#if defined(__linux__)
+			const unsigned cpus = std::max(1u, std::thread::hardware_concurrency());
+			cpu_set_t set;
+			CPU_ZERO(&set);
+			CPU_SET(index % cpus, &set);
+			pthread_setaffinity_np(thread.native_handle(), sizeof set, &set);
+#else
+			(void)thread;
+			(void)index;
+#endif
+		}
+	}// namespace detail
+
+	Scheduler::Scheduler(const Options &options, Callback callback)
+	  : options_(options), callback_(std::move(callback)) {}
+
+	Scheduler::~Scheduler() { stop(); }
+
+	void Scheduler::configure(VehicleId vehicle, const VehicleConfig &config) {
+		if (!started_) { configs_[vehicle] = config; }
+	}
+
+	bool Scheduler::add_stream(int fd, VehicleId vehicle) {
+		if (started_ || fd < 0) { return false; }
+		inputs_.push_back({ fd, false, vehicle, {}, 0, false, false });
+		streams_open_.store(inputs_.size(), std::memory_order_relaxed);
+		return true;
+	}
+
+	bool Scheduler::add_multiplexed_stream(int fd) {
+		if (started_ || fd < 0) { return false; }
+		inputs_.push_back({ fd, true, 0, {}, 0, false, false });
+		streams_open_.store(inputs_.size(), std::memory_order_relaxed);
+		return true;
+	}
+
+	bool Scheduler::start() {
+#if !ATTDET_FLEET_POSIX
+		return false;
+#endif
+		if (started_) { return false; }
+		started_ = true;
+		unsigned n = options_.workers ? options_.workers : std::thread::hardware_concurrency();
+		n = std::max(1u, n);
+		std::size_t queue = 2;
+		while (queue < options_.queue) { queue *= 2; }
+		for (unsigned i = 0; i < n; ++i) {
+			workers_.emplace_back(new detail::Worker(i, queue, options_.max_vehicles, configs_,
+			  options_.defaults, callback_));
+		}
+		for (auto &w : workers_) {
+			w->thread = std::thread(&detail::Worker::run, w.get());
+			if (options_.pin) { detail::pin(w->thread, w->index); }
+		}
+		ingest_ = std::thread(&Scheduler::ingest, this);
+		return true;
+	}
+
+	void Scheduler::wait() {
+		if (!started_ || finished_) { return; }
+		ingest_.join();
+		finish();
+	}
+
+	void Scheduler::stop() {
+		stopping_ = true;
+		wait();
+	}
+
+	void Scheduler::finish() {
+		for (auto &w : workers_) { w->finish(); }
+		for (auto &w : workers_) { w->thread.join(); }
+		finished_ = true;
+	}
+
+	bool Scheduler::line(Input &input, const char *text, std::int64_t now) {
+		detail::Sample sample;
+		sample.received = now;
+		sample.vehicle = input.vehicle;
+		bool ok;
+		if (input.multiplexed) {
+			double fields[10];
+			ok = io::parse_csv(text, fields, 10) == 10 && fields[0] >= 0.
+				 && fields[0] <= 4294967295. && fields[0] == std::floor(fields[0]);
+			if (ok) {
+				sample.vehicle = static_cast<VehicleId>(fields[0]);
+				std::memcpy(sample.data, fields + 1, sizeof sample.data);
+			}
+		} else {
+			ok = io::parse_csv(text, sample.data, 9) == 9;
+		}
+		if (ok) {
+			detail::Worker &w = *workers_[sample.vehicle % workers_.size()];
+			if (!w.ring.push(sample)) { return false; }
+			w.notify();
+		} else {
+			malformed_.store(malformed_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		}
+		lines_.store(lines_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		return true;
+	}
+
+	bool Scheduler::drain(Input &input, std::int64_t now) {
+		char *buffer = input.buffer.data();
+		std::size_t start = 0;
+		bool all = true;
+		for (std::size_t k = 0; k < input.used; ++k) {
+			if (buffer[k] != '\n') { continue; }
+			buffer[k] = '\0';
+			if (!line(input, buffer + start, now)) {
+				buffer[k] = '\n';
+				all = false;
+				break;
+			}
+			start = k + 1;
+		}
+		if (all && start == 0 && input.used == input.buffer.size() - 1) {
+			// Linha maior que o buffer: descarta
+			malformed_.store(malformed_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			input.used = 0;
+		} else if (start > 0) {
+			std::memmove(buffer, buffer + start, input.used - start);
+			input.used -= start;
+		}
+		return all;
+	}
+
+	void Scheduler::ingest() {
+#if ATTDET_FLEET_POSIX
+		std::vector<pollfd> fds(inputs_.size());
+		for (std::size_t i = 0; i < inputs_.size(); ++i) {
+			fds[i].fd = inputs_[i].fd;
+			fds[i].events = POLLIN;
+		}
+		std::size_t open = inputs_.size(), blocked = 0;
+		auto close = [&](std::size_t i) {
+			fds[i].fd = -1;
+			--open;
+			streams_open_.store(open, std::memory_order_relaxed);
+		};
+		while (open > 0 && !stopping_.load(std::memory_order_relaxed)) {
+			// Stream parado num ring cheio: as linhas ficam no buffer e o fd
+			// sai do poll até o worker abrir vaga. Um arquivo está sempre
+			// legível; sem isso ele seria lido mais rápido do que é resolvido
+			for (std::size_t i = 0; blocked > 0 && i < inputs_.size(); ++i) {
+				Input &in = inputs_[i];
+				if (!in.blocked || !drain(in, detail::now())) { continue; }
+				in.blocked = false;
+				--blocked;
+				if (in.eof) {
+					close(i);
+				} else {
+					fds[i].fd = in.fd;
+				}
+			}
+			// Timeout curto só para notar stop(), ou vaga num ring
+			const int ready = ::poll(fds.data(), fds.size(), blocked > 0 ? 1 : 50);
+			if (ready < 0 && errno != EINTR) { break; }
+			if (ready <= 0) { continue; }
+			for (std::size_t i = 0; i < fds.size(); ++i) {
+				if (fds[i].fd < 0 || fds[i].revents == 0) { continue; }
+				Input &in = inputs_[i];
+				char *buffer = in.buffer.data();
+				const ssize_t n = ::read(in.fd, buffer + in.used, in.buffer.size() - 1 - in.used);
+				if (n < 0 && (errno == EAGAIN || errno == EINTR)) { continue; }
+				if (n <= 0) {
+					// Fim do arquivo, ou EIO de um pty cujo outro lado fechou;
+					// a última linha pode não ter '\n'
+					in.eof = true;
+					if (in.used > 0) { buffer[in.used++] = '\n'; }
+				} else {
+					in.used += static_cast<std::size_t>(n);
+				}
+				if (!drain(in, detail::now())) {
+					in.blocked = true;
+					++blocked;
+					fds[i].fd = -1;
+				} else if (in.eof) {
+					close(i);
+				}
+			}
+		}
+		// stop() com linhas esperando vaga: descartadas
+		std::uint64_t left = 0;
+		for (const auto &in : inputs_) {
+			if (in.blocked) { left += static_cast<std::uint64_t>(std::count(in.buffer.data(), in.buffer.data() + in.used, '\n')); }
+		}
+		dropped_.store(left, std::memory_order_relaxed);
+#endif
+		streams_open_.store(0, std::memory_order_relaxed);
+	}
+
+	std::vector<VehicleMetrics> Scheduler::metrics() const {
+		std::vector<VehicleMetrics> out;
+		for (const auto &w : workers_) {
+			const auto n = w->count.load(std::memory_order_acquire);
+			for (std::size_t k = 0; k < n; ++k) {
+				const detail::Vehicle &v = *w->vehicles[k];
+				VehicleMetrics m{};
+				m.vehicle = v.id;
+				m.worker = v.worker;
+				m.samples = v.samples.load(std::memory_order_acquire);
+				if (m.samples == 0) {
+					out.push_back(m);
+					continue;
+				}
+				const auto span = v.last.load(std::memory_order_relaxed)
+								  - v.first.load(std::memory_order_relaxed);
+				m.rate = (span > 0) ? static_cast<double>(m.samples - 1) * 1E9 / static_cast<double>(span) : 0.;
+				m.latency_mean = static_cast<double>(v.latency_sum.load(std::memory_order_relaxed))
+								 / static_cast<double>(m.samples);
+				m.latency_max = static_cast<double>(v.latency_max.load(std::memory_order_relaxed));
+				// Percentis pelo histograma, borda superior do bin
+				std::array<std::uint64_t, detail::latency_bins> bins;
+				std::uint64_t total = 0;
+				for (int b = 0; b < detail::latency_bins; ++b) {
+					bins[b] = v.histogram[b].load(std::memory_order_relaxed);
+					total += bins[b];
+				}
+				auto percentile = [&](double p) {
+					const auto target = static_cast<std::uint64_t>(std::ceil(p * static_cast<double>(total)));
+					std::uint64_t seen = 0;
+					for (int b = 0; b < detail::latency_bins; ++b) {
+						seen += bins[b];
+						if (seen >= target && seen > 0) { return std::ldexp(1., b + 1); }
+					}
+					return std::ldexp(1., detail::latency_bins);
+				};
+				m.latency_p50 = percentile(.5);
+				m.latency_p99 = percentile(.99);
+				out.push_back(m);
+			}
+		}
+		return out;
+	}
+
+	Totals Scheduler::totals() const {
+		Totals t{};
+		t.lines = lines_.load(std::memory_order_relaxed);
+		t.malformed = malformed_.load(std::memory_order_relaxed);
+		t.dropped = dropped_.load(std::memory_order_relaxed);
+		for (const auto &w : workers_) {
+			t.rejected += w->rejected.load(std::memory_order_relaxed);
+		}
+		t.streams_open = streams_open_.load(std::memory_order_relaxed);
+		return t;
+	}
+
+}// namespace fleet
+}// namespace attdet
@@ -0,0 +1,40 @@
+/**
+ * @file io.cpp
+ * @brief Leitura e escrita de amostras sem alocação
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#include <attdet/io.h>
+#include <cstdio>
+#include <cstdlib>
+
+namespace attdet {
+namespace io {
+
+	std::size_t parse_csv(const char *line, double *out, std::size_t count) {
+		std::size_t n = 0;
+		const char *p = line;
+		while (n < count) {
+			char *end = nullptr;
+			const double value = std::strtod(p, &end);
+			if (end == p) { break; }
+			out[n++] = value;
+			if (*end != ',') { break; }
+			p = end + 1;
+		}
+		return n;
+	}
+
+	std::size_t format_quat(const Quat &q, char *buffer, std::size_t size) {
+		const int n = std::snprintf(
+		  buffer, size, "%.8f,%.8f,%.8f,%.8f\n", q[0], q[1], q[2], q[3]);
+		if (n < 0 || static_cast<std::size_t>(n) >= size) {
+			if (size > 0) { buffer[0] = '\0'; }
+			return 0;
+		}
+		return static_cast<std::size_t>(n);
+	}
+
+}// namespace io
+}// namespace attdet
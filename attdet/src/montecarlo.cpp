@@ -0,0 +1,221 @@
+/**
+ * @file montecarlo.cpp
+ * @brief Monte-Carlo de erro de atitude com Philox4x32-10
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#include <algorithm>
+#include <atomic>
+#include <attdet/montecarlo.h>
+#include <cmath>
+#include <thread>
+
+namespace attdet {
+namespace montecarlo {
+
+	constexpr int Statistics::bins_per_decade;
+	constexpr int Statistics::bins;
+
+	namespace {
+		constexpr double pi = 3.141592653589793;
+
+		inline void mulhilo(std::uint32_t a, std::uint32_t b, std::uint32_t &hi,
+		  std::uint32_t &lo) {
+			const std::uint64_t p = static_cast<std::uint64_t>(a) * b;
+			hi = static_cast<std::uint32_t>(p >> 32);
+			lo = static_cast<std::uint32_t>(p);
+		}
+
+		// Ângulo da rotação que leva truth a estimate, sem acos perto de 0
+		double error(const Quat &truth, const Quat &estimate) {
+			const double w = truth * estimate;
+			const double x = truth[3] * estimate[0] - truth[0] * estimate[3]
+							 - truth[1] * estimate[2] + truth[2] * estimate[1];
+			const double y = truth[3] * estimate[1] + truth[0] * estimate[2]
+							 - truth[1] * estimate[3] - truth[2] * estimate[0];
+			const double z = truth[3] * estimate[2] - truth[0] * estimate[1]
+							 + truth[1] * estimate[0] - truth[2] * estimate[3];
+			return 2. * std::atan2(std::sqrt(x * x + y * y + z * z), std::abs(w));
+		}
+
+		Statistics run_chunk(const std::vector<SensorModel> &suite,
+		  const Options &options, std::uint64_t begin, std::uint64_t end) {
+			const Solver solve = options.solver ? options.solver : static_cast<Solver>(&quest);
+			std::vector<Sensor> sensors(suite.size());
+			Statistics stats;
+			for (auto trial = begin; trial < end; ++trial) {
+				Stream stream(options.seed, trial);
+				const Quat truth = observe(stream, suite.data(),
+				  suite.data() + suite.size(), sensors.data(), options);
+				const Quat q = solve(sensors.data(), sensors.data() + sensors.size());
+				stats.add(error(truth, q));
+			}
+			return stats;
+		}
+	}// namespace
+
+	std::array<std::uint32_t, 4> philox(
+	  std::uint64_t key, std::uint64_t counter_hi, std::uint64_t counter_lo) {
+		std::uint32_t c[4] = { static_cast<std::uint32_t>(counter_lo),
+			static_cast<std::uint32_t>(counter_lo >> 32),
+			static_cast<std::uint32_t>(counter_hi),
+			static_cast<std::uint32_t>(counter_hi >> 32) };
+		std::uint32_t k0 = static_cast<std::uint32_t>(key);
+		std::uint32_t k1 = static_cast<std::uint32_t>(key >> 32);
+		for (int round = 0; round < 10; ++round) {
+			std::uint32_t hi0, lo0, hi1, lo1;
+			mulhilo(0xD2511F53u, c[0], hi0, lo0);
+			mulhilo(0xCD9E8D57u, c[2], hi1, lo1);
+			const std::uint32_t n[4] = { hi1 ^ c[1] ^ k0, lo1, hi0 ^ c[3] ^ k1, lo0 };
+			std::copy(n, n + 4, c);
+			k0 += 0x9E3779B9u;
+			k1 += 0xBB67AE85u;
+		}
+		return { { c[0], c[1], c[2], c[3] } };
+	}
+
+	std::uint32_t Stream::next() {
+		if (used_ == 4) {
+			block_ = philox(seed_, stream_, counter_++);
+			used_ = 0;
+		}
+		return block_[static_cast<std::size_t>(used_++)];
+	}
+
+	double Stream::uniform() {
+		const auto a = next() >> 5, b = next() >> 6;
+		return (a * 67108864. + b) * (1. / 9007199254740992.);
+	}
+
+	double Stream::normal() {
+		if (has_spare_) {
+			has_spare_ = false;
+			return spare_;
+		}
+		const double r = std::sqrt(-2. * std::log(1. - uniform()));
+		const double theta = 2. * pi * uniform();
+		spare_ = r * std::sin(theta);
+		has_spare_ = true;
+		return r * std::cos(theta);
+	}
+
+	Vec3 Stream::direction() {
+		const double z = 2. * uniform() - 1.;
+		const double phi = 2. * pi * uniform();
+		const double r = std::sqrt(std::max(0., 1. - z * z));
+		return { r * std::cos(phi), r * std::sin(phi), z };
+	}
+
+	Quat Stream::attitude() {
+		const double u1 = uniform(), u2 = 2. * pi * uniform(), u3 = 2. * pi * uniform();
+		const double a = std::sqrt(1. - u1), b = std::sqrt(u1);
+		return { a * std::sin(u2), a * std::cos(u2), b * std::sin(u3), b * std::cos(u3) };
+	}
+
+	void Statistics::add(double e) {
+		++trials;
+		if (!std::isfinite(e)) {
+			++failures;
+			return;
+		}
+		sum += e;
+		sum_squares += e * e;
+		max = std::max(max, e);
+		const double position = (std::log10(std::max(e, 1E-9)) + 9.) * bins_per_decade;
+		const int bin = std::min(bins - 1, static_cast<int>(position));
+		++histogram[static_cast<std::size_t>(bin)];
+	}
+
+	void Statistics::merge(const Statistics &other) {
+		trials += other.trials;
+		failures += other.failures;
+		sum += other.sum;
+		sum_squares += other.sum_squares;
+		max = std::max(max, other.max);
+		for (std::size_t i = 0; i < histogram.size(); ++i) {
+			histogram[i] += other.histogram[i];
+		}
+	}
+
+	double Statistics::mean() const {
+		const auto n = trials - failures;
+		return n ? sum / static_cast<double>(n) : 0.;
+	}
+
+	double Statistics::rms() const {
+		const auto n = trials - failures;
+		return n ? std::sqrt(sum_squares / static_cast<double>(n)) : 0.;
+	}
+
+	double Statistics::percentile(double p) const {
+		const auto n = trials - failures;
+		if (n == 0) { return 0.; }
+		const auto target = static_cast<std::uint64_t>(std::ceil(p * static_cast<double>(n)));
+		std::uint64_t count = 0;
+		for (int i = 0; i < bins; ++i) {
+			count += histogram[static_cast<std::size_t>(i)];
+			if (count >= target && count > 0) {
+				return std::min(max, std::pow(10., static_cast<double>(i + 1) / bins_per_decade - 9.));
+			}
+		}
+		return max;
+	}
+
+	Quat observe(Stream &stream, const SensorModel *first,
+	  const SensorModel *last, Sensor *out, const Options &options) {
+		Quat truth;
+		if (options.attitudes == Attitudes::Cone) {
+			const Vec3 axis = stream.direction();
+			const double half = .5 * options.cone * stream.uniform();
+			truth = { axis[0] * std::sin(half), axis[1] * std::sin(half),
+				axis[2] * std::sin(half), std::cos(half) };
+		} else {
+			truth = stream.attitude();
+		}
+		const Matrix3 A = Quat2DCM(truth);
+		for (auto model = first; model != last; ++model, ++out) {
+			const bool fixed = (model->reference * model->reference) > 0.;
+			out->reference = fixed ? alglin::normalize(model->reference) : stream.direction();
+			const Vec3 noise({ stream.normal(), stream.normal(), stream.normal() });
+			out->measure = alglin::normalize(Vec3(A * out->reference + model->noise * noise));
+			out->weight = (model->weight > 0.) ? model->weight
+						  : (model->noise > 0.) ? 1. / (model->noise * model->noise)
+												: 1.;
+		}
+		return truth;
+	}
+
+	Statistics run(const std::vector<SensorModel> &suite, const Options &options) {
+		Statistics total;
+		if (options.trials == 0 || suite.empty()) { return total; }
+		// Limita o número de lotes (memória), sem depender das threads
+		constexpr std::uint64_t max_chunks = 4096;
+		const auto chunk = std::max<std::uint64_t>({ 1, options.chunk,
+		  (options.trials + max_chunks - 1) / max_chunks });
+		const auto chunks = static_cast<std::size_t>((options.trials + chunk - 1) / chunk);
+		std::vector<Statistics> results(chunks);
+
+		unsigned threads = options.threads ? options.threads : std::thread::hardware_concurrency();
+		threads = std::max(1u, std::min<unsigned>(threads, static_cast<unsigned>(chunks)));
+		std::atomic<std::size_t> next(0);
+		auto work = [&]() {
+			for (auto c = next++; c < chunks; c = next++) {
+				const auto begin = c * chunk;
+				results[c] = run_chunk(suite, options, begin,
+				  std::min<std::uint64_t>(options.trials, begin + chunk));
+			}
+		};
+		std::vector<std::thread> workers;
+		workers.reserve(threads - 1);
+		for (unsigned t = 1; t < threads; ++t) { workers.emplace_back(work); }
+		work();
+		for (auto &w : workers) { w.join(); }
+
+		// Redução na ordem dos lotes: mesma soma para qualquer número de threads
+		for (const auto &r : results) { total.merge(r); }
+		return total;
+	}
+
+}// namespace montecarlo
+}// namespace attdet
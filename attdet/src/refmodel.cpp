@@ -0,0 +1,367 @@
+/**
+ * @file refmodel.cpp
+ * @brief Vetores de referência: campo geomagnético e direção do sol
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#include <algorithm>
+#include <attdet/refmodel.h>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+namespace attdet {
+namespace refmodel {
+
+	constexpr double ReferenceModel::sun_cache;
+
+	namespace {
+		constexpr double pi = 3.14159265358979323846;
+		constexpr double deg = pi / 180.;
+		constexpr double year = 365.25 * 86400.;// Ano juliano, s
+		constexpr double earth_radius = 6371.2;// Raio de referência, km
+		constexpr double wgs84_a = 6378.137;
+		constexpr double wgs84_f = 1. / 298.257223563;
+		constexpr int max_degree = 13;
+
+		double decimal_year(double time) { return 1970. + time / year; }
+
+		double julian_day(double time) { return time / 86400. + 2440587.5; }
+
+		// Base NED a partir de um vetor em ECEF
+		Vec3 ecef_to_ned(const Vec3 &v, double latitude, double longitude) {
+			const double sp = std::sin(latitude * deg);
+			const double cp = std::cos(latitude * deg);
+			const double sl = std::sin(longitude * deg);
+			const double cl = std::cos(longitude * deg);
+			return { -sp * cl * v[0] - sp * sl * v[1] + cp * v[2],
+				-sl * v[0] + cl * v[1],
+				-cp * cl * v[0] - cp * sl * v[1] - sp * v[2] };
+		}
+
+		Vec3 eci_to_ned(const Vec3 &v, const Geodetic &position, double time) {
+			// GMST, precisão de ~0.1 s para datas próximas de J2000
+			const double d = julian_day(time) - 2451545.0;
+			const double gmst =
+			  std::fmod(280.46061837 + 360.98564736629 * d, 360.) * deg;
+			const double c = std::cos(gmst);
+			const double s = std::sin(gmst);
+			const Vec3 ecef({ c * v[0] + s * v[1], -s * v[0] + c * v[1], v[2] });
+			return ecef_to_ned(ecef, position.latitude, position.longitude);
+		}
+	}// namespace
+
+	GaussCoefficients GaussCoefficients::load(const std::string &path) {
+		GaussCoefficients out;
+		std::ifstream file(path);
+		std::string line;
+		if (!std::getline(file, line)) { return out; }
+		std::istringstream(line) >> out.epoch;
+
+		const auto size = index(max_degree, max_degree) + 1;
+		out.g.assign(size, 0.);
+		out.h.assign(size, 0.);
+		out.dg.assign(size, 0.);
+		out.dh.assign(size, 0.);
+		int degree = 0;
+		while (std::getline(file, line)) {
+			std::istringstream row(line);
+			int n{}, m{};
+			double g{}, h{}, dg{}, dh{};
+			// A linha 9999... do fim do arquivo não cabe em int e encerra
+			if (!(row >> n >> m >> g >> h >> dg >> dh)) { break; }
+			if (n < 1 || n > max_degree || m < 0 || m > n) { return {}; }
+			const auto i = index(n, m);
+			out.g[i] = g;
+			out.h[i] = h;
+			out.dg[i] = dg;
+			out.dh[i] = dh;
+			degree = std::max(degree, n);
+		}
+		if (degree == 0 || out.epoch <= 0.) { return {}; }
+		out.degree = degree;
+		const auto used = index(degree, degree) + 1;
+		out.g.resize(used);
+		out.h.resize(used);
+		out.dg.resize(used);
+		out.dh.resize(used);
+		return out;
+	}
+
+	GaussCoefficients GaussCoefficients::igrf13_degree3() {
+		GaussCoefficients out;
+		out.degree = 3;
+		out.epoch = 2020.;
+		// n = 1..3, m = 0..n
+		out.g = { 0., -29404.8, -1450.9, -2499.6, 2982.0, 1677.0, 1363.2,
+			-2381.2, 1236.2, 525.7 };
+		out.h = { 0., 0., 4652.5, 0., -2991.6, -734.6, 0., -82.1, 241.9,
+			-543.4 };
+		out.dg = { 0., 5.7, 7.4, -11.0, -7.0, -2.1, 2.2, -5.9, 3.1, -12.0 };
+		out.dh = { 0., 0., -25.9, 0., -30.2, -22.4, 0., 6.0, -1.1, 0.5 };
+		return out;
+	}
+
+	/**
+	 * @brief Síntese em harmônicos esféricos (Wertz, apêndice H): Legendre
+	 * com normalização de Gauss por recorrência e fatores de Schmidt, em
+	 * coordenadas geocêntricas, girado de volta para a vertical geodésica.
+	 */
+	Vec3 magnetic_field(const GaussCoefficients &model, const Geodetic &position,
+	  double time) {
+		if (!model.valid() || model.degree > max_degree) { return {}; }
+		const int N = model.degree;
+		const double dt = decimal_year(time) - model.epoch;
+
+		// Geodésica -> geocêntrica
+		const double e2 = wgs84_f * (2. - wgs84_f);
+		const double phi = position.latitude * deg;
+		const double sphi = std::sin(phi);
+		const double rc = wgs84_a / std::sqrt(1. - e2 * sphi * sphi);
+		const double p = (rc + position.altitude) * std::cos(phi);
+		const double z = (rc * (1. - e2) + position.altitude) * sphi;
+		const double r = std::sqrt(p * p + z * z);
+		const double phic = std::asin(z / r);
+
+		const double ct = std::sin(phic);// cos(colatitude)
+		const double st = std::max(1E-10, std::cos(phic));
+		const double lambda = position.longitude * deg;
+
+		double P[max_degree + 1][max_degree + 1]{};
+		double dP[max_degree + 1][max_degree + 1]{};
+		double S[max_degree + 1][max_degree + 1]{};
+		double cm[max_degree + 1]{};
+		double sm[max_degree + 1]{};
+		P[0][0] = 1.;
+		S[0][0] = 1.;
+		cm[0] = 1.;
+		const double cl = std::cos(lambda);
+		const double sl = std::sin(lambda);
+		for (int m = 1; m <= N; ++m) {
+			cm[m] = cm[m - 1] * cl - sm[m - 1] * sl;
+			sm[m] = sm[m - 1] * cl + cm[m - 1] * sl;
+		}
+		for (int n = 1; n <= N; ++n) {
+			S[n][0] = S[n - 1][0] * (2. * n - 1.) / n;
+			for (int m = 1; m <= n; ++m) {
+				S[n][m] = S[n][m - 1]
+						  * std::sqrt((n - m + 1.) * ((m == 1) ? 2. : 1.) / (n + m));
+			}
+			for (int m = 0; m <= n; ++m) {
+				if (m == n) {
+					P[n][n] = st * P[n - 1][n - 1];
+					dP[n][n] = st * dP[n - 1][n - 1] + ct * P[n - 1][n - 1];
+				} else {
+					const double K = (n == 1)
+									   ? 0.
+									   : ((n - 1.) * (n - 1.) - m * m)
+										   / ((2. * n - 1.) * (2. * n - 3.));
+					const double P2 = (n >= 2 && m <= n - 2) ? P[n - 2][m] : 0.;
+					const double dP2 = (n >= 2 && m <= n - 2) ? dP[n - 2][m] : 0.;
+					P[n][m] = ct * P[n - 1][m] - K * P2;
+					dP[n][m] = ct * dP[n - 1][m] - st * P[n - 1][m] - K * dP2;
+				}
+			}
+		}
+
+		double br = 0., bt = 0., bp = 0.;
+		const double ratio = earth_radius / r;
+		double ar = ratio * ratio;
+		for (int n = 1; n <= N; ++n) {
+			ar *= ratio;// (a/r)^(n+2)
+			for (int m = 0; m <= n; ++m) {
+				const auto i = GaussCoefficients::index(n, m);
+				const double g = S[n][m] * (model.g[i] + dt * model.dg[i]);
+				const double h = S[n][m] * (model.h[i] + dt * model.dh[i]);
+				const double gh = g * cm[m] + h * sm[m];
+				br += (n + 1) * ar * gh * P[n][m];
+				bt -= ar * gh * dP[n][m];
+				bp -= ar * m * (-g * sm[m] + h * cm[m]) * P[n][m];
+			}
+		}
+		bp /= st;
+
+		// Norte, leste, baixo geocêntricos -> geodésicos
+		const double X = -bt;
+		const double Y = bp;
+		const double Z = -br;
+		const double psi = phic - phi;
+		return { X * std::cos(psi) - Z * std::sin(psi),
+			Y,
+			X * std::sin(psi) + Z * std::cos(psi) };
+	}
+
+	/**
+	 * @brief Efeméride solar de baixa precisão (Astronomical Almanac),
+	 * ~0.01 grau entre 1950 e 2050
+	 */
+	Vec3 sun_eci(double time) {
+		const double n = julian_day(time) - 2451545.0;
+		const double L = 280.460 + 0.9856474 * n;
+		const double g = (357.528 + 0.9856003 * n) * deg;
+		const double lambda =
+		  (L + 1.915 * std::sin(g) + 0.020 * std::sin(2. * g)) * deg;
+		const double epsilon = (23.439 - 0.0000004 * n) * deg;
+		return { std::cos(lambda),
+			std::cos(epsilon) * std::sin(lambda),
+			std::sin(epsilon) * std::sin(lambda) };
+	}
+
+	Vec3 sun_direction(const Geodetic &position, double time) {
+		return eci_to_ned(sun_eci(time), position, time);
+	}
+
+	double ReferenceModel::build_grid(const GridSpec &spec) {
+		spec_ = spec;
+		auto count = [](double lo, double hi, double step) {
+			return std::max(2, static_cast<int>(std::lround((hi - lo) / step)) + 1);
+		};
+		nlat_ = count(spec.lat_min, spec.lat_max, spec.lat_step);
+		nlon_ = count(spec.lon_min, spec.lon_max, spec.lon_step);
+		nalt_ = count(spec.alt_min, spec.alt_max, spec.alt_step);
+		spec_.lat_step = (spec.lat_max - spec.lat_min) / (nlat_ - 1);
+		spec_.lon_step = (spec.lon_max - spec.lon_min) / (nlon_ - 1);
+		spec_.alt_step = (spec.alt_max - spec.alt_min) / (nalt_ - 1);
+
+		grid_.assign(static_cast<std::size_t>(nlat_) * nlon_ * nalt_ * 6, 0.);
+		auto node = grid_.begin();
+		for (int i = 0; i < nlat_; ++i) {
+			for (int j = 0; j < nlon_; ++j) {
+				for (int k = 0; k < nalt_; ++k) {
+					const Geodetic p{ spec_.lat_min + i * spec_.lat_step,
+						spec_.lon_min + j * spec_.lon_step,
+						spec_.alt_min + k * spec_.alt_step };
+					// Variação secular é linear nos coeficientes
+					const auto b0 = refmodel::magnetic_field(model_, p, spec_.epoch);
+					const auto b1 =
+					  refmodel::magnetic_field(model_, p, spec_.epoch + year);
+					for (int c = 0; c < 3; ++c) {
+						*node++ = b0[c];
+						*node++ = (b1[c] - b0[c]) / year;
+					}
+				}
+			}
+		}
+
+		/*
+		 * Cota do erro, em [epoch, epoch + 1 ano]. Trilinear é o produto de
+		 * três interpolações lineares com pesos convexos, então
+		 *   |f - If| <= sum_d max|h_d^2 d2f/dx_d^2| / 8.
+		 * A segunda diferença num nó é h^2 f'' em algum ponto de [x - h, x + h];
+		 * a curvatura da célula é a maior dos 8 cantos, com margem de 2x, e a
+		 * cota nunca fica abaixo do erro medido no centro. O erro é afim no
+		 * tempo (variação secular linear), então bastam os dois extremos.
+		 */
+		constexpr double margin = 2.;
+		const int n[3] = { nlat_, nlon_, nalt_ };
+		const std::size_t stride[3] = { static_cast<std::size_t>(nlon_) * nalt_ * 6,
+			static_cast<std::size_t>(nalt_) * 6, 6 };
+		// |segunda diferença| do campo em dt ao longo de axis, no nó idx
+		auto second = [&](const int *idx, int axis, double dt) {
+			if (n[axis] < 3) { return -1.; }
+			const int m = std::min(n[axis] - 2, std::max(1, idx[axis]));
+			std::size_t at0 = 0;
+			for (int d = 0; d < 3; ++d) { at0 += (d == axis ? m : idx[d]) * stride[d]; }
+			double sum = 0.;
+			for (int c = 0; c < 3; ++c) {
+				auto f = [&](std::size_t at) { return grid_[at + 2 * c] + dt * grid_[at + 2 * c + 1]; };
+				const double d2 = f(at0 + stride[axis]) - 2. * f(at0) + f(at0 - stride[axis]);
+				sum += d2 * d2;
+			}
+			return std::sqrt(sum);
+		};
+
+		grid_error_ = 0.;
+		for (int i = 0; i + 1 < nlat_; ++i) {
+			for (int j = 0; j + 1 < nlon_; ++j) {
+				for (int k = 0; k + 1 < nalt_; ++k) {
+					const Geodetic p{ spec_.lat_min + (i + .5) * spec_.lat_step,
+						spec_.lon_min + (j + .5) * spec_.lon_step,
+						spec_.alt_min + (k + .5) * spec_.alt_step };
+					for (const double dt : { 0., year }) {
+						const Vec3 e(interpolate(p, spec_.epoch + dt)
+									 - refmodel::magnetic_field(model_, p, spec_.epoch + dt));
+						const double center = std::sqrt(e * e);
+						double bound = 0.;
+						for (int axis = 0; axis < 3; ++axis) {
+							double curvature = 0.;
+							for (int corner = 0; corner < 8; ++corner) {
+								const int idx[3] = { i + (corner & 1), j + ((corner >> 1) & 1),
+									k + ((corner >> 2) & 1) };
+								curvature = std::max(curvature, second(idx, axis, dt));
+							}
+							// Eixo com 2 nós: só o centro estima a curvatura
+							bound += (curvature < 0.) ? 8. * center : curvature;
+						}
+						grid_error_ = std::max(grid_error_, std::max(center, margin * bound / 8.));
+					}
+				}
+			}
+		}
+		return grid_error_;
+	}
+
+	bool ReferenceModel::inside(const Geodetic &p) const {
+		return has_grid() && p.latitude >= spec_.lat_min
+			   && p.latitude <= spec_.lat_max && p.longitude >= spec_.lon_min
+			   && p.longitude <= spec_.lon_max && p.altitude >= spec_.alt_min
+			   && p.altitude <= spec_.alt_max;
+	}
+
+	Vec3 ReferenceModel::interpolate(const Geodetic &p, double time) const {
+		auto cell = [](double x, double lo, double step, int n, double &t) {
+			const double u = (x - lo) / step;
+			const int i = std::min(n - 2, std::max(0, static_cast<int>(u)));
+			t = u - i;
+			return i;
+		};
+		double tl{}, to{}, ta{};
+		const int i = cell(p.latitude, spec_.lat_min, spec_.lat_step, nlat_, tl);
+		const int j = cell(p.longitude, spec_.lon_min, spec_.lon_step, nlon_, to);
+		const int k = cell(p.altitude, spec_.alt_min, spec_.alt_step, nalt_, ta);
+		const double dt = time - spec_.epoch;
+
+		Vec3 out{};
+		for (int a = 0; a < 2; ++a) {
+			for (int b = 0; b < 2; ++b) {
+				for (int c = 0; c < 2; ++c) {
+					const double w = (a ? tl : 1. - tl) * (b ? to : 1. - to)
+									 * (c ? ta : 1. - ta);
+					const auto n = ((static_cast<std::size_t>(i + a) * nlon_ + (j + b))
+									   * nalt_
+									 + (k + c))
+								   * 6;
+					for (int d = 0; d < 3; ++d) {
+						out[d] += w * (grid_[n + 2 * d] + dt * grid_[n + 2 * d + 1]);
+					}
+				}
+			}
+		}
+		return out;
+	}
+
+	Vec3 ReferenceModel::magnetic_field(const Geodetic &position,
+	  double time) const {
+		Geodetic p = position;
+		p.longitude = std::fmod(p.longitude + 540., 360.) - 180.;
+		if (inside(p)) { return interpolate(p, time); }
+		return refmodel::magnetic_field(model_, p, time);
+	}
+
+	Vec3 ReferenceModel::sun_direction(const Geodetic &position, double time) {
+		// O sol anda ~1 grau/dia em ECI: 60 s de cache custam < 0.001 grau
+		if (std::abs(time - sun_time_) > sun_cache) {
+			sun_eci_ = sun_eci(time);
+			sun_time_ = time;
+		}
+		return eci_to_ned(sun_eci_, position, time);
+	}
+
+	ReferenceVectors ReferenceModel::evaluate(const Geodetic &position,
+	  double time) {
+		return { magnetic_field(position, time), sun_direction(position, time) };
+	}
+
+}// namespace refmodel
+}// namespace attdet
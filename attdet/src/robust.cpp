@@ -0,0 +1,209 @@
+/**
+ * @file robust.cpp
+ * @brief QUEST robusto: RANSAC sobre pares de observações
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#include <algorithm>
+#include <attdet/robust.h>
+#include <cmath>
+#include <random>
+#include <thread>
+
+namespace attdet {
+
+constexpr std::size_t RobustOptions::min_batch;
+
+namespace {
+	struct Score {
+		std::size_t inliers;
+		double loss;
+		std::size_t subset;// desempate determinístico
+		Quat attitude;
+	};
+
+	bool better(const Score &a, const Score &b) {
+		if (a.inliers != b.inliers) { return a.inliers > b.inliers; }
+		if (a.loss != b.loss) { return a.loss < b.loss; }
+		return a.subset < b.subset;
+	}
+
+	struct Observations {
+		const Sensor *sensors;
+		std::size_t size;
+		std::vector<Matrix3> terms;// w * measure * reference^T
+		std::vector<double> scale;// 1 / (|measure| |reference|)
+		double cos_threshold;
+	};
+
+	Score score(const Observations &obs, const Quat &q, std::size_t id,
+	  std::vector<bool> *inliers = nullptr) {
+		const auto A = Quat2DCM(q);
+		Score out{ 0, 0., id, q };
+		for (std::size_t i = 0; i < obs.size; ++i) {
+			const auto &s = obs.sensors[i];
+			const double c = obs.scale[i] * (s.measure * (A * s.reference));
+			const bool in = c >= obs.cos_threshold;
+			if (in) {
+				++out.inliers;
+				out.loss += s.weight * (1. - c);
+			}
+			if (inliers != nullptr) { (*inliers)[i] = in; }
+		}
+		return out;
+	}
+
+	using Subset = std::pair<std::size_t, std::size_t>;
+
+	// Pares com medidas quase colineares não determinam a atitude
+	bool usable(const Observations &obs, std::size_t i, std::size_t j) {
+		const auto &a = obs.sensors[i].measure;
+		const auto &b = obs.sensors[j].measure;
+		return std::abs(a * b) < 0.9995 * std::sqrt((a * a) * (b * b));
+	}
+
+	std::vector<Subset> subsets(const Observations &obs, std::size_t max) {
+		std::vector<Subset> out;
+		const auto n = obs.size;
+		if (n * (n - 1) / 2 <= max) {
+			for (std::size_t i = 0; i < n; ++i) {
+				for (std::size_t j = i + 1; j < n; ++j) {
+					if (usable(obs, i, j)) { out.emplace_back(i, j); }
+				}
+			}
+			return out;
+		}
+		// Amostragem com semente fixa: mesma entrada, mesma resposta
+		std::minstd_rand g(12345);
+		std::uniform_int_distribution<std::size_t> pick(0, n - 1);
+		for (std::size_t tries = 0; out.size() < max && tries < 4 * max; ++tries) {
+			const auto i = pick(g);
+			const auto j = pick(g);
+			if (i != j && usable(obs, i, j)) {
+				out.emplace_back(std::min(i, j), std::max(i, j));
+			}
+		}
+		return out;
+	}
+
+	Score best_of(const Observations &obs, const std::vector<Subset> &list,
+	  std::size_t begin, std::size_t end) {
+		Score best{ 0, 0., list.size(), {} };
+		for (auto k = begin; k < end; ++k) {
+			const auto i = list[k].first;
+			const auto j = list[k].second;
+			// B do subconjunto: soma dos termos já calculados
+			const Matrix3 B = obs.terms[i] + obs.terms[j];
+			const Quat q = quest_profile(
+			  B, obs.sensors[i].weight + obs.sensors[j].weight);
+			const auto s = score(obs, q, k);
+			if (best.subset == list.size() || better(s, best)) { best = s; }
+		}
+		return best;
+	}
+}// namespace
+
+/**
+ * @brief QUEST with outlier rejection (see robust.h)
+ *
+ * @param first, last Sensors, at least 2
+ * @param options Threshold, subset budget and parallel batches
+ * @return RobustResult Attitude from the inliers and the inlier mask
+ */
+RobustResult quest_robust(const Sensor *first, const Sensor *last,
+  const RobustOptions &options) {
+	RobustResult result;
+	if (last - first < 2) { return result; }
+
+	Observations obs{ first,
+		static_cast<std::size_t>(last - first),
+		{},
+		{},
+		std::cos(options.threshold) };
+	obs.terms.reserve(obs.size);
+	obs.scale.reserve(obs.size);
+	Matrix3 B_all{};
+	double lambda_all{};
+	for (auto s = first; s != last; ++s) {
+		obs.terms.push_back(s->weight * alglin::outer(s->measure, s->reference));
+		obs.scale.push_back(
+		  1. / std::sqrt((s->measure * s->measure) * (s->reference * s->reference)));
+		B_all = B_all + obs.terms.back();
+		lambda_all += s->weight;
+	}
+	result.inliers.assign(obs.size, true);
+
+	const auto list = (obs.size > 2) ? subsets(obs, options.max_subsets)
+									 : std::vector<Subset>{};
+	if (list.empty()) {
+		// Sem redundância para votar: QUEST simples
+		result.attitude = quest_profile(B_all, lambda_all);
+		const auto s = score(obs, result.attitude, 0, &result.inliers);
+		result.inlier_count = s.inliers;
+		result.loss = s.loss;
+		return result;
+	}
+
+	// Lotes contíguos; cada lote devolve o seu melhor e a redução é serial.
+	// Criar e juntar uma thread custa ~100 soluções: lote mínimo de
+	// min_batch pares, senão fica tudo na thread que chamou
+	const auto batches = static_cast<std::size_t>(
+	  std::max(1u, std::min<unsigned>(options.threads,
+					 static_cast<unsigned>(list.size() / RobustOptions::min_batch))));
+	std::vector<Score> best(batches);
+	const auto per = (list.size() + batches - 1) / batches;
+	auto run = [&](std::size_t b) {
+		best[b] = best_of(obs, list, b * per, std::min(list.size(), (b + 1) * per));
+	};
+	std::vector<std::thread> workers;
+	workers.reserve(batches - 1);
+	for (std::size_t b = 1; b < batches; ++b) { workers.emplace_back(run, b); }
+	run(0);
+	for (auto &w : workers) { w.join(); }
+	Score winner = best[0];
+	for (const auto &s : best) {
+		if (s.subset < list.size() && better(s, winner)) { winner = s; }
+	}
+
+	// Inliers do melhor par: B = B_all - termos dos outliers (ou a soma
+	// direta dos inliers, o que for mais curto). Com menos de 2 nenhum par
+	// concorda nem consigo mesmo: B vazio daria NaN, então usa todas
+	std::vector<bool> in(obs.size);
+	score(obs, winner.attitude, 0, &in);
+	Matrix3 B{};
+	double lambda{};
+	const auto inliers = static_cast<std::size_t>(std::count(in.begin(), in.end(), true));
+	if (inliers < 2) {
+		B = B_all;
+		lambda = lambda_all;
+	} else if (2 * inliers >= obs.size) {
+		B = B_all;
+		lambda = lambda_all;
+		for (std::size_t i = 0; i < obs.size; ++i) {
+			if (!in[i]) {
+				B = B - obs.terms[i];
+				lambda -= first[i].weight;
+			}
+		}
+	} else {
+		for (std::size_t i = 0; i < obs.size; ++i) {
+			if (in[i]) {
+				B = B + obs.terms[i];
+				lambda += first[i].weight;
+			}
+		}
+	}
+	result.attitude = quest_profile(B, lambda);
+	const auto s = score(obs, result.attitude, 0, &result.inliers);
+	result.inlier_count = s.inliers;
+	result.loss = s.loss;
+	return result;
+}
+
+RobustResult quest_robust(const std::initializer_list<Sensor> &sensors,
+  const RobustOptions &options) {
+	return quest_robust(sensors.begin(), sensors.end(), options);
+}
+
+}// namespace attdet
@@ -0,0 +1,262 @@
+/**
+ * @file shm.cpp
+ * @brief Última atitude em memória compartilhada, com seqlock
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#include <atomic>
+#include <attdet/shm.h>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <thread>
+#include <type_traits>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define ATTDET_SHM_POSIX 1
+#else
+#define ATTDET_SHM_POSIX 0
+#endif
+
+namespace attdet {
+namespace shm {
+
+	namespace {
+		constexpr std::size_t words = sizeof(State) / sizeof(std::uint64_t);
+		constexpr std::size_t sample_word = offsetof(State, sample) / sizeof(std::uint64_t);
+		static_assert(sizeof(State) % sizeof(std::uint64_t) == 0, "State must be whole 64-bit words");
+		static_assert(std::is_trivial<State>::value, "State is copied word by word");
+		constexpr std::uint64_t magic = 0x314D485354544441ull;// "ATTDSHM1"
+
+		/**
+		 * read(): read_spins tentativas com pause (dezenas de µs, contra
+		 * dezenas de ns por escrita), depois dorme em passos curtos até
+		 * read_patience. Dormir deixa um publisher preemptado no meio da
+		 * escrita terminar (numa CPU só, girar não adianta, e yield() não
+		 * garante a vez); um que morreu não termina nunca.
+		 */
+		constexpr int read_spins = 1 << 12;
+		constexpr std::chrono::milliseconds read_patience(5);
+
+		inline void relax() {
+#if defined(__x86_64__) || defined(__i386__)
+			__builtin_ia32_pause();
+#endif
+		}
+	}// namespace
+
+	/**
+	 * sequence: 0 = nada publicado, ímpar = escrita em andamento, par =
+	 * estado consistente. Em linha própria de cache, separada do magic.
+	 */
+	struct Segment {
+		std::atomic<std::uint64_t> magic;
+		std::uint64_t size;// sizeof(State) de quem criou
+		alignas(64) std::atomic<std::uint64_t> sequence;
+		std::atomic<std::uint64_t> state[words];
+	};
+
+	State snapshot(std::uint64_t time, const Quat &attitude,
+	  const Matrix3 *covariance, const Sensor *first, const Sensor *last) {
+		State s{};
+		s.time = time;
+		for (int i = 0; i < 4; ++i) { s.attitude[i] = attitude[i]; }
+		if (covariance != nullptr) {
+			for (int i = 0; i < 3; ++i) {
+				for (int j = 0; j < 3; ++j) { s.covariance[3 * i + j] = (*covariance)[i][j]; }
+			}
+		}
+		for (auto sensor = first; sensor != last && s.sensor_count < max_sensors; ++sensor) {
+			auto &out = s.sensors[s.sensor_count++];
+			for (int i = 0; i < 3; ++i) {
+				out.measure[i] = sensor->measure[i];
+				out.reference[i] = sensor->reference[i];
+			}
+			out.weight = sensor->weight;
+		}
+		return s;
+	}
+
+	Publisher::Publisher(Publisher &&other) noexcept
+	  : segment_(other.segment_), sample_(other.sample_) {
+		other.segment_ = nullptr;
+	}
+
+	Publisher &Publisher::operator=(Publisher &&other) noexcept {
+		if (this != &other) {
+			release();
+			segment_ = other.segment_;
+			sample_ = other.sample_;
+			other.segment_ = nullptr;
+		}
+		return *this;
+	}
+
+	Publisher::~Publisher() { release(); }
+
+	void Publisher::release() {
+#if ATTDET_SHM_POSIX
+		if (segment_ != nullptr) { munmap(segment_, sizeof(Segment)); }
+#endif
+		segment_ = nullptr;
+	}
+
+	Publisher Publisher::create(const std::string &name, unsigned mode) {
+		Publisher publisher;
+#if ATTDET_SHM_POSIX
+		const int fd = shm_open(name.c_str(), O_RDWR | O_CREAT, static_cast<mode_t>(mode));
+		if (fd < 0) { return publisher; }
+		if (ftruncate(fd, sizeof(Segment)) != 0) {
+			close(fd);
+			return publisher;
+		}
+		void *map = mmap(nullptr, sizeof(Segment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		close(fd);
+		if (map == MAP_FAILED) { return publisher; }
+		auto segment = static_cast<Segment *>(map);
+		const bool same = segment->magic.load(std::memory_order_acquire) == magic
+						  && segment->size == sizeof(State);
+		if (same) {
+			// Publicador reiniciado: continua a contagem
+			publisher.sample_ = segment->state[sample_word].load(std::memory_order_relaxed);
+			// Escrita interrompida (ímpar): o State está pela metade. Fechar a
+			// sequência o tornaria consistente para os leitores; zera o estado
+			// e volta a "nada publicado" até o primeiro publish()
+			if (segment->sequence.load(std::memory_order_relaxed) & 1) {
+				for (auto &w : segment->state) { w.store(0, std::memory_order_relaxed); }
+				segment->sequence.store(0, std::memory_order_release);
+			}
+		} else {
+			// Segmento novo (zerado pelo ftruncate) ou de outra versão
+			new (map) Segment;
+			segment->size = sizeof(State);
+			segment->sequence.store(0, std::memory_order_relaxed);
+			for (auto &w : segment->state) { w.store(0, std::memory_order_relaxed); }
+			segment->magic.store(magic, std::memory_order_release);
+		}
+		publisher.segment_ = segment;
+#else
+		(void)name;
+		(void)mode;
+#endif
+		return publisher;
+	}
+
+	bool Publisher::unlink(const std::string &name) {
+#if ATTDET_SHM_POSIX
+		return shm_unlink(name.c_str()) == 0;
+#else
+		(void)name;
+		return false;
+#endif
+	}
+
+	void Publisher::publish(const State &state) noexcept {
+		if (segment_ == nullptr) { return; }
+		++sample_;
+		const auto bytes = reinterpret_cast<const unsigned char *>(&state);
+		const auto seq = segment_->sequence.load(std::memory_order_relaxed);
+		segment_->sequence.store(seq + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		for (std::size_t i = 0; i < words; ++i) {
+			std::uint64_t w;
+			std::memcpy(&w, bytes + i * sizeof w, sizeof w);
+			segment_->state[i].store(i == sample_word ? sample_ : w, std::memory_order_relaxed);
+		}
+		segment_->sequence.store(seq + 2, std::memory_order_release);
+	}
+
+	Reader::Reader(Reader &&other) noexcept : segment_(other.segment_) {
+		other.segment_ = nullptr;
+	}
+
+	Reader &Reader::operator=(Reader &&other) noexcept {
+		if (this != &other) {
+			release();
+			segment_ = other.segment_;
+			other.segment_ = nullptr;
+		}
+		return *this;
+	}
+
+	Reader::~Reader() { release(); }
+
+	void Reader::release() {
+#if ATTDET_SHM_POSIX
+		if (segment_ != nullptr) {
+			munmap(const_cast<Segment *>(segment_), sizeof(Segment));
+		}
+#endif
+		segment_ = nullptr;
+	}
+
+	Reader Reader::open(const std::string &name) {
+		Reader reader;
+#if ATTDET_SHM_POSIX
+		const int fd = shm_open(name.c_str(), O_RDONLY, 0);
+		if (fd < 0) { return reader; }
+		struct stat st {};
+		if (fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < sizeof(Segment)) {
+			close(fd);
+			return reader;
+		}
+		void *map = mmap(nullptr, sizeof(Segment), PROT_READ, MAP_SHARED, fd, 0);
+		close(fd);
+		if (map == MAP_FAILED) { return reader; }
+		reader.segment_ = static_cast<const Segment *>(map);
+		if (reader.segment_->magic.load(std::memory_order_acquire) != magic
+			|| reader.segment_->size != sizeof(State)) {
+			reader.release();
+		}
+#else
+		(void)name;
+#endif
+		return reader;
+	}
+
+	std::uint64_t Reader::sequence() const noexcept {
+		return segment_ ? segment_->sequence.load(std::memory_order_acquire) : 0;
+	}
+
+	bool Reader::try_read(State &out) const noexcept {
+		if (segment_ == nullptr) { return false; }
+		const auto before = segment_->sequence.load(std::memory_order_acquire);
+		if (before == 0 || (before & 1)) { return false; }
+		auto bytes = reinterpret_cast<unsigned char *>(&out);
+		for (std::size_t i = 0; i < words; ++i) {
+			const auto w = segment_->state[i].load(std::memory_order_relaxed);
+			std::memcpy(bytes + i * sizeof w, &w, sizeof w);
+		}
+		std::atomic_thread_fence(std::memory_order_acquire);
+		return segment_->sequence.load(std::memory_order_relaxed) == before;
+	}
+
+	bool Reader::read(State &out) const noexcept {
+		if (segment_ == nullptr) { return false; }
+		std::chrono::steady_clock::time_point deadline{};
+		for (int spin = 0;; ++spin) {
+			const auto seq = segment_->sequence.load(std::memory_order_relaxed);
+			if (seq == 0) { return false; }
+			if (!(seq & 1) && try_read(out)) { return true; }
+			if (spin < read_spins) {
+				relax();
+				continue;
+			}
+			const auto now = std::chrono::steady_clock::now();
+			if (spin == read_spins) {
+				deadline = now + read_patience;
+			} else if (now > deadline) {
+				return false;
+			}
+			std::this_thread::sleep_for(std::chrono::microseconds(20));
+		}
+	}
+
+}// namespace shm
+}// namespace attdet
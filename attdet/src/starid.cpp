@@ -0,0 +1,416 @@
+/**
+ * @file starid.cpp
+ * @brief Identificação de estrelas com índice k-vector
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#include <algorithm>
+#include <attdet/starid.h>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define STARID_MMAP 1
+#else
+#define STARID_MMAP 0
+#endif
+
+namespace attdet {
+namespace starid {
+
+	struct StarIndex::Header {
+		char magic[8];
+		std::uint32_t version;
+		std::uint32_t stars;
+		std::uint32_t pairs;
+		std::uint32_t reserved;
+		double fov;
+		// k-vector line: z(i) = q + m * i
+		double m;
+		double q;
+	};
+
+	namespace {
+		constexpr char magic[8] = { 'A', 'T', 'T', 'D', 'K', 'V', 'E', 'C' };
+		constexpr std::uint32_t version = 1;
+
+		std::size_t blob_size(std::size_t stars, std::size_t pairs) {
+			return sizeof(StarIndex::Header)
+				   + stars * sizeof(StarRecord) + pairs * sizeof(PairRecord)
+				   + pairs * sizeof(std::uint32_t);
+		}
+
+		double angle(const Vec3 &u, const Vec3 &v) {
+			return std::acos(std::max(-1., std::min(1., u * v)));
+		}
+
+		double triple(const Vec3 &a, const Vec3 &b, const Vec3 &c) {
+			return alglin::cross(a, b) * c;
+		}
+	}// namespace
+
+	StarIndex::StarIndex(StarIndex &&other) noexcept { *this = std::move(other); }
+
+	StarIndex &StarIndex::operator=(StarIndex &&other) noexcept {
+		if (this != &other) {
+			release();
+			owned_ = std::move(other.owned_);
+			map_ = other.map_;
+			map_size_ = other.map_size_;
+			blob_ = other.blob_;
+			stars_ = other.stars_;
+			pairs_ = other.pairs_;
+			k_ = other.k_;
+			other.map_ = nullptr;
+			other.map_size_ = 0;
+			other.blob_ = nullptr;
+			other.stars_ = nullptr;
+			other.pairs_ = nullptr;
+			other.k_ = nullptr;
+		}
+		return *this;
+	}
+
+	StarIndex::~StarIndex() { release(); }
+
+	void StarIndex::release() {
+#if STARID_MMAP
+		if (map_ != nullptr) { munmap(map_, map_size_); }
+#endif
+		map_ = nullptr;
+		map_size_ = 0;
+		owned_.clear();
+		blob_ = nullptr;
+		stars_ = nullptr;
+		pairs_ = nullptr;
+		k_ = nullptr;
+	}
+
+	const StarIndex::Header *StarIndex::header() const {
+		return reinterpret_cast<const Header *>(blob_);
+	}
+
+	/**
+	 * Aponta as tabelas para dentro do blob, se ele for um índice válido.
+	 * range() e identify() indexam com o que vem do arquivo: pares fora da
+	 * tabela de estrelas, um k-vector que desce ou passa de pairs, ou uma
+	 * reta sem inclinação levariam a leituras fora do blob.
+	 */
+	void StarIndex::bind(const unsigned char *blob, std::size_t size) {
+		if (size < sizeof(Header)) { return; }
+		const auto h = reinterpret_cast<const Header *>(blob);
+		if (std::memcmp(h->magic, magic, sizeof(magic)) != 0
+			|| h->version != version
+			|| size != blob_size(h->stars, h->pairs)) {
+			return;
+		}
+		const auto stars = reinterpret_cast<const StarRecord *>(blob + sizeof(Header));
+		const auto pairs = reinterpret_cast<const PairRecord *>(stars + h->stars);
+		const auto k = reinterpret_cast<const std::uint32_t *>(pairs + h->pairs);
+		if (h->pairs > 0 && !(std::isfinite(h->q) && std::isfinite(h->m) && h->m > 0.)) { return; }
+		for (std::uint32_t i = 0; i < h->pairs; ++i) {
+			const auto &p = pairs[i];
+			if (p.a >= h->stars || p.b >= h->stars || !(p.angle >= 0.)
+				|| (i > 0 && !(p.angle >= pairs[i - 1].angle))) {
+				return;
+			}
+			if (k[i] > h->pairs || (i > 0 && k[i] < k[i - 1])) { return; }
+		}
+		blob_ = blob;
+		stars_ = stars;
+		pairs_ = pairs;
+		k_ = k;
+	}
+
+	double StarIndex::fov() const { return valid() ? header()->fov : 0.; }
+	std::size_t StarIndex::stars() const {
+		return valid() ? header()->stars : 0;
+	}
+	std::size_t StarIndex::pairs() const {
+		return valid() ? header()->pairs : 0;
+	}
+
+	Vec3 StarIndex::direction(std::size_t i) const {
+		const auto &d = stars_[i].direction;
+		return { d[0], d[1], d[2] };
+	}
+
+	StarIndex StarIndex::build(const std::vector<CatalogStar> &catalog,
+	  double fov) {
+		std::vector<PairRecord> pairs;
+		const double min_cos = std::cos(fov);
+		for (std::size_t a = 0; a < catalog.size(); ++a) {
+			for (std::size_t b = a + 1; b < catalog.size(); ++b) {
+				const auto c = catalog[a].direction * catalog[b].direction;
+				if (c < min_cos) { continue; }
+				pairs.push_back({ angle(catalog[a].direction, catalog[b].direction),
+				  static_cast<std::uint32_t>(a),
+				  static_cast<std::uint32_t>(b) });
+			}
+		}
+		std::sort(pairs.begin(),
+		  pairs.end(),
+		  [](const PairRecord &x, const PairRecord &y) {
+			  return x.angle < y.angle;
+		  });
+
+		const auto n = pairs.size();
+		Header h{};
+		std::memcpy(h.magic, magic, sizeof(magic));
+		h.version = version;
+		h.stars = static_cast<std::uint32_t>(catalog.size());
+		h.pairs = static_cast<std::uint32_t>(n);
+		h.fov = fov;
+		if (n > 0) {
+			// A reta passa logo abaixo do primeiro e logo acima do último
+			const double y0 = pairs.front().angle;
+			const double y1 = pairs.back().angle;
+			const double xi = std::max(1E-12, (y1 - y0) * 1E-9);
+			h.m = (n > 1) ? (y1 - y0 + 2 * xi) / static_cast<double>(n - 1)
+						  : 2 * xi;
+			h.q = y0 - xi;
+		}
+
+		StarIndex index;
+		index.owned_.resize(blob_size(catalog.size(), n));
+		auto out = index.owned_.data();
+		std::memcpy(out, &h, sizeof(h));
+		out += sizeof(h);
+		for (const auto &star : catalog) {
+			const StarRecord r{ star.id,
+				0,
+				{ star.direction[0], star.direction[1], star.direction[2] } };
+			std::memcpy(out, &r, sizeof(r));
+			out += sizeof(r);
+		}
+		if (n > 0) {
+			std::memcpy(out, pairs.data(), n * sizeof(PairRecord));
+			out += n * sizeof(PairRecord);
+		}
+		// k[i] = número de pares com ângulo <= z(i)
+		std::size_t count = 0;
+		for (std::size_t i = 0; i < n; ++i) {
+			const double z = h.q + h.m * static_cast<double>(i);
+			while (count < n && pairs[count].angle <= z) { ++count; }
+			const auto k = static_cast<std::uint32_t>(count);
+			std::memcpy(out, &k, sizeof(k));
+			out += sizeof(k);
+		}
+		index.bind(index.owned_.data(), index.owned_.size());
+		return index;
+	}
+
+	bool StarIndex::save(const std::string &path) const {
+		if (!valid()) { return false; }
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		file.write(reinterpret_cast<const char *>(blob_),
+		  static_cast<std::streamsize>(blob_size(stars(), pairs())));
+		return static_cast<bool>(file);
+	}
+
+	StarIndex StarIndex::load(const std::string &path) {
+		StarIndex index;
+#if STARID_MMAP
+		const int fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0) { return index; }
+		struct stat st {};
+		if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+			close(fd);
+			return index;
+		}
+		const auto size = static_cast<std::size_t>(st.st_size);
+		void *map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);
+		if (map == MAP_FAILED) { return index; }
+		index.map_ = map;
+		index.map_size_ = size;
+		index.bind(static_cast<const unsigned char *>(map), size);
+		if (!index.valid()) { index.release(); }
+#else
+		std::ifstream file(path, std::ios::binary);
+		index.owned_.assign(std::istreambuf_iterator<char>(file),
+		  std::istreambuf_iterator<char>());
+		index.bind(index.owned_.data(), index.owned_.size());
+		if (!index.valid()) { index.release(); }
+#endif
+		return index;
+	}
+
+	void StarIndex::range(double lo, double hi, const PairRecord *&first,
+	  const PairRecord *&last) const {
+		first = last = pairs_;
+		const auto n = static_cast<long>(pairs());
+		if (n == 0 || hi < lo) { return; }
+		const auto h = header();
+		const auto bottom = static_cast<long>(std::floor((lo - h->q) / h->m));
+		const auto top = static_cast<long>(std::ceil((hi - h->q) / h->m));
+		if (top < 0 || bottom >= n) { return; }
+		std::size_t begin = (bottom < 0) ? 0 : k_[bottom];
+		std::size_t end = (top >= n) ? static_cast<std::size_t>(n) : k_[top];
+		// Só as pontas podem ter pares fora do intervalo
+		while (begin < end && pairs_[begin].angle < lo) { ++begin; }
+		while (end > begin && pairs_[end - 1].angle > hi) { --end; }
+		first = pairs_ + begin;
+		last = pairs_ + end;
+	}
+
+	namespace {
+		// Estrela do catálogo a ângulo theta de `star`, vinda do k-vector
+		struct Neighbour {
+			std::uint32_t star;
+			std::uint32_t other;
+		};
+
+		void neighbours(const StarIndex &index, double theta, double tolerance,
+		  std::vector<Neighbour> &out) {
+			const PairRecord *first = nullptr;
+			const PairRecord *last = nullptr;
+			index.range(theta - tolerance, theta + tolerance, first, last);
+			out.clear();
+			for (auto p = first; p != last; ++p) {
+				out.push_back({ p->a, p->b });
+				out.push_back({ p->b, p->a });
+			}
+			std::sort(out.begin(), out.end(),
+			  [](const Neighbour &x, const Neighbour &y) {
+				  return x.star < y.star;
+			  });
+		}
+
+		std::pair<std::vector<Neighbour>::const_iterator,
+		  std::vector<Neighbour>::const_iterator>
+		  partners(const std::vector<Neighbour> &list, std::uint32_t star) {
+			return std::equal_range(list.begin(), list.end(),
+			  Neighbour{ star, 0 },
+			  [](const Neighbour &x, const Neighbour &y) {
+				  return x.star < y.star;
+			  });
+		}
+
+		/**
+		 * Catálogo para o observado r, dado o triângulo já identificado.
+		 * Devolve false se não houver um único candidato.
+		 */
+		bool confirm(const StarIndex &index, const std::vector<Vec3> &observed,
+		  const std::size_t (&obs)[3], const std::uint32_t (&cat)[3],
+		  std::size_t r, double tolerance, std::uint32_t &found) {
+			const double t0 = angle(observed[obs[0]], observed[r]);
+			if (t0 > index.fov() + tolerance) { return false; }
+			const double t1 = angle(observed[obs[1]], observed[r]);
+			const double t2 = angle(observed[obs[2]], observed[r]);
+			const PairRecord *first = nullptr;
+			const PairRecord *last = nullptr;
+			index.range(t0 - tolerance, t0 + tolerance, first, last);
+			// Uma só estrela fixa: varrer a faixa é mais barato que ordenar
+			int count = 0;
+			for (auto p = first; p != last; ++p) {
+				if (p->a != cat[0] && p->b != cat[0]) { continue; }
+				const auto other = (p->a == cat[0]) ? p->b : p->a;
+				const auto d = index.direction(other);
+				if (std::abs(angle(index.direction(cat[1]), d) - t1) > tolerance
+					|| std::abs(angle(index.direction(cat[2]), d) - t2)
+						 > tolerance) {
+					continue;
+				}
+				found = other;
+				if (++count > 1) { return false; }
+			}
+			return count == 1;
+		}
+	}// namespace
+
+	std::vector<Match> identify(const StarIndex &index,
+	  const std::vector<Vec3> &observed, double tolerance) {
+		const auto n = observed.size();
+		if (!index.valid() || n < 3) { return {}; }
+		const double reach = index.fov() + tolerance;
+
+		std::vector<Neighbour> ik;
+		// Ordem da pirâmide: triângulos bem espalhados primeiro
+		for (std::size_t dj = 1; dj + 1 < n; ++dj) {
+			for (std::size_t dk = 1; dj + dk < n; ++dk) {
+				for (std::size_t i = 0; i + dj + dk < n; ++i) {
+					const std::size_t j = i + dj;
+					const std::size_t k = j + dk;
+					const double tij = angle(observed[i], observed[j]);
+					const double tik = angle(observed[i], observed[k]);
+					const double tjk = angle(observed[j], observed[k]);
+					if (tij > reach || tik > reach || tjk > reach) { continue; }
+					const bool chirality =
+					  triple(observed[i], observed[j], observed[k]) > 0;
+
+					const PairRecord *first = nullptr;
+					const PairRecord *last = nullptr;
+					index.range(tij - tolerance, tij + tolerance, first, last);
+					neighbours(index, tik, tolerance, ik);
+
+					int count = 0;
+					std::uint32_t cat[3]{};
+					for (auto p = first; p != last && count < 2; ++p) {
+						const std::uint32_t ends[2][2] = { { p->a, p->b },
+							{ p->b, p->a } };
+						for (const auto &e : ends) {
+							const auto candidates = partners(ik, e[0]);
+							for (auto it = candidates.first;
+								 it != candidates.second;
+								 ++it) {
+								const auto b = index.direction(e[1]);
+								const auto c = index.direction(it->other);
+								if (std::abs(angle(b, c) - tjk) > tolerance
+									|| (triple(index.direction(e[0]), b, c) > 0)
+										 != chirality) {
+									continue;
+								}
+								cat[0] = e[0];
+								cat[1] = e[1];
+								cat[2] = it->other;
+								++count;
+							}
+						}
+					}
+					if (count != 1) { continue; }
+
+					const std::size_t obs[3] = { i, j, k };
+					std::vector<Match> matches{ { i, cat[0] },
+						{ j, cat[1] },
+						{ k, cat[2] } };
+					for (std::size_t r = 0; r < n; ++r) {
+						if (r == i || r == j || r == k) { continue; }
+						std::uint32_t d{};
+						if (confirm(index, observed, obs, cat, r, tolerance, d)) {
+							matches.push_back({ r, d });
+						}
+					}
+					// Com 4+ estrelas, exige ao menos uma confirmação
+					if (n > 3 && matches.size() < 4) { continue; }
+					std::sort(matches.begin(), matches.end(),
+					  [](const Match &x, const Match &y) {
+						  return x.observed < y.observed;
+					  });
+					return matches;
+				}
+			}
+		}
+		return {};
+	}
+
+	std::vector<Sensor> to_sensors(const StarIndex &index,
+	  const std::vector<Vec3> &observed, const std::vector<Match> &matches) {
+		std::vector<Sensor> sensors;
+		sensors.reserve(matches.size());
+		const double w = matches.empty() ? 0. : 1. / matches.size();
+		for (const auto &m : matches) {
+			sensors.emplace_back(observed[m.observed], index.direction(m.star), w);
+		}
+		return sensors;
+	}
+
+}// namespace starid
+}// namespace attdet
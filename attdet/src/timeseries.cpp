@@ -0,0 +1,303 @@
+/**
+ * @file timeseries.cpp
+ * @brief Reamostragem de atitudes: SLERP/SQUAD e suavização na esfera
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#include <algorithm>
+#include <atomic>
+#include <attdet/timeseries.h>
+#include <cmath>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace attdet {
+namespace timeseries {
+
+	namespace {
+		// Produto de Hamilton, (x, y, z, w)
+		Quat multiply(const Quat &a, const Quat &b) {
+			return { a[3] * b[0] + a[0] * b[3] + a[1] * b[2] - a[2] * b[1],
+				a[3] * b[1] - a[0] * b[2] + a[1] * b[3] + a[2] * b[0],
+				a[3] * b[2] + a[0] * b[1] - a[1] * b[0] + a[2] * b[3],
+				a[3] * b[3] - a[0] * b[0] - a[1] * b[1] - a[2] * b[2] };
+		}
+
+		Quat conjugate(const Quat &q) { return { -q[0], -q[1], -q[2], q[3] }; }
+
+		Quat negate(const Quat &q) { return { -q[0], -q[1], -q[2], -q[3] }; }
+
+		// q ou -q, o que estiver no hemisfério de ref
+		Quat align(const Quat &q, const Quat &ref) {
+			return (q * ref < 0.) ? negate(q) : q;
+		}
+
+		// log de um quatérnio unitário: vetor (x, y, z) com w = 0
+		Quat qlog(const Quat &q) {
+			const double v = std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2]);
+			if (v < 1E-12) { return { q[0], q[1], q[2], 0. }; }
+			const double k = std::atan2(v, q[3]) / v;
+			return { k * q[0], k * q[1], k * q[2], 0. };
+		}
+
+		Quat qexp(const Quat &u) {
+			const double a = std::sqrt(u[0] * u[0] + u[1] * u[1] + u[2] * u[2]);
+			const double k = (a < 1E-12) ? 1. : std::sin(a) / a;
+			return { k * u[0], k * u[1], k * u[2], std::cos(a) };
+		}
+
+		Quat unit(const Quat &q) {
+			const double n = std::sqrt(q * q);
+			return { q[0] / n, q[1] / n, q[2] / n, q[3] / n };
+		}
+
+		/**
+		 * Control points of q1 for SQUAD on non-uniform knots: h0 and h1 are
+		 * the intervals before and after q1. The tangent at q1 is the central
+		 * difference (L+ - L-) / (h0 + h1), scaled by each segment's length;
+		 * with h0 == h1 both reduce to squad_control().
+		 * @return { incoming (segment before q1), outgoing (segment after) }
+		 */
+		std::pair<Quat, Quat> controls(const Quat &q0, const Quat &q1,
+		  const Quat &q2, double h0, double h1) {
+			const Quat inv = conjugate(q1);
+			const Quat next = qlog(multiply(inv, q2));
+			const Quat prev = qlog(multiply(inv, q0));
+			const double h = h0 + h1;
+			if (!(h > 0.)) { return { q1, q1 }; }
+			const Quat v = (1. / h) * (next - prev);
+			return { multiply(q1, qexp(-.5 * (h0 * v + prev))),
+				multiply(q1, qexp(.5 * (h1 * v - next))) };
+		}
+
+		struct Chunk {
+			std::vector<Sample> out;
+		};
+
+		// Saídas k em [begin, end) da grade t0 + k / rate
+
+		void run(const Sample *first, const Sample *last, const Options &opt,
+		  double t0, std::size_t begin, std::size_t end, Chunk &chunk) {
+			const auto n = static_cast<std::size_t>(last - first);
+			const double period = 1. / opt.rate;
+			const double window = 3. * opt.smoothing;
+			chunk.out.clear();
+
+			auto at_or_before = [&](double t) {
+				const auto it = std::upper_bound(first, last, t,
+				  [](double v, const Sample &s) { return v < s.time; });
+				return static_cast<std::size_t>(std::max<std::ptrdiff_t>(0, it - first - 1));
+			};
+			std::size_t i = at_or_before(t0 + static_cast<double>(begin) * period);
+			std::size_t segment = n;
+			Quat sa{}, sb{};
+
+			for (auto k = begin; k < end; ++k) {
+				const double t = t0 + static_cast<double>(k) * period;
+				while (i + 2 < n && first[i + 1].time <= t) { ++i; }
+				const auto &a = first[i];
+				const auto &b = first[std::min(i + 1, n - 1)];
+				const double span = b.time - a.time;
+				if (opt.max_gap > 0. && span > opt.max_gap) { continue; }
+
+				const Quat qa = a.attitude;
+				const Quat qb = align(b.attitude, qa);
+				const double u = (span > 0.) ? std::min(1., std::max(0., (t - a.time) / span)) : 0.;
+				Quat q;
+				if (opt.interpolation == Interpolation::Squad) {
+					// Pontos de controle só mudam com o segmento
+					if (i != segment) {
+						const auto &p = first[i > 0 ? i - 1 : i];
+						const auto &c = first[std::min(i + 2, n - 1)];
+						const Quat q0 = align(p.attitude, qa);
+						const Quat q3 = align(c.attitude, qb);
+						sa = controls(q0, qa, qb, a.time - p.time, span).second;
+						sb = controls(qa, qb, q3, span, c.time - b.time).first;
+						segment = i;
+					}
+					q = squad(qa, qb, sa, sb, u);
+				} else {
+					q = slerp(qa, qb, u);
+				}
+
+				if (opt.smoothing > 0.) {
+					// Regressão linear local no espaço tangente em q, pesos
+					// gaussianos: sem viés para rotação uniforme, inclusive
+					// nas bordas do log onde a janela é unilateral
+					double s0 = 0., s1 = 0., s2 = 0.;
+					Quat m0{}, m1{};
+					const Quat inv = conjugate(q);
+					for (auto j = at_or_before(t - window);
+						 j < n && first[j].time <= t + window; ++j) {
+						const double tau = first[j].time - t;
+						const double d = tau / opt.smoothing;
+						const double w = std::exp(-.5 * d * d);
+						const Quat delta = qlog(multiply(inv, align(first[j].attitude, q)));
+						s0 += w;
+						s1 += w * tau;
+						s2 += w * tau * tau;
+						m0 = m0 + w * delta;
+						m1 = m1 + (w * tau) * delta;
+					}
+					const double det = s0 * s2 - s1 * s1;
+					if (det > 1E-12 * s0 * s2) {
+						q = unit(multiply(q, qexp((1. / det) * (s2 * m0 - s1 * m1))));
+					} else if (s0 > 0.) {
+						q = unit(multiply(q, qexp((1. / s0) * m0)));
+					}
+				}
+
+				// Continuidade de sinal dentro do lote
+				if (!chunk.out.empty()) { q = align(q, chunk.out.back().attitude); }
+				chunk.out.push_back({ t, q });
+			}
+		}
+	}// namespace
+
+	Quat slerp(const Quat &a, const Quat &b_, double t) {
+		const Quat b = align(b_, a);
+		const double c = std::min(1., a * b);
+		if (c > 0.9995) {
+			// Quase iguais: interpolação linear normalizada
+			return unit(Quat((1. - t) * a + t * b));
+		}
+		const double theta = std::acos(c);
+		const double s = std::sin(theta);
+		return Quat((std::sin((1. - t) * theta) / s) * a + (std::sin(t * theta) / s) * b);
+	}
+
+	Quat squad_control(const Quat &q0, const Quat &q1, const Quat &q2) {
+		const Quat inv = conjugate(q1);
+		const Quat sum = qlog(multiply(inv, q2)) + qlog(multiply(inv, q0));
+		return multiply(q1, qexp(-.25 * sum));
+	}
+
+	Quat squad(const Quat &q1, const Quat &q2, const Quat &s1, const Quat &s2,
+	  double t) {
+		return slerp(slerp(q1, q2, t), slerp(s1, s2, t), 2. * t * (1. - t));
+	}
+
+	void resample(const Sample *first, const Sample *last, const Options &options,
+	  const Sink &sink) {
+		if (last - first < 2 || !(options.rate > 0.)) { return; }
+		const double t0 = std::ceil(first->time * options.rate) / options.rate;
+		const double t1 = (last - 1)->time;
+		if (t0 > t1) { return; }
+		const auto total = static_cast<std::size_t>(std::floor((t1 - t0) * options.rate)) + 1;
+
+		const auto chunk = std::max<std::size_t>(1, options.chunk);
+		const auto threads = std::max(1u, options.threads);
+		const auto count = (total + chunk - 1) / chunk;
+
+		// Lote k vai para a vaga k % threads; só é calculado depois que o
+		// lote k - threads foi entregue, e a memória fica em threads * chunk
+		struct Slot {
+			Chunk chunk;
+			bool ready = false;
+		};
+		std::vector<Slot> slots(threads);
+		for (auto &s : slots) { s.chunk.out.reserve(chunk); }
+		std::atomic<std::size_t> next{ 0 };
+		std::size_t delivered = 0;
+		bool stop = false;
+		std::mutex mutex;
+		std::condition_variable cv;
+
+		auto compute = [&](std::size_t k) {
+			auto &slot = slots[k % threads];
+			const auto begin = k * chunk;
+			run(first, last, options, t0, begin, std::min(total, begin + chunk), slot.chunk);
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				slot.ready = true;
+			}
+			cv.notify_all();
+		};
+
+		// Criados uma vez por chamada; pegam lotes pelo contador até acabar
+		auto worker = [&]() {
+			for (;;) {
+				const auto k = next.fetch_add(1);
+				if (k >= count) { return; }
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					cv.wait(lock, [&] { return stop || k < delivered + threads; });
+					if (stop) { return; }
+				}
+				compute(k);
+			}
+		};
+
+		// Para e junta os workers também se o sink lançar
+		struct Crew {
+			std::vector<std::thread> workers;
+			std::mutex &mutex;
+			std::condition_variable &cv;
+			bool &stop;
+			~Crew() {
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					stop = true;
+				}
+				cv.notify_all();
+				for (auto &w : workers) { w.join(); }
+			}
+		} crew{ {}, mutex, cv, stop };
+		crew.workers.reserve(threads - 1);
+		for (unsigned c = 1; c < threads; ++c) { crew.workers.emplace_back(worker); }
+
+		bool started = false;
+		Quat previous{};
+		while (delivered < count) {
+			auto &slot = slots[delivered % threads];
+			bool ready;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				ready = slot.ready;
+			}
+			if (!ready) {
+				// A thread que chama também calcula, mas só lotes com vaga
+				// livre: ela é quem libera as vagas e não pode esperar por uma
+				auto k = next.load();
+				if (k < count && k < delivered + threads && next.compare_exchange_weak(k, k + 1)) {
+					compute(k);
+				} else if (k >= count || k >= delivered + threads) {
+					std::unique_lock<std::mutex> lock(mutex);
+					cv.wait(lock, [&] { return slot.ready; });
+				}
+				continue;
+			}
+
+			// Entrega em ordem; o sinal de cada lote segue o anterior. Um lote
+			// todo dentro de uma lacuna (max_gap) vem vazio
+			auto &out = slot.chunk.out;
+			if (!out.empty()) {
+				if (started && out.front().attitude * previous < 0.) {
+					for (auto &s : out) { s.attitude = negate(s.attitude); }
+				}
+				sink(out.data(), out.data() + out.size());
+				previous = out.back().attitude;
+				started = true;
+			}
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				slot.ready = false;
+				++delivered;
+			}
+			cv.notify_all();
+		}
+	}
+
+	std::vector<Sample> resample(
+	  const Sample *first, const Sample *last, const Options &options) {
+		std::vector<Sample> out;
+		resample(first, last, options,
+		  [&out](const Sample *f, const Sample *l) { out.insert(out.end(), f, l); });
+		return out;
+	}
+
+}// namespace timeseries
+}// namespace attdet
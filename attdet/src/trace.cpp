@@ -0,0 +1,183 @@
+/**
+ * @file trace.cpp
+ * @brief Anéis de tracepoints por thread (attdet/trace.h)
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#include <algorithm>
+#include <atomic>
+#include <attdet/trace.h>
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+namespace attdet {
+namespace trace {
+
+	namespace {
+		constexpr std::size_t records = ATTDET_TRACE_RECORDS;
+		constexpr std::size_t threads = ATTDET_TRACE_THREADS;
+		static_assert((records & (records - 1)) == 0, "ATTDET_TRACE_RECORDS must be a power of two");
+
+		/**
+		 * Um escritor (a thread dona) e leitores quaisquer, como um seqlock:
+		 * o escritor anuncia `started` antes de sobrescrever a posição e
+		 * publica `done` depois. O leitor copia até `done` e descarta o que
+		 * `started` indica ter sido sobrescrito durante a cópia.
+		 */
+		struct Ring {
+			std::atomic<bool> owned{ false };
+			std::atomic<std::uint64_t> started{ 0 };
+			std::atomic<std::uint64_t> done{ 0 };
+			Record slots[records];
+		};
+
+		Ring pool[threads];
+		std::atomic<std::uint64_t> lost{ 0 };
+
+		// Devolve o anel ao pool quando a thread termina; os registros ficam
+		struct Handle {
+			Ring *ring = nullptr;
+			~Handle() {
+				if (ring != nullptr) { ring->owned.store(false, std::memory_order_release); }
+			}
+		};
+		thread_local Handle handle;
+
+		Ring *acquire() {
+			for (auto &ring : pool) {
+				bool expected = false;
+				if (ring.owned.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+					return &ring;
+				}
+			}
+			return nullptr;
+		}
+
+		struct Header {
+			char magic[8];
+			std::uint32_t version;
+			std::uint32_t record_size;
+		};
+		constexpr char magic[8] = "ATTDTRC";
+		constexpr std::uint32_t version = 1;
+	}// namespace
+
+	void emit(Event event, std::uint16_t tag, double a, double b, double c,
+	  double d) noexcept {
+		if (handle.ring == nullptr) {
+			handle.ring = acquire();
+			if (handle.ring == nullptr) {
+				lost.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+		}
+		Ring &ring = *handle.ring;
+		const auto n = ring.started.load(std::memory_order_relaxed);
+		ring.started.store(n + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+
+		Record &r = ring.slots[n & (records - 1)];
+		r.sequence = n;
+		r.time = static_cast<std::uint64_t>(
+		  std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch())
+			.count());
+		r.event = event;
+		r.tag = tag;
+		r.thread = static_cast<std::uint32_t>(handle.ring - pool);
+		r.value[0] = a;
+		r.value[1] = b;
+		r.value[2] = c;
+		r.value[3] = d;
+		ring.done.store(n + 1, std::memory_order_release);
+	}
+
+	std::size_t snapshot(Record *out, std::size_t capacity) {
+		std::size_t count = 0;
+		for (auto &ring : pool) {
+			const auto done = ring.done.load(std::memory_order_acquire);
+			const auto first = done > records ? done - records : 0;
+			const auto begin = count;
+			for (auto n = first; n < done && count < capacity; ++n) {
+				out[count++] = ring.slots[n & (records - 1)];
+			}
+			std::atomic_thread_fence(std::memory_order_acquire);
+			const auto started = ring.started.load(std::memory_order_relaxed);
+			const auto valid = started > records ? started - records : 0;
+			if (valid > first) {
+				// Sobrescritos durante a cópia: as `valid - first` mais antigas
+				const auto stale = std::min<std::size_t>(
+				  static_cast<std::size_t>(valid - first), count - begin);
+				std::copy(out + begin + stale, out + count, out + begin);
+				count -= stale;
+			}
+		}
+		std::sort(out, out + count, [](const Record &x, const Record &y) {
+			if (x.time != y.time) { return x.time < y.time; }
+			if (x.thread != y.thread) { return x.thread < y.thread; }
+			return x.sequence < y.sequence;
+		});
+		return count;
+	}
+
+	std::uint64_t dropped() { return lost.load(std::memory_order_relaxed); }
+
+	const char *event_name(Event event) {
+		switch (event) {
+		case Event::QuestCandidate: return "quest.candidate";
+		case Event::QuestResult: return "quest.result";
+		}
+		return "unknown";
+	}
+
+	long dump(std::FILE *out) {
+		std::vector<Record> buffer(records * threads);
+		const auto count = snapshot(buffer.data(), buffer.size());
+		Header header{};
+		std::memcpy(header.magic, magic, sizeof magic);
+		header.version = version;
+		header.record_size = sizeof(Record);
+		if (std::fwrite(&header, sizeof header, 1, out) != 1
+			|| std::fwrite(buffer.data(), sizeof(Record), count, out) != count) {
+			return -1;
+		}
+		return static_cast<long>(count);
+	}
+
+	long decode(std::FILE *in, std::FILE *out) {
+		Header header{};
+		if (std::fread(&header, sizeof header, 1, in) != 1
+			|| std::memcmp(header.magic, magic, sizeof magic) != 0
+			|| header.version != version || header.record_size != sizeof(Record)) {
+			return -1;
+		}
+		long count = 0;
+		std::uint64_t start = 0;
+		Record r;
+		while (std::fread(&r, sizeof r, 1, in) == 1) {
+			if (count++ == 0) { start = r.time; }
+			std::fprintf(out, "%14.9f %3u %8llu %-16s",
+			  static_cast<double>(r.time - start) * 1E-9, r.thread,
+			  static_cast<unsigned long long>(r.sequence), event_name(r.event));
+			switch (r.event) {
+			case Event::QuestCandidate:
+				std::fprintf(out, " rotation=%c detY=%.6e lambda=%.9f residual=%.3e%s\n",
+				  "XYZN?"[std::min<int>(r.tag, 4)], r.value[0], r.value[1],
+				  r.value[2], r.value[3] != 0. ? " selected" : "");
+				break;
+			case Event::QuestResult:
+				std::fprintf(out, " detY=%.6e lambda=%.9f norm=%.9f\n", r.value[0],
+				  r.value[1], r.value[2]);
+				break;
+			default:
+				std::fprintf(out, " tag=%u %g %g %g %g\n", r.tag, r.value[0],
+				  r.value[1], r.value[2], r.value[3]);
+			}
+		}
+		return count;
+	}
+
+}// namespace trace
+}// namespace attdet
@@ -0,0 +1,334 @@
+/**
+ * @file wcet.cpp
+ * @brief Perfil de pior caso de tempo: geometrias adversárias e busca local
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#include <algorithm>
+#include <attdet/montecarlo.h>
+#include <attdet/wcet.h>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#elif !defined(__aarch64__)
+#include <chrono>
+#endif
+
+namespace attdet {
+namespace wcet {
+
+	constexpr int Profile::bins_per_octave;
+	constexpr int Profile::bins;
+
+	std::uint64_t cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+		// lfence dos dois lados: nada do código medido sai da janela
+		_mm_lfence();
+		const std::uint64_t t = __rdtsc();
+		_mm_lfence();
+		return t;
+#elif defined(__aarch64__)
+		std::uint64_t t;
+		asm volatile("isb\n\tmrs %0, cntvct_el0" : "=r"(t) : : "memory");
+		return t;
+#else
+		return static_cast<std::uint64_t>(
+		  std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch())
+			.count());
+#endif
+	}
+
+	const char *name(Geometry geometry) {
+		switch (geometry) {
+			case Geometry::Random: return "random";
+			case Geometry::NearParallel: return "near-parallel";
+			case Geometry::AntiParallel: return "anti-parallel";
+			case Geometry::Rotation180: return "rotation-180";
+			case Geometry::Degenerate: return "degenerate";
+			case Geometry::Scale: return "scale";
+			case Geometry::NonFinite: return "non-finite";
+			case Geometry::Search: return "search";
+		}
+		return "?";
+	}
+
+	double Profile::percentile(double p) const {
+		if (inputs == 0) { return 0.; }
+		const auto target = static_cast<std::uint64_t>(std::ceil(p * static_cast<double>(inputs)));
+		std::uint64_t count = 0;
+		for (int i = 0; i < bins; ++i) {
+			count += histogram[static_cast<std::size_t>(i)];
+			if (count >= target && count > 0) {
+				const int octave = i / bins_per_octave, step = i % bins_per_octave;
+				return std::min(static_cast<double>(max),
+				  std::ldexp(1. + static_cast<double>(step + 1) / bins_per_octave, octave));
+			}
+		}
+		return static_cast<double>(max);
+	}
+
+	namespace {
+		using montecarlo::Stream;
+
+		// Gira v de angle em torno de um eixo perpendicular aleatório
+		Vec3 tilt(Stream &stream, const Vec3 &v, double angle) {
+			const Vec3 axis = alglin::normalize(alglin::cross(v, stream.direction()));
+			const Vec3 ortho = alglin::cross(axis, v);
+			const double c = std::cos(angle), s = std::sin(angle);
+			return Vec3({ c * v[0] + s * ortho[0], c * v[1] + s * ortho[1],
+			  c * v[2] + s * ortho[2] });
+		}
+
+		// 10^-8 .. 1
+		double small_angle(Stream &stream) { return std::pow(10., -8. * stream.uniform()); }
+
+		// Referências aleatórias e measure = A(q) reference, ajustadas por geometria
+		void generate(Stream &stream, Geometry geometry, std::vector<Sensor> &sensors) {
+			Quat truth = stream.attitude();
+			if (geometry == Geometry::Rotation180) {
+				const double angle = M_PI - ((stream.uniform() < .25) ? 0. : small_angle(stream));
+				Vec3 axis = stream.direction();
+				if (stream.uniform() < .5) {
+					const auto k = static_cast<int>(stream.next() % 3);
+					axis = Vec3{};
+					axis[k] = (stream.uniform() < .5) ? -1. : 1.;
+				}
+				const double s = std::sin(angle / 2.);
+				truth = Quat({ s * axis[0], s * axis[1], s * axis[2], std::cos(angle / 2.) });
+			}
+			for (auto &sensor : sensors) {
+				sensor.reference = stream.direction();
+				sensor.weight = .1 + stream.uniform();
+			}
+			if (geometry == Geometry::NearParallel) {
+				sensors[1].reference = tilt(stream, sensors[0].reference, small_angle(stream));
+			} else if (geometry == Geometry::AntiParallel) {
+				sensors[1].reference =
+				  tilt(stream, -1. * sensors[0].reference, small_angle(stream));
+			}
+			const Matrix3 A = Quat2DCM(truth);
+			for (auto &sensor : sensors) { sensor.measure = A * sensor.reference; }
+
+			const auto n = sensors.size();
+			Sensor &victim = sensors[stream.next() % n];
+			if (geometry == Geometry::Degenerate) {
+				switch (stream.next() % 5) {
+					case 0: victim.measure = Vec3{}; break;
+					case 1: victim.weight = 0.; break;
+					case 2:
+						for (auto &sensor : sensors) { sensor = sensors[0]; }
+						break;
+					case 3:
+						for (auto &sensor : sensors) { sensor.weight = 0.; }
+						break;
+					default:
+						for (auto &sensor : sensors) { sensor.measure = sensor.reference; }
+						break;
+				}
+			} else if (geometry == Geometry::Scale) {
+				static const double scales[] = { 1E150, 1E-150, 1E-310, 4.9E-324 };
+				const double scale = scales[stream.next() % 4];
+				switch (stream.next() % 3) {
+					case 0: victim.measure = scale * victim.measure; break;
+					case 1: victim.weight *= scale; break;
+					default:
+						for (auto &sensor : sensors) {
+							sensor.measure = scale * sensor.measure;
+							sensor.reference = scale * sensor.reference;
+						}
+						break;
+				}
+			} else if (geometry == Geometry::NonFinite) {
+				const double value = (stream.uniform() < .5)
+									   ? std::numeric_limits<double>::quiet_NaN()
+									   : std::numeric_limits<double>::infinity();
+				const auto k = static_cast<int>(stream.next() % 7);
+				if (k < 3) {
+					victim.measure[k] = value;
+				} else if (k < 6) {
+					victim.reference[k - 3] = value;
+				} else {
+					victim.weight = value;
+				}
+			}
+		}
+
+		// Perturbação relativa de todos os componentes, de 1E-12 a 1E-1
+		void perturb(Stream &stream, std::vector<Sensor> &sensors) {
+			const double size = std::pow(10., -1. - 11. * stream.uniform());
+			auto shake = [&stream, size](double &x) { x *= 1. + size * stream.normal(); };
+			for (auto &sensor : sensors) {
+				for (int i = 0; i < 3; ++i) {
+					shake(sensor.measure[i]);
+					shake(sensor.reference[i]);
+				}
+				shake(sensor.weight);
+			}
+		}
+
+		volatile double sink;
+
+		std::uint64_t overhead() {
+			std::uint64_t best = std::numeric_limits<std::uint64_t>::max();
+			for (int i = 0; i < 1000; ++i) {
+				const auto t0 = cycles();
+				const auto t1 = cycles();
+				best = std::min(best, t1 - t0);
+			}
+			return best;
+		}
+
+		std::uint64_t time(Solver solve, const std::vector<Sensor> &sensors, int repeats,
+		  std::uint64_t overhead, Quat &attitude) {
+			std::uint64_t best = std::numeric_limits<std::uint64_t>::max();
+			const Sensor *first = sensors.data();
+			const Sensor *last = first + sensors.size();
+			for (int r = 0; r < repeats; ++r) {
+				const auto t0 = cycles();
+				attitude = solve(first, last);
+				const auto t1 = cycles();
+				sink = attitude[3];
+				best = std::min(best, t1 - t0);
+			}
+			return (best > overhead) ? best - overhead : 0;
+		}
+
+		// Posição do bit mais alto (v > 0): floor(log2(v))
+		int highest_bit(std::uint64_t v) {
+#if defined(__GNUC__)
+			return 63 - __builtin_clzll(v);
+#else
+			int bit = 0;
+			while (v >>= 1) { ++bit; }
+			return bit;
+#endif
+		}
+
+		// Oitava pelo bit mais alto, passo pelos 3 bits seguintes
+		int bin(std::uint64_t ticks) {
+			if (ticks < 2) { return 0; }
+			const int octave = highest_bit(ticks);
+			const auto mantissa = (octave >= 3) ? (ticks >> (octave - 3)) : (ticks << (3 - octave));
+			const int step = static_cast<int>(mantissa & (Profile::bins_per_octave - 1));
+			return std::min(Profile::bins - 1, octave * Profile::bins_per_octave + step);
+		}
+
+		class Recorder {
+		  public:
+			Recorder(Profile &profile, std::size_t keep) : profile_(profile), keep_(keep) {
+				profile_.min = std::numeric_limits<std::uint64_t>::max();
+			}
+
+			// candidate = false: só entra nas estatísticas
+			void add(Geometry geometry, std::uint64_t ticks,
+			  const std::vector<Sensor> &sensors, const Quat &attitude, bool candidate = true) {
+				++profile_.inputs;
+				sum_ += static_cast<double>(ticks);
+				profile_.min = std::min(profile_.min, ticks);
+				profile_.max = std::max(profile_.max, ticks);
+				++profile_.histogram[static_cast<std::size_t>(bin(ticks))];
+				auto &by = profile_.max_by_geometry[static_cast<std::size_t>(geometry)];
+				by = std::max(by, ticks);
+
+				auto &worst = profile_.worst;
+				if (!candidate || keep_ == 0 || (worst.size() == keep_ && ticks <= worst.back().ticks)) { return; }
+				const auto at = std::upper_bound(worst.begin(), worst.end(), ticks,
+				  [](std::uint64_t t, const Case &c) { return t > c.ticks; });
+				worst.insert(at, Case{ geometry, ticks, sensors, attitude });
+				if (worst.size() > keep_) { worst.pop_back(); }
+			}
+
+			void finish() {
+				if (profile_.inputs == 0) {
+					profile_.min = 0;
+					return;
+				}
+				profile_.mean = sum_ / static_cast<double>(profile_.inputs);
+			}
+
+		  private:
+			Profile &profile_;
+			std::size_t keep_;
+			double sum_ = 0.;
+		};
+	}// namespace
+
+	Profile profile(const Options &options) {
+		const Solver solve = options.solver ? options.solver : static_cast<Solver>(&quest);
+		const int repeats = std::max(1, options.repeats);
+		Profile out;
+		out.overhead = overhead();
+		Recorder recorder(out, options.worst);
+		Stream stream(options.seed, 0);
+		std::vector<Sensor> sensors(std::max<std::size_t>(2, options.sensors));
+		Quat attitude;
+
+		// Search fica de fora da rotação
+		for (std::uint64_t i = 0; i < options.inputs; ++i) {
+			const auto geometry = static_cast<Geometry>(i % (geometries - 1));
+			generate(stream, geometry, sensors);
+			const auto ticks = time(solve, sensors, repeats, out.overhead, attitude);
+			recorder.add(geometry, ticks, sensors, attitude);
+		}
+
+		// Subida a partir dos piores: uma perturbação que custa mais entra na lista
+		for (std::uint64_t i = 0; i < options.search_steps && !out.worst.empty(); ++i) {
+			const Case &base = out.worst[i % out.worst.size()];
+			const auto threshold = base.ticks;
+			sensors = base.sensors;
+			perturb(stream, sensors);
+			const auto ticks = time(solve, sensors, repeats, out.overhead, attitude);
+			recorder.add(Geometry::Search, ticks, sensors, attitude, ticks > threshold);
+		}
+		recorder.finish();
+		return out;
+	}
+
+	namespace {
+		void append(std::string &out, double x) {
+			char buffer[40];
+			if (std::isnan(x)) {
+				out += "std::numeric_limits<double>::quiet_NaN()";
+			} else if (std::isinf(x)) {
+				out += (x < 0.) ? "-std::numeric_limits<double>::infinity()"
+								: "std::numeric_limits<double>::infinity()";
+			} else {
+				std::snprintf(buffer, sizeof buffer, "%.17g", x);
+				out += buffer;
+			}
+		}
+
+		void append(std::string &out, const Vec3 &v) {
+			out += "Vec3({ ";
+			for (int i = 0; i < 3; ++i) {
+				if (i > 0) { out += ", "; }
+				append(out, v[i]);
+			}
+			out += " })";
+		}
+	}// namespace
+
+	std::string to_cpp(const Case &c) {
+		char header[80];
+		std::snprintf(header, sizeof header, "// %s, %llu ticks\n{\n", name(c.geometry),
+		  static_cast<unsigned long long>(c.ticks));
+		std::string out = header;
+		for (const auto &sensor : c.sensors) {
+			out += "\tattdet::Sensor(";
+			append(out, sensor.measure);
+			out += ", ";
+			append(out, sensor.reference);
+			out += ", ";
+			append(out, sensor.weight);
+			out += "),\n";
+		}
+		out += "}";
+		return out;
+	}
+
+}// namespace wcet
+}// namespace attdet
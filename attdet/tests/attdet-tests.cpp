@@ -1,8 +1,44 @@
+#include <attdet/alloc.h>
 #include <attdet/attdet.h>
+#include <attdet/attdet_c.h>
+#include <attdet/calibration.h>
+#include <attdet/codec.h>
+#include <attdet/fleet.h>
+#include <attdet/io.h>
+#include <attdet/montecarlo.h>
+#include <attdet/refmodel.h>
+#include <attdet/timeseries.h>
+#include <attdet/trace.h>
+#include <attdet/robust.h>
+#include <attdet/shm.h>
+#include <attdet/starid.h>
+#include <attdet/wcet.h>
 #include <catch2/catch.hpp>
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <termios.h>
+#include <thread>
+#include <unistd.h>
 
 using namespace attdet;
 
+namespace {
+// Ângulo entre dois quatérnios unitários, em graus
+double angle(const Quat &p, const Quat &q) {
+	const double c = std::min(1., std::abs(p * q));
+	return 2. * std::acos(c) * 180. / 3.141592653589793;
+}
+}// namespace
+
 TEST_CASE("QUEST") {
 	Sensor sensor0({ 0.925417, -0.163176, -0.342020 }, { 1., 0., 0. }, .5);
 	Sensor sensor1({ -0.37852, -0.440970, -0.813798 }, { 0., 0., -1. }, .5);
@@ -64,6 +100,1371 @@ TEST_CASE("QUEST") {
 	}
 }
 
+TEST_CASE("SensorSet") {
+	montecarlo::Stream rng(5, 0);
+	auto observe = [&](const Quat &q, double noise, double weight) {
+		const Vec3 r = rng.direction();
+		Vec3 m = Quat2DCM(q) * r;
+		for (int i = 0; i < 3; ++i) { m[i] += noise * rng.normal(); }
+		return Sensor(alglin::normalize(m), r, weight);
+	};
+	// Perda de Wahba, sum(w * (1 - m . A r))
+	auto loss = [](const Quat &q, const Sensor *first, const Sensor *last) {
+		const Matrix3 A = Quat2DCM(q);
+		double sum = 0.;
+		for (; first != last; ++first) {
+			sum += first->weight * (1. - first->measure * Vec3(A * first->reference));
+		}
+		return sum;
+	};
+	SECTION("Forma fechada para 2 sensores") {
+		double worst = 0.;
+		for (int i = 0; i < 2000; ++i) {
+			const Quat q = rng.attitude();
+			const SensorSet<2> set = { { observe(q, 1E-3, .6), observe(q, 1E-2, .4) } };
+			const Quat closed = quest(set);
+			const Quat exact = qmethod({ set[0], set[1] });
+			REQUIRE(std::abs(closed * closed - 1.) < 1E-12);
+			// Ótimo exato, sem a iteração de Newton: nunca pior que o q-method
+			REQUIRE(loss(closed, set.begin(), set.end())
+					<= loss(exact, set.begin(), set.end()) + 1E-13);
+			// Pares quase paralelos deixam um eixo mal determinado
+			if (std::abs(set[0].reference * set[1].reference) < .9) {
+				worst = std::max(worst, angle(closed, exact));
+			}
+		}
+		REQUIRE(worst < 1E-5);
+	}
+	SECTION("Singularidades caem no caminho geral") {
+		Sensor s0({ 1., 1E-13, 0. }, { 1., 1E-13, 0. }, .5);
+		Sensor s1({ 1E-13, 0., 1. }, { 1E-13, 0., -1. }, .5);
+		REQUIRE(quest(SensorSet<2>{ { s0, s1 } }) == Quat{ 1., 0., 0., 0. });
+		s0.measure = { -1., 1E-10, 0. };
+		s1.measure = { 1E-10, 0., -1. };
+		REQUIRE(quest(SensorSet<2>{ { s0, s1 } }) == Quat{ 0., 0., 1., 0. });
+		s0.measure = { -1., 1E-10, 0. };
+		s1.measure = { 1E-10, 0., 1. };
+		const Quat a = quest(SensorSet<2>{ { s0, s1 } });
+		const Quat b = quest({ s0, s1 });
+		for (int i = 0; i < 4; ++i) { REQUIRE(a[i] == b[i]); }
+	}
+	SECTION("Três sensores") {
+		for (int i = 0; i < 200; ++i) {
+			const Quat q = rng.attitude();
+			const SensorSet<3> set = { { observe(q, 1E-3, .5), observe(q, 1E-2, .3),
+			  observe(q, 1E-3, .2) } };
+			REQUIRE(angle(quest(set), quest(set.data(), set.data() + 3)) < 1E-5);
+		}
+	}
+}
+
+TEST_CASE("q-method") {
+	Sensor sensor0({ 0.925417, -0.163176, -0.342020 }, { 1., 0., 0. }, .5);
+	Sensor sensor1({ -0.37852, -0.440970, -0.813798 }, { 0., 0., -1. }, .5);
+	SECTION("Igual ao QUEST") {
+		const Vec3 a = Quat2Euler(qmethod({ sensor0, sensor1 }));
+		REQUIRE(std::abs(a[0] - 30.) < 1E-4);
+		REQUIRE(std::abs(a[1] + 20.) < 1E-4);
+		REQUIRE(std::abs(a[2] - 10.) < 1E-4);
+	}
+	SECTION("Rotações de 180 graus") {
+		sensor0.reference = { 1., 1E-13, 0. };
+		sensor1.reference = { 1E-13, 0., -1. };
+
+		sensor0.measure = { 1., 1E-13, 0. };
+		sensor1.measure = { 1E-13, 0., 1. };
+		REQUIRE(std::abs(qmethod({ sensor0, sensor1 })[0]) == Approx(1.));
+
+		sensor0.measure = { -1., 1E-10, 0. };
+		sensor1.measure = { 1E-10, 0., 1. };
+		REQUIRE(std::abs(qmethod({ sensor0, sensor1 })[1]) == Approx(1.));
+
+		sensor0.measure = { -1., 1E-10, 0. };
+		sensor1.measure = { 1E-10, 0., -1. };
+		REQUIRE(std::abs(qmethod({ sensor0, sensor1 })[2]) == Approx(1.));
+	}
+}
+
+TEST_CASE("QUEST em ponto fixo") {
+	Sensor sensor0({ 0.925417, -0.163176, -0.342020 }, { 1., 0., 0. }, .5);
+	Sensor sensor1({ -0.37852, -0.440970, -0.813798 }, { 0., 0., -1. }, .5);
+	SECTION("Com dados normais") {
+		const auto q = quest({ sensor0, sensor1 });
+		const auto qf =
+		  to_double(quest_fixed({ SensorQ(sensor0), SensorQ(sensor1) }));
+		REQUIRE(angle(q, qf) < 0.01);
+	}
+	SECTION("Geometrias aleatórias") {
+		std::mt19937 g(42);
+		std::uniform_real_distribution<double> u(-1., 1.);
+		auto unit = [&]() {
+			return alglin::normalize(Vec3({ u(g), u(g), u(g) }));
+		};
+		double worst{};
+		for (int n = 0; n < 200; ++n) {
+			const auto A =
+			  Quat2DCM(alglin::normalize(Quat({ u(g), u(g), u(g), u(g) })));
+			const Vec3 r0 = unit();
+			const Vec3 r1 = unit();
+			// Vetores quase colineares: o problema é mal condicionado e a
+			// quantização da entrada em Q16.16 já domina o erro
+			if (std::abs(r0 * r1) > .99) { continue; }
+			const Sensor s0(A * r0, r0, .6);
+			const Sensor s1(A * r1, r1, .4);
+			const auto qd = quest({ s0, s1 });
+			const auto qf = to_double(quest_fixed({ SensorQ(s0), SensorQ(s1) }));
+			worst = std::max(worst, angle(qd, qf));
+		}
+		REQUIRE(worst < 0.01);
+	}
+}
+
+TEST_CASE("Identificação de estrelas") {
+	using namespace attdet::starid;
+	constexpr double pi = 3.141592653589793;
+	constexpr double fov = 20. * pi / 180.;
+	std::mt19937 g(7);
+	std::normal_distribution<double> gauss(0., 1.);
+	auto unit = [&]() {
+		return alglin::normalize(Vec3({ gauss(g), gauss(g), gauss(g) }));
+	};
+
+	std::vector<CatalogStar> catalog(1500);
+	for (std::size_t i = 0; i < catalog.size(); ++i) {
+		catalog[i] = { static_cast<std::uint32_t>(1000 + i), unit() };
+	}
+	const auto built = StarIndex::build(catalog, fov);
+	REQUIRE(built.valid());
+	REQUIRE(built.stars() == catalog.size());
+
+	// O k-vector devolve exatamente os pares do intervalo
+	const PairRecord *first = nullptr;
+	const PairRecord *last = nullptr;
+	built.range(.1, .1001, first, last);
+	std::size_t brute = 0;
+	for (std::size_t p = 0; p < built.pairs(); ++p) {
+		const auto a = built.pair_data()[p].angle;
+		brute += (a >= .1 && a <= .1001) ? 1 : 0;
+	}
+	REQUIRE(static_cast<std::size_t>(last - first) == brute);
+
+	const std::string path = "starid-test.kvec";
+	REQUIRE(built.save(path));
+	const auto index = StarIndex::load(path);
+	std::remove(path.c_str());
+	REQUIRE(index.valid());
+	REQUIRE(index.mapped());
+	REQUIRE(index.pairs() == built.pairs());
+	REQUIRE(!StarIndex::load("does-not-exist.kvec").valid());
+
+	// Arquivo corrompido: cada tabela estragada dá um índice inválido
+	{
+		std::vector<char> blob;
+		REQUIRE(built.save(path));
+		std::ifstream in(path, std::ios::binary);
+		blob.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+		const std::size_t pair_table = blob.size() - built.pairs() * (sizeof(PairRecord) + 4);
+		const std::size_t k_table = blob.size() - built.pairs() * 4;
+		auto corrupt = [&](std::size_t at, std::uint32_t value) {
+			auto bad = blob;
+			std::memcpy(bad.data() + at, &value, sizeof value);
+			std::ofstream(path, std::ios::binary | std::ios::trunc).write(bad.data(),
+			  static_cast<std::streamsize>(bad.size()));
+			const bool ok = StarIndex::load(path).valid();
+			std::remove(path.c_str());
+			return ok;
+		};
+		REQUIRE(corrupt(pair_table + offsetof(PairRecord, a), 0));
+		// Estrela fora da tabela
+		REQUIRE(!corrupt(pair_table + offsetof(PairRecord, a),
+		  static_cast<std::uint32_t>(built.stars())));
+		REQUIRE(!corrupt(pair_table + 7 * sizeof(PairRecord) + offsetof(PairRecord, b), ~0u));
+		// k-vector além de pairs e fora de ordem
+		REQUIRE(!corrupt(k_table + 4 * (built.pairs() - 1),
+		  static_cast<std::uint32_t>(built.pairs() + 1)));
+		REQUIRE(!corrupt(k_table + 4 * (built.pairs() / 2), 0));
+		// Truncado
+		std::ofstream(path, std::ios::binary | std::ios::trunc).write(blob.data(),
+		  static_cast<std::streamsize>(blob.size() - 4));
+		REQUIRE(!StarIndex::load(path).valid());
+		std::remove(path.c_str());
+	}
+
+	// Estrelas dentro do campo de visada, no referencial do corpo
+	const Quat truth = alglin::normalize(Quat({ .3, -.2, .7, .6 }));
+	const Matrix3 A = Quat2DCM(truth);
+	const Vec3 boresight = catalog[42].direction;
+	std::vector<Vec3> observed;
+	std::vector<std::size_t> source;
+	for (std::size_t i = 0; i < catalog.size(); ++i) {
+		if (std::acos(catalog[i].direction * boresight) > fov / 2) { continue; }
+		const Vec3 noise = 1E-5 * unit();
+		observed.push_back(alglin::normalize(Vec3(A * catalog[i].direction + noise)));
+		source.push_back(i);
+	}
+	// Um falso positivo (pixel quente)
+	observed.push_back(alglin::normalize(Vec3(A * boresight + .05 * unit())));
+	source.push_back(catalog.size());
+	REQUIRE(observed.size() >= 5);
+
+	const auto matches = identify(index, observed, 1E-4);
+	REQUIRE(matches.size() >= 4);
+	for (const auto &m : matches) {
+		REQUIRE(m.star == source[m.observed]);
+		REQUIRE(index.star(m.star).id == catalog[m.star].id);
+	}
+
+	const auto sensors = to_sensors(index, observed, matches);
+	const auto q = quest(sensors.data(), sensors.data() + sensors.size());
+	REQUIRE(angle(q, truth) < 0.01);
+
+	// Poucas estrelas ou ruído acima da tolerância: sem identificação
+	REQUIRE(identify(index, { observed[0], observed[1] }, 1E-4).empty());
+}
+
+TEST_CASE("Modelos de referência") {
+	using namespace attdet::refmodel;
+	constexpr double t2021 = 1609459200.;// 2021-01-01 00:00 UTC
+
+	SECTION("Dipolo") {
+		const std::string path = "dipole-test.cof";
+		{
+			std::ofstream cof(path);
+			cof << "    2020.0            DIPOLE        01/01/2020\n"
+				<< "  1  0  -30000.0       0.0        0.0        0.0\n"
+				<< "999999999999999999999999999999999999999999999999\n";
+		}
+		const auto dipole = GaussCoefficients::load(path);
+		std::remove(path.c_str());
+		REQUIRE(dipole.valid());
+		REQUIRE(dipole.degree == 1);
+		REQUIRE(!GaussCoefficients::load("does-not-exist.cof").valid());
+
+		// Equador: só a componente norte, 30000 (a/r)^3
+		const double re = 6371.2 / 6378.137;
+		const auto eq = magnetic_field(dipole, { 0., 0., 0. }, t2021);
+		REQUIRE(eq[0] == Approx(30000. * re * re * re));
+		REQUIRE(std::abs(eq[2]) < 1E-6);
+		// Polo norte: aponta para baixo com o dobro da intensidade
+		const double rp = 6371.2 / 6356.752;
+		const auto pole = magnetic_field(dipole, { 90., 0., 0. }, t2021);
+		REQUIRE(pole[2] == Approx(60000. * rp * rp * rp));
+	}
+	SECTION("Sol") {
+		// Equinócio de março de 2021: 20/03 09:37 UTC
+		const auto equinox = sun_eci(1616233020.);
+		REQUIRE(std::acos(equinox[0]) * 180. / 3.141592653589793 < 0.05);
+		// Meio-dia solar em (0, 0): sol no zênite, a menos da declinação
+		const auto noon = sun_direction({ 0., 0., 0. }, 1616242020.);
+		REQUIRE(noon[2] < -0.9999);
+	}
+	SECTION("Grade de interpolação") {
+		ReferenceModel model(GaussCoefficients::igrf13_degree3());
+		const double err =
+		  model.build_grid({ -30., 30., 2., -60., 0., 2., 0., 800., 200., t2021 });
+		REQUIRE(model.has_grid());
+		REQUIRE(err < 200.);
+
+		std::mt19937 g(3);
+		std::uniform_real_distribution<double> u(0., 1.);
+		const auto coefficients = GaussCoefficients::igrf13_degree3();
+		// Cota, não estimativa: vale em qualquer ponto do primeiro ano
+		for (int n = 0; n < 2000; ++n) {
+			const Geodetic p{ -30. + 60. * u(g), -60. * u(g), 800. * u(g) };
+			const double t = t2021 + 86400. * 365. * u(g);
+			const Vec3 e(
+			  model.magnetic_field(p, t) - magnetic_field(coefficients, p, t));
+			REQUIRE(std::sqrt(e * e) <= err);
+		}
+		// Fora da grade: avaliação completa
+		const Geodetic far{ 60., 100., 0. };
+		REQUIRE(model.magnetic_field(far, t2021)
+				== magnetic_field(coefficients, far, t2021));
+	}
+}
+
+TEST_CASE("QUEST contínuo") {
+	const Vec3 refs[3] = { { 1., 0., 0. }, { 0., 0.6, -0.8 }, { 0., 1., 0. } };
+	const Vec3 axis = alglin::normalize(Vec3({ 1., 2., 3. }));
+	montecarlo::Stream noise(5, 0);
+	// Rotação de 0.5 grau por amostra em torno de axis, com ruído de 1E-3
+	auto sample = [&](double angle, Sensor *out) {
+		const Quat truth({ axis[0] * std::sin(angle / 2), axis[1] * std::sin(angle / 2),
+		  axis[2] * std::sin(angle / 2), std::cos(angle / 2) });
+		const Matrix3 A = Quat2DCM(truth);
+		for (int k = 0; k < 3; ++k) {
+			const Vec3 e({ noise.normal(), noise.normal(), noise.normal() });
+			out[k] = Sensor(alglin::normalize(Vec3(A * refs[k] + 1E-3 * e)), refs[k], 1.);
+		}
+	};
+	Sensor sensors[3];
+	SECTION("Igual ao QUEST, com poucas buscas") {
+		StreamingQuest solver;
+		const int n = 2000;
+		double worst = 0.;
+		for (int i = 0; i < n; ++i) {
+			sample(i * 0.5 * 3.141592653589793 / 180., sensors);
+			const Quat q = solver.update(sensors, sensors + 3);
+			REQUIRE(std::abs(q * q - 1.) < 1E-12);
+			worst = std::max(worst, angle(q, quest(sensors, sensors + 3)));
+		}
+		REQUIRE(worst < 1E-5);// ~ resolução de acos perto de 1
+		REQUIRE(solver.searches() < n / 20);
+	}
+	SECTION("Salto de 180 graus") {
+		StreamingQuest solver;
+		sample(0., sensors);
+		solver.update(sensors, sensors + 3);
+		REQUIRE(solver.frame() == Rotations::None);
+		sample(3.141592653589793, sensors);
+		const Quat q = solver.update(sensors, sensors + 3);
+		REQUIRE(angle(q, quest(sensors, sensors + 3)) < 1E-5);
+		REQUIRE(solver.searches() == 2);
+		REQUIRE(solver.frame() != Rotations::None);
+	}
+	SECTION("Troca de pesos e reset") {
+		StreamingQuest solver;
+		sample(.3, sensors);
+		solver.update(sensors, sensors + 3);
+		sample(.31, sensors);
+		sensors[2].weight = 0.;// sensor perdido
+		REQUIRE(angle(solver.update(sensors, sensors + 3), quest(sensors, sensors + 3)) < 1E-5);
+		REQUIRE(solver.lambda() <= 2.);
+		solver.reset();
+		REQUIRE(solver.update(sensors, sensors + 3) == quest(sensors, sensors + 3));
+	}
+}
+
+TEST_CASE("QUEST robusto") {
+	std::mt19937 g(11);
+	std::normal_distribution<double> gauss(0., 1.);
+	auto unit = [&]() {
+		return alglin::normalize(Vec3({ gauss(g), gauss(g), gauss(g) }));
+	};
+	const Quat truth = alglin::normalize(Quat({ -.1, .5, .2, .8 }));
+	const Matrix3 A = Quat2DCM(truth);
+
+	std::vector<Sensor> sensors;
+	for (int i = 0; i < 7; ++i) {
+		const Vec3 r = unit();
+		const Vec3 noise = 1E-4 * unit();
+		sensors.emplace_back(alglin::normalize(Vec3(A * r + noise)), r, 1.);
+	}
+	// Magnetômetro perto de um motor: 30 graus fora
+	sensors[3].measure = alglin::normalize(Vec3(sensors[3].measure + .5 * unit()));
+	const auto first = sensors.data();
+	const auto last = sensors.data() + sensors.size();
+
+	const auto plain = quest(first, last);
+	REQUIRE(angle(plain, truth) > 1.);
+
+	const auto robust = quest_robust(first, last);
+	REQUIRE(angle(robust.attitude, truth) < 0.05);
+	REQUIRE(robust.inlier_count == sensors.size() - 1);
+	REQUIRE(!robust.inliers[3]);
+
+	SECTION("Lotes paralelos dão o mesmo resultado") {
+		// 32 pares: abaixo de min_batch, roda tudo na thread que chamou
+		const auto small = quest_robust(first, last, RobustOptions(0.0087, 32, 4));
+		REQUIRE(small.attitude == robust.attitude);
+		REQUIRE(small.inliers == robust.inliers);
+
+		// 512 pares em 4 lotes de verdade
+		std::vector<Sensor> many;
+		for (int i = 0; i < 64; ++i) {
+			const Vec3 r = unit();
+			many.emplace_back(alglin::normalize(Vec3(A * r + 1E-4 * unit())), r, 1.);
+		}
+		for (int i = 0; i < 64; i += 9) {
+			many[i].measure = alglin::normalize(Vec3(many[i].measure + .5 * unit()));
+		}
+		const auto serial = quest_robust(many.data(), many.data() + many.size(),
+		  RobustOptions(0.0087, 512, 1));
+		const auto parallel = quest_robust(many.data(), many.data() + many.size(),
+		  RobustOptions(0.0087, 512, 4));
+		REQUIRE(parallel.attitude == serial.attitude);
+		REQUIRE(parallel.inliers == serial.inliers);
+		REQUIRE(serial.inlier_count == 64 - 8);
+	}
+	SECTION("Orçamento de subconjuntos") {
+		const auto few = quest_robust(first, last, RobustOptions(0.0087, 6, 2));
+		REQUIRE(!few.inliers[3]);
+		REQUIRE(angle(few.attitude, truth) < 0.05);
+	}
+	SECTION("Sem outliers, igual ao QUEST") {
+		sensors[3].measure = A * sensors[3].reference;
+		const auto clean = quest_robust(first, last);
+		REQUIRE(clean.inlier_count == sensors.size());
+		REQUIRE(angle(clean.attitude, quest(first, last)) < 1E-6);
+	}
+	SECTION("Todas as observações são outliers") {
+		// Medidas sem relação com as referências: nenhum par tem 2 inliers
+		std::vector<Sensor> noise;
+		for (int i = 0; i < 6; ++i) { noise.emplace_back(unit(), unit(), 1.); }
+		const auto *f = noise.data(), *l = noise.data() + noise.size();
+		const auto lost = quest_robust(f, l, RobustOptions(1E-6));
+		for (int i = 0; i < 4; ++i) { REQUIRE(std::isfinite(lost.attitude[i])); }
+		REQUIRE(lost.inlier_count < 2);
+		REQUIRE(angle(lost.attitude, quest(f, l)) < 1E-6);
+	}
+}
+
+TEST_CASE("Sem alocação no caminho quente") {
+	const Sensor acc({ 0., 1., 0. }, { 0.016, -0.042, -0.999 }, .6);
+	const Sensor mag({ 0., 1., 0. }, { -0.145, -0.653, -0.744 }, .4);
+	const char line[] = "0.16,-0.40,-9.40,0.01,0.02,0.03,-4.00,-18.00,-20.00\r\n";
+	double data[9];
+	char out[96];
+
+	SECTION("Contador ativo") {
+		const auto before = alloc::counts();
+		int *volatile p = new int(1);// volatile: o par não pode ser elidido
+		delete p;
+		const auto after = alloc::counts();
+		REQUIRE(after.allocations == before.allocations + 1);
+		REQUIRE(after.deallocations == before.deallocations + 1);
+	}
+	SECTION("Leitura e escrita") {
+		REQUIRE(io::parse_csv(line, data, 9) == 9);
+		REQUIRE(data[8] == -20.);
+		REQUIRE(io::parse_csv("1.0,2.0,x", data, 9) == 2);
+		REQUIRE(io::format_quat({ 0., 0., 0., 1. }, out, sizeof out)
+				== std::string("0.00000000,0.00000000,0.00000000,1.00000000\n").size());
+		REQUIRE(io::format_quat({ 0., 0., 0., 1. }, out, 8) == 0);
+	}
+	SECTION("quest, triad e E/S") {
+		alloc::StageStats stages[] = { { "parse", 0, 0, 0 }, { "quest", 0, 0, 0 },
+			{ "triad", 0, 0, 0 }, { "format", 0, 0, 0 } };
+		Sensor a = acc, m = mag;
+		double sum = 0.;// mantém os resultados vivos
+		for (int i = 0; i < 64; ++i) {
+			{
+				alloc::Stage stage(stages[0]);
+				io::parse_csv(line, data, 9);
+				a.measure = alglin::normalize(Vec3({ data[0], data[1], data[2] }));
+				m.measure = alglin::normalize(Vec3({ data[6], data[7], data[8] }));
+			}
+			Quat q;
+			{
+				alloc::Stage stage(stages[1]);
+				q = quest({ a, m });
+			}
+			{
+				alloc::Stage stage(stages[2]);
+				sum += triad(a, m)[0][0];
+			}
+			{
+				alloc::Stage stage(stages[3]);
+				sum += io::format_quat(q, out, sizeof out);
+			}
+		}
+		REQUIRE(sum != 0.);
+		for (const auto &s : stages) {
+			INFO(s.name);
+			REQUIRE(s.calls == 64);
+			REQUIRE(s.allocations == 0);
+		}
+	}
+}
+
+TEST_CASE("Interface C") {
+	const Sensor s0({ 0.925417, -0.163176, -0.342020 }, { 1., 0., 0. }, .5);
+	const Sensor s1({ -0.37852, -0.440970, -0.813798 }, { 0., 0., -1. }, .5);
+	auto c = [](const Sensor &s) {
+		return attdet_sensor{ { s.measure[0], s.measure[1], s.measure[2] },
+			{ s.reference[0], s.reference[1], s.reference[2] }, s.weight };
+	};
+	const attdet_sensor sensors[] = { c(s0), c(s1) };
+	const Quat expected = quest({ s0, s1 });
+	attdet_quat q;
+
+	REQUIRE(attdet_abi_version() == ATTDET_C_ABI_VERSION);
+	SECTION("Igual ao QUEST") {
+		REQUIRE(attdet_quest(sensors, 2, &q) == ATTDET_OK);
+		REQUIRE(angle({ q.x, q.y, q.z, q.w }, expected) < 1E-9);
+	}
+	SECTION("Erros") {
+		REQUIRE(attdet_quest(nullptr, 2, &q) == ATTDET_ERR_NULL);
+		REQUIRE(attdet_quest(sensors, 1, &q) == ATTDET_ERR_COUNT);
+		REQUIRE(q.w == 1.);
+		attdet_sensor zero[] = { c(s0), c(s1) };
+		zero[0].weight = zero[1].weight = 0.;
+		REQUIRE(attdet_quest(zero, 2, &q) == ATTDET_ERR_WEIGHT);
+		REQUIRE(std::string(attdet_status_string(ATTDET_ERR_WEIGHT)).size() > 0);
+	}
+	SECTION("Lote") {
+		attdet_sensor batch[] = { c(s0), c(s1), c(s0), c(s1), c(s1), c(s0) };
+		batch[2].weight = batch[3].weight = 0.;
+		attdet_quat out[3];
+		attdet_status status[3];
+		const auto before = alloc::counts();
+		const auto first = attdet_quest_batch(batch, 2, 3, out, status);
+		REQUIRE(alloc::counts().allocations == before.allocations);
+		REQUIRE(first == ATTDET_ERR_WEIGHT);
+		REQUIRE(status[0] == ATTDET_OK);
+		REQUIRE(status[1] == ATTDET_ERR_WEIGHT);
+		REQUIRE(status[2] == ATTDET_OK);
+		REQUIRE(angle({ out[0].x, out[0].y, out[0].z, out[0].w }, expected) < 1E-9);
+		REQUIRE(out[1].w == 1.);
+		REQUIRE(attdet_quest_batch(nullptr, 2, 0, nullptr, nullptr) == ATTDET_OK);
+	}
+	SECTION("Ponto fixo") {
+		attdet_sensor_q fixed[2];
+		for (int k = 0; k < 2; ++k) {
+			const SensorQ sq(k == 0 ? s0 : s1);
+			for (int i = 0; i < 3; ++i) {
+				fixed[k].measure[i] = sq.measure[i].raw;
+				fixed[k].reference[i] = sq.reference[i].raw;
+			}
+			fixed[k].weight = sq.weight.raw;
+		}
+		attdet_quat_q qq;
+		REQUIRE(attdet_quest_fixed(fixed, 2, &qq) == ATTDET_OK);
+		const double one = 1 << 30;
+		REQUIRE(angle({ qq.x / one, qq.y / one, qq.z / one, qq.w / one }, expected) < .01);
+	}
+	SECTION("TRIAD e conversões") {
+		double A[9], R[9];
+		REQUIRE(attdet_triad(&sensors[0], &sensors[1], A) == ATTDET_OK);
+		REQUIRE(attdet_quest(sensors, 2, &q) == ATTDET_OK);
+		REQUIRE(attdet_quat_to_dcm(&q, R) == ATTDET_OK);
+		const Matrix3 T = triad(s0, s1), D = Quat2DCM(expected);
+		for (int i = 0; i < 9; ++i) {
+			REQUIRE(A[i] == T[i / 3][i % 3]);
+			REQUIRE(std::abs(R[i] - D[i / 3][i % 3]) < 1E-12);
+		}
+		attdet_vec3 e;
+		REQUIRE(attdet_quat_to_euler(&q, &e) == ATTDET_OK);
+		REQUIRE(std::abs(e.x - 30.) < 1E-4);
+		REQUIRE(std::abs(e.y + 20.) < 1E-4);
+		REQUIRE(std::abs(e.z - 10.) < 1E-4);
+	}
+}
+
+TEST_CASE("Reamostragem") {
+	using namespace attdet::timeseries;
+	// Cone: eixo inclinado 30 graus girando em z, ângulo crescendo no tempo
+	auto truth = [](double t) {
+		const double c = .5 * t, s = .8 * t;
+		const Vec3 axis({ .5 * std::cos(c), .5 * std::sin(c), std::sqrt(.75) });
+		return Quat({ axis[0] * std::sin(s), axis[1] * std::sin(s),
+		  axis[2] * std::sin(s), std::cos(s) });
+	};
+	std::mt19937 g(3);
+	std::uniform_real_distribution<double> jitter(-.02, .02);
+	std::vector<Sample> log;
+	for (int i = 0; i < 2000; ++i) {
+		const double t = .05 * i + jitter(g);
+		Quat q = truth(t);
+		if (i % 7 == 3) { q = -1. * q; }// q e -q: mesma atitude
+		log.push_back({ t, q });
+	}
+	const auto *first = log.data(), *last = log.data() + log.size();
+
+	SECTION("SLERP") {
+		const Quat a({ 0., 0., 0., 1. });
+		const Quat b({ 0., 0., std::sin(.25 * M_PI), std::cos(.25 * M_PI) });
+		REQUIRE(angle(slerp(a, b, 0.), a) < 1E-9);
+		REQUIRE(angle(slerp(a, b, 1.), b) < 1E-9);
+		REQUIRE(std::abs(angle(slerp(a, b, .5), a) - 45.) < 1E-9);
+		REQUIRE(angle(slerp(a, -1. * b, .5), slerp(a, b, .5)) < 1E-9);
+	}
+	SECTION("Grade fixa, sinal contínuo") {
+		double rms[2];
+		for (auto mode : { Interpolation::Slerp, Interpolation::Squad }) {
+			const auto out = resample(first, last, Options(10., mode));
+			REQUIRE(out.size() > 900);
+			double worst = 0., sum = 0.;
+			for (std::size_t k = 0; k < out.size(); ++k) {
+				REQUIRE(std::abs(out[k].time * 10. - std::round(out[k].time * 10.)) < 1E-9);
+				const double e = angle(out[k].attitude, truth(out[k].time));
+				worst = std::max(worst, e);
+				sum += e * e;
+				if (k > 0) { REQUIRE(out[k].attitude * out[k - 1].attitude > 0.); }
+			}
+			REQUIRE(worst < .05);
+			rms[static_cast<int>(mode)] = std::sqrt(sum / static_cast<double>(out.size()));
+		}
+		// SQUAD é C1: segue melhor a curvatura do cone
+		REQUIRE(rms[1] < .7 * rms[0]);
+	}
+	SECTION("Lotes paralelos dão o mesmo resultado") {
+		Options serial(25.);
+		serial.smoothing = .1;
+		Options parallel = serial;
+		parallel.threads = 3;
+		parallel.chunk = 37;
+		std::size_t max_chunk = 0;
+		std::vector<Sample> b;
+		resample(first, last, parallel, [&](const Sample *f, const Sample *l) {
+			max_chunk = std::max<std::size_t>(max_chunk, static_cast<std::size_t>(l - f));
+			b.insert(b.end(), f, l);
+		});
+		const auto a = resample(first, last, serial);
+		REQUIRE(max_chunk <= 37);
+		REQUIRE(a.size() == b.size());
+		for (std::size_t k = 0; k < a.size(); ++k) {
+			REQUIRE(a[k].time == b[k].time);
+			REQUIRE(a[k].attitude == b[k].attitude);
+		}
+
+		// Sink que lança: os workers param e são juntados antes de propagar
+		int calls = 0;
+		REQUIRE_THROWS(resample(first, last, parallel, [&](const Sample *, const Sample *) {
+			if (++calls == 2) { throw std::runtime_error("sink"); }
+		}));
+		REQUIRE(calls == 2);
+	}
+	SECTION("Suavização") {
+		std::normal_distribution<double> noise(0., .005);
+		auto noisy = log;
+		for (auto &s : noisy) {
+			for (int i = 0; i < 4; ++i) { s.attitude[i] += noise(g); }
+			s.attitude = alglin::normalize(s.attitude);
+		}
+		auto rms = [&](double smoothing) {
+			Options opt(10.);
+			opt.smoothing = smoothing;
+			const auto out = resample(noisy.data(), noisy.data() + noisy.size(), opt);
+			double sum = 0.;
+			for (const auto &s : out) {
+				const double e = angle(s.attitude, truth(s.time));
+				sum += e * e;
+			}
+			return std::sqrt(sum / static_cast<double>(out.size()));
+		};
+		REQUIRE(rms(.1) < .6 * rms(0.));
+	}
+	SECTION("Lacunas") {
+		auto gap = log;
+		gap.erase(gap.begin() + 500, gap.begin() + 600);// 5 s sem dados
+		Options opt(10.);
+		opt.max_gap = .5;
+		const auto out = resample(gap.data(), gap.data() + gap.size(), opt);
+		for (const auto &s : out) {
+			REQUIRE((s.time <= gap[499].time || s.time >= gap[500].time));
+		}
+		REQUIRE(out.size() < resample(first, last, opt).size() - 40);
+
+		// Lotes pequenos: vários caem inteiros na lacuna e voltam vazios
+		const Sample sparse[] = { { 0., log[0].attitude }, { .5, log[5].attitude },
+			{ 100., log[10].attitude }, { 100.5, log[15].attitude } };
+		opt.chunk = 4;
+		for (unsigned threads : { 1u, 3u }) {
+			opt.threads = threads;
+			const auto few = resample(sparse, sparse + 4, opt);
+			// t = .5 já abre o segmento de 99.5 s
+			REQUIRE(few.size() == 11);
+			REQUIRE(few[4].time == Approx(.4));
+			REQUIRE(few[5].time == Approx(100.));
+		}
+	}
+}
+
+TEST_CASE("Monte-Carlo") {
+	using namespace attdet::montecarlo;
+	SECTION("Philox4x32-10, vetores do Random123") {
+		const auto zero = philox(0, 0, 0);
+		REQUIRE(zero[0] == 0x6627e8d5u);
+		REQUIRE(zero[1] == 0xe169c58du);
+		REQUIRE(zero[2] == 0xbc57ac4cu);
+		REQUIRE(zero[3] == 0x9b00dbd8u);
+		const auto ones = philox(~0ull, ~0ull, ~0ull);
+		REQUIRE(ones[0] == 0x408f276du);
+		REQUIRE(ones[1] == 0x41c83b0eu);
+		REQUIRE(ones[2] == 0xa20bc7c6u);
+		REQUIRE(ones[3] == 0x6d5451fdu);
+	}
+	SECTION("Distribuições") {
+		Stream stream(7, 0);
+		double mean = 0., var = 0., q = 0.;
+		const int n = 100000;
+		for (int i = 0; i < n; ++i) {
+			mean += stream.uniform();
+			const double x = stream.normal();
+			var += x * x;
+			q += std::abs(stream.attitude()[3]);
+		}
+		REQUIRE(std::abs(mean / n - .5) < .01);
+		REQUIRE(std::abs(var / n - 1.) < .02);
+		// |w| de um quatérnio uniforme em SO(3): média 4 / (3 pi)
+		REQUIRE(std::abs(q / n - 4. / (3. * 3.141592653589793)) < .01);
+	}
+	const double sigma = 1E-3;
+	const std::vector<SensorModel> suite = { SensorModel(sigma, Vec3({ 1., 0., 0. })),
+		SensorModel(sigma, Vec3({ 0., 1., 0. })) };
+	SECTION("Reprodutível para qualquer número de threads") {
+		Options options(20000, 42);
+		options.chunk = 1000;
+		options.threads = 1;
+		const auto a = run(suite, options);
+		options.threads = 3;
+		const auto b = run(suite, options);
+		REQUIRE(a.trials == 20000);
+		REQUIRE(a.failures == 0);
+		REQUIRE(a.sum == b.sum);
+		REQUIRE(a.histogram == b.histogram);
+	}
+	SECTION("Erro proporcional ao ruído") {
+		Options options(20000);
+		const auto a = run(suite, options);
+		const auto b = run({ SensorModel(sigma / 2, Vec3({ 1., 0., 0. })),
+							 SensorModel(sigma / 2, Vec3({ 0., 1., 0. })) },
+		  options);
+		REQUIRE(a.rms() > .5 * sigma);
+		REQUIRE(a.rms() < 3. * sigma);
+		REQUIRE(std::abs(b.rms() / a.rms() - .5) < .05);
+		REQUIRE(a.percentile(.5) < a.percentile(.99));
+		REQUIRE(a.percentile(.99) <= a.max);
+	}
+	SECTION("Atitudes num cone") {
+		Options options;
+		options.attitudes = Attitudes::Cone;
+		options.cone = .1;
+		Stream stream(1, 2);
+		Sensor out[2];
+		for (int i = 0; i < 1000; ++i) {
+			const Quat q = observe(stream, suite.data(), suite.data() + 2, out, options);
+			REQUIRE(2. * std::acos(std::min(1., std::abs(q[3]))) <= .1 + 1E-12);
+		}
+	}
+}
+
+TEST_CASE("Tracepoints") {
+	std::vector<trace::Record> buffer(ATTDET_TRACE_RECORDS * ATTDET_TRACE_THREADS);
+	// Registros emitidos aqui levam `marker` em value[3]
+	auto marked = [&buffer](double marker) {
+		const auto n = trace::snapshot(buffer.data(), buffer.size());
+		std::vector<trace::Record> out;
+		for (std::size_t i = 0; i < n; ++i) {
+			if (buffer[i].value[3] == marker) { out.push_back(buffer[i]); }
+		}
+		return out;
+	};
+	SECTION("Anel por thread") {
+		for (int i = 0; i < 3; ++i) {
+			trace::emit(trace::Event::QuestResult, 7, i, 0., 0., -1.);
+		}
+		const auto r = marked(-1.);
+		REQUIRE(r.size() == 3);
+		for (int i = 0; i < 3; ++i) {
+			REQUIRE(r[i].value[0] == i);
+			REQUIRE(r[i].tag == 7);
+			REQUIRE(r[i].sequence == r[0].sequence + i);
+		}
+	}
+	SECTION("Sobrescreve os mais antigos") {
+		const int n = ATTDET_TRACE_RECORDS + 10;
+		for (int i = 0; i < n; ++i) {
+			trace::emit(trace::Event::QuestResult, 0, i, 0., 0., -2.);
+		}
+		const auto r = marked(-2.);
+		REQUIRE(r.size() == ATTDET_TRACE_RECORDS);
+		REQUIRE(r.front().value[0] == 10.);
+		REQUIRE(r.back().value[0] == n - 1);
+	}
+	SECTION("Várias threads") {
+		std::vector<std::thread> workers;
+		for (int t = 0; t < 3; ++t) {
+			workers.emplace_back([t]() {
+				for (int i = 0; i < 50; ++i) {
+					trace::emit(trace::Event::QuestResult, 0, i, t, 0., -3.);
+				}
+			});
+		}
+		for (auto &w : workers) { w.join(); }
+		const auto r = marked(-3.);
+		REQUIRE(r.size() == 150);
+		for (int t = 0; t < 3; ++t) {
+			REQUIRE(std::count_if(r.begin(), r.end(), [t](const trace::Record &x) {
+				return x.value[1] == t;
+			}) == 50);
+		}
+		REQUIRE(trace::dropped() == 0);
+	}
+	SECTION("Dump e decodificação") {
+		trace::emit(trace::Event::QuestCandidate, 3, 1., 2., 0., 1.);
+		std::FILE *bin = std::tmpfile(), *text = std::tmpfile();
+		REQUIRE(bin != nullptr);
+		REQUIRE(text != nullptr);
+		const long written = trace::dump(bin);
+		REQUIRE(written > 0);
+		std::rewind(bin);
+		REQUIRE(trace::decode(bin, text) == written);
+		std::rewind(text);
+		char line[256] = {};
+		bool found = false;
+		while (std::fgets(line, sizeof line, text)) {
+			found = found || std::string(line).find("rotation=N") != std::string::npos;
+		}
+		REQUIRE(found);
+		std::rewind(text);
+		REQUIRE(trace::decode(text, bin) == -1);
+		std::fclose(bin);
+		std::fclose(text);
+	}
+#if ATTDET_TRACE == 1
+	SECTION("Candidatos do QUEST") {
+		const Sensor s0({ 0.925417, -0.163176, -0.342020 }, { 1., 0., 0. }, .5);
+		const Sensor s1({ -0.37852, -0.440970, -0.813798 }, { 0., 0., -1. }, .5);
+		quest({ s0, s1 });
+		const auto n = trace::snapshot(buffer.data(), buffer.size());
+		REQUIRE(n >= 5);
+		const auto *r = &buffer[n - 5];
+		for (int i = 0; i < 4; ++i) {
+			REQUIRE(r[i].event == trace::Event::QuestCandidate);
+			REQUIRE(r[i].tag == i);
+			REQUIRE(std::abs(r[i].value[2]) < 1E-6);// resíduo de Newton
+		}
+		REQUIRE(r[0].value[3] == 1.);
+		REQUIRE(r[4].event == trace::Event::QuestResult);
+		REQUIRE(r[4].value[0] > 0.);
+	}
+#endif
+}
+
+TEST_CASE("Memória compartilhada") {
+	const std::string name = "/attdet-test-" + std::to_string(::getpid());
+	shm::Publisher::unlink(name);
+	REQUIRE_FALSE(shm::Reader::open(name).valid());
+	auto publisher = shm::Publisher::create(name);
+	REQUIRE(publisher.valid());
+	auto reader = shm::Reader::open(name);
+	REQUIRE(reader.valid());
+	shm::State state;
+	REQUIRE_FALSE(reader.read(state));
+
+	SECTION("Estado completo") {
+		const Sensor sensors[2] = { Sensor({ 1., 0., 0. }, { 0., 1., 0. }, 1E4),
+			Sensor({ 0., 1., 0. }, { -1., 0., 0. }, 1E4) };
+		const Quat q = quest(sensors, sensors + 2);
+		const Matrix3 P = quest_covariance(sensors, sensors + 2);
+		// Eixos x e y observados: P = diag(1, 1, 1/2) / w
+		REQUIRE(std::abs(P[0][0] - 1E-4) < 1E-12);
+		REQUIRE(std::abs(P[2][2] - .5E-4) < 1E-12);
+		publisher.publish(shm::snapshot(123, q, &P, sensors, sensors + 2));
+		REQUIRE(reader.read(state));
+		REQUIRE(state.time == 123);
+		REQUIRE(state.sample == 1);
+		REQUIRE(state.attitude[3] == q[3]);
+		REQUIRE(state.covariance[8] == P[2][2]);
+		REQUIRE(state.sensor_count == 2);
+		REQUIRE(state.sensors[1].reference[0] == -1.);
+		// Publicador reiniciado continua a contagem
+		publisher = shm::Publisher::create(name);
+		publisher.publish(shm::State{});
+		REQUIRE(reader.read(state));
+		REQUIRE(state.sample == 2);
+	}
+	SECTION("Escritor morto no meio da escrita") {
+		publisher.publish(shm::snapshot(7, Quat({ 0., 0., 0., 1. }), nullptr, nullptr, nullptr));
+		// Simula a queda: sequência ímpar (offset 64, linha própria) e State pela metade
+		const int fd = ::open(("/dev/shm" + name).c_str(), O_RDWR);
+		REQUIRE(fd >= 0);
+		void *map = ::mmap(nullptr, 4096, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		::close(fd);
+		REQUIRE(map != MAP_FAILED);
+		auto *words = static_cast<std::uint64_t *>(map);
+		REQUIRE(words[8] == reader.sequence());
+		words[8] += 1;
+		words[9] = 999;// time
+		::munmap(map, 4096);
+		REQUIRE_FALSE(reader.try_read(state));
+		// read() desiste em vez de girar para sempre
+		REQUIRE_FALSE(reader.read(state));
+
+		publisher = shm::Publisher::create(name);
+		REQUIRE(reader.sequence() == 0);
+		REQUIRE_FALSE(reader.read(state));
+		publisher.publish(shm::snapshot(8, Quat({ 0., 0., 0., 1. }), nullptr, nullptr, nullptr));
+		REQUIRE(reader.read(state));
+		REQUIRE(state.time == 8);
+		REQUIRE(state.sample == 2);
+	}
+	SECTION("Leituras consistentes durante escritas") {
+		publisher.publish(shm::State{});
+		std::atomic<bool> done{ false };
+		std::thread writer([&]() {
+			shm::State s{};
+			for (std::uint64_t k = 1; !done; ++k) {
+				s.time = k;
+				for (auto &x : s.attitude) { x = static_cast<double>(k); }
+				for (auto &x : s.covariance) { x = static_cast<double>(k); }
+				publisher.publish(s);
+			}
+		});
+		int torn = 0, reads = 0;
+		std::uint64_t last = 0;
+		for (int i = 0; i < 20000; ++i) {
+			if (!reader.read(state)) { continue; }
+			++reads;
+			const double k = static_cast<double>(state.time);
+			for (auto x : state.attitude) { torn += (x != k); }
+			for (auto x : state.covariance) { torn += (x != k); }
+			torn += (state.time < last);
+			last = state.time;
+			if (i % 64 == 0) { std::this_thread::yield(); }
+		}
+		done = true;
+		writer.join();
+		REQUIRE(reads == 20000);
+		REQUIRE(last > 1);
+		REQUIRE(torn == 0);
+	}
+	REQUIRE(shm::Publisher::unlink(name));
+}
+
+TEST_CASE("Codec de quatérnios") {
+	const double rad = 180. / 3.141592653589793;
+	montecarlo::Stream rng(7, 0);
+
+	SECTION("Smallest-three") {
+		std::vector<Quat> q(1003);// não múltiplo de 4: cauda escalar
+		for (auto &x : q) { x = rng.attitude(); }
+		q[0] = { 0., 0., 0., -1. };
+		q[1] = { .5, -.5, .5, -.5 };// empate: menor índice
+		for (unsigned bits : { 32u, 48u, 64u }) {
+			const codec::Format format(bits);
+			const unsigned b = (bits - 2) / 3;
+			std::vector<unsigned char> buffer(q.size() * format.bytes());
+			codec::Encoder encoder(format);
+			REQUIRE(encoder.encode(q.data(), q.data() + q.size(), buffer.data()) == buffer.size());
+			std::vector<Quat> out(q.size());
+			codec::Decoder decoder(format);
+			REQUIRE(decoder.decode(buffer.data(), q.size(), out.data()) == q.size());
+			double worst = 0.;
+			for (std::size_t i = 0; i < q.size(); ++i) {
+				// Lote (AVX2 se disponível) igual ao escalar, bit a bit
+				std::uint64_t code = 0;
+				for (std::size_t k = 0; k < format.bytes(); ++k) {
+					code |= std::uint64_t(buffer[i * format.bytes() + k]) << (8 * k);
+				}
+				REQUIRE(code == codec::pack(q[i], b));
+				const Quat u = codec::unpack(code, b);
+				for (std::size_t k = 0; k < 4; ++k) { REQUIRE(std::abs(u[k] - out[i][k]) < 1E-15); }
+				REQUIRE(std::abs(out[i] * out[i] - 1.) < 1E-12);
+				worst = std::max(worst, angle(q[i], out[i]));
+			}
+			REQUIRE(worst < codec::max_error(format) * rad);
+			REQUIRE(worst > .3 * codec::max_error(format) * rad);
+		}
+		REQUIRE(codec::max_error(codec::Format(32)) < 4.9E-3);
+		REQUIRE(codec::max_error(codec::Format(64)) < 4.7E-6);
+	}
+	SECTION("Delta") {
+		const codec::Format format(32, true, .05, 50);
+		// Rotação lenta com saltos a cada 121 amostras
+		std::vector<Quat> q(1000);
+		const Vec3 axis = rng.direction();
+		for (std::size_t i = 0; i < q.size(); ++i) {
+			const double theta = .01 * static_cast<double>(i) + .4 * static_cast<double>(i / 121);
+			q[i] = { std::sin(theta / 2.) * axis[0], std::sin(theta / 2.) * axis[1],
+				std::sin(theta / 2.) * axis[2], std::cos(theta / 2.) };
+		}
+		std::vector<unsigned char> buffer(q.size() * format.bytes());
+		codec::Encoder encoder(format);
+		encoder.encode(q.data(), q.data() + q.size(), buffer.data());
+		std::vector<Quat> out(q.size());
+		codec::Decoder decoder(format);
+		REQUIRE(decoder.decode(buffer.data(), q.size(), out.data()) == q.size());
+		std::size_t keys = 0;
+		for (std::size_t i = 0; i < q.size(); ++i) {
+			const bool key = (buffer[i * format.bytes()] & 1) == 0;
+			keys += key;
+			REQUIRE(angle(q[i], out[i]) < codec::max_error(format, key) * rad);
+		}
+		// 20 a cada key_interval, saltos fora deles
+		REQUIRE(keys == 20 + 8);
+		REQUIRE(codec::max_error(format, false) < .02 * codec::max_error(format));
+
+		// Sem quadro-chave: NaN até o próximo
+		codec::Decoder late(format);
+		REQUIRE(late.decode(buffer.data() + format.bytes(), 60, out.data()) == 11);
+		REQUIRE(std::isnan(out[0][3]));
+		REQUIRE(angle(q[60], out[59]) < codec::max_error(format, false) * rad);
+	}
+	SECTION("Formato inválido") {
+		const Quat q[2] = { rng.attitude(), rng.attitude() };
+		unsigned char buffer[32] = {};
+		Quat out[2];
+		for (const auto &format : { codec::Format(96), codec::Format(4), codec::Format(32, true, 0.) }) {
+			REQUIRE(!format.valid());
+			codec::Encoder encoder(format);
+			REQUIRE(!encoder.valid());
+			REQUIRE(encoder.encode(q, q + 2, buffer) == 0);
+			codec::Decoder decoder(format);
+			REQUIRE(!decoder.valid());
+			REQUIRE(decoder.decode(buffer, 2, out) == 0);
+			REQUIRE(std::isnan(out[1][3]));
+			REQUIRE(std::isnan(codec::max_error(format)));
+		}
+	}
+	SECTION("Passo máximo do delta") {
+		const Quat q[2] = { rng.attitude(), rng.attitude() };
+		unsigned char buffer[32] = {};
+		// 3 sin^2(max_step / 2) = 1 no limite: w do delta deixa de existir
+		REQUIRE(3. * std::pow(std::sin(codec::max_delta_step / 2.), 2) == Approx(1.));
+		const codec::Format below(32, true, codec::max_delta_step * (1. - 1E-6));
+		REQUIRE(below.valid());
+		REQUIRE(std::isfinite(codec::max_error(below, false)));
+		for (const double step : { codec::max_delta_step, 1.5, 4. }) {
+			const codec::Format format(32, true, step);
+			REQUIRE(!format.valid());
+			REQUIRE(std::isnan(codec::max_error(format, false)));
+			REQUIRE(codec::Encoder(format).encode(q, q + 2, buffer) == 0);
+			// Sem delta max_step não é usado
+			REQUIRE(codec::Format(32, false, step).valid());
+		}
+	}
+}
+
+TEST_CASE("Calibração de magnetômetro") {
+	montecarlo::Stream rng(11, 0);
+	// raw = B S f + o, S simétrica: a correção ideal é W = S^-1 / B
+	const double B = 50.;
+	const Matrix3 S({ { 1.20, .10, -.05 }, { .10, .80, .08 }, { -.05, .08, 1.05 } });
+	const Vec3 offset({ 15., -10., 25. });
+	auto sample = [&](const Vec3 &f, const Vec3 &o, double noise) {
+		Vec3 raw;
+		for (int i = 0; i < 3; ++i) {
+			raw[i] = o[i] + noise * rng.normal();
+			for (int j = 0; j < 3; ++j) { raw[i] += B * S[i][j] * f[j]; }
+		}
+		return raw;
+	};
+	auto error = [](const Vec3 &a, const Vec3 &b) {
+		return std::acos(std::min(1., a * b)) * 180. / 3.141592653589793;
+	};
+
+	SECTION("Ajuste exato") {
+		calibration::Accumulator acc(B), first(B), second(B);
+		calibration::Correction c;
+		REQUIRE_FALSE(acc.fit(c));
+		std::vector<Vec3> f(300), raw(300);
+		for (std::size_t i = 0; i < f.size(); ++i) {
+			f[i] = rng.direction();
+			raw[i] = sample(f[i], offset, 0.);
+			acc.add(raw[i]);
+			(i < 150 ? first : second).add(raw[i]);
+		}
+		REQUIRE(acc.fit(c));
+		for (int i = 0; i < 3; ++i) { REQUIRE(std::abs(c.offset[i] - offset[i]) < 1E-8); }
+		REQUIRE(std::abs(c.radius - B * std::cbrt(alglin::det(S))) < 1E-8);
+		REQUIRE(c.residual < 1E-6);// cancelamento em p^T N p - 2 p^T r + n
+		std::vector<Vec3> corrected(raw.size());
+		calibration::apply(c, raw.data(), raw.data() + raw.size(), corrected.data());
+		for (std::size_t i = 0; i < f.size(); ++i) {
+			const Vec3 e(corrected[i] - f[i]);
+			REQUIRE(e * e < 1E-18);
+			REQUIRE(corrected[i] == c(raw[i]));
+		}
+		// Acumuladores parciais somados dão o mesmo ajuste
+		first += second;
+		calibration::Correction merged;
+		REQUIRE(first.fit(merged));
+		for (int i = 0; i < 3; ++i) { REQUIRE(std::abs(merged.offset[i] - c.offset[i]) < 1E-8); }
+
+		// Amostras num plano não determinam o elipsoide
+		calibration::Accumulator flat(B);
+		for (int i = 0; i < 100; ++i) {
+			const double t = .1 * i;
+			flat.add(sample(Vec3({ std::cos(t), std::sin(t), 0. }), offset, 0.));
+		}
+		calibration::Correction untouched;
+		REQUIRE_FALSE(flat.fit(untouched));
+		REQUIRE(untouched.offset[0] == 0.);
+	}
+	SECTION("Cobertura parcial") {
+		// Calota de meio-ângulo a em torno de z: a 1 rad o ajuste sai com o
+		// centro deslocado em z e precisa ser recusado
+		const Vec3 small({ 5., -3., 2. });
+		auto cap = [&](double a) {
+			calibration::Accumulator acc(B);
+			for (int n = 0; n < 5000;) {
+				const auto f = rng.direction();
+				if (f[2] < std::cos(a)) { continue; }
+				acc.add(sample(f, small, .2));
+				++n;
+			}
+			return acc;
+		};
+		calibration::Correction c;
+		REQUIRE_FALSE(cap(1.).fit(c));
+		REQUIRE(c.offset[2] == 0.);
+		REQUIRE(cap(2.).fit(c));
+		for (int i = 0; i < 3; ++i) { REQUIRE(std::abs(c.offset[i] - small[i]) < .5); }
+
+		// Raio longe de scale: unidades erradas
+		calibration::Accumulator wrong(5. * B);
+		for (int i = 0; i < 300; ++i) { wrong.add(sample(rng.direction(), small, 0.)); }
+		REQUIRE_FALSE(wrong.fit(c));
+	}
+	SECTION("Ruído e deriva") {
+		// Offset muda no meio: com esquecimento o ajuste segue o novo
+		const Vec3 moved({ 5., 0., 30. });
+		calibration::Accumulator all(B), recent(B, .995);
+		for (int i = 0; i < 6000; ++i) {
+			const auto raw = sample(rng.direction(), i < 3000 ? offset : moved, .2);
+			all.add(raw);
+			recent.add(raw);
+		}
+		calibration::Correction c, d;
+		REQUIRE(all.fit(c));
+		REQUIRE(recent.fit(d));
+		REQUIRE(std::abs(c.offset[0] - 10.) < 1.);
+		for (int i = 0; i < 3; ++i) { REQUIRE(std::abs(d.offset[i] - moved[i]) < .5); }
+		REQUIRE(recent.weight() < 201.);
+		double worst = 0.;
+		for (int i = 0; i < 200; ++i) {
+			const auto f = rng.direction();
+			worst = std::max(worst, error(d(sample(f, moved, 0.)), f));
+		}
+		REQUIRE(worst < .5);
+	}
+	SECTION("Calibrador") {
+		for (bool background : { false, true }) {
+			calibration::Calibrator cal(calibration::CalibratorOptions(B, 1., 200, 100, background));
+			const auto f0 = rng.direction();
+			// Antes do primeiro ajuste: só normaliza
+			const auto raw = sample(f0, offset, 0.);
+			REQUIRE(error(cal.update(raw), alglin::normalize(raw)) < 1E-6);
+			int n = 1;
+			for (; n < 2000; ++n) { cal.add(sample(rng.direction(), offset, .1)); }
+			if (!background) { REQUIRE(cal.fits() == 10); }
+			// Resultado do worker chega nas amostras seguintes
+			for (int spins = 0; cal.fits() == 0 && spins < 100000; ++spins) {
+				cal.add(sample(rng.direction(), offset, .1));
+				std::this_thread::yield();
+			}
+			REQUIRE(cal.fits() > 0);
+			const auto f = rng.direction();
+			REQUIRE(error(cal.correct(sample(f, offset, 0.)), f) < .5);
+			REQUIRE(std::abs(cal.correction().offset[2] - offset[2]) < .5);
+		}
+	}
+}
+
+TEST_CASE("Vários veículos") {
+	const Vec3 g({ 0.16, -0.4, -9.4 }), m({ -4., -18., -20. });
+	const fleet::VehicleConfig config(g, m, .6, .4, false);
+	montecarlo::Stream rng(13, 0);
+	// "ax,ay,az,gx,gy,gz,mx,my,mz" de um veículo na atitude q
+	auto format = [&](const Quat &q, char *out, std::size_t size) {
+		const Vec3 a = Quat2DCM(q) * g, b = Quat2DCM(q) * m;
+		return static_cast<std::size_t>(std::snprintf(out, size,
+		  "%.12f,%.12f,%.12f,0,0,0,%.12f,%.12f,%.12f\n", a[0], a[1], a[2], b[0], b[1], b[2]));
+	};
+	constexpr int vehicles = 12, samples = 100;
+	std::vector<std::vector<Quat>> truth(vehicles + 1), solved(vehicles + 1);
+	std::vector<std::vector<std::uint64_t>> numbers(vehicles + 1);
+	// Cada veículo tem um só worker: sem corrida entre os callbacks
+	auto record = [&](fleet::VehicleId v, std::uint64_t n, const Quat &q) {
+		solved[v].push_back(q);
+		numbers[v].push_back(n);
+	};
+
+	SECTION("Arquivo multiplexado") {
+		std::FILE *file = std::tmpfile();
+		char text[256];
+		for (int k = 0; k < samples; ++k) {
+			for (int v = 1; v <= vehicles; ++v) {
+				truth[v].push_back(rng.attitude());
+				std::fprintf(file, "%d,", v);
+				format(truth[v].back(), text, sizeof text);
+				std::fputs(text, file);
+			}
+		}
+		std::fputs("5,1,2\n", file);// campos faltando
+		std::fflush(file);
+		std::rewind(file);
+
+		fleet::Options options(3);
+		options.defaults = config;
+		fleet::Scheduler scheduler(options, record);
+		REQUIRE(scheduler.add_multiplexed_stream(fileno(file)));
+		REQUIRE(scheduler.start());
+		REQUIRE_FALSE(scheduler.add_stream(0, 1));
+		scheduler.wait();
+		std::fclose(file);
+
+		const auto totals = scheduler.totals();
+		REQUIRE(totals.lines == vehicles * samples + 1);
+		REQUIRE(totals.malformed == 1);
+		REQUIRE(totals.dropped == 0);
+		REQUIRE(totals.streams_open == 0);
+		const auto metrics = scheduler.metrics();
+		REQUIRE(metrics.size() == vehicles);
+		for (const auto &x : metrics) {
+			REQUIRE(x.worker == x.vehicle % 3);
+			REQUIRE(x.samples == samples);
+			REQUIRE(x.latency_p50 > 0.);
+			REQUIRE(x.latency_p99 >= x.latency_p50);
+			REQUIRE(x.latency_max >= x.latency_mean);
+		}
+		for (int v = 1; v <= vehicles; ++v) {
+			REQUIRE(solved[v].size() == samples);
+			for (int k = 0; k < samples; ++k) {
+				REQUIRE(numbers[v][k] == static_cast<std::uint64_t>(k + 1));
+				REQUIRE(angle(solved[v][k], truth[v][k]) < 1E-4);
+			}
+		}
+	}
+	SECTION("Ring cheio segura a leitura") {
+		// 1200 linhas num ring de 16 e um worker lento: o arquivo espera
+		std::FILE *file = std::tmpfile();
+		char text[256];
+		for (int k = 0; k < samples; ++k) {
+			for (int v = 1; v <= vehicles; ++v) {
+				truth[v].push_back(rng.attitude());
+				std::fprintf(file, "%d,", v);
+				format(truth[v].back(), text, sizeof text);
+				std::fputs(text, file);
+			}
+		}
+		std::fflush(file);
+		std::rewind(file);
+
+		fleet::Options options(1);
+		options.queue = 16;
+		options.defaults = config;
+		fleet::Scheduler scheduler(options, [&](fleet::VehicleId v, std::uint64_t n, const Quat &q) {
+			if (n % 25 == 0) { std::this_thread::sleep_for(std::chrono::microseconds(200)); }
+			record(v, n, q);
+		});
+		REQUIRE(scheduler.add_multiplexed_stream(fileno(file)));
+		REQUIRE(scheduler.start());
+		scheduler.wait();
+		std::fclose(file);
+
+		const auto totals = scheduler.totals();
+		REQUIRE(totals.lines == vehicles * samples);
+		REQUIRE(totals.dropped == 0);
+		for (int v = 1; v <= vehicles; ++v) {
+			REQUIRE(solved[v].size() == samples);
+			for (int k = 0; k < samples; ++k) {
+				REQUIRE(angle(solved[v][k], truth[v][k]) < 1E-4);
+			}
+		}
+	}
+	SECTION("Pipe e pty") {
+		int pipefd[2];
+		REQUIRE(::pipe(pipefd) == 0);
+		const int master = ::posix_openpt(O_RDWR | O_NOCTTY);
+		REQUIRE(master >= 0);
+		REQUIRE(::grantpt(master) == 0);
+		REQUIRE(::unlockpt(master) == 0);
+		const int slave = ::open(::ptsname(master), O_RDWR | O_NOCTTY);
+		REQUIRE(slave >= 0);
+		termios tio;
+		::tcgetattr(slave, &tio);
+		::cfmakeraw(&tio);
+		::tcsetattr(slave, TCSANOW, &tio);
+
+		fleet::Options options(2);
+		fleet::Scheduler scheduler(options, record);
+		scheduler.configure(7, config);
+		scheduler.configure(8, config);
+		REQUIRE(scheduler.add_stream(pipefd[0], 7));
+		REQUIRE(scheduler.add_stream(slave, 8));
+		REQUIRE(scheduler.totals().streams_open == 2);
+		REQUIRE(scheduler.start());
+		char text[256];
+		for (int k = 0; k < samples; ++k) {
+			for (int v : { 7, 8 }) {
+				truth[v].push_back(rng.attitude());
+				const auto n = format(truth[v].back(), text, sizeof text);
+				REQUIRE(::write(v == 7 ? pipefd[1] : master, text, n) == static_cast<ssize_t>(n));
+			}
+			if (k % 8 == 0) { std::this_thread::sleep_for(std::chrono::milliseconds(1)); }
+		}
+		// Espera o pty esvaziar antes de fechar o mestre
+		for (int spins = 0; spins < 2000 && scheduler.totals().lines < 2 * samples; ++spins) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		::close(pipefd[1]);
+		::close(master);
+		scheduler.wait();
+		::close(pipefd[0]);
+		::close(slave);
+
+		const auto totals = scheduler.totals();
+		REQUIRE(totals.lines == 2 * samples);
+		REQUIRE(totals.dropped == 0);
+		for (int v : { 7, 8 }) {
+			REQUIRE(solved[v].size() == samples);
+			for (int k = 0; k < samples; ++k) {
+				REQUIRE(angle(solved[v][k], truth[v][k]) < 1E-4);
+			}
+		}
+	}
+}
+
+TEST_CASE("Pior caso de tempo") {
+	wcet::Options options(700, 3);
+	options.search_steps = 200;
+	options.worst = 4;
+	const auto p = wcet::profile(options);
+
+	SECTION("Distribuição") {
+		REQUIRE(p.inputs == 900);
+		std::uint64_t n = 0;
+		for (const auto bin : p.histogram) { n += bin; }
+		REQUIRE(n == p.inputs);
+		REQUIRE(static_cast<double>(p.min) <= p.mean);
+		REQUIRE(p.mean <= static_cast<double>(p.max));
+		REQUIRE(p.percentile(.5) <= p.percentile(.99));
+		REQUIRE(p.percentile(1.) == static_cast<double>(p.max));
+		// Toda geometria gerada foi medida
+		for (int g = 0; g + 1 < wcet::geometries; ++g) {
+			REQUIRE(p.max_by_geometry[static_cast<std::size_t>(g)] > 0);
+		}
+	}
+
+	SECTION("Piores entradas") {
+		REQUIRE(p.worst.size() == 4);
+		REQUIRE(p.worst.front().ticks == p.max);
+		for (std::size_t i = 1; i < p.worst.size(); ++i) {
+			REQUIRE(p.worst[i - 1].ticks >= p.worst[i].ticks);
+		}
+		for (const auto &c : p.worst) {
+			REQUIRE(c.sensors.size() == 2);
+			const auto text = wcet::to_cpp(c);
+			REQUIRE(text.find(wcet::name(c.geometry)) != std::string::npos);
+			REQUIRE(text.find("attdet::Sensor(") != text.rfind("attdet::Sensor("));
+		}
+		wcet::Case c{ wcet::Geometry::NonFinite, 1, { Sensor() }, Quat{} };
+		c.sensors[0].measure[1] = std::numeric_limits<double>::quiet_NaN();
+		c.sensors[0].weight = -std::numeric_limits<double>::infinity();
+		const auto text = wcet::to_cpp(c);
+		REQUIRE(text.find("Vec3({ 0, std::numeric_limits<double>::quiet_NaN(), 0 })")
+				!= std::string::npos);
+		REQUIRE(text.find("-std::numeric_limits<double>::infinity()") != std::string::npos);
+	}
+
+	SECTION("Casos de regressão") {
+		// Mais lento do attdet-wcet: measure subnormal (~2x o tempo típico)
+		const std::vector<Sensor> subnormal{
+			Sensor(Vec3({ -0.53874001232382762, 0.52957980782603054, 0.65521326777185052 }),
+			  Vec3({ -0.012280555508288705, 0.6691498117892809, -0.74302605427991408 }),
+			  0.82217974182609277),
+			Sensor(Vec3({ -3.7530237801599765e-311, -8.4857149981292435e-312,
+					 -9.2300996156737069e-311 }),
+			  Vec3({ -0.22658942790549705, -0.94311128598226035, -0.24330707637540372 }),
+			  1.0206478197334465),
+		};
+		const Quat q = quest(subnormal.data(), subnormal.data() + subnormal.size());
+		REQUIRE(std::isfinite(q * q));
+		REQUIRE(std::abs(q * q - 1.) < 1E-12);
+
+		// 180 graus exatos em torno de X: três dos quatro referenciais são singulares
+		const Quat truth({ 1., 0., 0., 0. });
+		const Matrix3 A = Quat2DCM(truth);
+		const Vec3 r1({ .6, .8, 0. }), r2({ 0., .6, .8 });
+		const Quat q180 = quest({ Sensor(A * r1, r1, .5), Sensor(A * r2, r2, .5) });
+		REQUIRE(angle(q180, truth) < 1E-4);
+	}
+}
+
 TEST_CASE("Block Matrix Construction") {
 	Vec3 a({ 1., 3., 4. });
 	Vec3 b({ 0., 0., 0. });
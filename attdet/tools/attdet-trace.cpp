@@ -0,0 +1,24 @@
+/**
+ * @file attdet-trace.cpp
+ * @brief Decodifica um dump de attdet::trace::dump(): attdet-trace [arquivo]
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#include <attdet/trace.h>
+#include <cstdio>
+
+int main(int argc, char **argv) {
+	std::FILE *in = (argc > 1) ? std::fopen(argv[1], "rb") : stdin;
+	if (in == nullptr) {
+		std::perror(argv[1]);
+		return 1;
+	}
+	const long count = attdet::trace::decode(in, stdout);
+	if (in != stdin) { std::fclose(in); }
+	if (count < 0) {
+		std::fprintf(stderr, "not an attdet trace dump\n");
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,36 @@
+/**
+ * @file attdet-wcet.cpp
+ * @brief Pior caso de tempo do quest: attdet-wcet [entradas [sensores [semente]]]
+ *
+ * Imprime a distribuição de ticks por entrada, o pior por geometria e as
+ * entradas mais lentas como C++, prontas para um teste de regressão.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#include <attdet/wcet.h>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace attdet;
+
+int main(int argc, char **argv) {
+	wcet::Options options((argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 100000);
+	if (argc > 2) { options.sensors = std::strtoul(argv[2], nullptr, 10); }
+	if (argc > 3) { options.seed = std::strtoull(argv[3], nullptr, 10); }
+	options.worst = 8;
+	const auto p = wcet::profile(options);
+
+	std::printf("inputs %llu, sensors %zu, timer overhead %llu ticks\n",
+	  static_cast<unsigned long long>(p.inputs), options.sensors,
+	  static_cast<unsigned long long>(p.overhead));
+	std::printf("min %llu  mean %.1f  p50 %.0f  p99 %.0f  p99.99 %.0f  max %llu\n",
+	  static_cast<unsigned long long>(p.min), p.mean, p.percentile(.5), p.percentile(.99),
+	  p.percentile(.9999), static_cast<unsigned long long>(p.max));
+	for (int g = 0; g < wcet::geometries; ++g) {
+		std::printf("  %-14s max %llu\n", wcet::name(static_cast<wcet::Geometry>(g)),
+		  static_cast<unsigned long long>(p.max_by_geometry[static_cast<std::size_t>(g)]));
+	}
+	for (const auto &c : p.worst) { std::printf("%s\n", wcet::to_cpp(c).c_str()); }
+	return 0;
+}
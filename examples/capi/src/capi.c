@@ -0,0 +1,39 @@
+/*
+ * QUEST pela interface C (attdet/attdet_c.h): entradas e saídas em arrays
+ * do chamador, sem alocação.
+ */
+#include <attdet/attdet_c.h>
+#include <stdio.h>
+
+#define SAMPLES 2
+
+int main(void) {
+	/* Duas amostras de dois sensores cada, em sequência */
+	const attdet_sensor sensors[2 * SAMPLES] = {
+		{ { 0.925417, -0.163176, -0.342020 }, { 1., 0., 0. }, .5 },
+		{ { -0.37852, -0.440970, -0.813798 }, { 0., 0., -1. }, .5 },
+		/* Sem peso: a amostra falha sozinha e o lote continua */
+		{ { 1., 0., 0. }, { 1., 0., 0. }, 0. },
+		{ { 0., 0., -1. }, { 0., 0., -1. }, 0. },
+	};
+	attdet_quat q[SAMPLES];
+	attdet_status status[SAMPLES];
+	attdet_vec3 euler;
+	int i;
+
+	if (attdet_abi_version() != ATTDET_C_ABI_VERSION) {
+		fprintf(stderr, "attdet ABI mismatch\n");
+		return 1;
+	}
+	attdet_quest_batch(sensors, 2, SAMPLES, q, status);
+	for (i = 0; i < SAMPLES; ++i) {
+		if (status[i] != ATTDET_OK) {
+			printf("%d: %s\n", i, attdet_status_string(status[i]));
+			continue;
+		}
+		attdet_quat_to_euler(&q[i], &euler);
+		printf("%d: q = %.6f %.6f %.6f %.6f\tangles = %.4f %.4f %.4f\n", i,
+		  q[i].x, q[i].y, q[i].z, q[i].w, euler.x, euler.y, euler.z);
+	}
+	return 0;
+}
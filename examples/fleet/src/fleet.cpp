@@ -0,0 +1,92 @@
+/*
+ * Estação de solo com vários veículos: cada fonte é uma porta serial, pty,
+ * pipe ou arquivo com linhas "ax,ay,az,gx,gy,gz,mx,my,mz".
+ *
+ *   fleet [-w workers] id=caminho ... [mux=caminho ...]
+ *
+ * "mux=" lê linhas "id,ax,...,mz" de vários veículos na mesma fonte. As
+ * métricas por veículo saem a cada 5 s, até todas as fontes fecharem.
+ */
+#include <attdet/fleet.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <string>
+#include <termios.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace attdet;
+
+namespace {
+int open_source(const char *path) {
+	const int fd = ::open(path, O_RDONLY | O_NOCTTY);
+	if (fd >= 0 && ::isatty(fd)) {
+		termios tio{};
+		::tcgetattr(fd, &tio);
+		::cfmakeraw(&tio);
+		::cfsetispeed(&tio, B115200);
+		::tcsetattr(fd, TCSANOW, &tio);
+	}
+	return fd;
+}
+
+void report(const fleet::Scheduler &scheduler) {
+	const auto t = scheduler.totals();
+	std::printf("lines %llu, malformed %llu, dropped %llu, streams open %llu\n",
+	  static_cast<unsigned long long>(t.lines), static_cast<unsigned long long>(t.malformed),
+	  static_cast<unsigned long long>(t.dropped), static_cast<unsigned long long>(t.streams_open));
+	std::printf("%8s %6s %10s %10s %10s %10s %10s\n", "vehicle", "worker", "samples",
+	  "rate (Hz)", "p50 (us)", "p99 (us)", "max (us)");
+	for (const auto &m : scheduler.metrics()) {
+		std::printf("%8u %6u %10llu %10.1f %10.1f %10.1f %10.1f\n", m.vehicle, m.worker,
+		  static_cast<unsigned long long>(m.samples), m.rate, m.latency_p50 / 1E3,
+		  m.latency_p99 / 1E3, m.latency_max / 1E3);
+	}
+}
+}// namespace
+
+int main(int argc, char **argv) {
+	fleet::Options options(0);
+	int first = 1;
+	if (argc > 2 && std::strcmp(argv[1], "-w") == 0) {
+		options.workers = static_cast<unsigned>(std::atoi(argv[2]));
+		first = 3;
+	}
+	// Referências das demos serial e websocket
+	options.defaults =
+	  fleet::VehicleConfig(Vec3({ 0.16, -0.4, -9.4 }), Vec3({ -4., -18., -20. }));
+	fleet::Scheduler scheduler(options);
+	std::vector<int> fds;
+	for (int i = first; i < argc; ++i) {
+		const char *eq = std::strchr(argv[i], '=');
+		if (eq == nullptr) {
+			std::fprintf(stderr, "usage: fleet [-w workers] id=path ... [mux=path ...]\n");
+			return 1;
+		}
+		const std::string key(argv[i], static_cast<std::size_t>(eq - argv[i]));
+		const int fd = open_source(eq + 1);
+		if (fd < 0) {
+			std::perror(eq + 1);
+			return 1;
+		}
+		fds.push_back(fd);
+		if (key == "mux") {
+			scheduler.add_multiplexed_stream(fd);
+		} else {
+			scheduler.add_stream(fd, static_cast<fleet::VehicleId>(std::strtoul(key.c_str(), nullptr, 10)));
+		}
+	}
+	scheduler.start();
+	while (scheduler.totals().streams_open > 0) {
+		for (int k = 0; k < 50 && scheduler.totals().streams_open > 0; ++k) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		}
+		report(scheduler);
+	}
+	scheduler.wait();
+	for (int fd : fds) { ::close(fd); }
+}
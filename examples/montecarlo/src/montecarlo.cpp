@@ -0,0 +1,34 @@
+/*
+ * Dimensionamento de sensores por Monte-Carlo: sensor solar + magnetômetro,
+ * varrendo o ruído do sensor solar.
+ *
+ *   montecarlo [ensaios por ponto = 1000000] [threads = todas]
+ */
+#include <attdet/montecarlo.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace attdet::montecarlo;
+
+int main(int argc, char **argv) {
+	constexpr double deg = 3.141592653589793 / 180.;
+	Options options(argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000);
+	options.threads = argc > 2 ? static_cast<unsigned>(std::atoi(argv[2])) : 0;
+
+	const Vec3 sun({ 0.3, 0.5, 0.81 });
+	const Vec3 field({ 0.2, -0.1, 0.97 });// ~30 graus entre os dois
+	std::printf("%10s %10s %10s %10s %10s %12s\n", "sun (deg)", "mean", "rms",
+	  "p99", "max", "trials/s");
+	for (double sigma : { 0.05, 0.1, 0.2, 0.5, 1., 2. }) {
+		const std::vector<SensorModel> suite = { SensorModel(sigma * deg, sun),
+			SensorModel(1. * deg, field) };
+		const auto start = std::chrono::steady_clock::now();
+		const auto stats = run(suite, options);
+		const std::chrono::duration<double> elapsed =
+		  std::chrono::steady_clock::now() - start;
+		std::printf("%10.2f %10.4f %10.4f %10.4f %10.4f %12.0f\n", sigma,
+		  stats.mean() / deg, stats.rms() / deg, stats.percentile(.99) / deg,
+		  stats.max / deg, static_cast<double>(stats.trials) / elapsed.count());
+	}
+}
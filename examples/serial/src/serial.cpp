@@ -1,13 +1,16 @@
 #include "serial.h"
+#include <attdet/alloc.h>
+#include <attdet/calibration.h>
+#include <attdet/io.h>
+#include <cmath>
 #include <cstdlib>
 #include <fcntl.h>
 #include <iomanip>
-#include <regex>
+#include <iterator>
 #include <stdio.h>
 #include <string.h>
 #include <termios.h>
 #include <unistd.h>
-#include <vector>
 
 enum class baud { b9600 = B9600, b115200 = B115200 };
 template<int B = 255> struct SerialRead {
@@ -60,8 +63,8 @@ template<int B = 255> struct SerialRead {
 	}
 
 	char *readline() {
-		int res = read(fd, this->buffer, B);
-		this->buffer[res] = 0;
+		auto res = read(fd, this->buffer, B - 1);
+		this->buffer[res > 0 ? res : 0] = 0;
 		return this->buffer;
 	}
 
@@ -75,44 +78,59 @@ template<int B = 255> struct SerialRead {
 using namespace attdet;
 
 int main() {
-
-	const std::regex data_regex(
-	  "([\\-]?[\\d]+\\.[\\d]+),([\\-]?[\\d]+\\.[\\d]+),([\\-]?[\\d]+\\.[\\d]+),"
-	  "([\\-]?[\\d]+\\.[\\d]+),([\\-]?[\\d]+\\.[\\d]+),([\\-]?[\\d]+\\.[\\d]+),"
-	  "([\\-]?[\\d]+\\.[\\d]+),([\\-]?[\\d]+\\.[\\d]+),([\\-]?[\\d]+\\.[\\d]+)."
-	  "\\D");
 	std::cout << std::fixed << std::setprecision(8);
 
 	const Vec3 m_ref({ -4., -18., -20. });
 	const Vec3 a_ref({ 0.16, -0.4, -9.4 });
 
-	auto mag_sensor = Sensor({ 0., 1., 0. }, alglin::normalize(m_ref), .40);
-	auto acc_sensor = Sensor({ 0., 1., 0. }, alglin::normalize(a_ref), .60);
+	// Atualizados no lugar a cada amostra; quest() usa a forma fechada de 2
+	SensorSet<2> sensors = { { Sensor({ 0., 1., 0. }, alglin::normalize(a_ref), .60),
+	  Sensor({ 0., 1., 0. }, alglin::normalize(m_ref), .40) } };
+	auto &acc_sensor = sensors[0];
+	auto &mag_sensor = sensors[1];
+	// Hard/soft iron ajustado durante o voo, fora da thread de leitura
+	calibration::Calibrator mag_calibration(
+	  calibration::CalibratorOptions(std::sqrt(m_ref * m_ref), .9995));
+
+#if ATTDET_COUNT_ALLOCATIONS
+	alloc::StageStats stages[] = { { "read", 0, 0, 0 }, { "parse", 0, 0, 0 },
+		{ "quest", 0, 0, 0 }, { "print", 0, 0, 0 } };
+#define STAGE(i) alloc::Stage stage_##i(stages[i])
+#else
+#define STAGE(i)
+#endif
 
 	SerialRead<255> serial("/dev/ttyUSB0", baud::b115200);
-	while (true) {
-		auto line = std::string{ serial.readline() };
-		std::smatch s_data;
-
-		if (std::regex_match(line, s_data, data_regex)) {
-			std::vector<float> data{};
-			std::for_each(s_data.begin() + 1,
-			  s_data.end(),
-			  [&data](decltype(*s_data.begin()) x) {
-				  float f = std::atof(x.str().c_str());
-				  data.push_back(f);
-			  });
-
+	// ax,ay,az,gx,gy,gz,mx,my,mz
+	double data[9];
+	for (unsigned long n = 1;; ++n) {
+		const char *line;
+		{
+			STAGE(0);
+			line = serial.readline();
+		}
+		{
+			STAGE(1);
+			if (io::parse_csv(line, data, 9) != 9) { continue; }
 			acc_sensor.measure =
 			  alglin::normalize(Vec3({ data[0], data[1], data[2] }));
 			mag_sensor.measure =
-			  alglin::normalize(Vec3({ data[6], data[7], data[8] }));
-
-			auto q = quest({ acc_sensor, mag_sensor });
+			  mag_calibration.update(Vec3({ data[6], data[7], data[8] }));
+		}
+		Quat q;
+		{
+			STAGE(2);
+			q = quest(sensors);
+		}
+		{
+			STAGE(3);
 			std::cout << "Acc: " << acc_sensor.measure;
 			std::cout << "Mag: " << mag_sensor.measure;
 			std::cout << "Quaternion: " << q;
 			std::cout << "Euler: " << Quat2Euler(q);
 		}
+#if ATTDET_COUNT_ALLOCATIONS
+		if (n % 1000 == 0) { alloc::report(std::begin(stages), std::end(stages)); }
+#endif
 	}
 }
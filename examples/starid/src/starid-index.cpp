@@ -0,0 +1,49 @@
+#include <attdet/starid.h>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+/**
+ * Gera o índice k-vector de um catálogo, fora de voo.
+ * Catálogo em CSV: id,ascensão reta (graus),declinação (graus)
+ *
+ *   starid-index hipparcos.csv catalog.kvec 20
+ *
+ * O arquivo gerado é carregado com attdet::starid::StarIndex::load().
+ */
+int main(int argc, char **argv) {
+	using namespace attdet::starid;
+	if (argc != 4) {
+		std::cerr << "usage: " << argv[0] << " catalog.csv index.kvec fov_deg\n";
+		return 1;
+	}
+	constexpr double deg = 3.141592653589793 / 180.;
+	std::ifstream csv(argv[1]);
+	if (!csv) {
+		std::cerr << "cannot open " << argv[1] << '\n';
+		return 1;
+	}
+	std::vector<CatalogStar> catalog;
+	std::string line;
+	while (std::getline(csv, line)) {
+		std::istringstream row(line);
+		std::uint32_t id{};
+		double ra{};
+		double dec{};
+		char sep{};
+		if (!(row >> id >> sep >> ra >> sep >> dec)) { continue; }
+		catalog.push_back({ id,
+		  Vec3({ std::cos(dec * deg) * std::cos(ra * deg),
+			std::cos(dec * deg) * std::sin(ra * deg),
+			std::sin(dec * deg) }) });
+	}
+
+	const auto index = StarIndex::build(catalog, std::atof(argv[3]) * deg);
+	if (!index.save(argv[2])) {
+		std::cerr << "cannot write " << argv[2] << '\n';
+		return 1;
+	}
+	std::cout << index.stars() << " stars, " << index.pairs() << " pairs\n";
+}
@@ -0,0 +1,84 @@
+#if !defined(_BROADCAST_H_)
+#define _BROADCAST_H_
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+
+/**
+ * One writer, any number of readers: the writer publishes numbered frames
+ * into a ring of Slots slots and never waits for anyone. Each reader keeps
+ * its own cursor (next frame number) and reads at its own pace; a reader
+ * more than Slots frames behind finds its frame overwritten (read() returns
+ * false) and is considered lost.
+ *
+ * Each slot is a seqlock: seq is odd while the writer fills it and 2n + 2
+ * once it holds frame n, so a read racing an overwrite is detected.
+ */
+template<std::size_t Slots = 1024, std::size_t Bytes = 96> class Broadcast {
+	static_assert((Slots & (Slots - 1)) == 0, "Slots must be a power of two");
+
+  public:
+	static constexpr std::size_t slots = Slots;
+	static constexpr std::size_t bytes = Bytes;
+
+	void publish(const char *data, std::size_t size) {
+		const auto n = head_.load(std::memory_order_relaxed);
+		Slot &slot = ring_[n & (Slots - 1)];
+		slot.seq.store(2 * n + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		slot.size = size < Bytes ? size : Bytes;
+		std::memcpy(slot.data, data, slot.size);
+		slot.seq.store(2 * n + 2, std::memory_order_release);
+		head_.store(n + 1, std::memory_order_release);
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+		}
+		published_.notify_all();
+	}
+
+	// Number of the next frame to be published (= frames published so far)
+	std::uint64_t head() const { return head_.load(std::memory_order_acquire); }
+
+	/**
+	 * @brief Copies frame n into out (at least Bytes long)
+	 * @return false if frame n was overwritten or is not published yet
+	 */
+	bool read(std::uint64_t n, char *out, std::size_t &size) const {
+		const Slot &slot = ring_[n & (Slots - 1)];
+		const auto before = slot.seq.load(std::memory_order_acquire);
+		if (before != 2 * n + 2) { return false; }
+		size = slot.size;
+		std::memcpy(out, slot.data, size < Bytes ? size : Bytes);
+		std::atomic_thread_fence(std::memory_order_acquire);
+		return slot.seq.load(std::memory_order_relaxed) == before;
+	}
+
+	// Blocks until head() > seen or timeout; returns head()
+	template<class Rep, class Period>
+	std::uint64_t wait(std::uint64_t seen, std::chrono::duration<Rep, Period> timeout) {
+		std::unique_lock<std::mutex> lock(mutex_);
+		published_.wait_for(lock, timeout, [&]() { return head() > seen; });
+		return head();
+	}
+
+  private:
+	struct Slot {
+		std::atomic<std::uint64_t> seq{ 0 };
+		std::size_t size = 0;
+		char data[Bytes];
+	};
+	std::array<Slot, Slots> ring_{};
+	std::atomic<std::uint64_t> head_{ 0 };
+	std::mutex mutex_;
+	std::condition_variable published_;
+};
+
+template<std::size_t S, std::size_t B> constexpr std::size_t Broadcast<S, B>::slots;
+template<std::size_t S, std::size_t B> constexpr std::size_t Broadcast<S, B>::bytes;
+
+#endif// _BROADCAST_H_
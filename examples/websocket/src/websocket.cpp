@@ -15,33 +15,35 @@
 #include "Poco/Net/HTTPServerParams.h"
 #include "Poco/Net/HTTPServerRequest.h"
 #include "Poco/Net/HTTPServerResponse.h"
+#include "Poco/Net/PollSet.h"
 #include "Poco/Net/ServerSocket.h"
 #include "Poco/Util/ServerApplication.h"
 #include "alglin/alglin.hpp"
 #include "attdet/attdet.h"
+#include "attdet/calibration.h"
+#include "attdet/io.h"
+#include "attdet/shm.h"
+#include "broadcast.h"
 #include <algorithm>
+#include <atomic>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 #include <cstdlib>
 #include <fcntl.h>
 #include <iomanip>
-#include <regex>
-#include <sstream>
+#include <poll.h>
 #include <stdio.h>
 #include <string.h>
 #include <termios.h>
 #include <unistd.h>
 
-#define REGEX_STR                                                       \
-	"([\\-]?[\\d]+\\.[\\d]+),([\\-]?[\\d]+\\.[\\d]+),([\\-]?[\\d]+\\.[" \
-	"\\d]+),"                                                           \
-	"([\\-]?[\\d]+\\.[\\d]+),([\\-]?[\\d]+\\.[\\d]+),([\\-]?[\\d]+\\.[" \
-	"\\d]+),"                                                           \
-	"([\\-]?[\\d]+\\.[\\d]+),([\\-]?[\\d]+\\.[\\d]+),([\\-]?[\\d]+\\.[" \
-	"\\d]+)."                                                           \
-	"\\D"
-
-
 using Poco::Net::WebSocket;
 using Poco::Net::HTTPRequestHandler;
 using Poco::Net::HTTPRequestHandlerFactory;
@@ -49,6 +51,7 @@ using Poco::Net::HTTPServer;
 using Poco::Net::HTTPServerRequest;
 using Poco::Net::HTTPServerResponse;
 using Poco::Net::HTTPServerParams;
+using Poco::Net::PollSet;
 using Poco::Net::ServerSocket;
 
 
@@ -61,10 +64,7 @@ template<int B = 255> struct SerialRead {
 	SerialRead(const std::string &port, baud baudrate) {
 		termios newtio;
 		fd = open(port.c_str(), O_RDONLY | O_NOCTTY);
-		if (fd < 0) {
-			std::cerr << "Failed to open Serial Port\r\n";
-			throw;
-		}
+		if (fd < 0) { throw std::runtime_error("Failed to open Serial Port " + port); }
 		tcgetattr(fd, &oldtio); /* save current serial port settings */
 		newtio.c_cflag =
 		  static_cast<int>(baudrate) | CRTSCTS | CS8 | CLOCAL | CREAD;
@@ -77,9 +77,15 @@ template<int B = 255> struct SerialRead {
 		tcsetattr(fd, TCSANOW, &newtio);// activate
 	}
 
-	char *readline() {
-		int res = read(fd, this->buffer, B);
-		this->buffer[res] = 0;
+	// timeout_ms >= 0: string vazia se nenhuma linha chegar nesse tempo
+	char *readline(int timeout_ms = -1) {
+		pollfd pending{ fd, POLLIN, 0 };
+		if (timeout_ms >= 0 && poll(&pending, 1, timeout_ms) <= 0) {
+			this->buffer[0] = 0;
+			return this->buffer;
+		}
+		auto res = read(fd, this->buffer, B - 1);
+		this->buffer[res > 0 ? res : 0] = 0;
 		return this->buffer;
 	}
 
@@ -101,87 +107,312 @@ struct PageRequestHandler : public HTTPRequestHandler {
 };
 
 
-/** Contem o loop do socket */
-struct WebSocketRequestHandler : public HTTPRequestHandler {
-	void handleRequest(
-	  HTTPServerRequest &request, HTTPServerResponse &response) override {
-		WebSocket ws(request, response);
-		std::cout << "WebSocket connection established.\n";
-		int flags{ 129 };
-		int n{};
-
-		const std::regex data_regex(REGEX_STR);
-		static std::smatch s_data;
-        
+/** Amostras publicadas: "x,y,z,w\n" de io::format_quat */
+using Frames = Broadcast<1024, 96>;
+
+/**
+ * Um cliente: a conexão já aceita e o próximo quadro que ele deve receber.
+ * lag = head - cursor; passando de max_lag o cliente é descartado.
+ */
+struct Subscriber {
+	WebSocket ws;
+	std::uint64_t cursor;
+	std::uint64_t max_lag;
+	std::string peer;
+};
+
+struct HubStats {
+	std::atomic<std::uint64_t> clients{ 0 };
+	std::atomic<std::uint64_t> frames{ 0 };
+	std::atomic<std::uint64_t> closed{ 0 };
+	std::atomic<std::uint64_t> slow{ 0 };
+	std::atomic<std::uint64_t> max_lag{ 0 };
+};
+
+/**
+ * Envia os quadros de Frames para um grupo de clientes a partir de uma só
+ * thread: cada socket é registrado uma vez num PollSet (epoll no Linux) ao
+ * entrar e retirado ao sair. A cada quadro novo um poll() devolve só os
+ * sockets prontos: escreve nos que cabem (escrita) e lê dos que têm dados
+ * (leitura: close e ping do cliente). Nada bloqueia por um cliente lento;
+ * ele só acumula lag até ser descartado.
+ */
+class Shard {
+  public:
+	Shard(Frames &frames, HubStats &stats) : frames_(frames), stats_(stats) {}
+
+	void subscribe(Subscriber subscriber) {
+		std::lock_guard<std::mutex> lock(mutex_);
+		incoming_.push_back(std::move(subscriber));
+		++size_;
+	}
+
+	std::size_t size() const { return size_; }
+
+	void run(const std::atomic<bool> &running) {
+		std::uint64_t seen = frames_.head();
+		std::vector<Subscriber> clients;
+		// Registro persistente: socket -> posição em clients, mantido por remove()
+		std::unordered_map<poco_socket_t, std::size_t> index;
+		PollSet sockets;
+		char frame[Frames::bytes];
+		while (running) {
+			seen = frames_.wait(seen, std::chrono::milliseconds(100));
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				for (auto &s : incoming_) {
+					s.cursor = seen;// começa pela próxima amostra
+					index[s.ws.impl()->sockfd()] = clients.size();
+					sockets.add(s.ws, PollSet::POLL_READ | PollSet::POLL_WRITE | PollSet::POLL_ERROR);
+					clients.push_back(std::move(s));
+				}
+				incoming_.clear();
+			}
+			if (clients.empty()) { continue; }
+
+			std::vector<bool> drop(clients.size(), false);
+			for (const auto &ready : sockets.poll(Poco::Timespan(0))) {
+				const auto i = index[ready.first.impl()->sockfd()];
+				auto &c = clients[i];
+				if ((ready.second & PollSet::POLL_ERROR)
+					|| ((ready.second & PollSet::POLL_READ) && !receive(c))) {
+					drop[i] = true;
+					++stats_.closed;
+					continue;
+				}
+				if (!(ready.second & PollSet::POLL_WRITE)) { continue; }
+				try {
+					// No máximo um lote por rodada, para não monopolizar a thread
+					for (int k = 0; k < 64 && c.cursor < seen; ++k, ++c.cursor) {
+						std::size_t size{};
+						if (!frames_.read(c.cursor, frame, size)) { break; }
+						c.ws.sendFrame(frame, static_cast<int>(size));
+						++stats_.frames;
+					}
+				} catch (const Poco::Exception &) {
+					drop[i] = true;
+					++stats_.closed;
+				}
+			}
+			for (std::size_t i = 0; i < clients.size(); ++i) {
+				const auto lag = seen - clients[i].cursor;
+				if (!drop[i] && lag > clients[i].max_lag) {
+					drop[i] = true;
+					++stats_.slow;
+				}
+				if (!drop[i]) {
+					auto max = stats_.max_lag.load();
+					while (lag > max && !stats_.max_lag.compare_exchange_weak(max, lag)) {}
+				}
+			}
+			remove(clients, drop, index, sockets);
+		}
+	}
+
+  private:
+	// Quadros do cliente: responde ping, false em close ou erro
+	static bool receive(Subscriber &c) {
+		char buffer[128];
+		int flags{};
+		try {
+			const int n = c.ws.receiveFrame(buffer, sizeof buffer, flags);
+			const int op = flags & WebSocket::FRAME_OP_BITMASK;
+			if (n <= 0 || op == WebSocket::FRAME_OP_CLOSE) { return false; }
+			if (op == WebSocket::FRAME_OP_PING) {
+				c.ws.sendFrame(buffer, n, WebSocket::FRAME_FLAG_FIN | WebSocket::FRAME_OP_PONG);
+			}
+			return true;
+		} catch (const Poco::Exception &) { return false; }
+	}
+
+	void remove(std::vector<Subscriber> &clients,
+	  const std::vector<bool> &drop,
+	  std::unordered_map<poco_socket_t, std::size_t> &index,
+	  PollSet &sockets) {
+		std::size_t kept = 0;
+		for (std::size_t i = 0; i < clients.size(); ++i) {
+			if (drop[i]) {
+				std::cout << "WebSocket connection closed: " << clients[i].peer << '\n';
+				index.erase(clients[i].ws.impl()->sockfd());
+				sockets.remove(clients[i].ws);
+				try {
+					clients[i].ws.shutdown();
+				} catch (const Poco::Exception &) {}
+				clients[i].ws.close();
+				--size_;
+				--stats_.clients;
+			} else {
+				if (kept != i) {
+					clients[kept] = std::move(clients[i]);
+					index[clients[kept].ws.impl()->sockfd()] = kept;
+				}
+				++kept;
+			}
+		}
+		clients.erase(clients.begin() + static_cast<std::ptrdiff_t>(kept), clients.end());
+	}
+
+	Frames &frames_;
+	HubStats &stats_;
+	std::mutex mutex_;
+	std::vector<Subscriber> incoming_;
+	std::atomic<std::size_t> size_{ 0 };
+};
+
+/**
+ * Uma thread de aquisição (porta serial, QUEST) publica em Frames; as
+ * conexões são divididas entre shards, cada um com sua thread de envio.
+ */
+class Hub {
+  public:
+	// Um cliente mais atrasado que o anel nunca alcança: frames_.read falha
+	// e o cursor fica parado. Limitar max_lag a slots garante o descarte.
+	Hub(const std::string &port, unsigned shards, std::uint64_t max_lag)
+	  : max_lag_(std::min<std::uint64_t>(max_lag, Frames::slots)) {
+		for (unsigned i = 0; i < std::max(1u, shards); ++i) {
+			shards_.emplace_back(new Shard(frames_, stats_));
+		}
+		running_ = true;
+		acquisition_ = std::thread(&Hub::acquire, this, port);
+		for (auto &s : shards_) {
+			senders_.emplace_back(&Shard::run, s.get(), std::cref(running_));
+		}
+	}
+
+	~Hub() {
+		running_ = false;
+		acquisition_.join();
+		for (auto &t : senders_) { t.join(); }
+	}
+
+	// Entrega uma conexão aceita ao shard menos ocupado
+	void subscribe(WebSocket ws, const std::string &peer) {
+		ws.setSendTimeout(Poco::Timespan(0, 10000));
+		ws.setReceiveTimeout(Poco::Timespan(0, 10000));
+		auto shard = std::min_element(shards_.begin(), shards_.end(),
+		  [](const std::unique_ptr<Shard> &a, const std::unique_ptr<Shard> &b) {
+			  return a->size() < b->size();
+		  });
+		++stats_.clients;
+		(*shard)->subscribe({ ws, 0, max_lag_, peer });
+	}
+
+	HubStats &stats() { return stats_; }
+
+  private:
+	void acquire(const std::string &port) {
+		using namespace attdet;
 		const Vec3 m_ref({ -4., -18., -20. });
 		const Vec3 a_ref({ 0.16, -0.4, -9.4 });
-		using namespace attdet;
-		auto mag_sensor = Sensor({ 0., 1., 0. }, alglin::normalize(m_ref), .40);
-		auto acc_sensor = Sensor({ 0., 1., 0. }, alglin::normalize(a_ref), .60);
-
-		SerialRead<255> serial("/dev/ttyUSB0", baud::b115200);
-		do {
-
-			while (true) {
-				auto line = std::string{ serial.readline() };
-
-				if (std::regex_match(line, s_data, data_regex)) {
-					std::vector<float> data{};
-					std::for_each(s_data.begin() + 1,
-					  s_data.end(),
-					  [&data](decltype(*s_data.begin()) x) {
-						  float f = std::atof(x.str().c_str());
-						  data.push_back(f);
-					  });
-
-					acc_sensor.measure =
-					  alglin::normalize(Vec3({ data[0], data[1], data[2] }));
-					mag_sensor.measure =
-					  alglin::normalize(Vec3({ data[6], data[7], data[8] }));
-
-					auto q = quest({ acc_sensor, mag_sensor });
-					std::stringstream ss;
-					ss << q[0] << ',' << q[1] << ',' << q[2] << ',' << q[3]
-					   << '\n';
-
-					// std::cout << ss.str();
-					ws.sendFrame(ss.str().c_str(), ss.str().size());
+		Sensor sensors[2] = { Sensor({ 0., 1., 0. }, alglin::normalize(a_ref), .60),
+			Sensor({ 0., 1., 0. }, alglin::normalize(m_ref), .40) };
+		StreamingQuest solver;
+		calibration::Calibrator mag_calibration(
+		  calibration::CalibratorOptions(std::sqrt(m_ref * m_ref), .9995));
+		// Consumidores locais leem a mesma amostra de /dev/shm/attdet
+		auto local = shm::Publisher::create("/attdet");
+		// ax,ay,az,gx,gy,gz,mx,my,mz
+		double data[9];
+		char frame[Frames::bytes];
+		try {
+			SerialRead<255> serial(port, baud::b115200);
+			while (running_) {
+				// Sem timeout o join em ~Hub esperaria a próxima linha da porta
+				if (io::parse_csv(serial.readline(100), data, 9) == 9) {
+					sensors[0].measure = alglin::normalize(Vec3({ data[0], data[1], data[2] }));
+					sensors[1].measure = mag_calibration.update(Vec3({ data[6], data[7], data[8] }));
+					const auto q = solver.update(sensors, sensors + 2);
+					frames_.publish(frame, io::format_quat(q, frame, sizeof frame));
+					const auto now = std::chrono::steady_clock::now().time_since_epoch();
+					local.publish(shm::snapshot(
+					  static_cast<std::uint64_t>(
+						std::chrono::duration_cast<std::chrono::nanoseconds>(now).count()),
+					  q, nullptr, sensors, sensors + 2));
 				}
 			}
-		} while (n > 0
-				 && (flags & WebSocket::FRAME_OP_BITMASK)
-					  != WebSocket::FRAME_OP_CLOSE);
-		std::cout << "WebSocket connection closed.\n";
+		} catch (const std::exception &e) { std::cerr << e.what() << '\n'; }
+	}
+
+	Frames frames_;
+	HubStats stats_;
+	std::uint64_t max_lag_;
+	std::atomic<bool> running_{ false };
+	std::vector<std::unique_ptr<Shard>> shards_;
+	std::thread acquisition_;
+	std::vector<std::thread> senders_;
+};
+
+/** Faz o handshake e entrega a conexão ao Hub; a thread do Poco fica livre */
+struct WebSocketRequestHandler : public HTTPRequestHandler {
+	explicit WebSocketRequestHandler(Hub &hub) : hub_(hub) {}
+	void handleRequest(
+	  HTTPServerRequest &request, HTTPServerResponse &response) override {
+		try {
+			WebSocket ws(request, response);
+			std::cout << "WebSocket connection established.\n";
+			hub_.subscribe(ws, request.clientAddress().toString());
+		} catch (const Poco::Net::WebSocketException &e) {
+			std::cerr << e.displayText() << '\n';
+		}
 	}
+	Hub &hub_;
 };
 
 /** Primeiro a receber o request e checa se é pra usar WebSockets */
 struct RequestHandlerFactory : public HTTPRequestHandlerFactory {
+	explicit RequestHandlerFactory(Hub &hub) : hub_(hub) {}
 	HTTPRequestHandler *createRequestHandler(
 	  const HTTPServerRequest &req) override {
 		std::cout << "Request " << req.clientAddress().toString() << '\n';
 		if (req.find("Upgrade") != req.end()
 			&& Poco::icompare(req["Upgrade"], "websocket") == 0) {
-			return new WebSocketRequestHandler;
+			return new WebSocketRequestHandler(hub_);
 		} else {
 			return new PageRequestHandler;
 		}
 	}
+	Hub &hub_;
 };
 
 
-/** (http://localhost:9980/) */
+/**
+ * (http://localhost:9980/) websocket [porta serial] [shards] [lag máximo]
+ * shards: threads de envio (padrão: núcleos - 1); lag máximo em quadros.
+ */
 struct WebSocketServer : public Poco::Util::ServerApplication {
-	int main(const std::vector<std::string> &) {
+	int main(const std::vector<std::string> &args) {
+		const std::string port = args.size() > 0 ? args[0] : "/dev/ttyUSB0";
+		const unsigned cores = std::thread::hardware_concurrency();
+		const unsigned shards = args.size() > 1
+								  ? static_cast<unsigned>(std::stoul(args[1]))
+								  : std::max(1u, cores > 1 ? cores - 1 : 1u);
+		const std::uint64_t max_lag =
+		  args.size() > 2 ? std::stoull(args[2]) : Frames::slots / 2;
+		Hub hub(port, shards, max_lag);
+
 		ServerSocket socket_server((unsigned short)9980);
+		auto params = new HTTPServerParams;
+		params->setMaxQueued(1024);
 		HTTPServer http_server(
-		  new RequestHandlerFactory, socket_server, new HTTPServerParams);
+		  new RequestHandlerFactory(hub), socket_server, params);
 		http_server.start();
+		std::thread report([this, &hub]() {
+			while (!stop_) {
+				std::this_thread::sleep_for(std::chrono::seconds(5));
+				auto &s = hub.stats();
+				std::cout << "clients " << s.clients << " frames " << s.frames
+						  << " closed " << s.closed << " slow " << s.slow
+						  << " max lag " << s.max_lag.exchange(0) << '\n';
+			}
+		});
 		waitForTerminationRequest();
+		stop_ = true;
+		report.join();
 		http_server.stop();
 
 		return 0;
 	}
+	std::atomic<bool> stop_{ false };
 };
 
 int main(int argc, char **argv) {
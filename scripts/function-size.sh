@@ -0,0 +1,28 @@
+#!/bin/sh
+# .text por função, da maior para a menor, e o total.
+#   function-size.sh <binário ou .a> [baseline]
+# Com baseline (saída anterior deste script), mostra só o que mudou.
+set -e
+[ -n "$1" ] || { echo "usage: $0 <binary> [baseline]" >&2; exit 1; }
+
+report() {
+	nm -S -C --size-sort --radix=d "$1" 2>/dev/null |
+		awk '$3 ~ /^[tTwW]$/ { size = $2 + 0; $1 = $2 = $3 = ""; sub(/^ +/, "");
+			sum[$0] += size } END { for (f in sum) printf "%8d %s\n", sum[f], f }' |
+		sort -rn
+}
+
+current=$(report "$1")
+echo "$current"
+echo "$current" | awk '{ t += $1 } END { printf "%8d TOTAL\n", t }'
+
+if [ -n "$2" ] && [ -f "$2" ]; then
+	echo "--- changes against $2"
+	echo "$current" | awk 'NR == FNR { size = $1; $1 = ""; sub(/^ +/, ""); old[$0] = size; next }
+		{ size = $1; $1 = ""; sub(/^ +/, ""); new[$0] = size }
+		END {
+			for (f in new) if (!(f in old)) printf "%+8d %s (new)\n", new[f], f
+			for (f in old) if (!(f in new)) printf "%+8d %s (removed)\n", -old[f], f
+			for (f in new) if ((f in old) && new[f] != old[f]) printf "%+8d %s\n", new[f] - old[f], f
+		}' "$2" - | sort -k1,1nr
+fi